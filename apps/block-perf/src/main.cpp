@@ -1,7 +1,9 @@
 #include <api/block_itf.h>
 #include <api/components.h>
 #include <common/assert.h>
+#include <common/cycles.h>
 #include <common/exceptions.h>
+#include <common/hdr_histogram.h>
 #include <common/rand.h>
 #include <common/spsc_bounded_queue.h>
 #include <common/utils.h>
@@ -14,26 +16,29 @@
 #include <libpmempool.h>
 #include <spdk/env.h>
 #include <stdio.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
 #include <boost/program_options.hpp>
+#include <atomic>
+#include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <iostream>
 
 using namespace std;
 
-enum {
-  WORKLOAD_RAND_READ = 1,
-  WORKLOAD_RAND_WRITE = 2,
-  WORKLOAD_RW = 5,
-};
-
 struct {
   unsigned n_client_threads;
   unsigned n_io_threads = 1;
-  unsigned chunk_size_in_block = 8;
-  int workload = WORKLOAD_RAND_READ;
+  unsigned chunk_size_in_block = 8; /*< current point of the I/O size sweep */
+  unsigned queue_depth = 32;        /*< current point of the queue depth sweep */
+  unsigned read_pct = 100;
+  unsigned rate = 0;                /*< per-thread IOPS in open-loop mode, 0 = closed loop */
 } Options;
 
+static constexpr unsigned MAX_QUEUE_DEPTH = 1024;
+
 #define START_IO_CORE 2
 #define START_CLIENT_CORE 6
 
@@ -107,6 +112,9 @@ public:
     _phys_base = spdk_vtophys(_base);
   }
 
+  /* release all allocations; used between sweep points */
+  void reset() { _offset = 0; }
+
   ~Pmem_allocator() {
     pmem_unmap(_base, _len);
   }
@@ -131,11 +139,30 @@ private:
 
 Pmem_allocator* g_pmem_allocator = nullptr;
 
+enum {
+  LAT_READ = 0,
+  LAT_WRITE = 1,
+};
+
+/** 
+ * Results of one client thread for one sweep point
+ * 
+ */
+struct Task_result {
+  unsigned     core;
+  unsigned     device; /*< index into Main::block_v */
+  double       secs;
+  HdrHistogram latency[2]; /*< completion latency in ns, LAT_READ/LAT_WRITE */
+};
+
 class Main {
 public:
   Main(const vector<string>& pci_id_vector,
        const std::string& pmem_path,
-       unsigned duration);
+       unsigned duration,
+       const vector<unsigned>& qd_sweep,
+       const vector<unsigned>& bs_sweep,
+       const std::string& json_path);
   
   ~Main();
 
@@ -144,18 +171,34 @@ public:
   const vector<Component::IBlock_device*>& block_v() const { return _block_v; }
   const std::string pmem_path() const { return _pmem_path; }
   const unsigned duration() const { return _duration; }
+
+  /* called by each IO_task as it finishes */
+  void add_result(Task_result * result);
   
 private:
   void create_block_components(const vector<string>& vs);
+  void report_point(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer);
 
   vector<Component::IBlock_device*> _block_v;
+  vector<string>                    _pci_id_v;
   Core::Poller*                     _io_poller;
   std::string                       _pmem_path;
   unsigned                          _duration;
+  vector<unsigned>                  _qd_sweep;
+  vector<unsigned>                  _bs_sweep;
+  std::string                       _json_path;
+  std::mutex                        _results_lock;
+  vector<Task_result*>              _results;
 };
 
-Main::Main(const vector<string>& pci_id_vector, const std::string& pmem_path, unsigned duration)
-  : _pmem_path(pmem_path), _duration(duration) {
+Main::Main(const vector<string>& pci_id_vector,
+           const std::string& pmem_path,
+           unsigned duration,
+           const vector<unsigned>& qd_sweep,
+           const vector<unsigned>& bs_sweep,
+           const std::string& json_path)
+  : _pci_id_v(pci_id_vector), _pmem_path(pmem_path), _duration(duration),
+    _qd_sweep(qd_sweep), _bs_sweep(bs_sweep), _json_path(json_path) {
   create_block_components(pci_id_vector);
 }
 
@@ -179,11 +222,16 @@ int main(int argc, char* argv[]) {
       ("pci", po::value<vector<string>>(), "PCIe id for NVMe drive")
       ("threads", po::value<int>(), "# client threads")
       ("chunk_size_in_block", po::value<int>(), "# how many blocks to submit in one async call")
+      ("bs", po::value<vector<unsigned>>()->multitoken(), "I/O sizes in blocks to sweep (default chunk_size_in_block)")
+      ("qd", po::value<vector<unsigned>>()->multitoken(), "Per-thread queue depths to sweep (default 32)")
       ("iothreads", po::value<int>(), "# IO threads (default 1)")
       ("rw", "read-write workload")("randwrite", "randomw-write workload")
       ("randread", "random-read workload")
+      ("read_pct", po::value<unsigned>(), "Percentage of reads in a random read/write mix")
+      ("rate", po::value<unsigned>(), "Open-loop mode: issue this many IOPS per client thread")
       ("pmem", po::value<std::string>(),"Use persistent memory for main memory buffers")
-      ("time", po::value<unsigned>()->default_value(60),"Duration in seconds")
+      ("time", po::value<unsigned>()->default_value(60),"Duration in seconds of each sweep point")
+      ("json", po::value<std::string>(), "Write results as JSON to this file")
       ("help", "Show help.");
 
     po::variables_map vm;
@@ -205,17 +253,44 @@ int main(int argc, char* argv[]) {
     if (vm.count("chunk_size_in_block"))
       Options.chunk_size_in_block = vm["chunk_size_in_block"].as<int>();
 
-    if (vm.count("rw")) {
+    if (vm.count("read_pct")) {
+      Options.read_pct = vm["read_pct"].as<unsigned>();
+      if (Options.read_pct > 100)
+        throw General_exception("read_pct must be 0..100");
+      PINF("Using random %u:%u read-write workload", Options.read_pct, 100 - Options.read_pct);
+    } else if (vm.count("rw")) {
       PINF("Using RW 50:50 workload");
-      Options.workload = WORKLOAD_RW;
+      Options.read_pct = 50;
     } else if (vm.count("randwrite")) {
       PINF("Using random write workload");
-      Options.workload = WORKLOAD_RAND_WRITE;
+      Options.read_pct = 0;
     } else {
       PINF("Using random read workload");
-      Options.workload = WORKLOAD_RAND_READ;
+      Options.read_pct = 100;
     }
 
+    if (vm.count("rate")) {
+      Options.rate = vm["rate"].as<unsigned>();
+      PINF("Using open-loop mode at %u IOPS per thread", Options.rate);
+    }
+
+    vector<unsigned> qd_sweep = {Options.queue_depth};
+    if (vm.count("qd")) qd_sweep = vm["qd"].as<vector<unsigned>>();
+    for (auto qd : qd_sweep) {
+      if (qd == 0 || qd > MAX_QUEUE_DEPTH)
+        throw General_exception("queue depth must be 1..%u", MAX_QUEUE_DEPTH);
+    }
+
+    vector<unsigned> bs_sweep = {Options.chunk_size_in_block};
+    if (vm.count("bs")) bs_sweep = vm["bs"].as<vector<unsigned>>();
+    for (auto bs : bs_sweep) {
+      if (bs == 0)
+        throw General_exception("I/O size must be at least one block");
+    }
+
+    std::string json_path;
+    if (vm.count("json")) json_path = vm["json"].as<std::string>();
+
     if (vm.count("pci")) {
       DPDK::eal_init(256);
 
@@ -225,13 +300,17 @@ int main(int argc, char* argv[]) {
         g_pmem_allocator = new Pmem_allocator(pmem_path);
       }
 
-      m = new Main(vm["pci"].as<std::vector<std::string>>(), pmem_path, vm["time"].as<unsigned>());
+      m = new Main(vm["pci"].as<std::vector<std::string>>(), pmem_path, vm["time"].as<unsigned>(),
+                   qd_sweep, bs_sweep, json_path);
       m->run();
       delete m;
     } else {
       printf("block-perf [--pci 8b:00.0 --pci 86:00.0 ] --threads 4\n");
       return -1;
     }
+  } catch (const Exception& e) {
+    PERR("%s", e.cause());
+    return -1;
   } catch (...) {
     printf("block-perf [--pci 8b:00.0 --pci 86:00.0 ] --threads 4\n");
     return -1;
@@ -249,125 +328,152 @@ private:
   static constexpr bool option_DEBUG = true;
 
 public:
-  IO_task(Main* m) {  // vector<Component::IBlock_device *> bdv) : _bdv(bdv) {
+  IO_task(Main* m) : _main(m) {
     _bdv = m->block_v();
     _pmem_path = m->pmem_path();
   }
 
   void initialize(unsigned core) override {
-    unsigned index = core % _bdv.size();
-    _block = _bdv[index];
+    _index = core % _bdv.size();
+    _block = _bdv[_index];
     _block->get_volume_info(_vi);
+    _queue_id = (core % Options.n_io_threads) + START_IO_CORE;
+    _chunk = Options.chunk_size_in_block;
 
     if(_vi.block_size != 4096)
       throw General_exception("block device is not in 4K format");
+
+    if(_vi.block_count <= _chunk)
+      throw General_exception("I/O size exceeds device");
     
-    PLOG("IO_task: %p is using IBlock_device %p (%s) %u/%lu, chunk size %u*4KB",
-         this, _block, _vi.volume_name, index, _bdv.size(),
-         Options.chunk_size_in_block);
+    PLOG("IO_task: %p is using IBlock_device %p (%s) %u/%lu, chunk size %u*4KB, qd %u",
+         this, _block, _vi.volume_name, _index, _bdv.size(),
+         _chunk, Options.queue_depth);
 
-    size_t size = Options.chunk_size_in_block * KB(4) + MB(2);
+    /* one buffer per outstanding I/O, so the buffer queue bounds the queue depth */
+    _buffer_size = _chunk * KB(4) + MB(2);
     /* check for persistent memory use */
     if (_pmem_path == "") {
       /* create buffers */
-      for (unsigned i = 0; i < NUM_BUFFERS; i++) {
+      for (unsigned i = 0; i < Options.queue_depth; i++) {
         auto iob =
-          _block->allocate_io_buffer(size, KB(4), Component::NUMA_NODE_ANY);
+          _block->allocate_io_buffer(_buffer_size, KB(4), Component::NUMA_NODE_ANY);
+        _iob_v.push_back(iob);
         _buffer_q.enqueue(iob);
       }
     }
     else {
       PLOG("(Experimental) using persistent memory (%s)", _pmem_path.c_str());
 
-      for (unsigned i = 0; i < NUM_BUFFERS; i++) {
-        void * vaddr;
+      for (unsigned i = 0; i < Options.queue_depth; i++) {
         addr_t paddr = 0;
-        vaddr = g_pmem_allocator->allocate(size, paddr);
-        auto iob = _block->register_memory_for_io(vaddr, paddr, size);
-
+        void * vaddr = g_pmem_allocator->allocate(_buffer_size, paddr);
+        auto iob = _block->register_memory_for_io(vaddr, paddr, _buffer_size);
+        _vaddr_v.push_back(vaddr);
+        _iob_v.push_back(iob);
         _buffer_q.enqueue(iob);
       }
 
       PLOG("IO_task: core(%u) task(%p) using index (%u) pthread (%p)", core,
-           this, index, (void*)pthread_self());
+           this, _index, (void*)pthread_self());
     }
+
+    _result = new Task_result;
+    _result->core = core;
+    _result->device = _index;
+    _ns_per_cycle = 1000.0 / Common::get_rdtsc_frequency_mhz();
+    if (Options.rate)
+      _interval_cycles = cpu_time_t(Common::get_rdtsc_frequency_mhz() * 1.0e6 / Options.rate);
+
     /* start timer after initialization */
     PLOG("Start time stamped.");
     _ts_start = std::chrono::high_resolution_clock::now();
-    
+    _next_issue = rdtsc();
   }
 
   struct memory_pair {
     Component::io_buffer_t iob;
-    IO_task* pthis;
+    IO_task*               pthis;
+    cpu_time_t             start; /*< TSC at (intended) issue */
+    int                    type;  /*< LAT_READ or LAT_WRITE */
   };
 
+  /* called on the IO thread servicing this task's queue */
   static void release_cb(uint64_t gwid, void* arg0, void* arg1) {
     memory_pair* mp = (memory_pair*)arg0;
-    mp->pthis->free_buffer(mp->iob);
+    IO_task* pthis = mp->pthis;
+    pthis->_result->latency[mp->type].record(uint64_t((rdtsc() - mp->start) * pthis->_ns_per_cycle));
+    pthis->free_buffer(mp->iob);
     delete mp;
+    pthis->_inflight.fetch_sub(1, std::memory_order_release);
   }
 
   bool do_work(unsigned core) override {
-    memory_pair* mp = new memory_pair;
-    mp->iob = alloc_buffer();
-    mp->pthis = this;
-
-    auto block = genrand64_int64() % (_vi.block_count - Options.chunk_size_in_block);
+    cpu_time_t start = 0;
+
+    if (Options.rate) {
+      /* open loop: latency is taken from the scheduled issue time, so
+         time spent waiting for a free slot counts against the device */
+      if (rdtsc() < _next_issue) {
+        cpu_relax();
+        return true;
+      }
+      start = _next_issue;
+    }
 
-    switch (Options.workload) {
-    case WORKLOAD_RAND_READ:
-      _last_gwid = _block->async_read(mp->iob, 0, block, Options.chunk_size_in_block, /* n blocks */
-                                      (core % Options.n_io_threads) + START_IO_CORE, release_cb,
-                                      (void*)mp);
-      _io_count++;
-      break;
-    case WORKLOAD_RAND_WRITE:
-      _last_gwid =
-        _block->async_write(mp->iob, 0, block, Options.chunk_size_in_block, /* n blocks */
-                            (core % Options.n_io_threads) + START_IO_CORE,
-                            release_cb, (void*)mp);
-      _io_count++;
-      break;
-    case WORKLOAD_RW:
-      _block->read(mp->iob, 0, block, Options.chunk_size_in_block, /* n blocks */
-                   (core % Options.n_io_threads) + START_IO_CORE);
+    Component::io_buffer_t iob;
+    if (!_buffer_q.dequeue(iob)) { /* queue depth reached */
+      cpu_relax();
+      return true;
+    }
 
-      _block->write(mp->iob, 0, block, Options.chunk_size_in_block, /* n blocks */
-                    (core % Options.n_io_threads) + START_IO_CORE);
+    if (Options.rate)
+      _next_issue += _interval_cycles;
+    else
+      start = rdtsc();
 
-      free_buffer(mp->iob);
-      _io_count += 2;
-      break;
-    default:
-      throw General_exception("unhandled workload");
-    }
+    memory_pair* mp = new memory_pair;
+    mp->iob = iob;
+    mp->pthis = this;
+    mp->start = start;
+    mp->type = (genrand64_int64() % 100) < Options.read_pct ? LAT_READ : LAT_WRITE;
+
+    auto block = genrand64_int64() % (_vi.block_count - _chunk);
+
+    _inflight.fetch_add(1, std::memory_order_relaxed);
+    if (mp->type == LAT_READ)
+      _block->async_read(iob, 0, block, _chunk, /* n blocks */
+                         _queue_id, release_cb, (void*)mp);
+    else
+      _block->async_write(iob, 0, block, _chunk, /* n blocks */
+                          _queue_id, release_cb, (void*)mp);
     return true;
   }
 
   void cleanup(unsigned core) override {
-    if (_last_gwid) {
-      PINF("IO_task: check completion for gwid %lu", _last_gwid);
-      _block->check_completion(_last_gwid,
-                               (core % Options.n_io_threads) + START_IO_CORE);
-    }
+    /* drain so that the histograms are complete and the buffers can go */
+    while (_inflight.load(std::memory_order_acquire) > 0)
+      cpu_relax();
 
     _ts_end = std::chrono::high_resolution_clock::now();
     double secs = std::chrono::duration_cast<std::chrono::milliseconds>(_ts_end-_ts_start).count() / 1000.0;
     PLOG("End time stamped. Duration %.2g", secs);
 
+    auto io_count = _result->latency[LAT_READ].count() + _result->latency[LAT_WRITE].count();
     PINF("(%p) %lu operations at throughput %.2f MB/s",
          this,
-         _io_count,
-         (((_io_count / secs) * 4.0 * Options.chunk_size_in_block)) / 1024.0);
-  }
-
-  Component::io_buffer_t alloc_buffer() {
-    Component::io_buffer_t iob;
-    while (!_buffer_q.dequeue(iob)) {
-      cpu_relax();
+         io_count,
+         (((io_count / secs) * 4.0 * _chunk)) / 1024.0);
+
+    for (unsigned i = 0; i < _iob_v.size(); i++) {
+      if (_pmem_path == "")
+        _block->free_io_buffer(_iob_v[i]);
+      else
+        _block->unregister_memory_for_io(_vaddr_v[i], _buffer_size);
     }
-    return iob;
+
+    _result->secs = secs;
+    _main->add_result(_result); /* Main takes ownership */
   }
 
   void free_buffer(Component::io_buffer_t iob) {
@@ -376,22 +482,119 @@ public:
     }
   }
 
-  size_t io_count() const { return _io_count; }
-
 private:
-  static constexpr unsigned NUM_BUFFERS = 1024;  
-
+  Main*                             _main;
   Component::VOLUME_INFO            _vi;
-  unsigned long                     _io_count = 0;
   std::string                       _pmem_path;
   vector<Component::IBlock_device*> _bdv;
   Component::IBlock_device*         _block;
-
-  Common::Spsc_bounded_lfq_sleeping<Component::io_buffer_t, NUM_BUFFERS>  _buffer_q;
+  unsigned                          _index;
+  int                               _queue_id;
+  unsigned                          _chunk;
+  size_t                            _buffer_size;
+  vector<Component::io_buffer_t>    _iob_v;
+  vector<void*>                     _vaddr_v;
+  std::atomic<unsigned>             _inflight{0};
+  Task_result*                      _result = nullptr;
+  double                            _ns_per_cycle;
+  cpu_time_t                        _interval_cycles = 0;
+  cpu_time_t                        _next_issue = 0;
+
+  Common::Spsc_bounded_lfq_sleeping<Component::io_buffer_t, MAX_QUEUE_DEPTH>  _buffer_q;
   std::chrono::time_point<std::chrono::system_clock> _ts_start, _ts_end;
-  uint64_t _last_gwid = 0;
 };
 
+void Main::add_result(Task_result * result) {
+  std::lock_guard<std::mutex> g(_results_lock);
+  _results.push_back(result);
+}
+
+static void write_latency(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer,
+                          const char * name,
+                          const HdrHistogram& h) {
+  auto us = [](uint64_t ns) { return double(ns) / 1000.0; };
+  writer.Key(name);
+  writer.StartObject();
+  writer.Key("count"); writer.Uint64(h.count());
+  writer.Key("min_us"); writer.Double(us(h.min()));
+  writer.Key("p50_us"); writer.Double(us(h.percentile(50.0)));
+  writer.Key("p90_us"); writer.Double(us(h.percentile(90.0)));
+  writer.Key("p99_us"); writer.Double(us(h.percentile(99.0)));
+  writer.Key("p999_us"); writer.Double(us(h.percentile(99.9)));
+  writer.Key("max_us"); writer.Double(us(h.max()));
+  writer.EndObject();
+}
+
+/** 
+ * Summarize and emit the results collected for the current sweep
+ * point, then discard them.
+ */
+void Main::report_point(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) {
+  std::lock_guard<std::mutex> g(_results_lock);
+
+  double secs = 0.0;
+  vector<HdrHistogram> device_latency(_block_v.size() * 2);
+  HdrHistogram total[2];
+  for (auto r : _results) {
+    for (unsigned t = LAT_READ; t <= LAT_WRITE; t++) {
+      device_latency[r->device * 2 + t].add(r->latency[t]);
+      total[t].add(r->latency[t]);
+    }
+    secs = std::max(secs, r->secs);
+  }
+
+  uint64_t io_count = total[LAT_READ].count() + total[LAT_WRITE].count();
+  double iops = secs > 0.0 ? io_count / secs : 0.0;
+  double mbps = iops * 4.0 * Options.chunk_size_in_block / 1024.0;
+
+  PMAJOR("qd %u bs %u*4KB: %.0f IOPS %.2f MB/s", Options.queue_depth,
+         Options.chunk_size_in_block, iops, mbps);
+  for (unsigned t = LAT_READ; t <= LAT_WRITE; t++) {
+    if (total[t].count() == 0) continue;
+    PMAJOR("  %s latency (us): p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f",
+           t == LAT_READ ? "read " : "write",
+           total[t].percentile(50.0) / 1000.0, total[t].percentile(90.0) / 1000.0,
+           total[t].percentile(99.0) / 1000.0, total[t].percentile(99.9) / 1000.0,
+           total[t].max() / 1000.0);
+  }
+
+  writer.StartObject();
+  writer.Key("qd"); writer.Uint(Options.queue_depth);
+  writer.Key("bs_blocks"); writer.Uint(Options.chunk_size_in_block);
+  writer.Key("secs"); writer.Double(secs);
+  writer.Key("iops"); writer.Double(iops);
+  writer.Key("mbps"); writer.Double(mbps);
+  write_latency(writer, "read", total[LAT_READ]);
+  write_latency(writer, "write", total[LAT_WRITE]);
+
+  writer.Key("devices");
+  writer.StartArray();
+  for (unsigned d = 0; d < _block_v.size(); d++) {
+    writer.StartObject();
+    writer.Key("pci"); writer.String(_pci_id_v[d].c_str());
+    write_latency(writer, "read", device_latency[d * 2 + LAT_READ]);
+    write_latency(writer, "write", device_latency[d * 2 + LAT_WRITE]);
+    writer.EndObject();
+  }
+  writer.EndArray();
+
+  writer.Key("threads");
+  writer.StartArray();
+  for (auto r : _results) {
+    writer.StartObject();
+    writer.Key("core"); writer.Uint(r->core);
+    writer.Key("pci"); writer.String(_pci_id_v[r->device].c_str());
+    write_latency(writer, "read", r->latency[LAT_READ]);
+    write_latency(writer, "write", r->latency[LAT_WRITE]);
+    writer.EndObject();
+    delete r;
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  _results.clear();
+}
+
 void Main::run() {
   PMAJOR("Using %u client threads", Options.n_client_threads);
   PMAJOR("Using %u IO threads", Options.n_io_threads);
@@ -401,13 +604,46 @@ void Main::run() {
     m.add_core(i + START_CLIENT_CORE);
   }
 
-  {
-    Core::Per_core_tasking<IO_task, typeof(this)> workers(m, this);
-    sleep(_duration);
-    PLOG("sleep complete.");
+  rapidjson::StringBuffer sb;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+  writer.StartObject();
+  writer.Key("threads"); writer.Uint(Options.n_client_threads);
+  writer.Key("iothreads"); writer.Uint(Options.n_io_threads);
+  writer.Key("read_pct"); writer.Uint(Options.read_pct);
+  writer.Key("rate"); writer.Uint(Options.rate);
+  writer.Key("time"); writer.Uint(_duration);
+  writer.Key("results");
+  writer.StartArray();
+
+  for (auto bs : _bs_sweep) {
+    for (auto qd : _qd_sweep) {
+      Options.chunk_size_in_block = bs;
+      Options.queue_depth = qd;
+      {
+        Core::Per_core_tasking<IO_task, typeof(this)> workers(m, this);
+        sleep(_duration);
+        PLOG("sleep complete.");
+      }
+      report_point(writer);
+      if (g_pmem_allocator)
+        g_pmem_allocator->reset();
+    }
   }
-  sleep(1);
+
+  writer.EndArray();
+  writer.EndObject();
   PLOG("Per core tasking complete");
+
+  if (!_json_path.empty()) {
+    std::ofstream outf(_json_path);
+    if (outf) {
+      outf << sb.GetString() << std::endl;
+      PLOG("created report with filename '%s'", _json_path.c_str());
+    }
+    else {
+      PERR("couldn't open report file %s to write.", _json_path.c_str());
+    }
+  }
 }
 
 void Main::create_block_components(const vector<string>& vs) {
@@ -30,6 +30,7 @@
 #include <functional>
 #include <cstdint>
 #include <mutex>
+#include <vector>
 #include <semaphore.h>
 #include <common/exceptions.h>
 #include <common/utils.h>
@@ -237,6 +238,98 @@ public:
    */
   virtual bool check_completion(workid_t gwid, int queue_id = 0) = 0;
 
+  enum {
+    IO_OP_READ  = 0x1,
+    IO_OP_WRITE = 0x2,
+  };
+
+  /**
+   * One piece of a scatter-gather list
+   *
+   */
+  struct io_segment_t {
+    io_buffer_t buffer;
+    uint64_t    buffer_offset; /*< offset from the start of the IO buffer, as async_read */
+    uint64_t    lba_count;
+  };
+
+  /**
+   * Vectored IO: the blocks starting at lba are scattered to (or
+   * gathered from) the segments in order
+   *
+   */
+  struct io_request_t {
+    int                  op; /*< IO_OP_READ or IO_OP_WRITE */
+    uint64_t             lba;
+    const io_segment_t * segments; /*< must stay valid until the request completes */
+    unsigned             segment_count;
+    workid_t             gwid; /*< out: work identifier */
+  };
+
+  /**
+   * Submit a batch of asynchronous IO operations. Devices that can
+   * will post the whole batch to the device in one go. There is no
+   * completion callback; use check_completion or harvest_completions.
+   *
+   * @param requests Array of requests; gwid is set for each
+   * @param count Number of requests
+   * @param queue_id Logical queue identifier (counting from 0, -1=unspecified)
+   */
+  virtual void async_submit(io_request_t * requests,
+                            size_t count,
+                            int queue_id = 0) {
+    /* segments may complete in any order, so wait for all but the
+       last segment of each request; its gwid then covers the request */
+    std::vector<workid_t> pending;
+    for(size_t i = 0; i < count; i++) {
+      io_request_t& r = requests[i];
+      if(r.segment_count == 0)
+        throw API_exception("bad async_submit param (segment_count == 0)");
+
+      uint64_t lba = r.lba;
+      for(unsigned s = 0; s < r.segment_count; s++) {
+        const io_segment_t& seg = r.segments[s];
+        if(r.op == IO_OP_READ)
+          r.gwid = async_read(seg.buffer, seg.buffer_offset, lba, seg.lba_count, queue_id);
+        else if(r.op == IO_OP_WRITE)
+          r.gwid = async_write(seg.buffer, seg.buffer_offset, lba, seg.lba_count, queue_id);
+        else
+          throw API_exception("bad async_submit param (op)");
+        if(s + 1 < r.segment_count)
+          pending.push_back(r.gwid);
+        lba += seg.lba_count;
+      }
+    }
+
+    for(auto gwid : pending) {
+      while(!check_completion(gwid, queue_id))
+        cpu_relax();
+    }
+  }
+
+  /**
+   * Find which of a set of work requests have completed. This API
+   * is thread-safe.
+   *
+   * @param gwids Work request identifiers
+   * @param count Number of work request identifiers
+   * @param out_completed Out array (of at least count entries) of completed identifiers
+   * @param queue_id Logical queue identifier (counting from 0, -1=unspecified)
+   *
+   * @return Number of identifiers written to out_completed
+   */
+  virtual size_t harvest_completions(const workid_t * gwids,
+                                     size_t count,
+                                     workid_t * out_completed,
+                                     int queue_id = 0) {
+    size_t n = 0;
+    for(size_t i = 0; i < count; i++) {
+      if(check_completion(gwids[i], queue_id))
+        out_completed[n++] = gwids[i];
+    }
+    return n;
+  }
+
   /** 
    * Get device information
    * 
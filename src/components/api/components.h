@@ -123,6 +123,10 @@ DECLARE_STATIC_COMPONENT_UUID(mapstore_factory, 0xfac20985,0x1253,0x404d,0x94d7,
 DECLARE_STATIC_COMPONENT_UUID(rbtreeindex,0x8a120985,0x1253,0x404d,0x94d7,0x77,0x92,0x75,0x21,0xa1,0x29);
 DECLARE_STATIC_COMPONENT_UUID(rbtreeindex_factory, 0xfac20985,0x1253,0x404d,0x94d7,0x77,0x92,0x75,0x21,0xa1,0x29);
 
+/*< persistent b+tree index*/
+DECLARE_STATIC_COMPONENT_UUID(pmbtreeindex,0x8a3c5e41,0x6d2b,0x4f0a,0x9c1e,0x52,0x7b,0x0d,0x93,0xe4,0x16);
+DECLARE_STATIC_COMPONENT_UUID(pmbtreeindex_factory, 0xfac35e41,0x6d2b,0x4f0a,0x9c1e,0x52,0x7b,0x0d,0x93,0xe4,0x16);
+
 /*< dummy store */
 DECLARE_STATIC_COMPONENT_UUID(dummystore, 0xb3612e90,0x4ad5,0x4845,0xa91e,0x8a,0x3f,0xa9,0x15,0xa1,0x2e);
 DECLARE_STATIC_COMPONENT_UUID(dummystore_factory, 0xfac12e90,0x4ad5,0x4845,0xa91e,0x8a,0x3f,0xa9,0x15,0xa1,0x2e);
@@ -108,7 +108,8 @@ public:
   /** 
    * Configure a pool
    * 
-   * @param setting Configuration request (e.g., AddIndex::VolatileTree)
+   * @param setting Configuration request (e.g., AddIndex::VolatileTree,
+   * AddIndex::PersistentTree, RemoveIndex::, QoS::Weight::<n>)
 
    * 
    * @return S_OK on success
@@ -206,6 +207,46 @@ public:
                         offset_t& out_matched_offset,
                         std::string& out_matched_key) = 0;
 
+  /** 
+   * Read a batch of key-value pairs in key order.  Uses the pool's
+   * ordered index if one has been added (see configure_pool).
+   * 
+   * @param pool Pool handle
+   * @param start_key Key to start from (inclusive)
+   * @param prefix Restrict to keys with this prefix (may be empty)
+   * @param max_count Maximum number of pairs in the batch (0 for no limit)
+   * @param max_bytes Byte budget for the batch (0 for transport maximum)
+   * @param out_pairs [out] Key-value pairs (appended)
+   * @param out_cursor [out] Start key for the next batch; empty when the scan is complete
+   * 
+   * @return S_OK, E_BUSY if the first key in range is write-locked (retry), or other error code
+   */
+  virtual status_t scan(const IKVStore::pool_t pool,
+                        const std::string& start_key,
+                        const std::string& prefix,
+                        const size_t max_count,
+                        const size_t max_bytes,
+                        std::vector<std::pair<std::string, std::string>>& out_pairs,
+                        std::string& out_cursor) = 0;
+
+  /** 
+   * Update a value in place by applying a vector of operations on the
+   * server in a single round trip. The operations are applied
+   * atomically with respect to other clients. Results of increment
+   * and compare-and-swap operations are set in the operation objects.
+   * 
+   * @param pool Pool handle
+   * @param key Object key
+   * @param op_vector Operation vector
+   * @param take_lock Ignored; the server always locks the value
+   * 
+   * @return S_OK, E_CAS_FAILED (nothing applied), E_KEY_NOT_FOUND or other error code
+   */
+  virtual status_t atomic_update(const IKVStore::pool_t pool,
+                                 const std::string& key,
+                                 const std::vector<IKVStore::Operation*>& op_vector,
+                                 bool take_lock = true) = 0;
+
   /** 
    * Erase an object
    * 
@@ -317,11 +358,13 @@ public:
   
 
   /** 
-   * Create a "session" to a remote shard
+   * Create a "session" to a remote shard, or to a set of shards across
+   * which keys are distributed by hash
    * 
    * @param debug_level Debug level (0-3)
    * @param owner Owner info (not used)
-   * @param addr_with_port Address and port information, e.g. 10.0.0.22:11911 (must be RDMA)
+   * @param addr_with_port Address and port information, e.g. 10.0.0.22:11911 (must be RDMA),
+   * or a comma separated list of shards, e.g. 10.0.0.22:11911-11926,10.0.0.23:11911
    * @param nic_device RDMA network device (e.g., mlnx5_0)
    * 
    * @return Pointer to IDawn instance. Use release_ref() to close.
@@ -20,11 +20,18 @@
 
 #include <cstdlib>
 #include <functional>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 #include <assert.h>
 #include <common/exceptions.h>
 #include <api/components.h>
 
+namespace Common
+{
+class Key_matcher; /* common/key_matcher.h */
+}
+
 namespace Component
 {
 
@@ -102,6 +109,70 @@ public:
                         offset_t& out_matched_position,
                         std::string& out_matched_key,
                         unsigned max_comparisons = 0) = 0;
+
+  /** 
+   * Perform a key search with a precompiled expression.  Searches
+   * that call find repeatedly should compile the expression once.
+   * Keys that do not start with matcher.prefix() are skipped by
+   * seeking and do not count as comparisons.
+   * 
+   * @param matcher Compiled expression
+   * @param begin_position Position from which to start from. Counting from 0.
+   * @param out_matched_position [out] Position of the match, or of the last key compared
+   * @param out_matched_key Matching key result
+   * @param max_comparisons Maximum number of failed comparisons
+   * 
+   * @return S_OK, E_MAX_REACHED, E_FAIL if no further key can match, or E_NOT_IMPL
+   */
+  virtual status_t find(const Common::Key_matcher& matcher,
+                        offset_t begin_position,
+                        offset_t& out_matched_position,
+                        std::string& out_matched_key,
+                        unsigned max_comparisons) {
+    return E_NOT_IMPL;
+  }
+
+  /** 
+   * Matcher type for a find_t other than FIND_TYPE_NEXT.  A template
+   * only so that callers, not this header, include common/key_matcher.h
+   * 
+   */
+  template <typename Matcher = Common::Key_matcher>
+  static typename Matcher::Type matcher_type(find_t find_type) {
+    switch (find_type) {
+    case FIND_TYPE_EXACT:
+      return Matcher::Type::EXACT;
+    case FIND_TYPE_PREFIX:
+      return Matcher::Type::PREFIX;
+    case FIND_TYPE_REGEX:
+      return Matcher::Type::REGEX;
+    default:
+      throw API_exception("find type has no matcher");
+    }
+  }
+
+  /** 
+   * Visit keys in order, starting from the first key that is not
+   * less than 'start_key'
+   * 
+   * @param start_key Key to start from (inclusive)
+   * @param function Functor called for each key; return false to stop
+   * 
+   * @return S_OK or E_NOT_IMPL
+   */
+  virtual status_t scan(const std::string& start_key,
+                        std::function<bool(const std::string& key)> function) {
+    return E_NOT_IMPL;
+  }
+
+  /** 
+   * Longest key the index can hold; insert of a longer key throws
+   * 
+   * @return Maximum key length in bytes
+   */
+  virtual size_t max_key_length() const {
+    return std::numeric_limits<size_t>::max();
+  }
 };
 
 
@@ -139,6 +139,47 @@ class IKVStore : public Component::IBase {
     const void* data() const noexcept { return _data; }
   };
 
+  class Operation_zero : public Operation_sized {
+   public:
+    Operation_zero(size_t offset, size_t len)
+        : Operation_sized(Op_type::ZERO, offset, len)
+    {
+    }
+  };
+
+  /* result is the value before the increment */
+  class Operation_increment_uint64 : public Operation {
+    uint64_t _delta;
+    uint64_t _result = 0;
+
+   public:
+    Operation_increment_uint64(size_t offset, uint64_t delta)
+        : Operation(Op_type::INCREMENT_UINT64, offset), _delta(delta)
+    {
+    }
+    uint64_t delta() const noexcept { return _delta; }
+    uint64_t result() const noexcept { return _result; }
+    void     set_result(uint64_t result) noexcept { _result = result; }
+  };
+
+  /* result is the value found; swap happened if it equals expected() */
+  class Operation_cas_uint64 : public Operation {
+    uint64_t _expected;
+    uint64_t _desired;
+    uint64_t _result = 0;
+
+   public:
+    Operation_cas_uint64(size_t offset, uint64_t expected, uint64_t desired)
+        : Operation(Op_type::CAS_UINT64, offset), _expected(expected),
+          _desired(desired)
+    {
+    }
+    uint64_t expected() const noexcept { return _expected; }
+    uint64_t desired() const noexcept { return _desired; }
+    uint64_t result() const noexcept { return _result; }
+    void     set_result(uint64_t result) noexcept { _result = result; }
+  };
+
   enum lock_type_t {
     STORE_LOCK_READ  = 1,
     STORE_LOCK_WRITE = 2,
@@ -153,6 +194,7 @@ class IKVStore : public Component::IBase {
     E_BAD_ALIGNMENT  = E_ERROR_BASE - 4,
     E_TOO_LARGE      = E_ERROR_BASE - 5,
     E_ALREADY_OPEN   = E_ERROR_BASE - 6,
+    E_CAS_FAILED     = E_ERROR_BASE - 7,
   };
 
   /**
@@ -497,8 +539,9 @@ class IKVStore : public Component::IBase {
    * Update an existing value by applying a series of operations.
    * Together the set of operations make up an atomic transaction.
    * If the operation requires a result the operation type may provide
-   * a method to accept the result. No operation currently requires
-   * a result, but compare and swap probably would.
+   * a method to accept the result (increment and compare-and-swap
+   * report the previous value). A failed compare-and-swap aborts the
+   * whole update with E_CAS_FAILED.
    *
    * @param pool Pool handle
    * @param key Object key
@@ -564,6 +607,29 @@ class IKVStore : public Component::IBase {
     return E_NOT_SUPPORTED;
   }
 
+  /**
+   * Apply functor to the next slice of keys, so that a pool can be
+   * walked in bounded steps between other operations.  Keys present
+   * for the whole walk are visited exactly once; keys added or removed
+   * during it may or may not be visited.
+   *
+   * @param pool Pool handle
+   * @param cursor [in-out] Walk position; 0 to start
+   * @param max_keys Approximate number of keys to visit
+   * @param function Functor
+   *
+   * @return S_OK when the walk is complete, S_MORE if keys remain,
+   * E_BAD_OFFSET if the pool was resized since the walk started (restart
+   * from 0), E_POOL_NOT_FOUND, E_NOT_SUPPORTED
+   */
+  virtual status_t map_keys_slice(const pool_t                               pool,
+                                  uint64_t&                                  cursor,
+                                  size_t                                     max_keys,
+                                  std::function<int(const std::string& key)> function)
+  {
+    return E_NOT_SUPPORTED;
+  }
+
   /**
    * Free server-side allocated memory
    *
@@ -86,6 +86,43 @@ bool Block_device_component::check_completion(uint64_t gwid, int queue_id) {
   return _device->check_completion(gwid, queue_id);
 }
 
+void Block_device_component::async_submit(io_request_t* requests, size_t count,
+                                          int queue_id) {
+  if (count == 0) return;
+
+  for (size_t i = 0; i < count; i++) {
+    auto& r = requests[i];
+    if (r.segment_count == 0 || (r.op != IO_OP_READ && r.op != IO_OP_WRITE))
+      throw API_exception("bad async_submit param");
+    for (unsigned s = 0; s < r.segment_count; s++) {
+      if (r.segments[s].lba_count == 0)
+        throw API_exception("bad async_submit param (lba_count == 0)");
+    }
+  }
+
+  uint64_t first_gwid = issued_gwid + 1;
+  issued_gwid += count;
+
+  _device->queue_submit_async_ops(requests, count, first_gwid, queue_id);
+}
+
+size_t Block_device_component::harvest_completions(const workid_t* gwids,
+                                                   size_t count,
+                                                   workid_t* out_completed,
+                                                   int queue_id) {
+  if (count == 0) return 0;
+
+  uint64_t last = _device->last_completion(queue_id);
+
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    /* above issued_gwid may have not got through FIFO yet */
+    if (gwids[i] <= last && gwids[i] <= issued_gwid)
+      out_completed[n++] = gwids[i];
+  }
+  return n;
+}
+
 void Block_device_component::attach_work(
     std::function<void(void*)> work_function, void* arg, int queue_id) {
   _device->attach_work(queue_id, work_function, arg);
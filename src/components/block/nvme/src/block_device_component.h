@@ -127,6 +127,33 @@ class Block_device_component : public Core::Physical_memory,
    */
   virtual bool check_completion(uint64_t gwid, int queue_id = 0) override;
 
+  /**
+   * Submit a batch of asynchronous IO operations. The batch is posted
+   * to the IO thread in one go and issued back-to-back; multi-segment
+   * requests use the NVMe scatter-gather path.
+   *
+   * @param requests Array of requests; gwid is set for each
+   * @param count Number of requests
+   * @param queue_id Logical queue identifier
+   */
+  virtual void async_submit(io_request_t *requests, size_t count,
+                            int queue_id = 0) override;
+
+  /**
+   * Find which of a set of work requests have completed, with a single
+   * query to the IO thread
+   *
+   * @param gwids Work request identifiers
+   * @param count Number of work request identifiers
+   * @param out_completed Out array of completed identifiers
+   * @param queue_id Logical queue identifier
+   *
+   * @return Number of identifiers written to out_completed
+   */
+  virtual size_t harvest_completions(const workid_t *gwids, size_t count,
+                                     workid_t *out_completed,
+                                     int queue_id = 0) override;
+
   /**
    * Get device information
    *
@@ -55,44 +55,50 @@
  * @param queue
  */
 static void do_work(struct rte_ring* ring, Nvme_queue* queue) {
-  IO_descriptor* desc = nullptr;
+  IO_descriptor* descs[Nvme_device::IO_BURST];
   Nvme_device* device = queue->device();
 
   /* active completion polling */
   queue->process_completions();
 
-  /* deque next desc */
-  if (unlikely(rte_ring_sc_dequeue(ring, (void**) &desc) != 0)) {
-    return;
-  }
-
-  if (desc == nullptr) return;
-
-  desc->queue = queue;
-
-  assert(desc);
-
-  /** check completion request */
-  if (unlikely(desc->op == COMANCHE_OP_CHECK_COMPLETION)) {
-    if (desc->tag == 0) {
-      desc->status =
-          queue->pending_remain() ? IO_STATUS_COMPLETE : IO_STATUS_PENDING;
-    } else {
-      desc->status = queue->check_completion(desc->tag) ? IO_STATUS_COMPLETE
-                                                        : IO_STATUS_PENDING;
+  /* deque next descs; a batch submitted together is issued back-to-back */
+  unsigned n = rte_ring_sc_dequeue_burst(ring, (void**) descs,
+                                         Nvme_device::IO_BURST, nullptr);
+
+  for (unsigned i = 0; i < n; i++) {
+    IO_descriptor* desc = descs[i];
+    if (desc == nullptr) continue;
+
+    desc->queue = queue;
+
+    /** check completion request */
+    if (unlikely(desc->op == COMANCHE_OP_CHECK_COMPLETION)) {
+      if (desc->tag == 0) {
+        desc->status =
+            queue->pending_remain() ? IO_STATUS_COMPLETE : IO_STATUS_PENDING;
+      } else {
+        desc->status = queue->check_completion(desc->tag) ? IO_STATUS_COMPLETE
+                                                          : IO_STATUS_PENDING;
+      }
     }
-  }
-  /** submission request */
-  else {
-    assert(check_aligned(desc->buffer, 32));
-    queue->push_pending_fifo(desc);
-    assert(desc->buffer);
+    /** last completion request; answer goes in lba_count */
+    else if (unlikely(desc->op == COMANCHE_OP_LAST_COMPLETION)) {
+      desc->lba_count = queue->get_last_completion();
+      wmb();
+      desc->status = IO_STATUS_COMPLETE;
+    }
+    /** submission request */
+    else {
+      assert(check_aligned(desc->buffer, 32));
+      queue->push_pending_fifo(desc);
+      assert(desc->buffer);
 #ifndef DISABLE_IO
-    queue->submit_async_op_internal(desc);
+      queue->submit_async_op_internal(desc);
 #else
-    queue->remove_pending_fifo(desc);
-    device->free_desc(desc);
+      queue->remove_pending_fifo(desc);
+      device->free_desc(desc);
 #endif
+    }
   }
 }
 
@@ -720,6 +726,7 @@ void Nvme_device::queue_submit_async_op(void* buffer, uint64_t lba,
   desc->cb = cb;
   desc->arg0 = arg0;
   desc->arg1 = arg1;
+  desc->sgl = nullptr;
 
   wmb();
 
@@ -738,6 +745,87 @@ void Nvme_device::queue_submit_async_op(void* buffer, uint64_t lba,
   }
 }
 
+void Nvme_device::queue_submit_async_ops(
+    Component::IBlock_device::io_request_t* requests, size_t count,
+    uint64_t first_tag, int queue_id) {
+  if (queue_id == 0) queue_id = _default_core;
+
+  struct rte_ring* ring = _qm_state.ring_list[queue_id];
+
+  if (!ring)
+    throw Logic_exception("invalid queue_id: qm_state[%d] not set up",
+                          queue_id);
+
+  std::vector<IO_descriptor*> descs(count);
+
+  for (size_t i = 0; i < count; i++) {
+    auto& r = requests[i];
+    auto& seg = r.segments[0];
+
+    IO_descriptor* desc = alloc_desc();
+    assert(desc);
+
+    desc->buffer = reinterpret_cast<char*>(seg.buffer) + seg.buffer_offset;
+    desc->lba = r.lba;
+    desc->lba_count = 0;
+    for (unsigned s = 0; s < r.segment_count; s++)
+      desc->lba_count += r.segments[s].lba_count;
+    desc->op = (r.op == Component::IBlock_device::IO_OP_READ)
+                   ? COMANCHE_OP_READ
+                   : COMANCHE_OP_WRITE;
+    desc->tag = r.gwid = first_tag + i;
+    desc->cb = nullptr;
+    desc->arg0 = desc->arg1 = nullptr;
+    desc->sgl = (r.segment_count > 1) ? r.segments : nullptr;
+    desc->sgl_count = r.segment_count;
+    descs[i] = desc;
+  }
+
+  wmb();
+
+  /* post the batch onto the FIFO ring (as multi-producer) */
+  size_t posted = 0;
+  unsigned retries = 0;
+  while (posted < count) {
+    posted += rte_ring_mp_enqueue_burst(ring, (void**) &descs[posted],
+                                        count - posted, nullptr);
+    if (posted < count) {
+      cpu_relax();
+      if (retries++ > 100) usleep(100);
+    }
+  }
+}
+
+uint64_t Nvme_device::last_completion(int queue_id) {
+  if (queue_id == 0) queue_id = _default_core;
+
+  struct rte_ring* ring = _qm_state.ring_list[queue_id];
+  if (!ring)
+    throw API_exception(
+        "invalid queue for last_completion; default may be invalid");
+
+  IO_descriptor desc;
+  desc.op = COMANCHE_OP_LAST_COMPLETION;
+  desc.status = IO_STATUS_UNKNOWN;
+
+  wmb();
+
+  while (rte_ring_mp_enqueue(ring, (void*) &desc) != 0) {
+    cpu_relax();
+  }
+
+  cpu_time_t start = rdtsc();
+  while (!desc.status) {
+    if ((rdtsc() - start) > (2400 * 10000000UL)) {
+      throw Logic_exception("last_completion timed out");
+    }
+    cpu_relax();
+  }
+  rmb();
+
+  return desc.lba_count;
+}
+
 bool Nvme_device::check_completion(uint64_t gwid, int queue_id) {
   if (queue_id == 0) queue_id = _default_core;
 
@@ -54,6 +54,7 @@ class Nvme_queue;
 class Nvme_device {
  public:
   static constexpr unsigned IO_SW_QUEUE_DEPTH = 2048; /**< must be power of 2 */
+  static constexpr unsigned IO_BURST = 32; /**< descriptors taken per IO thread cycle */
   static constexpr unsigned DEFAULT_NAMESPACE_ID = 1;
   static constexpr bool option_DEBUG = false;
 
@@ -204,6 +205,28 @@ class Nvme_device {
                              void *arg0 = nullptr, void *arg1 = nullptr,
                              int queue_id = 0);
 
+  /**
+   * Asynchronous IO for a batch of vectored requests, posted to the
+   * queue's FIFO in one go
+   *
+   * @param requests Requests; gwid is set for each
+   * @param count Number of requests
+   * @param first_tag Tag of the first request; the rest follow in order
+   * @param queue_id Queue identifier
+   */
+  void queue_submit_async_ops(Component::IBlock_device::io_request_t *requests,
+                              size_t count, uint64_t first_tag,
+                              int queue_id = 0);
+
+  /**
+   * Get the tag of the last operation completed on a queue
+   *
+   * @param queue_id Queue identifier
+   *
+   * @return Tag, or UINT64_MAX if nothing is pending
+   */
+  uint64_t last_completion(int queue_id = 0);
+
   /**
    * Check if all operations up to and inclusive of this gwid
    * are complete.
@@ -109,6 +109,37 @@ static void async_io_internal_complete(void* arg,
   desc->queue->device()->free_desc(desc);
 }
 
+/**
+ * Scatter-gather callbacks for vectored IO: position the cursor at a
+ * byte offset, then hand out the remainder of each segment in turn
+ *
+ */
+static void sgl_reset(void* arg, uint32_t offset) {
+  IO_descriptor* desc = static_cast<IO_descriptor*>(arg);
+  const uint64_t block_size = desc->queue->block_size();
+
+  desc->sgl_index = 0;
+  while (offset >= desc->sgl[desc->sgl_index].lba_count * block_size) {
+    offset -= desc->sgl[desc->sgl_index].lba_count * block_size;
+    desc->sgl_index++;
+  }
+  desc->sgl_offset = offset;
+}
+
+static int sgl_next(void* arg, void** address, uint32_t* length) {
+  IO_descriptor* desc = static_cast<IO_descriptor*>(arg);
+  if (desc->sgl_index >= desc->sgl_count) return -1;
+
+  auto& seg = desc->sgl[desc->sgl_index];
+  *address = reinterpret_cast<char*>(seg.buffer) + seg.buffer_offset +
+             desc->sgl_offset;
+  *length = seg.lba_count * desc->queue->block_size() - desc->sgl_offset;
+
+  desc->sgl_index++;
+  desc->sgl_offset = 0;
+  return 0;
+}
+
 void Nvme_queue::submit_async_op_internal(IO_descriptor* desc) {
   assert(desc);
   assert(desc->buffer);
@@ -138,7 +169,15 @@ retry_submission:
 #endif
 
   int rc = 0;
-  if (desc->op == OP_FLAG_READ) {
+  if (desc->sgl) {
+    if (desc->op == OP_FLAG_WRITE) wmb();
+
+    rc = (desc->op == OP_FLAG_READ ? spdk_nvme_ns_cmd_readv
+                                   : spdk_nvme_ns_cmd_writev)(
+        _device->ns(), _qpair, desc->lba, desc->lba_count,
+        async_io_internal_complete, (void*) desc, 0 /* flags */, sgl_reset,
+        sgl_next);
+  } else if (desc->op == OP_FLAG_READ) {
     rc = spdk_nvme_ns_cmd_read(
         _device->ns(), _qpair, desc->buffer, desc->lba, /* LBA start */
         desc->lba_count,                                /* number of LBAs */
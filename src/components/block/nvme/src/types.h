@@ -24,6 +24,7 @@
 #ifndef __COMANCHE_TYPES_H__
 #define __COMANCHE_TYPES_H__
 
+#include <api/block_itf.h>
 #include <common/exceptions.h>
 #include <infiniband/verbs.h>
 #include <rapidjson/document.h>
@@ -46,6 +47,7 @@ enum {
   COMANCHE_OP_READ = 0x2,  // do not modify (see Nvme_queue.h)
   COMANCHE_OP_WRITE = 0x4,
   COMANCHE_OP_CHECK_COMPLETION = 0x8,
+  COMANCHE_OP_LAST_COMPLETION = 0x10,
 };
 
 enum {
@@ -61,7 +63,7 @@ class IO_descriptor;
 
 class IO_descriptor {
  public:
-  IO_descriptor() : prev(nullptr), next(nullptr) {}
+  IO_descriptor() : prev(nullptr), next(nullptr), sgl(nullptr) {}
 
   IO_descriptor* prev;  // 8
   IO_descriptor* next;  // 16
@@ -76,12 +78,16 @@ class IO_descriptor {
   void* arg1;          // 64
   uint64_t tag;        // 72
   Nvme_queue* queue;   // 80
-  int op;              // 88
+  int op;              // 84
+  const Component::IBlock_device::io_segment_t* sgl;  // 92 (nullptr: use buffer)
+  uint32_t sgl_count;                                 // 96
+  uint32_t sgl_index;                                 // 100
+  uint32_t sgl_offset;                                // 104
 #ifdef CONFIG_QUEUE_STATS
-  cpu_time_t time_stamp;  // 92
-  byte padding[128 - 92];
+  cpu_time_t time_stamp;  // 112
+  byte padding[128 - 112];
 #else
-  byte padding[128 - 84];
+  byte padding[128 - 104];
 #endif
 } __attribute__((packed, aligned(64)));
 
@@ -21,6 +21,7 @@
  * Daniel G. Waddington (daniel.waddington@ibm.com)
  *
  */
+#include <algorithm>
 #include <functional>
 #include <utility>
 #include <signal.h>
@@ -227,12 +228,14 @@ Block_posix::check_complete(uint64_t workid)
     free_descriptor(desc.aiocb); /* free descriptor */
     
     _outstanding.pop_back();
+    _last_completed = desc.tag;
 
     if(option_DEBUG) {
       PINF("[block-posix]: processed completion %ld", desc.tag);
     }
     if(desc.tag >= workid) return true;
   }
+  _last_completed = _work_id;
   fsync(_fd);
   
   return true;
@@ -374,6 +377,115 @@ async_write(io_buffer_t buffer,
   return gwid;
 }
 
+void
+Block_posix::
+async_submit(io_request_t * requests,
+             size_t count,
+             int queue_id)
+{
+  /* validate up front so that a bad request submits nothing */
+  for(size_t i = 0; i < count; i++) {
+    const io_request_t& r = requests[i];
+    if(r.segment_count == 0 || (r.op != IO_OP_READ && r.op != IO_OP_WRITE))
+      throw API_exception("bad async_submit param");
+  }
+
+  /* one AIO per segment; batches larger than the descriptor pool are
+     split, each chunk retiring before the next is allocated */
+  std::vector<struct aiocb*> list;
+  std::vector<io_request_t*> owner;
+
+  for(size_t i = 0; i < count; i++) {
+    io_request_t& r = requests[i];
+    uint64_t lba = r.lba;
+    for(unsigned s = 0; s < r.segment_count; s++) {
+      const io_segment_t& seg = r.segments[s];
+      struct aiocb * desc = allocate_descriptor();
+      desc->aio_buf = reinterpret_cast<char*>(seg.buffer) + seg.buffer_offset;
+      desc->aio_fildes = _fd;
+      desc->aio_offset = lba * IO_BLOCK_SIZE;
+      desc->aio_lio_opcode = (r.op == IO_OP_READ) ? LIO_READ : LIO_WRITE;
+      desc->aio_nbytes = seg.lba_count * IO_BLOCK_SIZE;
+      desc->aio_sigevent.sigev_notify = SIGEV_NONE;
+      list.push_back(desc);
+      owner.push_back(&r);
+      lba += seg.lba_count;
+
+      if(list.size() == AIO_DESCRIPTOR_POOL_SIZE) {
+        submit_descriptors(list, owner);
+        list.clear();
+        owner.clear();
+        if(i + 1 < count || s + 1 < r.segment_count) {
+          while(!check_complete(_work_id))
+            cpu_relax();
+        }
+      }
+    }
+  }
+
+  if(!list.empty())
+    submit_descriptors(list, owner);
+
+  if(option_DEBUG)
+    PLOG("block-posix: async-submit %lu requests up to %ld", count, _work_id);
+}
+
+void
+Block_posix::
+submit_descriptors(const std::vector<struct aiocb*>& list,
+                   const std::vector<io_request_t*>& owner)
+{
+  if(lio_listio(LIO_NOWAIT, const_cast<struct aiocb**>(list.data()), list.size(), nullptr) != 0) {
+    int err = errno;
+    /* part of the list may have been queued: reap every operation
+       before its descriptor goes back to the pool */
+    for(auto desc : list) {
+      while(aio_error(desc) == EINPROGRESS) {
+        const struct aiocb * wait[] = { desc };
+        aio_suspend(wait, 1, nullptr);
+      }
+      aio_return(desc);
+      free_descriptor(desc);
+    }
+    throw General_exception("lio_listio failed (%d)", err);
+  }
+
+  /* tag only once submitted, so that check_complete never polls an
+     unsubmitted descriptor; the last segment's tag covers its request */
+  std::lock_guard<std::mutex> g(_work_lock);
+  for(size_t k = 0; k < list.size(); k++) {
+    _work_id++;
+    _outstanding.push_front({list[k],_work_id,0xF00D});
+    owner[k]->gwid = _work_id;
+  }
+}
+
+size_t
+Block_posix::
+harvest_completions(const workid_t * gwids,
+                    size_t count,
+                    workid_t * out_completed,
+                    int queue_id)
+{
+  if(count == 0) return 0;
+
+  /* retire as much as has finished, then compare against the watermark */
+  check_complete(*std::max_element(gwids, gwids + count));
+
+  uint64_t last;
+  {
+    std::lock_guard<std::mutex> g(_work_lock);
+    last = _last_completed;
+  }
+
+  size_t n = 0;
+  for(size_t i = 0; i < count; i++) {
+    if(gwids[i] <= last)
+      out_completed[n++] = gwids[i];
+  }
+  return n;
+}
+
 void
 Block_posix::
 write(Component::io_buffer_t buffer,
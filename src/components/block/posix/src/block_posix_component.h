@@ -172,6 +172,33 @@ public:
    */
   virtual bool check_completion(Component::workid_t gwid, int queue_id = 0) override;
 
+  /** 
+   * Submit a batch of asynchronous IO operations with a single
+   * lio_listio call (one AIO request per segment)
+   * 
+   * @param requests Array of requests; gwid is set for each
+   * @param count Number of requests
+   * @param queue_id Logical queue identifier (ignored)
+   */
+  virtual void async_submit(io_request_t * requests,
+                            size_t count,
+                            int queue_id = 0) override;
+
+  /** 
+   * Find which of a set of work requests have completed
+   * 
+   * @param gwids Work request identifiers
+   * @param count Number of work request identifiers
+   * @param out_completed Out array of completed identifiers
+   * @param queue_id Logical queue identifier (ignored)
+   * 
+   * @return Number of identifiers written to out_completed
+   */
+  virtual size_t harvest_completions(const Component::workid_t * gwids,
+                                     size_t count,
+                                     Component::workid_t * out_completed,
+                                     int queue_id = 0) override;
+
   /** 
    * Get device information
    * 
@@ -188,6 +215,8 @@ private:
   void free_descriptor(struct aiocb * desc);
   uint64_t add_outstanding(struct aiocb * desc);
   bool check_complete(uint64_t workid);
+  void submit_descriptors(const std::vector<struct aiocb*>& list,
+                          const std::vector<io_request_t*>& owner);
   
 private:
   typedef struct {
@@ -204,6 +233,7 @@ private:
   int                        _fd_xms = 0;
   std::mutex                 _work_lock;
   uint64_t                   _work_id;
+  uint64_t                   _last_completed = 0; /* all work up to here is complete */
   std::list<work_desc_t>     _outstanding;
 };
 
@@ -403,6 +403,52 @@ TEST_F(Block_posix_test, AsyncSwap)
 
 }
 
+TEST_F(Block_posix_test, VectoredSubmit)
+{
+  using namespace Component;
+  unsigned NUM_REQUESTS = 32;
+  unsigned BLOCKS_PER_REQUEST = 4;
+  size_t size = NUM_REQUESTS * BLOCKS_PER_REQUEST * 4096;
+
+  io_buffer_t mem = _block->allocate_io_buffer(size,4096,Component::NUMA_NODE_ANY);
+  uint32_t * p = (uint32_t *) _block->virt_addr(mem);
+  for(unsigned i=0;i<size/sizeof(uint32_t);i++) p[i] = i;
+
+  /* each request gathers its blocks from two segments, in reverse order */
+  std::vector<IBlock_device::io_segment_t> segments;
+  std::vector<IBlock_device::io_request_t> requests;
+  for(unsigned r=0;r<NUM_REQUESTS;r++) {
+    uint64_t base = r * BLOCKS_PER_REQUEST * 4096;
+    segments.push_back({mem, base + 2 * 4096, 2});
+    segments.push_back({mem, base, 2});
+  }
+  for(unsigned r=0;r<NUM_REQUESTS;r++)
+    requests.push_back({IBlock_device::IO_OP_WRITE, r * BLOCKS_PER_REQUEST, &segments[r*2], 2, 0});
+
+  _block->async_submit(requests.data(), requests.size());
+
+  std::vector<workid_t> gwids, completed(NUM_REQUESTS);
+  for(auto& r: requests) gwids.push_back(r.gwid);
+  while(_block->harvest_completions(gwids.data(), gwids.size(), completed.data()) < NUM_REQUESTS)
+    usleep(100);
+
+  /* read back contiguously */
+  memset(p, 0, size);
+  IBlock_device::io_segment_t all = {mem, 0, NUM_REQUESTS * BLOCKS_PER_REQUEST};
+  IBlock_device::io_request_t read = {IBlock_device::IO_OP_READ, 0, &all, 1, 0};
+  _block->async_submit(&read, 1);
+  while(!_block->check_completion(read.gwid)) usleep(100);
+
+  for(unsigned r=0;r<NUM_REQUESTS;r++) {
+    uint32_t * q = p + r * BLOCKS_PER_REQUEST * 1024;
+    ASSERT_EQ(r * BLOCKS_PER_REQUEST * 1024 + 2 * 1024, q[0]);
+    ASSERT_EQ(r * BLOCKS_PER_REQUEST * 1024, q[2 * 1024]);
+  }
+
+  _block->free_io_buffer(mem);
+  PMAJOR("> vectored submit test OK");
+}
+
 TEST_F(Block_posix_test, ReleaseBlockDevice)
 {
   assert(_block);
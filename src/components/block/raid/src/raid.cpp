@@ -172,6 +172,70 @@ bool Raid_component::check_completion(workid_t lgwid, int queue_id)
   return _bdv_itf[index].block_device->check_completion(gwid, queue_id);
 }
 
+void Raid_component::async_submit(io_request_t * requests,
+                                  size_t count,
+                                  int queue_id)
+{
+  std::vector<io_request_t> per_device[MAX_DEVICE_COUNT];
+  std::vector<size_t>       origin[MAX_DEVICE_COUNT];
+
+  for(size_t i = 0; i < count; i++) {
+    io_request_t& r = requests[i];
+    if(r.segment_count != 1 || r.segments[0].lba_count != 1)
+      throw API_exception("invalid parameter(s)");
+
+    unsigned index;
+    select_device(r.lba, index);
+    io_request_t dr = r;
+    dr.lba = r.lba / _device_count;
+    per_device[index].push_back(dr);
+    origin[index].push_back(i);
+  }
+
+  for(unsigned index = 0; index < _device_count; index++) {
+    auto& batch = per_device[index];
+    if(batch.empty()) continue;
+
+    _bdv_itf[index].block_device->async_submit(batch.data(), batch.size(), queue_id);
+
+    for(size_t j = 0; j < batch.size(); j++)
+      requests[origin[index][j]].gwid = (batch[j].gwid | (((uint64_t)index) << 60));
+
+    if(option_DEBUG)
+      PLOG("issuing batch of %lu to device[%u]", batch.size(), index);
+  }
+}
+
+size_t Raid_component::harvest_completions(const workid_t * lgwids,
+                                           size_t count,
+                                           workid_t * out_completed,
+                                           int queue_id)
+{
+  std::vector<workid_t> per_device[MAX_DEVICE_COUNT];
+
+  for(size_t i = 0; i < count; i++) {
+    uint64_t index = lgwids[i] >> 60;
+    if(index >= _device_count)
+      throw API_exception("invalid gwid (%lx)", lgwids[i]);
+    per_device[index].push_back(gwid_to_seq(lgwids[i]));
+  }
+
+  size_t n = 0;
+  for(unsigned index = 0; index < _device_count; index++) {
+    auto& gwids = per_device[index];
+    if(gwids.empty()) continue;
+
+    size_t done = _bdv_itf[index].block_device->harvest_completions(gwids.data(),
+                                                                    gwids.size(),
+                                                                    &out_completed[n],
+                                                                    queue_id);
+    for(size_t j = 0; j < done; j++)
+      out_completed[n + j] |= (((uint64_t)index) << 60);
+    n += done;
+  }
+  return n;
+}
+
 uint64_t Raid_component::gwid_to_seq(uint64_t gwid)
 {
   return (gwid & 0x00FFFFFFFFFFFFFFUL);
@@ -142,6 +142,34 @@ public:
    */
   virtual bool check_completion(Component::workid_t gwid, int queue_id = 0) override;
 
+  /** 
+   * Submit a batch of asynchronous IO operations; each member device
+   * gets one batch. Requests must be single-block, as for async_read.
+   * 
+   * @param requests Array of requests; gwid is set for each
+   * @param count Number of requests
+   * @param queue_id Logical queue identifier (counting from 0, -1=unspecified)
+   */
+  virtual void async_submit(io_request_t * requests,
+                            size_t count,
+                            int queue_id = 0) override;
+
+  /** 
+   * Find which of a set of work requests have completed; each member
+   * device is asked once
+   * 
+   * @param gwids Work request identifiers
+   * @param count Number of work request identifiers
+   * @param out_completed Out array of completed identifiers
+   * @param queue_id Logical queue identifier (counting from 0, -1=unspecified)
+   * 
+   * @return Number of identifiers written to out_completed
+   */
+  virtual size_t harvest_completions(const Component::workid_t * gwids,
+                                     size_t count,
+                                     Component::workid_t * out_completed,
+                                     int queue_id = 0) override;
+
   /** 
    * Get device information
    * 
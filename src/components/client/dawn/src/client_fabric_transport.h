@@ -62,6 +62,36 @@ class Fabric_transport {
     }
   }
 
+  /* work requests awaited together by one poll loop */
+  struct Wait_set {
+    void *   context[2];
+    unsigned remaining;
+  };
+
+  static Component::IFabric_op_completer::cb_acceptance wait_set_callback(
+      void *        context,
+      status_t      st,
+      std::uint64_t completion_flags,
+      std::size_t   len,
+      void *        error_data,
+      void *        param)
+  {
+    if (unlikely(st != S_OK))
+      throw Program_exception(
+          "poll_completions failed unexpectedly (st=%d) (cf=%lx)", st,
+          completion_flags);
+
+    auto ws = static_cast<Wait_set *>(param);
+    for (auto &c : ws->context) {
+      if (c && c == context) {
+        c = nullptr;
+        ws->remaining--;
+        return Component::IFabric_op_completer::cb_acceptance::ACCEPT;
+      }
+    }
+    return Component::IFabric_op_completer::cb_acceptance::DEFER;
+  }
+
   /**
    * Wait for completion of a IO buffer posting
    *
@@ -75,6 +105,19 @@ class Fabric_transport {
     }
   }
 
+  /**
+   * Wait for completion of two postings, in any order, in a single
+   * poll loop
+   *
+   */
+  void wait_for_completions(void *wr0, void *wr1)
+  {
+    Wait_set ws{{wr0, wr1}, 2};
+    while (ws.remaining) {
+      _transport->poll_completions_tentative(wait_set_callback, &ws);
+    }
+  }
+
   /**
    * Forwarders that allow us to avoid exposing _transport and _bm
    *
@@ -89,6 +132,11 @@ class Fabric_transport {
     return _transport->get_memory_descriptor(region);
   }
 
+  inline std::uint64_t get_memory_remote_key(memory_region_t region)
+  {
+    return _transport->get_memory_remote_key(region);
+  }
+
   inline void deregister_memory(memory_region_t region)
   {
     _transport->deregister_memory(region);
@@ -157,6 +205,32 @@ class Fabric_transport {
     iob->reset_length();
   }
 
+  /**
+   * Send a request and wait for its response. The receive is posted
+   * before the send. A request that fits is injected, which produces no
+   * send completion; otherwise the send completion is reaped in the same
+   * poll loop as the response instead of being waited for first.
+   *
+   * @param iobs Request buffer
+   * @param iobr Response buffer
+   * @param iob_extra Second buffer sent after the request (e.g. value)
+   */
+  void sync_request(buffer_t *iobs, buffer_t *iobr, buffer_t *iob_extra = nullptr)
+  {
+    post_recv(iobr);
+
+    if (!iob_extra && iobs->length() <= _max_inject_size) {
+      _transport->inject_send(iobs->base(), iobs->length());
+      wait_for_completion(iobr);
+    }
+    else {
+      post_send(iobs, iob_extra);
+      wait_for_completions(iobs, iobr);
+    }
+
+    iobs->reset_length();
+  }
+
   /**
    * Post send (one or two buffers) and wait for completion.
    *
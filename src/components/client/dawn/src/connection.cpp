@@ -19,7 +19,9 @@
 #include "connection.h"
 #include "protocol.h"
 
+#include <chrono>
 #include <memory>
+#include <vector>
 
 using namespace Component;
 
@@ -118,16 +120,8 @@ Connection_handler::pool_t Connection_handler::open_pool(const std::string name,
      * Here, &*iobr is equivalent to iobr->get(). The choice is a
      * matter of style. &* uses two fewer tokens.
      */
-    /* the sequence "post_recv, sync_inject_send, wait_for_completion"
-     * is common enough that it probably deserves its own function.
-     * But we may find that the entire single-exchange pattern as seen
-     * in open_pool, create_pool and several others could be placed in
-     * a single template function.
-     */
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr); /* await response */
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_pool_response>(iobr->base());
@@ -172,9 +166,7 @@ Connection_handler::pool_t Connection_handler::create_pool(const std::string nam
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_pool_response>(iobr->base());
@@ -203,9 +195,7 @@ status_t Connection_handler::close_pool(pool_t pool)
 
   iobs->set_length(msg->msg_len);
 
-  post_recv(&*iobr);
-  sync_inject_send(&*iobs);
-  wait_for_completion(&*iobr);
+  sync_request(&*iobs, &*iobr);
 
   const auto response_msg =
     response_ptr<const Dawn::Protocol::Message_pool_response>(iobr->base());
@@ -230,9 +220,7 @@ status_t Connection_handler::delete_pool(const std::string& name)
                                                                           name);
   iobs->set_length(msg->msg_len);
 
-  post_recv(&*iobr);
-  sync_inject_send(&*iobs);
-  wait_for_completion(&*iobr);
+  sync_request(&*iobs, &*iobr);
 
   const auto response_msg =
     response_ptr<const Dawn::Protocol::Message_pool_response>(iobr->base());
@@ -260,9 +248,7 @@ status_t Connection_handler::configure_pool(const Component::IKVStore::pool_t po
 
   iobs->set_length(msg->msg_len);
 
-  post_recv(&*iobr);
-  sync_inject_send(&*iobs);
-  wait_for_completion(&*iobr);
+  sync_request(&*iobs, &*iobr);
 
   const auto response_msg =
     response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -294,12 +280,31 @@ status_t Connection_handler::put(const pool_t pool,
                                  const size_t value_len,
                                  uint32_t flags)
 {
-  API_LOCK();
-
   if (option_DEBUG)
     PINF("put: %.*s (key_len=%lu) (value_len=%lu)", (int) key_len, (char*) key,
          key_len, value_len);
 
+  if (key_len + value_len + 1 + sizeof(Dawn::Protocol::Message_IO_request) <=
+      MAX_BATCHED_MESSAGE) {
+    alignas(8) char buffer[MAX_BATCHED_MESSAGE];
+    const auto      msg = new (buffer) Dawn::Protocol::Message_IO_request(sizeof(buffer),
+                                                                          auth_id(),
+                                                                          ++_request_id,
+                                                                          pool,
+                                                                          Dawn::Protocol::OP_PUT,
+                                                                          key,
+                                                                          key_len,
+                                                                          value,
+                                                                          value_len,
+                                                                          flags);
+    if (_options.short_circuit_backend)
+      msg->resvd |= Dawn::Protocol::MSG_RESVD_SCBE;
+
+    return batched_request(msg);
+  }
+
+  API_LOCK();
+
   /* check key length */
   if ((key_len + value_len + sizeof(Dawn::Protocol::Message_IO_request)) >
       Buffer_manager<Component::IFabric_client>::BUFFER_LEN) {
@@ -329,9 +334,7 @@ status_t Connection_handler::put(const pool_t pool,
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -364,11 +367,19 @@ status_t Connection_handler::two_stage_put_direct(const pool_t
   assert(value_len <= _max_message_size);
   assert(value_len > 0);
 
+  buffer_t* value_buffer = reinterpret_cast<buffer_t*>(handle);
+  assert(value_buffer->check_magic());
+
+  if (option_DEBUG)
+    PLOG("value_buffer: (iov_len=%lu, region=%p, desc=%p)",
+         value_buffer->iov->iov_len, value_buffer->region, value_buffer->desc);
+
   {
     const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
     const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
 
-    /* send advance leader message */
+    /* send advance leader message; the server reads the value from
+       the registered buffer and responds once it has it */
     const auto request_id = ++_request_id;
     const auto msg        = new (iobs->base())
       Protocol::Message_IO_request(iobs->length(),
@@ -376,37 +387,28 @@ status_t Connection_handler::two_stage_put_direct(const pool_t
                                    Protocol::OP_PUT_ADVANCE,  // op
                                    key, key_len, value_len, flags);
     msg->flags = flags;
+
+    const Protocol::Put_advance_param param{reinterpret_cast<uint64_t>(value_buffer->base()),
+                                            get_memory_remote_key(value_buffer->region)};
+    if (msg->msg_len + sizeof(param) > iobs->length())
+      return IKVStore::E_TOO_LARGE;
+    memcpy(const_cast<char*>(msg->value()), &param, sizeof(param));
+    msg->msg_len += sizeof(param);
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
-    
-    /* wait for response from header before posting the value */    
 
     if(option_DEBUG)
       PMAJOR("got response (status=%u) from put direct header",response_msg->status);
 
-    /* if response is not OK, don't follow with the value */
     if(response_msg->status != S_OK) {
-      return msg->status;
+      return response_msg->status;
     }
   }
 
-  /* send value */
-  buffer_t* value_buffer = reinterpret_cast<buffer_t*>(handle);
-  value_buffer->set_length(value_len);
-  assert(value_buffer->check_magic());
-
-  if (option_DEBUG)
-    PLOG("value_buffer: (iov_len=%lu, region=%p, desc=%p)",
-         value_buffer->iov->iov_len, value_buffer->region, value_buffer->desc);
-
-  sync_send(value_buffer);  // client owns buffer
-
   if (option_DEBUG) {
     PINF("two_stage_put_direct: complete");
   }
@@ -495,9 +497,7 @@ status_t Connection_handler::put_direct(const pool_t                         poo
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_send(&*iobs, value_buffer); /* send two concatentated buffers in single DMA */
-    wait_for_completion(&*iobr); /* get response */
+    sync_request(&*iobs, &*iobr, value_buffer); /* request and value sent in a single DMA */
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -543,9 +543,7 @@ status_t Connection_handler::get(const pool_t       pool,
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -601,9 +599,7 @@ status_t Connection_handler::get(const pool_t       pool,
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr); /* TODO; could we issue the recv and send together? */
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -698,9 +694,7 @@ status_t Connection_handler::get_direct(const pool_t                         poo
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr); /* get response */
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -746,6 +740,19 @@ status_t Connection_handler::get_direct(const pool_t                         poo
 status_t Connection_handler::erase(const pool_t pool,
                                    const std::string& key)
 {
+  if (key.length() + 1 + sizeof(Dawn::Protocol::Message_IO_request) <= MAX_BATCHED_MESSAGE) {
+    alignas(8) char buffer[MAX_BATCHED_MESSAGE];
+    const auto      msg = new (buffer) Dawn::Protocol::Message_IO_request(sizeof(buffer),
+                                                                          auth_id(),
+                                                                          ++_request_id,
+                                                                          pool,
+                                                                          Dawn::Protocol::OP_ERASE,
+                                                                          key.c_str(),
+                                                                          key.length(),
+                                                                          0);
+    return batched_request(msg);
+  }
+
   API_LOCK();
 
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -767,9 +774,7 @@ status_t Connection_handler::erase(const pool_t pool,
 
     iobs->set_length(msg->msg_len);
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_IO_response>(iobr->base());
@@ -787,6 +792,108 @@ status_t Connection_handler::erase(const pool_t pool,
   return status;
 }
 
+status_t Connection_handler::batched_request(const Dawn::Protocol::Message_IO_request* msg)
+{
+  Batched_request request{msg, E_FAIL, false};
+
+  std::unique_lock<std::mutex> g(_batch_lock);
+  _batch.push_back(&request);
+
+  while (!request.done) {
+    g.unlock();
+#ifdef THREAD_SAFE_CLIENT
+    /* whichever thread gets the connection sends everything queued so
+       far; the others wait for their responses to be filled in */
+    if (_api_lock.try_lock()) {
+      send_batch();
+      _api_lock.unlock();
+      _batch_cv.notify_all();
+      g.lock();
+    }
+    else {
+      g.lock();
+      if (!request.done)
+        _batch_cv.wait_for(g, std::chrono::microseconds(BATCH_WAIT_USEC));
+    }
+#else
+    send_batch();
+    g.lock();
+#endif
+  }
+  return request.status;
+}
+
+void Connection_handler::send_batch()
+{
+  using namespace Dawn::Protocol;
+
+  std::vector<Batched_request*> batch;
+  {
+    std::lock_guard<std::mutex> g(_batch_lock);
+    while (!_batch.empty() && batch.size() < MAX_BATCH) {
+      batch.push_back(_batch.front());
+      _batch.pop_front();
+    }
+  }
+  if (batch.empty()) return;
+
+  std::vector<status_t> status(batch.size(), E_FAIL);
+
+  try {
+    const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+
+    /* requests are packed on 8-byte boundaries; all but the last are
+       flagged so that the shard looks for the next */
+    auto   base   = static_cast<char*>(iobs->base());
+    size_t offset = 0;
+    size_t length = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+      const auto msg = batch[i]->msg;
+      auto       copy = reinterpret_cast<Message*>(base + offset);
+      memcpy(static_cast<void*>(copy), msg, msg->msg_len);
+      if (i + 1 < batch.size()) copy->resvd |= MSG_RESVD_BATCH;
+      length = offset + msg->msg_len;
+      offset += batch_stride(msg->msg_len);
+    }
+    iobs->set_length(length);
+
+    /* each response arrives separately; give each a slot of one buffer */
+    std::vector<::iovec> slots(batch.size());
+    for (size_t i = 0; i < slots.size(); i++) {
+      slots[i] = {static_cast<char*>(iobr->base()) + i * RESPONSE_SLOT, RESPONSE_SLOT};
+      post_recv(&slots[i], &slots[i] + 1, &iobr->desc, &slots[i]);
+    }
+
+    sync_inject_send(&*iobs);
+
+    /* the shard may reorder requests for different pools, so responses
+       are matched by request id */
+    for (auto& slot : slots) {
+      wait_for_completion(&slot);
+
+      const auto response_msg =
+        response_ptr<const Message_IO_response>(slot.iov_base);
+
+      for (size_t i = 0; i < batch.size(); i++) {
+        if (batch[i]->msg->request_id == response_msg->request_id) {
+          status[i] = response_msg->status;
+          break;
+        }
+      }
+    }
+  }
+  catch(...) {
+    PWRN("Dawn_client: batched request failed");
+  }
+
+  std::lock_guard<std::mutex> g(_batch_lock);
+  for (size_t i = 0; i < batch.size(); i++) {
+    batch[i]->status = status[i];
+    batch[i]->done   = true;
+  }
+}
+
 size_t Connection_handler::count(const pool_t pool)
 {
   API_LOCK();
@@ -802,9 +909,7 @@ size_t Connection_handler::count(const pool_t pool)
     msg->type = Component::IKVStore::Attribute::COUNT;
     iobs->set_length(msg->base_message_size());
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_INFO_response>(iobr->base());
@@ -840,9 +945,7 @@ status_t Connection_handler::get_attribute(const IKVStore::pool_t pool,
     msg->set_key(iobs->length(), *key);
     iobs->set_length(msg->message_size());
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_INFO_response>(iobr->base());
@@ -876,9 +979,7 @@ status_t Connection_handler::get_statistics(Component::IDawn::Shard_stats& out_s
     msg->type = Dawn::Protocol::INFO_TYPE_GET_STATS;
     iobs->set_length(msg->message_size());
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_stats>(iobr->base());
@@ -917,9 +1018,7 @@ status_t Connection_handler::find(const IKVStore::pool_t pool,
     msg->set_key(iobs->length(), key_expression);
     iobs->set_length(msg->message_size());
 
-    post_recv(&*iobr);
-    sync_inject_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_INFO_response>(iobr->base());
@@ -939,6 +1038,193 @@ status_t Connection_handler::find(const IKVStore::pool_t pool,
 }
 
 
+status_t Connection_handler::scan(const IKVStore::pool_t pool,
+                                  const std::string& start_key,
+                                  const std::string& prefix,
+                                  const size_t max_count,
+                                  const size_t max_bytes,
+                                  std::vector<std::pair<std::string, std::string>>& out_pairs,
+                                  std::vector<size_t>& out_omitted,
+                                  std::string& out_cursor)
+{
+  using namespace Dawn::Protocol;
+
+  API_LOCK();
+
+  const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  assert(iobs);
+  assert(iobr);
+
+  status_t status;
+
+  try {
+    /* parameters travel in the value field, followed by the prefix */
+    std::string param(sizeof(Scan_request_param), '\0');
+    const Scan_request_param p{max_count, max_bytes};
+    memcpy(&param[0], &p, sizeof(p));
+    param += prefix;
+
+    const auto msg = new (iobs->base()) Message_IO_request(iobs->length(),
+                                                           auth_id(),
+                                                           ++_request_id,
+                                                           pool,
+                                                           OP_SCAN,
+                                                           start_key,
+                                                           param,
+                                                           0);
+    iobs->set_length(msg->msg_len);
+
+    sync_request(&*iobs, &*iobr);
+
+    const auto response_msg =
+      response_ptr<const Message_IO_response>(iobr->base());
+
+    status = response_msg->status;
+    out_cursor.clear();
+
+    if(status == S_OK) {
+      const char * p_data = response_msg->data;
+      const size_t data_len = response_msg->data_length();
+      if(data_len < sizeof(Scan_response_header))
+        throw Protocol_exception("bad scan response");
+
+      Scan_response_header header;
+      memcpy(&header, p_data, sizeof(header));
+      size_t pos = sizeof(header);
+
+      for(uint32_t i=0; i<header.count; i++) {
+        Scan_record_header rec;
+        if(pos + sizeof(rec) > data_len)
+          throw Protocol_exception("bad scan response");
+        memcpy(&rec, p_data + pos, sizeof(rec));
+        pos += sizeof(rec);
+
+        const bool omitted = (rec.value_len == Scan_record_header::VALUE_OMITTED);
+        const size_t value_len = omitted ? 0 : rec.value_len;
+        if(pos + rec.key_len + value_len > data_len)
+          throw Protocol_exception("bad scan response");
+
+        if(omitted)
+          out_omitted.push_back(i);
+
+        out_pairs.emplace_back(std::string(p_data + pos, rec.key_len),
+                               std::string(p_data + pos + rec.key_len, value_len));
+        pos += rec.key_len + value_len;
+      }
+
+      /* continue from the immediate successor of the last key */
+      if(header.more && header.count > 0) {
+        out_cursor = out_pairs.back().first;
+        out_cursor.push_back('\0');
+      }
+    }
+
+    if (option_DEBUG)
+      PLOG("got response from SCAN operation: status=%d pairs=%lu cursor_len=%lu",
+           status, out_pairs.size(), out_cursor.size());
+  }
+  catch(...) {
+    status = E_FAIL;
+  }
+
+  return status;
+}
+
+
+status_t Connection_handler::atomic_update(const IKVStore::pool_t pool,
+                                          const std::string& key,
+                                          const std::vector<IKVStore::Operation*>& op_vector)
+{
+  using namespace Dawn::Protocol;
+
+  if(op_vector.empty())
+    return E_BAD_PARAM;
+
+  /* encode operation vector; write data follows its descriptor */
+  std::string ops;
+  for(auto op : op_vector) {
+    Atomic_update_op desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = static_cast<uint32_t>(op->type());
+    desc.offset = op->offset();
+    const IKVStore::Operation_write * wr = nullptr;
+
+    switch(op->type()) {
+    case IKVStore::Op_type::WRITE:
+      wr = static_cast<const IKVStore::Operation_write*>(op);
+      desc.len = wr->size();
+      break;
+    case IKVStore::Op_type::ZERO:
+      desc.len = static_cast<const IKVStore::Operation_zero*>(op)->size();
+      break;
+    case IKVStore::Op_type::INCREMENT_UINT64:
+      desc.arg0 = static_cast<const IKVStore::Operation_increment_uint64*>(op)->delta();
+      break;
+    case IKVStore::Op_type::CAS_UINT64:
+      desc.arg0 = static_cast<const IKVStore::Operation_cas_uint64*>(op)->expected();
+      desc.arg1 = static_cast<const IKVStore::Operation_cas_uint64*>(op)->desired();
+      break;
+    default:
+      return E_NOT_SUPPORTED;
+    }
+
+    ops.append(reinterpret_cast<const char*>(&desc), sizeof(desc));
+    if(wr)
+      ops.append(static_cast<const char*>(wr->data()), wr->size());
+  }
+
+  API_LOCK();
+
+  const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  assert(iobs);
+  assert(iobr);
+
+  status_t status;
+
+  try {
+    const auto msg = new (iobs->base()) Message_IO_request(iobs->length(),
+                                                           auth_id(),
+                                                           ++_request_id,
+                                                           pool,
+                                                           OP_ATOMIC_UPDATE,
+                                                           key,
+                                                           ops,
+                                                           0);
+    iobs->set_length(msg->msg_len);
+
+    sync_request(&*iobs, &*iobr);
+
+    const auto response_msg =
+      response_ptr<const Message_IO_response>(iobr->base());
+
+    status = response_msg->status;
+
+    /* results are also returned for a failed compare-and-swap */
+    if(response_msg->data_length() == op_vector.size() * sizeof(uint64_t)) {
+      for(size_t i=0;i<op_vector.size();i++) {
+        uint64_t result;
+        memcpy(&result, response_msg->data + (i * sizeof(uint64_t)), sizeof(result));
+        if(op_vector[i]->type() == IKVStore::Op_type::INCREMENT_UINT64)
+          static_cast<IKVStore::Operation_increment_uint64*>(op_vector[i])->set_result(result);
+        else if(op_vector[i]->type() == IKVStore::Op_type::CAS_UINT64)
+          static_cast<IKVStore::Operation_cas_uint64*>(op_vector[i])->set_result(result);
+      }
+    }
+
+    if (option_DEBUG)
+      PLOG("got response from ATOMIC_UPDATE operation: status=%d ops=%lu",
+           status, op_vector.size());
+  }
+  catch(...) {
+    status = E_FAIL;
+  }
+
+  return status;
+}
+
+
 status_t Connection_handler::invoke_ado(const IKVStore::pool_t pool,
                                         const std::string& key,
                                         const std::vector<uint8_t>& request,
@@ -966,9 +1252,7 @@ status_t Connection_handler::invoke_ado(const IKVStore::pool_t pool,
                                                                             value_size);
     iobs->set_length(msg->message_size());
 
-    post_recv(&*iobr);
-    sync_send(&*iobs);
-    wait_for_completion(&*iobr);
+    sync_request(&*iobs, &*iobr);
 
     const auto response_msg =
       response_ptr<const Dawn::Protocol::Message_ado_response>(iobr->base());
@@ -1026,6 +1310,7 @@ int Connection_handler::tick()
     PMAJOR("client : HANDSHAKE_GET_RESPONSE");
 
     _max_message_size = max_message_size(); /* from fabric component */
+    if (response_msg->credits > 0) _credits = response_msg->credits;
     break;
   }
   case READY: {
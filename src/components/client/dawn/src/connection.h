@@ -20,6 +20,9 @@
 #include <sys/mman.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <set>
 
@@ -42,6 +45,11 @@
 
 namespace Dawn
 {
+namespace Protocol
+{
+struct Message_IO_request;
+}
+
 namespace Client
 {
 /* Adaptor point for other transports */
@@ -54,6 +62,11 @@ using Connection_base = Dawn::Client::Fabric_transport;
 class Connection_handler : public Connection_base {
   const bool option_DEBUG = Dawn::Global::debug_level > 1;
 
+  static constexpr unsigned MAX_BATCH           = 16;   /*< requests coalesced into one send */
+  static constexpr size_t   MAX_BATCHED_MESSAGE = 1024; /*< larger requests are sent alone */
+  static constexpr size_t   RESPONSE_SLOT       = 256;  /*< receive space per batched response */
+  static constexpr unsigned BATCH_WAIT_USEC     = 20;   /*< recheck interval while queued */
+
  public:
   using memory_region_t = typename Transport::memory_region_t;
 
@@ -169,6 +182,27 @@ class Connection_handler : public Connection_base {
                 offset_t& out_matched_offset,
                 std::string& out_matched_key);
 
+  /**
+   * Read one batch of key-value pairs in key order
+   *
+   * @param out_pairs [out] Pairs are appended
+   * @param out_omitted [out] Batch-relative indices of pairs whose value
+   * was too large to be returned and must be fetched with get
+   * @param out_cursor [out] Start key of next batch, empty when done
+   */
+  status_t scan(const Component::IKVStore::pool_t pool,
+                const std::string& start_key,
+                const std::string& prefix,
+                const size_t max_count,
+                const size_t max_bytes,
+                std::vector<std::pair<std::string, std::string>>& out_pairs,
+                std::vector<size_t>& out_omitted,
+                std::string& out_cursor);
+
+  status_t atomic_update(const Component::IKVStore::pool_t pool,
+                         const std::string& key,
+                         const std::vector<Component::IKVStore::Operation*>& op_vector);
+
   status_t invoke_ado(const Component::IKVStore::pool_t pool,
                       const std::string& key,
                       const std::vector<uint8_t>& request,
@@ -178,8 +212,35 @@ class Connection_handler : public Connection_base {
 
   bool check_message_size(size_t size) const { return size > _max_message_size; }
 
+  /* requests the server will accept outstanding on this session */
+  unsigned credits() const { return _credits; }
+
  private:
-  
+  /* small request queued to be sent, possibly with those of other threads */
+  struct Batched_request {
+    const Dawn::Protocol::Message_IO_request* msg;
+    status_t                                  status;
+    bool                                      done;
+  };
+
+  /**
+   * Issue a small IO request whose response carries only a status. Requests
+   * queued by threads sharing this connection are sent together in one
+   * buffer by whichever thread holds the connection.
+   *
+   * @param msg Request, built by the caller
+   *
+   * @return Response status
+   */
+  status_t batched_request(const Dawn::Protocol::Message_IO_request* msg);
+
+  /**
+   * Send the queued requests (up to MAX_BATCH) and collect their
+   * responses. Called with the API lock held.
+   *
+   */
+  void send_batch();
+
   /**
    * FSM tick call
    *
@@ -223,10 +284,15 @@ class Connection_handler : public Connection_base {
   std::mutex _api_lock;
 #endif
 
+  std::mutex                   _batch_lock;
+  std::condition_variable      _batch_cv;
+  std::deque<Batched_request*> _batch;
+
   bool     _exit                = false;
-  uint64_t _request_id          = 0;
+  std::atomic<uint64_t> _request_id{0};
   size_t   _max_message_size    = 0;
   size_t   _max_inject_size     = 0;
+  unsigned _credits             = 1;
 
   struct {
     bool short_circuit_backend = false;
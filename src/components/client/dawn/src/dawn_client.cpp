@@ -17,11 +17,16 @@
 #include <api/fabric_itf.h>
 #include <city.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <numeric>
+#include <random>
 #include <regex>
+#include <sstream>
 #include <thread>
-#include <random>
-#include <chrono>
 
 using namespace Component;
 
@@ -33,6 +38,17 @@ unsigned debug_level = 0;
 }
 }  // namespace Dawn
 
+namespace
+{
+/* small dense number for the calling thread, used to spread threads over sessions */
+unsigned thread_ordinal()
+{
+  static std::atomic<unsigned> next{0};
+  thread_local unsigned        ordinal = next++;
+  return ordinal;
+}
+}  // namespace
+
 Dawn_client::Dawn_client(unsigned           debug_level,
                          const std::string& owner,
                          const std::string& addr_port_str,
@@ -42,104 +58,215 @@ Dawn_client::Dawn_client(unsigned           debug_level,
 
   Dawn::Global::debug_level = debug_level;
 
-  smatch m;
-
-  try {
-    /* e.g. 10.0.0.21:11911 (verbs)
-       9.1.75.6:11911:sockets (sockets)
-    */
-    regex r("([[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+)[:]([[:"
-            "digit:]]+)(?:[:]([[:alnum:]]+))?");
-    regex_search(addr_port_str, m, r);
+  /* e.g. 10.0.0.21:11911 (verbs)
+     9.1.75.6:11911:sockets (sockets)
+     10.0.0.21:11911-11926,10.0.0.22:11911-11926 (shards)
+  */
+  regex r("([[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+[.][[:digit:]]+)[:]([[:"
+          "digit:]]+)(?:[-]([[:digit:]]+))?(?:[:]([[:alnum:]]+))?");
+
+  std::string       endpoint;
+  std::stringstream ss(addr_port_str);
+  while (std::getline(ss, endpoint, ',')) {
+    smatch m;
+    if (!regex_match(endpoint, m, r))
+      throw API_exception("invalid endpoint (%s)", endpoint.c_str());
+
+    const int first = stoi(m[2].str());
+    const int last  = m[3].matched ? stoi(m[3].str()) : first;
+    if (last < first)
+      throw API_exception("invalid port range (%s)", endpoint.c_str());
+
+    const std::string provider = m[4].matched ? m[4].str() : "verbs"; /* default provider */
+    if (!_provider.empty() && provider != _provider)
+      throw API_exception("shards must use one fabric provider");
+    _provider = provider;
+
+    for (int port = first; port <= last; port++) {
+      _shards.emplace_back();
+      _shards.back().endpoint = Endpoint{m[1].str(), port};
+    }
   }
-  catch (...) {
+
+  if (_shards.empty())
     throw API_exception("invalid parameter");
-  }
 
-  const std::string ip_addr = m[1].str();
-  char*             end;
-  const int         port = (int) strtoul(m[2].str().c_str(), &end, 10);
-  const std::string provider =
-      m[3].matched ? m[3].str() : "verbs"; /* default provider */
+  if (_shards.size() > (size_t(1) << (64 - SHARD_OFFSET_SHIFT)))
+    throw API_exception("too many shards");
 
-  PMAJOR("Dawn-client protocol session: %p (%s) (%d) (%s)", this,
-         ip_addr.c_str(), port, provider.c_str());
+  char* env = getenv("DAWN_SESSIONS_PER_SHARD");
+  if (env && atoi(env) > 0)
+    _sessions_per_shard = unsigned(atoi(env));
 
-  open_transport(device, ip_addr, port, provider);
+  for (auto& shard : _shards)
+    shard.sessions.reset(new std::atomic<Session*>[_sessions_per_shard]());
+
+  PMAJOR("Dawn-client protocol session: %p (%s) (%lu shards) (%s)", this,
+         addr_port_str.c_str(), _shards.size(), _provider.c_str());
+
+  open_transport(device, _provider);
 }
 
 Dawn_client::~Dawn_client() { close_transport(); }
 
 void Dawn_client::open_transport(const std::string& device,
-                                 const std::string& ip_addr,
-                                 const int          port,
                                  const std::string& provider)
 {
-    PMAJOR("Enter LOAD component pid %d", int(getpid()));
-  {
-    IBase* comp = load_component("libcomanche-fabric.so", net_fabric_factory);
-    PMAJOR("LOADED component pid %d", int(getpid()));
-    assert(comp);
-    _factory = static_cast<IFabric_factory*>(
-        comp->query_interface(IFabric_factory::iid()));
-    assert(_factory);
-
-    /* The libfabric 1.6 sockets provider requires a "BASIC" specfication, which
-     * is supposedly obsolete after libfabric 1.4.
-     */
-    const std::string mr_mode =
-        provider == "sockets" ? "[ \"FI_MR_BASIC\" ]"
-                              : "[ \"FI_MR_LOCAL\", \"FI_MR_VIRT_ADDR\", "
-                                "\"FI_MR_ALLOCATED\", \"FI_MR_PROV_KEY\" ]";
-
-    const std::string fabric_spec{"{ \"fabric_attr\" : { \"prov_name\" : \"" +
-                                  provider +
-                                  "\" },"
-                                  " \"domain_attr\" : "
-                                  "{ \"mr_mode\" : " +
-                                  mr_mode + " , \"name\" : \"" + device +
-                                  "\" }"
-                                  ","
-                                  " \"ep_attr\" : { \"type\" : \"FI_EP_MSG\" }"
-                                  "}"};
-    PMAJOR("TRY TO OPEN FABRIC pid %d", int(getpid()));
-
-    _fabric = _factory->make_fabric(fabric_spec);
-    const std::string client_spec{"{}"};
-
-    std::mt19937_64 eng{std::random_device{}()};  // or seed however you want
-    std::uniform_int_distribution<> dist{10, 100};
-    std::this_thread::sleep_for(std::chrono::milliseconds{dist(eng)});
-
-    _transport = _fabric->open_client(client_spec, ip_addr, port);
-    assert(_transport);
-  }
+  PMAJOR("Enter LOAD component pid %d", int(getpid()));
+
+  IBase* comp = load_component("libcomanche-fabric.so", net_fabric_factory);
+  PMAJOR("LOADED component pid %d", int(getpid()));
+  assert(comp);
+  _factory = static_cast<IFabric_factory*>(
+      comp->query_interface(IFabric_factory::iid()));
+  assert(_factory);
+
+  /* The libfabric 1.6 sockets provider requires a "BASIC" specfication, which
+   * is supposedly obsolete after libfabric 1.4.
+   */
+  const std::string mr_mode =
+      provider == "sockets" ? "[ \"FI_MR_BASIC\" ]"
+                            : "[ \"FI_MR_LOCAL\", \"FI_MR_VIRT_ADDR\", "
+                              "\"FI_MR_ALLOCATED\", \"FI_MR_PROV_KEY\" ]";
+
+  const std::string fabric_spec{"{ \"fabric_attr\" : { \"prov_name\" : \"" +
+                                provider +
+                                "\" },"
+                                " \"domain_attr\" : "
+                                "{ \"mr_mode\" : " +
+                                mr_mode + " , \"name\" : \"" + device +
+                                "\" }"
+                                ","
+                                " \"ep_attr\" : { \"type\" : \"FI_EP_MSG\" }"
+                                "}"};
+  PMAJOR("TRY TO OPEN FABRIC pid %d", int(getpid()));
+
+  _fabric = _factory->make_fabric(fabric_spec);
+
+  std::mt19937_64 eng{std::random_device{}()};  // or seed however you want
+  std::uniform_int_distribution<> dist{10, 100};
+  std::this_thread::sleep_for(std::chrono::milliseconds{dist(eng)});
+
+  /* connect the calling thread to every shard up front so that an
+     unreachable shard is reported here; other sessions connect on demand */
+  for (unsigned i = 0; i < _shards.size(); i++)
+    session(i);
 
   PMAJOR("FABRIC OPEN CLIENT");
-
-  assert(_transport);
-  _connection = new Dawn::Client::Connection_handler(_transport);
-  _connection->bootstrap();
 }
 
 void Dawn_client::close_transport()
 {
   PLOG("Dawn_client: closing fabric transport (%p)", this);
 
-  if (_connection) {
-    _connection->shutdown();
+  for (auto& shard : _shards) {
+    for (unsigned i = 0; i < _sessions_per_shard; i++) {
+      Session* s = shard.sessions[i].load();
+      if (!s) continue;
+      s->connection->shutdown();
+      delete s->connection;
+      delete s->transport;
+      delete s;
+    }
   }
 
-  delete _connection;
-  delete _transport;
+  for (auto r : _regions)
+    delete r;
+
   delete _fabric;
   _factory->release_ref();
   PLOG("Dawn_client: closed fabric transport.");
 }
 
+unsigned Dawn_client::shard_of(const std::string& key) const
+{
+  if (_shards.size() == 1) return 0;
+  return unsigned(CityHash64WithSeed(key.data(), key.size(), ROUTING_SEED) % _shards.size());
+}
+
+Dawn_client::Session& Dawn_client::session(unsigned shard)
+{
+  auto& slot = _shards[shard].sessions[thread_ordinal() % _sessions_per_shard];
+
+  Session* s = slot.load(std::memory_order_acquire);
+  if (s) return *s;
+
+  std::lock_guard<std::mutex> g(_sessions_lock);
+  s = slot.load(std::memory_order_relaxed);
+  if (!s) {
+    const Endpoint& ep = _shards[shard].endpoint;
+    std::unique_ptr<Session> ns(new Session());
+    ns->transport = _fabric->open_client("{}", ep.ip_addr, ep.port);
+    assert(ns->transport);
+    ns->connection = new Connection_handler(ns->transport);
+    ns->connection->bootstrap();
+    s = ns.release();
+    slot.store(s, std::memory_order_release);
+
+    if (Dawn::Global::debug_level > 0)
+      PLOG("Dawn_client: session %p to %s:%d", (void*) s, ep.ip_addr.c_str(), ep.port);
+  }
+  return *s;
+}
+
+IKVStore::pool_t Dawn_client::session_pool(Session& session, pool_t pool)
+{
+  std::lock_guard<std::mutex> g(session.lock);
+
+  auto i = session.pools.find(pool);
+  if (i != session.pools.end()) return i->second;
+
+  Pool p;
+  {
+    std::lock_guard<std::mutex> gp(_pools_lock);
+    auto j = _pools.find(pool);
+    if (j == _pools.end()) return POOL_ERROR;
+    p = j->second;
+  }
+
+  const pool_t sp = session.connection->open_pool(p.name, p.flags);
+  if (sp != POOL_ERROR) session.pools[pool] = sp;
+  return sp;
+}
+
+IKVStore::memory_handle_t Dawn_client::session_handle(Session&        session,
+                                                      memory_handle_t handle)
+{
+  if (handle == HANDLE_NONE) return HANDLE_NONE;
+
+  auto reg = reinterpret_cast<Registration*>(handle);
+
+  std::lock_guard<std::mutex> g(session.lock);
+  auto i = session.regions.find(reg);
+  if (i != session.regions.end()) return i->second;
+
+  const auto h = session.connection->register_direct_memory(reg->vaddr, reg->len);
+  session.regions[reg] = h;
+  return h;
+}
+
+status_t Dawn_client::for_each_shard(const std::function<status_t(unsigned, Session&)>& fn)
+{
+  /* sessions belong to the calling thread, so resolve them before fanning out */
+  std::vector<Session*> sessions;
+  for (unsigned i = 0; i < _shards.size(); i++)
+    sessions.push_back(&session(i));
+
+  std::vector<std::future<status_t>> results;
+  for (unsigned i = 1; i < sessions.size(); i++)
+    results.push_back(std::async(std::launch::async, fn, i, std::ref(*sessions[i])));
+
+  status_t hr = fn(0, *sessions[0]);
+  for (auto& r : results) {
+    const status_t h = r.get();
+    if (hr == S_OK) hr = h;
+  }
+  return hr;
+}
+
 int Dawn_client::thread_safety() const
 {
-  return IKVStore::THREAD_MODEL_SINGLE_PER_POOL;
+  return IKVStore::THREAD_MODEL_MULTI_PER_POOL;
 }
 
 int Dawn_client::get_capability(Capability cap) const
@@ -158,30 +285,105 @@ IKVStore::pool_t Dawn_client::create_pool(const std::string& name,
                                           uint32_t           flags,
                                           uint64_t           expected_obj_count)
 {
-  return _connection->create_pool(name, size, flags, expected_obj_count);
+  /* keys are spread evenly, so each shard holds its share of the pool */
+  const size_t n = _shards.size();
+  std::vector<pool_t> created(n, POOL_ERROR);
+
+  auto hr = for_each_shard([&](unsigned shard, Session& s) {
+    created[shard] = s.connection->create_pool(name, (size + n - 1) / n, flags,
+                                               (expected_obj_count + n - 1) / n);
+    return created[shard] == POOL_ERROR ? E_FAIL : S_OK;
+  });
+
+  /* pools that are opened again later are opened without the create flags */
+  return add_pool(name, 0, hr == S_OK, created);
 }
 
 IKVStore::pool_t Dawn_client::open_pool(const std::string& name,
                                         uint32_t       flags)
 {
-  return _connection->open_pool(name, flags);
+  const size_t n = _shards.size();
+  std::vector<pool_t> opened(n, POOL_ERROR);
+
+  auto hr = for_each_shard([&](unsigned shard, Session& s) {
+    opened[shard] = s.connection->open_pool(name, flags);
+    return opened[shard] == POOL_ERROR ? E_FAIL : S_OK;
+  });
+
+  return add_pool(name, flags, hr == S_OK, opened);
+}
+
+IKVStore::pool_t Dawn_client::add_pool(const std::string&         name,
+                                       uint32_t                   flags,
+                                       bool                       complete,
+                                       const std::vector<pool_t>& shard_pools)
+{
+  if (!complete) {
+    for (unsigned i = 0; i < shard_pools.size(); i++) {
+      if (shard_pools[i] != POOL_ERROR)
+        session(i).connection->close_pool(shard_pools[i]);
+    }
+    return POOL_ERROR;
+  }
+
+  pool_t pool;
+  {
+    std::lock_guard<std::mutex> g(_pools_lock);
+    pool = _next_pool++;
+  }
+
+  for (unsigned i = 0; i < shard_pools.size(); i++) {
+    Session& s = session(i);
+    std::lock_guard<std::mutex> g(s.lock);
+    s.pools[pool] = shard_pools[i];
+  }
+
+  std::lock_guard<std::mutex> g(_pools_lock);
+  _pools[pool] = Pool{name, flags};
+  return pool;
 }
 
 status_t Dawn_client::close_pool(const IKVStore::pool_t pool)
 {
   if(!pool) return E_INVAL;
-  return _connection->close_pool(pool);
+
+  {
+    std::lock_guard<std::mutex> g(_pools_lock);
+    if (_pools.erase(pool) == 0) return E_INVAL;
+  }
+
+  /* the pool may be open on any session that a thread used it from */
+  status_t hr = S_OK;
+  for (auto& shard : _shards) {
+    for (unsigned i = 0; i < _sessions_per_shard; i++) {
+      Session* s = shard.sessions[i].load(std::memory_order_acquire);
+      if (!s) continue;
+      std::lock_guard<std::mutex> g(s->lock);
+      auto j = s->pools.find(pool);
+      if (j == s->pools.end()) continue;
+      const status_t h = s->connection->close_pool(j->second);
+      if (hr == S_OK) hr = h;
+      s->pools.erase(j);
+    }
+  }
+  return hr;
 }
 
 status_t Dawn_client::delete_pool(const std::string& name)
 {
-  return _connection->delete_pool(name);
+  return for_each_shard([&](unsigned, Session& s) {
+    return s.connection->delete_pool(name);
+  });
 }
 
 status_t Dawn_client::configure_pool(const IKVStore::pool_t pool,
                                      const std::string& json)
 {
-  return _connection->configure_pool(pool, json);
+  return for_each_shard([&](unsigned, Session& s) {
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return status_t(E_POOL_NOT_FOUND);
+    return s.connection->configure_pool(sp, json);
+  });
 }
 
 
@@ -192,7 +394,10 @@ status_t Dawn_client::put(const IKVStore::pool_t pool,
                           uint32_t               flags)
 {
   assert(flags < FLAGS_MAX_VALUE);
-  return _connection->put(pool, key, value, value_len, flags);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->put(sp, key, value, value_len, flags);
 }
 
 status_t Dawn_client::put_direct(const pool_t       pool,
@@ -202,7 +407,11 @@ status_t Dawn_client::put_direct(const pool_t       pool,
                                  memory_handle_t    handle,
                                  uint32_t           flags)
 {
-  return _connection->put_direct(pool, key, value, value_len, handle, flags);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->put_direct(sp, key, value, value_len,
+                                  session_handle(s, handle), flags);
 }
 
 status_t Dawn_client::get(const IKVStore::pool_t pool,
@@ -210,7 +419,10 @@ status_t Dawn_client::get(const IKVStore::pool_t pool,
                           void*&  out_value, /* release with free() */
                           size_t& out_value_len)
 {
-  return _connection->get(pool, key, out_value, out_value_len);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->get(sp, key, out_value, out_value_len);
 }
 
 status_t Dawn_client::get_direct(const pool_t       pool,
@@ -219,7 +431,11 @@ status_t Dawn_client::get_direct(const pool_t       pool,
                                  size_t&            out_value_len,
                                  memory_handle_t    handle)
 {
-  return _connection->get_direct(pool, key, out_value, out_value_len, handle);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->get_direct(sp, key, out_value, out_value_len,
+                                  session_handle(s, handle));
 }
 
 Component::IKVStore::memory_handle_t
@@ -232,22 +448,58 @@ Dawn_client::register_direct_memory(void*  vaddr,
   //        vaddr, len, strerro(errno));
   // }
 
-  return _connection->register_direct_memory(vaddr, len);
+  /* the memory is registered with each session when first used there */
+  auto reg = new Registration{vaddr, len};
+  {
+    std::lock_guard<std::mutex> g(_regions_lock);
+    _regions.insert(reg);
+  }
+  return reinterpret_cast<memory_handle_t>(reg);
 }
 
 status_t Dawn_client::unregister_direct_memory(IKVStore::memory_handle_t handle)
 {
-  return _connection->unregister_direct_memory(handle);
+  auto reg = reinterpret_cast<Registration*>(handle);
+  {
+    std::lock_guard<std::mutex> g(_regions_lock);
+    if (_regions.erase(reg) == 0) return E_INVAL;
+  }
+
+  status_t hr = S_OK;
+  for (auto& shard : _shards) {
+    for (unsigned i = 0; i < _sessions_per_shard; i++) {
+      Session* s = shard.sessions[i].load(std::memory_order_acquire);
+      if (!s) continue;
+      std::lock_guard<std::mutex> g(s->lock);
+      auto j = s->regions.find(reg);
+      if (j == s->regions.end()) continue;
+      const status_t h = s->connection->unregister_direct_memory(j->second);
+      if (hr == S_OK) hr = h;
+      s->regions.erase(j);
+    }
+  }
+  delete reg;
+  return hr;
 }
 
 status_t Dawn_client::erase(const IKVStore::pool_t pool, const std::string& key)
 {
-  return _connection->erase(pool, key);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->erase(sp, key);
 }
 
 size_t Dawn_client::count(const IKVStore::pool_t pool)
 {
-  return _connection->count(pool);
+  std::vector<size_t> counts(_shards.size(), 0);
+  for_each_shard([&](unsigned shard, Session& s) {
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return status_t(E_POOL_NOT_FOUND);
+    counts[shard] = s.connection->count(sp);
+    return status_t(S_OK);
+  });
+  return std::accumulate(counts.begin(), counts.end(), size_t(0));
 }
 
 status_t Dawn_client::get_attribute(const IKVStore::pool_t pool,
@@ -255,12 +507,57 @@ status_t Dawn_client::get_attribute(const IKVStore::pool_t pool,
                                     std::vector<uint64_t>& out_attr,
                                     const std::string* key)
 {
-  return _connection->get_attribute(pool, attr, out_attr, key);
+  if (key) {
+    auto& s = session(shard_of(*key));
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+    return s.connection->get_attribute(sp, attr, out_attr, key);
+  }
+
+  /* pool attributes: counts are summed and utilization is the fullest shard */
+  std::vector<std::vector<uint64_t>> values(_shards.size());
+  auto hr = for_each_shard([&](unsigned shard, Session& s) {
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return status_t(E_POOL_NOT_FOUND);
+    return s.connection->get_attribute(sp, attr, values[shard], nullptr);
+  });
+  if (hr != S_OK) return hr;
+
+  std::vector<uint64_t> result = values[0];
+  for (unsigned i = 1; i < values.size(); i++) {
+    for (size_t j = 0; j < result.size() && j < values[i].size(); j++) {
+      if (attr == IKVStore::Attribute::COUNT)
+        result[j] += values[i][j];
+      else if (attr == IKVStore::Attribute::PERCENT_USED)
+        result[j] = std::max(result[j], values[i][j]);
+    }
+  }
+  out_attr.insert(out_attr.end(), result.begin(), result.end());
+  return S_OK;
 }
 
 status_t Dawn_client::get_statistics(Shard_stats& out_stats)
 {
-  return _connection->get_statistics(out_stats);
+  std::vector<Shard_stats> stats(_shards.size());
+  auto hr = for_each_shard([&](unsigned shard, Session& s) {
+    return s.connection->get_statistics(stats[shard]);
+  });
+  if (hr != S_OK) return hr;
+
+  out_stats = stats[0];
+  for (unsigned i = 1; i < stats.size(); i++) {
+    out_stats.op_request_count        += stats[i].op_request_count;
+    out_stats.op_put_count            += stats[i].op_put_count;
+    out_stats.op_get_count            += stats[i].op_get_count;
+    out_stats.op_put_direct_count     += stats[i].op_put_direct_count;
+    out_stats.op_get_twostage_count   += stats[i].op_get_twostage_count;
+    out_stats.op_ado_count            += stats[i].op_ado_count;
+    out_stats.op_erase_count          += stats[i].op_erase_count;
+    out_stats.op_failed_request_count += stats[i].op_failed_request_count;
+    out_stats.last_op_count_snapshot  += stats[i].last_op_count_snapshot;
+    out_stats.client_count            += stats[i].client_count;
+  }
+  return S_OK;
 }
 
 
@@ -280,7 +577,129 @@ status_t Dawn_client::find(const IKVStore::pool_t pool,
                            offset_t& out_matched_offset,
                            std::string& out_matched_key)
 {
-  return _connection->find(pool, key_expression, offset, out_matched_offset, out_matched_key);
+  /* shards are searched in turn; the offset carries the shard number */
+  const offset_t mask = (offset_t(1) << SHARD_OFFSET_SHIFT) - 1;
+  offset_t local = offset & mask;
+
+  for (unsigned shard = unsigned(offset >> SHARD_OFFSET_SHIFT); shard < _shards.size(); shard++) {
+    auto& s = session(shard);
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+
+    offset_t matched;
+    auto hr = s.connection->find(sp, key_expression, local, matched, out_matched_key);
+    if (hr == S_OK) {
+      out_matched_offset = (offset_t(shard) << SHARD_OFFSET_SHIFT) | matched;
+      return S_OK;
+    }
+    if (hr != E_FAIL) /* E_FAIL: no further match on this shard */
+      return hr;
+    local = 0;
+  }
+  return E_FAIL;
+}
+
+status_t Dawn_client::scan(const IKVStore::pool_t pool,
+                           const std::string& start_key,
+                           const std::string& prefix,
+                           const size_t max_count,
+                           const size_t max_bytes,
+                           std::vector<std::pair<std::string, std::string>>& out_pairs,
+                           std::string& out_cursor)
+{
+  struct Batch {
+    std::vector<std::pair<std::string, std::string>> pairs;
+    std::vector<size_t> omitted;
+    std::string         cursor;
+  };
+
+  /* every shard returns its next batch; the batches are merged in key order */
+  std::vector<Batch> batches(_shards.size());
+  auto hr = for_each_shard([&](unsigned shard, Session& s) {
+    const auto sp = session_pool(s, pool);
+    if (sp == POOL_ERROR) return status_t(E_POOL_NOT_FOUND);
+    auto& b = batches[shard];
+    return s.connection->scan(sp, start_key, prefix, max_count, max_bytes,
+                              b.pairs, b.omitted, b.cursor);
+  });
+  if(hr != S_OK)
+    return hr;
+
+  struct Item {
+    unsigned shard;
+    size_t   index;
+  };
+  std::vector<Item> items;
+  for (unsigned i = 0; i < batches.size(); i++)
+    for (size_t j = 0; j < batches[i].pairs.size(); j++)
+      items.push_back(Item{i, j});
+
+  std::sort(items.begin(), items.end(), [&batches](const Item& a, const Item& b) {
+    return batches[a.shard].pairs[a.index].first < batches[b.shard].pairs[b.index].first;
+  });
+
+  /* the first key a shard did not return; the merged batch must stop
+     before it, or keys from other shards at or above it would be
+     returned again when the scan resumes there */
+  std::string shard_cursor;
+  for (auto& b : batches) {
+    if (!b.cursor.empty() && (shard_cursor.empty() || b.cursor < shard_cursor))
+      shard_cursor = b.cursor;
+  }
+
+  size_t taken = 0;
+  size_t bytes = 0;
+  for (; taken < items.size(); taken++) {
+    const auto& pair = batches[items[taken].shard].pairs[items[taken].index];
+    if (max_count && taken == max_count) break;
+    if (!shard_cursor.empty() && pair.first >= shard_cursor) break;
+    bytes += pair.first.size() + pair.second.size();
+    if (max_bytes && taken > 0 && bytes > max_bytes) break;
+  }
+
+  /* the next unseen key is the first pair not taken, or the first key
+     a shard did not return */
+  out_cursor = shard_cursor;
+  if (taken < items.size()) {
+    const auto& next = batches[items[taken].shard].pairs[items[taken].index].first;
+    if (out_cursor.empty() || next < out_cursor)
+      out_cursor = next;
+  }
+
+  for (size_t i = 0; i < taken; i++) {
+    const Item& item = items[i];
+    auto& b = batches[item.shard];
+    out_pairs.push_back(std::move(b.pairs[item.index]));
+
+    /* values too large for a scan response are fetched individually */
+    if (std::find(b.omitted.begin(), b.omitted.end(), item.index) == b.omitted.end())
+      continue;
+
+    auto& pair = out_pairs.back();
+    auto& s = session(item.shard);
+    void * value = nullptr;
+    size_t value_len = 0;
+    hr = s.connection->get(session_pool(s, pool), pair.first, value, value_len);
+    if(hr == S_OK) {
+      pair.second.assign(static_cast<const char*>(value), value_len);
+      ::free(value);
+    }
+    else if(hr != IKVStore::E_KEY_NOT_FOUND) {
+      return hr;
+    }
+  }
+  return S_OK;
+}
+
+status_t Dawn_client::atomic_update(const IKVStore::pool_t pool,
+                                    const std::string& key,
+                                    const std::vector<IKVStore::Operation*>& op_vector,
+                                    bool take_lock)
+{
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->atomic_update(sp, key, op_vector);
 }
 
 status_t Dawn_client::invoke_ado(const IKVStore::pool_t pool,
@@ -290,7 +709,10 @@ status_t Dawn_client::invoke_ado(const IKVStore::pool_t pool,
                                  std::vector<uint8_t>& out_response,
                                  const size_t value_size)
 {
-  return _connection->invoke_ado(pool, key, request, flags, out_response, value_size);
+  auto& s = session(shard_of(key));
+  const auto sp = session_pool(s, pool);
+  if (sp == POOL_ERROR) return E_POOL_NOT_FOUND;
+  return s.connection->invoke_ado(sp, key, request, flags, out_response, value_size);
 }
 
 
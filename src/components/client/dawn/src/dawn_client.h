@@ -28,9 +28,28 @@
 #include <api/kvindex_itf.h>
 #include <api/dawn_itf.h>
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
 #include "connection.h"
 #include "dawn_client_config.h"
 
+/**
+ * Client for one or more Dawn shards. Keys are hashed to shards, and
+ * each shard is reached through a small pool of sessions (connections),
+ * one per application thread up to a limit, so that a single client
+ * process can drive all of the server cores.
+ *
+ * Pool handles, memory handles and find offsets returned by this class
+ * are client-side; pools are created, opened and closed on every shard,
+ * and are opened on a session the first time a thread uses them.
+ */
+
 class Dawn_client : public virtual Component::IKVStore,
                     public virtual Component::IDawn
 {
@@ -51,7 +70,9 @@ class Dawn_client : public virtual Component::IKVStore,
    * 
    * @param debug_level Debug level (e.g., 0-3)
    * @param owner Owner information (not used)
-   * @param addr_port_str Address and port info (e.g. 10.0.0.22:11911)
+   * @param addr_port_str Address and port info (e.g. 10.0.0.22:11911), or
+   * a comma separated list of shard endpoints, each of which may give a
+   * port range (e.g. 10.0.0.22:11911-11926,10.0.0.23:11911-11926)
    * @param device NIC device (e.g., mlnx5_0)
    * 
    */
@@ -164,6 +185,19 @@ class Dawn_client : public virtual Component::IKVStore,
                         offset_t& out_matched_offset,
                         std::string& out_matched_key) override;
 
+  virtual status_t scan(const IKVStore::pool_t pool,
+                        const std::string& start_key,
+                        const std::string& prefix,
+                        const size_t max_count,
+                        const size_t max_bytes,
+                        std::vector<std::pair<std::string, std::string>>& out_pairs,
+                        std::string& out_cursor) override;
+
+  virtual status_t atomic_update(const IKVStore::pool_t pool,
+                                 const std::string& key,
+                                 const std::vector<IKVStore::Operation*>& op_vector,
+                                 bool take_lock = true) override;
+
   virtual status_t invoke_ado(const IKVStore::pool_t pool,
                               const std::string& key,
                               const std::vector<uint8_t>& request,
@@ -173,20 +207,107 @@ class Dawn_client : public virtual Component::IKVStore,
 
   
  private:
-
-  Component::IFabric_factory* _factory;
-  Component::IFabric*         _fabric;
-  Component::IFabric_client*  _transport;
-
-  Dawn::Client::Connection_handler* _connection;
+  using Connection_handler = Dawn::Client::Connection_handler;
+
+  static constexpr unsigned DEFAULT_SESSIONS_PER_SHARD = 8;
+  static constexpr unsigned SHARD_OFFSET_SHIFT = 48; /* find offsets carry the shard above this */
+  static constexpr uint64_t ROUTING_SEED = 0x9e3779b97f4a7c15ULL; /* decorrelates from server hashing */
+
+  struct Endpoint {
+    std::string ip_addr;
+    int         port;
+  };
+
+  /* application memory registered through register_direct_memory */
+  struct Registration {
+    void*  vaddr;
+    size_t len;
+  };
+
+  /* a connection to a shard; shared by threads once the pool is full */
+  struct Session {
+    Component::IFabric_client*  transport  = nullptr;
+    Connection_handler*         connection = nullptr;
+    std::mutex                  lock; /* guards pools and regions */
+    std::map<pool_t, pool_t>    pools; /* client pool to session pool */
+    std::map<Registration*, memory_handle_t> regions;
+  };
+
+  struct Shard {
+    Endpoint                              endpoint;
+    std::unique_ptr<std::atomic<Session*>[]> sessions; /* connected on first use */
+  };
+
+  struct Pool {
+    std::string name;
+    uint32_t    flags;
+  };
+
+  Component::IFabric_factory* _factory = nullptr;
+  Component::IFabric*         _fabric  = nullptr;
+  std::string                 _provider;
+  unsigned                    _sessions_per_shard = DEFAULT_SESSIONS_PER_SHARD;
+  std::vector<Shard>          _shards;
+  std::mutex                  _sessions_lock; /* guards session creation */
+
+  std::mutex                     _pools_lock;
+  std::map<pool_t, Pool>         _pools;
+  pool_t                         _next_pool = 1;
+  std::mutex                     _regions_lock;
+  std::set<Registration*>        _regions;
 
  private:
   void open_transport(const std::string& device,
-                      const std::string& ip_addr,
-                      const int          port,
                       const std::string& provider);
 
   void close_transport();
+
+  /** 
+   * Select the shard that holds a key
+   * 
+   */
+  unsigned shard_of(const std::string& key) const;
+
+  /** 
+   * Session used by the calling thread to reach a shard; the session is
+   * connected on first use
+   * 
+   */
+  Session& session(unsigned shard);
+
+  /** 
+   * Session pool handle for a client pool, opening the pool on the
+   * session if this is its first use there
+   * 
+   */
+  pool_t session_pool(Session& session, pool_t pool);
+
+  /** 
+   * Register a pool opened or created on every shard, or close the
+   * shard pools if it was not
+   * 
+   * @param complete True if the pool is open on every shard
+   * @param shard_pools Pool handle for each shard on the calling thread's session
+   */
+  pool_t add_pool(const std::string&         name,
+                  uint32_t                   flags,
+                  bool                       complete,
+                  const std::vector<pool_t>& shard_pools);
+
+  /** 
+   * Session memory handle for a client memory handle, registering the
+   * memory with the session if needed
+   * 
+   */
+  memory_handle_t session_handle(Session& session, memory_handle_t handle);
+
+  /** 
+   * Run an operation against every shard in parallel, using the calling
+   * thread's sessions
+   * 
+   * @return S_OK, or the first error in shard order
+   */
+  status_t for_each_shard(const std::function<status_t(unsigned, Session&)>& fn);
 };
 
 
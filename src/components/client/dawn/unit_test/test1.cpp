@@ -12,6 +12,7 @@
 */
 
 #include <api/components.h>
+#include <api/dawn_itf.h>
 #include <api/kvstore_itf.h>
 #include <common/cpu.h>
 #include <common/str_utils.h>
@@ -21,6 +22,7 @@
 #include <sys/mman.h>
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <set>
 
 #include <chrono> /* milliseconds */
 #include <thread> /* this_thread::sleep_for */
@@ -272,6 +274,57 @@ TEST_F(Dawn_client_test, BasicPutAndGet)
   PLOG("BasicPutAndGet OK!");
 }
 
+TEST_F(Dawn_client_test, ScanShards)
+{
+  PMAJOR("Running ScanShards...");
+  using namespace Component;
+
+  /* scan merges the batches of every shard in --server-addr */
+  IBase *comp = load_component("libcomanche-dawn-client.so", dawn_client_factory);
+  ASSERT_TRUE(comp);
+  auto dfact = (IDawn_factory *) comp->query_interface(IDawn_factory::iid());
+  ASSERT_TRUE(dfact);
+  IDawn *dawn = dfact->dawn_create(Options.debug_level, "dwaddington", Options.addr,
+                                   Options.device);
+  dfact->release_ref();
+  ASSERT_TRUE(dawn);
+
+  const std::string poolname = Options.pool + "/ScanShards";
+  auto pool = dawn->create_pool(poolname, MB(8));
+  ASSERT_TRUE(pool != IKVStore::POOL_ERROR);
+
+  /* values of varying size, so that byte-limited batches from the
+     shards end at different keys */
+  std::set<std::string> keys;
+  for (unsigned i = 0; i < 1000; i++) {
+    const std::string key   = "scan-" + std::to_string(i);
+    const std::string value = key + std::string(i % 97, '.');
+    keys.insert(key);
+    ASSERT_EQ(S_OK, dawn->put(pool, key, value.c_str(), value.length()));
+  }
+
+  std::set<std::string> seen;
+  std::string start = "scan-";
+  std::string cursor;
+  do {
+    std::vector<std::pair<std::string, std::string>> pairs;
+    ASSERT_EQ(S_OK, dawn->scan(pool, start, "scan-", 0, 512, pairs, cursor));
+    for (auto &p : pairs) {
+      ASSERT_TRUE(seen.insert(p.first).second) << "key returned twice: " << p.first;
+      ASSERT_EQ(0, p.second.compare(0, p.first.length(), p.first));
+    }
+    ASSERT_TRUE(cursor.empty() || cursor > start);
+    start = cursor;
+  } while (!cursor.empty());
+
+  ASSERT_TRUE(seen == keys);
+
+  dawn->close_pool(pool);
+  dawn->delete_pool(poolname);
+  dawn->release_ref();
+  PLOG("ScanShards OK!");
+}
+
 
 #ifdef TEST_SCALE_IOPS
 
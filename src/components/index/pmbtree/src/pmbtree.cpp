@@ -0,0 +1,685 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "pmbtree.h"
+#include <common/exceptions.h>
+#include <common/utils.h>
+#include <nupm/pm_lowlevel.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Component;
+
+namespace
+{
+constexpr uint64_t PMBTREE_MAGIC   = 0x31454552544d50ULL; /* "PMTREE1" */
+constexpr uint32_t PMBTREE_VERSION = 1;
+constexpr size_t   INITIAL_PAGES   = 256;
+constexpr uint32_t NODE_LEAF       = 1;
+constexpr uint32_t NODE_INNER      = 2;
+}  // namespace
+
+/* page 0 holds the header; page number 0 is therefore never a node */
+struct PmBTree::Root_record {
+  uint64_t seq;
+  uint64_t root;      /* root node page, 0 for an empty tree */
+  uint64_t count;     /* keys in the tree */
+  uint64_t next_page; /* first page never allocated */
+  uint64_t free_head; /* free page list, 0 terminated */
+  uint64_t reserved[3];
+};
+
+struct PmBTree::Header {
+  uint64_t    magic;
+  uint32_t    version;
+  uint32_t    page_size;
+  uint64_t    active; /* committed root record */
+  uint64_t    clean;  /* non-zero if closed since the last update */
+  uint64_t    reserved[4];
+  Root_record roots[2];
+};
+
+struct PmBTree::Page_header {
+  uint64_t next_free; /* free list link; left intact when the page is reused */
+  uint32_t type;
+  uint32_t nkeys;
+  uint64_t count; /* keys in subtree */
+};
+
+struct PmBTree::Txn {
+  Root_record           state; /* copy of the committed record */
+  std::vector<uint64_t> freed; /* pages replaced by this update */
+};
+
+uint64_t PmBTree::Node::count() const
+{
+  if (leaf) return keys.size();
+  uint64_t total = 0;
+  for (auto c : counts) total += c;
+  return total;
+}
+
+size_t PmBTree::Node::encoded_size() const
+{
+  size_t size = sizeof(Page_header);
+  for (auto& k : keys) size += sizeof(uint16_t) + k.size();
+  if (!leaf) size += children.size() * 2 * sizeof(uint64_t);
+  return size;
+}
+
+PmBTree::PmBTree(const std::string& owner, const std::string& path) : _path(path)
+{
+  _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (_fd == -1)
+    throw General_exception("PmBTree: unable to open (%s)", path.c_str());
+
+  struct stat st;
+  if (::fstat(_fd, &st) == -1) {
+    ::close(_fd);
+    throw General_exception("PmBTree: fstat failed on (%s)", path.c_str());
+  }
+
+  bool existing = size_t(st.st_size) >= PAGE_SIZE;
+  _size = existing ? size_t(st.st_size) : INITIAL_PAGES * PAGE_SIZE;
+  if (!existing && ::ftruncate(_fd, off_t(_size)) == -1) {
+    ::close(_fd);
+    throw General_exception("PmBTree: unable to size (%s)", path.c_str());
+  }
+
+  void* p = MAP_FAILED;
+#ifdef MAP_SYNC
+  p = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE,
+             MAP_SHARED_VALIDATE | MAP_SYNC, _fd, 0);
+  _map_sync = (p != MAP_FAILED);
+#endif
+  if (p == MAP_FAILED) /* not DAX; fall back to msync */
+    p = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (p == MAP_FAILED) {
+    ::close(_fd);
+    throw General_exception("PmBTree: mmap failed on (%s)", path.c_str());
+  }
+  _base = static_cast<char*>(p);
+
+  auto h = header();
+  if (!existing || h->magic != PMBTREE_MAGIC) {
+    format();
+  }
+  else if (h->version != PMBTREE_VERSION || h->page_size != PAGE_SIZE) {
+    ::munmap(_base, _size);
+    ::close(_fd);
+    throw General_exception("PmBTree: incompatible index (%s)", path.c_str());
+  }
+  else if (!h->clean) {
+    PWRN("PmBTree: index (%s) was not closed cleanly; discarding", path.c_str());
+    format();
+  }
+}
+
+PmBTree::~PmBTree()
+{
+  if (_base) {
+    header()->clean = 1;
+    persist(&header()->clean, sizeof(uint64_t));
+    ::munmap(_base, _size);
+  }
+  if (_fd != -1) ::close(_fd);
+}
+
+PmBTree::Header* PmBTree::header() const
+{
+  return reinterpret_cast<Header*>(_base);
+}
+
+PmBTree::Page_header* PmBTree::page_header(uint64_t page) const
+{
+  assert(page > 0);
+  assert((page + 1) * PAGE_SIZE <= _size);
+  return reinterpret_cast<Page_header*>(_base + page * PAGE_SIZE);
+}
+
+const PmBTree::Root_record& PmBTree::committed() const
+{
+  auto h = header();
+  return h->roots[h->active & 1];
+}
+
+void PmBTree::format()
+{
+  static_assert(sizeof(Root_record) == 64, "root record should be a cache line");
+
+  auto h = header();
+  memset(h, 0, sizeof(Header));
+  h->version            = PMBTREE_VERSION;
+  h->page_size          = PAGE_SIZE;
+  h->clean              = 1;
+  h->roots[0].next_page = 1;
+  persist(h, sizeof(Header));
+
+  /* magic last, so a torn format is reformatted */
+  h->magic = PMBTREE_MAGIC;
+  persist(&h->magic, sizeof(uint64_t));
+}
+
+void PmBTree::grow(size_t pages)
+{
+  if (pages * PAGE_SIZE <= _size) return;
+
+  size_t new_size = std::max(_size * 2, pages * PAGE_SIZE);
+  if (::ftruncate(_fd, off_t(new_size)) == -1)
+    throw General_exception("PmBTree: unable to extend (%s)", _path.c_str());
+
+  /* nodes refer to each other by page number, so the mapping may move */
+  void* p = ::mremap(_base, _size, new_size, MREMAP_MAYMOVE);
+  if (p == MAP_FAILED)
+    throw General_exception("PmBTree: mremap failed on (%s)", _path.c_str());
+
+  _base = static_cast<char*>(p);
+  _size = new_size;
+}
+
+void PmBTree::persist(const void* p, size_t len) const
+{
+  if (_map_sync) {
+    nupm::mem_flush(p, len);
+  }
+  else {
+    auto addr  = reinterpret_cast<addr_t>(p);
+    auto start = round_down(addr, PAGE_SIZE);
+    if (::msync(reinterpret_cast<void*>(start), len + (addr - start), MS_SYNC) == -1)
+      throw General_exception("PmBTree: msync failed on (%s)", _path.c_str());
+  }
+}
+
+void PmBTree::mark_dirty()
+{
+  auto h = header();
+  if (h->clean) {
+    h->clean = 0;
+    persist(&h->clean, sizeof(uint64_t));
+  }
+}
+
+PmBTree::Node PmBTree::read_node(uint64_t page) const
+{
+  auto        ph = page_header(page);
+  const char* p  = reinterpret_cast<const char*>(ph + 1);
+
+  Node node;
+  node.leaf = (ph->type == NODE_LEAF);
+  if (!node.leaf) {
+    if (ph->type != NODE_INNER)
+      throw General_exception("PmBTree: corrupt node (page %lu)", page);
+    node.children.resize(ph->nkeys + 1);
+    node.counts.resize(ph->nkeys + 1);
+    for (size_t i = 0; i <= ph->nkeys; i++) {
+      memcpy(&node.children[i], p, sizeof(uint64_t));
+      memcpy(&node.counts[i], p + sizeof(uint64_t), sizeof(uint64_t));
+      p += 2 * sizeof(uint64_t);
+    }
+  }
+
+  node.keys.reserve(ph->nkeys);
+  for (size_t i = 0; i < ph->nkeys; i++) {
+    uint16_t len;
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    node.keys.emplace_back(p, len);
+    p += len;
+  }
+  return node;
+}
+
+uint64_t PmBTree::alloc_page(Txn& txn)
+{
+  auto& s = txn.state;
+  if (s.free_head) {
+    auto page   = s.free_head;
+    s.free_head = page_header(page)->next_free;
+    return page;
+  }
+  grow(s.next_page + 1);
+  return s.next_page++;
+}
+
+uint64_t PmBTree::write_node(Txn& txn, const Node& node)
+{
+  assert(node.encoded_size() <= PAGE_SIZE);
+
+  auto page = alloc_page(txn);
+  auto ph   = page_header(page);
+
+  /* next_free is not written: the page is still on the committed free
+     list until this update commits */
+  ph->type  = node.leaf ? NODE_LEAF : NODE_INNER;
+  ph->nkeys = uint32_t(node.keys.size());
+  ph->count = node.count();
+
+  char* p = reinterpret_cast<char*>(ph + 1);
+  if (!node.leaf) {
+    for (size_t i = 0; i < node.children.size(); i++) {
+      memcpy(p, &node.children[i], sizeof(uint64_t));
+      memcpy(p + sizeof(uint64_t), &node.counts[i], sizeof(uint64_t));
+      p += 2 * sizeof(uint64_t);
+    }
+  }
+  for (auto& k : node.keys) {
+    auto len = uint16_t(k.size());
+    memcpy(p, &len, sizeof(len));
+    p += sizeof(len);
+    memcpy(p, k.data(), len);
+    p += len;
+  }
+
+  persist(ph, size_t(p - reinterpret_cast<char*>(ph)));
+  return page;
+}
+
+void PmBTree::commit(Txn& txn)
+{
+  /* the replaced pages are still part of the committed tree, but their
+     free list link is not node content */
+  for (auto page : txn.freed) {
+    auto ph       = page_header(page);
+    ph->next_free = txn.state.free_head;
+    persist(&ph->next_free, sizeof(uint64_t));
+    txn.state.free_head = page;
+  }
+
+  auto h     = header();
+  auto slot  = (h->active & 1) ^ 1;
+  txn.state.seq++;
+  h->roots[slot] = txn.state;
+  persist(&h->roots[slot], sizeof(Root_record));
+
+  h->active = slot;
+  persist(&h->active, sizeof(uint64_t));
+}
+
+void PmBTree::split(Node& left, Node& right, std::string& separator) const
+{
+  /* split by bytes rather than key count, keys vary in length */
+  const size_t entry_extra = left.leaf ? sizeof(uint16_t)
+                                       : sizeof(uint16_t) + 2 * sizeof(uint64_t);
+  const size_t n      = left.keys.size();
+  size_t       target = (left.encoded_size() - sizeof(Page_header)) / 2;
+  size_t       mid    = 0;
+  for (size_t used = 0; mid < n; mid++) {
+    used += entry_extra + left.keys[mid].size();
+    if (used >= target) break;
+  }
+
+  right      = Node();
+  right.leaf = left.leaf;
+
+  if (left.leaf) {
+    mid = std::min(std::max(mid, size_t(1)), n - 1);
+    right.keys.assign(left.keys.begin() + long(mid), left.keys.end());
+    left.keys.resize(mid);
+    separator = right.keys.front();
+  }
+  else {
+    /* keys[mid] moves up; children[0..mid] stay left */
+    mid       = std::min(std::max(mid, size_t(1)), n - 2);
+    separator = left.keys[mid];
+    right.keys.assign(left.keys.begin() + long(mid) + 1, left.keys.end());
+    right.children.assign(left.children.begin() + long(mid) + 1, left.children.end());
+    right.counts.assign(left.counts.begin() + long(mid) + 1, left.counts.end());
+    left.keys.resize(mid);
+    left.children.resize(mid + 1);
+    left.counts.resize(mid + 1);
+  }
+}
+
+void PmBTree::insert(const std::string& key)
+{
+  if (key.size() > MAX_KEY_LEN)
+    throw API_exception("PmBTree: key length (%lu) exceeds maximum (%lu)", key.size(),
+                        MAX_KEY_LEN);
+
+  Txn txn{committed(), {}};
+
+  if (txn.state.root == 0) {
+    mark_dirty();
+    Node leaf;
+    leaf.keys.push_back(key);
+    txn.state.root  = write_node(txn, leaf);
+    txn.state.count = 1;
+    commit(txn);
+    return;
+  }
+
+  /* descend, keeping copies of the path */
+  struct Step {
+    uint64_t page;
+    Node     node;
+    size_t   slot;
+  };
+  std::vector<Step> path;
+  for (uint64_t page = txn.state.root;;) {
+    Node node = read_node(page);
+    if (node.leaf) {
+      auto i = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+      if (i != node.keys.end() && *i == key) return; /* already present */
+      node.keys.insert(i, key);
+      path.push_back({page, std::move(node), 0});
+      break;
+    }
+    size_t slot =
+        size_t(std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin());
+    uint64_t child = node.children[slot];
+    path.push_back({page, std::move(node), slot});
+    page = child;
+  }
+
+  mark_dirty();
+
+  /* rewrite the path bottom up, splitting full nodes */
+  uint64_t    left_page = 0, right_page = 0;
+  uint64_t    left_count = 0, right_count = 0;
+  std::string separator;
+  for (size_t i = path.size(); i-- > 0;) {
+    auto& step = path[i];
+    auto& node = step.node;
+    if (!node.leaf) {
+      node.children[step.slot] = left_page;
+      node.counts[step.slot]   = left_count;
+      if (right_page) {
+        node.keys.insert(node.keys.begin() + long(step.slot), separator);
+        node.children.insert(node.children.begin() + long(step.slot) + 1, right_page);
+        node.counts.insert(node.counts.begin() + long(step.slot) + 1, right_count);
+      }
+    }
+    txn.freed.push_back(step.page);
+
+    right_page = 0;
+    if (node.encoded_size() > PAGE_SIZE) {
+      Node right;
+      split(node, right, separator);
+      right_page  = write_node(txn, right);
+      right_count = right.count();
+    }
+    left_page  = write_node(txn, node);
+    left_count = node.count();
+  }
+
+  if (right_page) { /* root split; tree grows by a level */
+    Node root;
+    root.leaf     = false;
+    root.keys     = {separator};
+    root.children = {left_page, right_page};
+    root.counts   = {left_count, right_count};
+    left_page     = write_node(txn, root);
+  }
+
+  txn.state.root = left_page;
+  txn.state.count++;
+  commit(txn);
+}
+
+void PmBTree::erase(const std::string& key)
+{
+  Txn txn{committed(), {}};
+  if (txn.state.root == 0) return;
+
+  struct Step {
+    uint64_t page;
+    Node     node;
+    size_t   slot;
+  };
+  std::vector<Step> path;
+  for (uint64_t page = txn.state.root;;) {
+    Node node = read_node(page);
+    if (node.leaf) {
+      auto i = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+      if (i == node.keys.end() || *i != key) return; /* not present */
+      node.keys.erase(i);
+      path.push_back({page, std::move(node), 0});
+      break;
+    }
+    size_t slot =
+        size_t(std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin());
+    uint64_t child = node.children[slot];
+    path.push_back({page, std::move(node), slot});
+    page = child;
+  }
+
+  mark_dirty();
+
+  /* nodes are not merged; a node left empty is unlinked from its parent */
+  bool     removed    = false;
+  uint64_t new_page   = 0;
+  uint64_t new_count  = 0;
+  for (size_t i = path.size(); i-- > 0;) {
+    auto& step = path[i];
+    auto& node = step.node;
+    if (!node.leaf) {
+      if (removed) {
+        node.children.erase(node.children.begin() + long(step.slot));
+        node.counts.erase(node.counts.begin() + long(step.slot));
+        if (!node.keys.empty())
+          node.keys.erase(node.keys.begin() + long(step.slot == 0 ? 0 : step.slot - 1));
+      }
+      else {
+        node.children[step.slot] = new_page;
+        node.counts[step.slot]   = new_count;
+      }
+    }
+    txn.freed.push_back(step.page);
+
+    removed = node.leaf ? node.keys.empty() : node.children.empty();
+    if (removed) continue;
+
+    if (i == 0 && !node.leaf && node.children.size() == 1) {
+      new_page = node.children[0]; /* single child becomes the root */
+      continue;
+    }
+    new_page  = write_node(txn, node);
+    new_count = node.count();
+  }
+
+  txn.state.root = removed ? 0 : new_page;
+  txn.state.count--;
+  commit(txn);
+}
+
+void PmBTree::clear()
+{
+  mark_dirty();
+
+  /* rather than walking the old tree onto the free list, every page is
+     made available again by resetting the allocator */
+  Txn txn{committed(), {}};
+  txn.state.root      = 0;
+  txn.state.count     = 0;
+  txn.state.next_page = 1;
+  txn.state.free_head = 0;
+  commit(txn);
+}
+
+size_t PmBTree::count() const { return committed().count; }
+
+std::string PmBTree::get(offset_t position) const
+{
+  if (position >= count()) {
+    throw std::out_of_range("Position out of range");
+  }
+
+  /* descend by subtree counts */
+  for (uint64_t page = committed().root;;) {
+    Node node = read_node(page);
+    if (node.leaf) return node.keys[position];
+    size_t i = 0;
+    while (position >= node.counts[i]) position -= node.counts[i++];
+    page = node.children[i];
+  }
+}
+
+PmBTree::cursor_t PmBTree::seek_position(offset_t position) const
+{
+  cursor_t cursor;
+  if (position >= count()) return cursor;
+
+  for (uint64_t page = committed().root;;) {
+    Node node = read_node(page);
+    if (node.leaf) {
+      cursor.emplace_back(std::move(node), position);
+      return cursor;
+    }
+    size_t i = 0;
+    while (position >= node.counts[i]) position -= node.counts[i++];
+    page = node.children[i];
+    cursor.emplace_back(std::move(node), i);
+  }
+}
+
+PmBTree::cursor_t PmBTree::seek_key(const std::string& key, offset_t* out_position) const
+{
+  cursor_t cursor;
+  offset_t position = 0;
+  if (committed().root == 0) return cursor;
+
+  for (uint64_t page = committed().root;;) {
+    Node node = read_node(page);
+    if (node.leaf) {
+      size_t i =
+          size_t(std::lower_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin());
+      if (out_position) *out_position = position + i;
+      cursor.emplace_back(std::move(node), i);
+      return cursor;
+    }
+    size_t i =
+        size_t(std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin());
+    for (size_t j = 0; j < i; j++) position += node.counts[j];
+    page = node.children[i];
+    cursor.emplace_back(std::move(node), i);
+  }
+}
+
+void PmBTree::walk(cursor_t& cursor, const std::function<bool(const std::string&)>& fn) const
+{
+  while (!cursor.empty()) {
+    auto& leaf = cursor.back();
+    for (; leaf.second < leaf.first.keys.size(); leaf.second++)
+      if (!fn(leaf.first.keys[leaf.second])) return;
+
+    /* climb to the nearest ancestor with a further child */
+    cursor.pop_back();
+    while (!cursor.empty() && cursor.back().second + 1 >= cursor.back().first.children.size())
+      cursor.pop_back();
+    if (cursor.empty()) return;
+
+    uint64_t page = cursor.back().first.children[++cursor.back().second];
+    for (;;) {
+      Node node    = read_node(page);
+      bool is_leaf = node.leaf;
+      if (!is_leaf) page = node.children[0];
+      cursor.emplace_back(std::move(node), 0);
+      if (is_leaf) break;
+    }
+  }
+}
+
+status_t PmBTree::find(const std::string& key_expression,
+                       offset_t           begin_position,
+                       find_t             find_type,
+                       offset_t&          out_matched_pos,
+                       std::string&       out_matched_key,
+                       unsigned           max_comparisons)
+{
+  if (begin_position >= count()) {
+    throw std::out_of_range("begin_postion out of bounds");
+  }
+
+  if (find_type == FIND_TYPE_NEXT) {
+    out_matched_pos = begin_position;
+    out_matched_key = get(begin_position);
+    return S_OK;
+  }
+
+  /* callers that do not compile their own expression usually repeat
+     the same one */
+  auto type = matcher_type(find_type);
+  if (!_matcher || _matcher->type() != type || _matcher->expression() != key_expression)
+    _matcher.reset(new Common::Key_matcher(type, key_expression));
+
+  return find(*_matcher, begin_position, out_matched_pos, out_matched_key, max_comparisons);
+}
+
+status_t PmBTree::find(const Common::Key_matcher& matcher,
+                       offset_t                   begin_position,
+                       offset_t&                  out_matched_pos,
+                       std::string&               out_matched_key,
+                       unsigned                   max_comparisons)
+{
+  if (begin_position >= count()) {
+    throw std::out_of_range("begin_postion out of bounds");
+  }
+
+  const auto& prefix   = matcher.prefix();
+  auto        cursor   = seek_position(begin_position);
+  offset_t    position = begin_position;
+
+  /* seek over keys that sort before the required prefix */
+  auto& leaf = cursor.back();
+  if (leaf.first.keys[leaf.second] < prefix) cursor = seek_key(prefix, &position);
+
+  unsigned attempts = 0;
+  status_t result   = E_FAIL;
+
+  walk(cursor, [&](const std::string& key) {
+    if (key.compare(0, prefix.size(), prefix) != 0)
+      return false; /* past the keys that can match */
+
+    out_matched_pos = position;
+    if (matcher.match(key)) {
+      out_matched_key = key;
+      result          = S_OK;
+      return false;
+    }
+    if (matcher.exact()) return false;
+    if (++attempts > max_comparisons) {
+      result = E_MAX_REACHED;
+      return false;
+    }
+    position++;
+    return true;
+  });
+
+  return result;
+}
+
+status_t PmBTree::scan(const std::string& start_key,
+                       std::function<bool(const std::string& key)> function)
+{
+  auto cursor = seek_key(start_key);
+  walk(cursor, function);
+  return S_OK;
+}
+
+/**
+ * Factory entry point
+ *
+ */
+extern "C" void* factory_createInstance(Component::uuid_t& component_id)
+{
+  if (component_id == PmBTree_factory::component_id()) {
+    return static_cast<void*>(new PmBTree_factory());
+  }
+  else
+    return NULL;
+}
@@ -0,0 +1,163 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __PMBTREE_COMPONENT_H__
+#define __PMBTREE_COMPONENT_H__
+
+#include <api/kvindex_itf.h>
+#include <common/key_matcher.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Persistent ordered index. Keys are held in a copy-on-write B+-tree
+ * in a memory mapped file, which is expected to live on a DAX (fsdax)
+ * file system so that the tree is resident in persistent memory.
+ *
+ * Updates never modify a live node: the path from leaf to root is
+ * rewritten into free pages and the new root is published by flipping
+ * between two root records in the file header. A crash therefore leaves
+ * either the old or the new tree, and opening the index only maps the
+ * file and reads the header.
+ *
+ * The tree cannot know whether the keys it holds still match the store
+ * it indexes. The header records whether the index was closed cleanly;
+ * an index that was open for update when its process died is opened
+ * empty, so that the owner rebuilds it.
+ */
+class PmBTree : public Component::IKVIndex {
+ public:
+  static constexpr size_t PAGE_SIZE   = 4096;
+  static constexpr size_t MAX_KEY_LEN = 1024; /*< keeps split halves within a page */
+
+  PmBTree(const std::string& owner, const std::string& path);
+  virtual ~PmBTree();
+
+  DECLARE_VERSION(0.1);
+  DECLARE_COMPONENT_UUID(0x8a3c5e41, 0x6d2b, 0x4f0a, 0x9c1e, 0x52, 0x7b, 0x0d, 0x93, 0xe4, 0x16);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex::iid()) {
+      return (void*) static_cast<Component::IKVIndex*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+ public:
+  virtual void        insert(const std::string& key) override;
+  virtual void        erase(const std::string& key) override;
+  virtual void        clear() override;
+  virtual std::string get(offset_t position) const override;
+  virtual size_t      count() const override;
+  virtual status_t    find(const std::string& key_expression,
+                           offset_t           begin_position,
+                           find_t             find_type,
+                           offset_t&          out_end_position,
+                           std::string&       out_matched_key,
+                           unsigned           max_comparisons = 0) override;
+  virtual status_t    find(const Common::Key_matcher& matcher,
+                           offset_t                   begin_position,
+                           offset_t&                  out_matched_position,
+                           std::string&               out_matched_key,
+                           unsigned                   max_comparisons) override;
+  virtual status_t    scan(const std::string& start_key,
+                           std::function<bool(const std::string& key)> function) override;
+  virtual size_t      max_key_length() const override { return MAX_KEY_LEN; }
+
+ private:
+  struct Header;
+  struct Root_record;
+  struct Page_header;
+
+  /* decoded copy of a node page */
+  struct Node {
+    bool                     leaf = true;
+    std::vector<std::string> keys;
+    std::vector<uint64_t>    children; /* inner: child pages, keys.size()+1 */
+    std::vector<uint64_t>    counts;   /* inner: keys under each child */
+
+    uint64_t count() const;
+    size_t   encoded_size() const;
+  };
+
+  /* update in progress; becomes visible on commit */
+  struct Txn;
+
+  /* in-order position: a node and slot for each level, leaf last */
+  using cursor_t = std::vector<std::pair<Node, size_t>>;
+
+  Header*      header() const;
+  Page_header* page_header(uint64_t page) const;
+  const Root_record& committed() const;
+
+  void     format();
+  void     grow(size_t pages);
+  void     persist(const void* p, size_t len) const;
+  void     mark_dirty();
+  Node     read_node(uint64_t page) const;
+  uint64_t write_node(Txn& txn, const Node& node);
+  uint64_t alloc_page(Txn& txn);
+  void     commit(Txn& txn);
+  void     split(Node& left, Node& right, std::string& separator) const;
+
+  cursor_t seek_position(offset_t position) const;
+  cursor_t seek_key(const std::string& key, offset_t* out_position = nullptr) const;
+  void     walk(cursor_t& cursor, const std::function<bool(const std::string&)>& fn) const;
+
+ private:
+  std::string _path;
+  int         _fd       = -1;
+  char*       _base     = nullptr;
+  size_t      _size     = 0;
+  bool        _map_sync = false; /* mapping is synchronous; cache flush suffices */
+  std::unique_ptr<Common::Key_matcher> _matcher; /* last expression given to find */
+};
+
+class PmBTree_factory : public Component::IKVIndex_factory {
+ public:
+  DECLARE_VERSION(0.1);
+  DECLARE_COMPONENT_UUID(0xfac35e41, 0x6d2b, 0x4f0a, 0x9c1e, 0x52, 0x7b, 0x0d, 0x93, 0xe4, 0x16);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex_factory::iid()) {
+      return (void*) static_cast<Component::IKVIndex_factory*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+  /**
+   * Open or create a persistent index
+   *
+   * @param owner Owner
+   * @param path Backing file, e.g. /mnt/pmem0/mypool.idx
+   */
+  virtual Component::IKVIndex* create(const std::string& owner,
+                                      const std::string& path) override
+  {
+    Component::IKVIndex* obj =
+        static_cast<Component::IKVIndex*>(new PmBTree(owner, path));
+    assert(obj);
+    obj->add_ref();
+    return obj;
+  }
+};
+#endif
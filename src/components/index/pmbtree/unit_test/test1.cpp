@@ -0,0 +1,270 @@
+/* note: we do not include component source, only the API definition */
+#include <api/components.h>
+#include <api/kvindex_itf.h>
+#include <common/key_matcher.h>
+#include <common/str_utils.h>
+#include <common/utils.h>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <ctime>
+#include <set>
+
+#define COUNT 100000
+#define LENGTH 16
+
+static constexpr size_t PmBTree_max_key_len = 1024; /* PmBTree::MAX_KEY_LEN */
+
+using namespace Component;
+using namespace Common;
+using namespace std;
+
+namespace
+{
+/* set PMBTREE_PATH to place the index on a DAX file system */
+const char *index_path()
+{
+  auto p = getenv("PMBTREE_PATH");
+  return p ? p : "/tmp/pmbtree-test1.idx";
+}
+
+class KVIndex_test : public ::testing::Test {
+ protected:
+  IKVIndex *open_index(const std::string &path = index_path())
+  {
+    Component::IBase *comp = Component::load_component(
+        "libcomanche-indexpmbtree.so", Component::pmbtreeindex_factory);
+    if (!comp) return nullptr;
+    IKVIndex_factory *fact =
+        (IKVIndex_factory *) comp->query_interface(IKVIndex_factory::iid());
+    auto index = fact->create("owner", path);
+    fact->release_ref();
+    return index;
+  }
+
+  static Component::IKVIndex *_kvindex;
+  static std::set<std::string> _keys;
+};
+
+Component::IKVIndex *KVIndex_test::_kvindex;
+std::set<std::string> KVIndex_test::_keys;
+
+/* small fixed key set: car1 car10 car2 cat dog key-1 key-22 key-x */
+void check_matcher_find(IKVIndex *index)
+{
+  for (auto k : {"key-x", "car2", "dog", "car10", "key-1", "cat", "car1", "key-22"})
+    index->insert(k);
+  ASSERT_EQ(8, index->count());
+
+  IKVIndex::offset_t pos;
+  string             key;
+
+  ASSERT_EQ(S_OK, index->find("car", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("car1", key);
+  ASSERT_EQ(0, pos);
+  ASSERT_EQ(S_OK, index->find("car", 2, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("car2", key);
+  ASSERT_EQ(2, pos);
+  ASSERT_EQ(E_FAIL, index->find("car", 3, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ(S_OK, index->find("key", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("key-1", key);
+  ASSERT_EQ(5, pos);
+
+  ASSERT_EQ(S_OK, index->find("key-\\d+", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key-1", key);
+  ASSERT_EQ(5, pos);
+  ASSERT_EQ(S_OK, index->find("key-\\d+", 6, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key-22", key);
+  ASSERT_EQ(6, pos);
+  ASSERT_EQ(E_FAIL, index->find("key-\\d+", 7, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ(S_OK, index->find("car\\d{2}", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("car10", key);
+  ASSERT_EQ(1, pos);
+  ASSERT_EQ(S_OK, index->find(".*g", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("dog", key);
+  ASSERT_EQ(4, pos);
+
+  ASSERT_EQ(S_OK, index->find("cat", 0, IKVIndex::FIND_TYPE_EXACT, pos, key, 100));
+  ASSERT_EQ(3, pos);
+  ASSERT_EQ(E_FAIL, index->find("cab", 0, IKVIndex::FIND_TYPE_EXACT, pos, key, 100));
+
+  /* precompiled expression */
+  Key_matcher matcher(Key_matcher::Type::REGEX, "ca[rt]2?");
+  ASSERT_EQ("ca", matcher.prefix());
+  ASSERT_EQ(S_OK, index->find(matcher, 0, pos, key, 100));
+  ASSERT_EQ("car2", key);
+  ASSERT_EQ(2, pos);
+  ASSERT_EQ(S_OK, index->find(matcher, 3, pos, key, 100));
+  ASSERT_EQ("cat", key);
+
+  /* failed comparisons are bounded */
+  Key_matcher bounded(Key_matcher::Type::REGEX, "c.*t");
+  ASSERT_EQ(E_MAX_REACHED, index->find(bounded, 0, pos, key, 1));
+  ASSERT_EQ(1, pos);
+  ASSERT_EQ(S_OK, index->find(bounded, 0, pos, key, 3));
+  ASSERT_EQ("cat", key);
+}
+
+TEST_F(KVIndex_test, Instantiate)
+{
+  unlink(index_path());
+  _kvindex = open_index();
+  ASSERT_TRUE(_kvindex);
+  ASSERT_EQ(0, _kvindex->count());
+}
+
+TEST_F(KVIndex_test, InsertPerf)
+{
+  string *keys = new string[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    keys[i] = random_string(LENGTH);
+    _keys.insert(keys[i]);
+  }
+  clock_t start = clock();
+  for (int i = 0; i < COUNT; i++) {
+    _kvindex->insert(keys[i]);
+  }
+  delete[] keys;
+  double duration = (clock() - start) / (double) CLOCKS_PER_SEC;
+  PINF("Time sec: %lf", duration);
+  PINF("Size: %ld", _kvindex->count());
+  ASSERT_EQ(_keys.size(), _kvindex->count());
+}
+
+TEST_F(KVIndex_test, Erase)
+{
+  /* erase every other key */
+  bool odd = false;
+  for (auto i = _keys.begin(); i != _keys.end();) {
+    if ((odd = !odd)) {
+      _kvindex->erase(*i);
+      i = _keys.erase(i);
+    }
+    else
+      i++;
+  }
+  _kvindex->erase("not-a-key");
+  ASSERT_EQ(_keys.size(), _kvindex->count());
+}
+
+TEST_F(KVIndex_test, Reopen)
+{
+  _kvindex->release_ref();
+  _kvindex = open_index();
+  ASSERT_TRUE(_kvindex);
+  ASSERT_EQ(_keys.size(), _kvindex->count());
+}
+
+TEST_F(KVIndex_test, Get)
+{
+  uint64_t pos = 0;
+  for (auto &k : _keys) {
+    if (pos % 997 == 0) ASSERT_EQ(k, _kvindex->get(pos));
+    pos++;
+  }
+  ASSERT_THROW(_kvindex->get(_keys.size()), std::out_of_range);
+}
+
+TEST_F(KVIndex_test, Scan)
+{
+  auto           start = *std::next(_keys.begin(), _keys.size() / 2);
+  vector<string> result;
+  _kvindex->scan(start, [&result](const string &key) {
+    result.push_back(key);
+    return result.size() < 100;
+  });
+  ASSERT_EQ(100, result.size());
+  ASSERT_TRUE(std::equal(result.begin(), result.end(), _keys.find(start)));
+}
+
+TEST_F(KVIndex_test, Find)
+{
+  auto                    target = *std::next(_keys.begin(), _keys.size() / 3);
+  IKVIndex::offset_t      pos;
+  string                  key;
+  ASSERT_EQ(S_OK, _kvindex->find(target, 0, IKVIndex::FIND_TYPE_EXACT, pos, key,
+                                 _keys.size()));
+  ASSERT_EQ(target, key);
+  ASSERT_EQ(_keys.size() / 3, pos);
+
+  ASSERT_EQ(S_OK, _kvindex->find(target.substr(0, 8), 0, IKVIndex::FIND_TYPE_PREFIX,
+                                 pos, key, _keys.size()));
+  ASSERT_EQ(0, key.compare(0, 8, target.substr(0, 8)));
+
+  ASSERT_EQ(S_OK, _kvindex->find(target.substr(0, 4) + ".*", 0, IKVIndex::FIND_TYPE_REGEX,
+                                 pos, key, _keys.size()));
+  ASSERT_EQ(0, key.compare(0, 4, target.substr(0, 4)));
+  ASSERT_EQ(*_keys.lower_bound(target.substr(0, 4)), key);
+}
+
+TEST_F(KVIndex_test, FindMatcher)
+{
+  const std::string path = std::string(index_path()) + ".find";
+  unlink(path.c_str());
+
+  auto index = open_index(path);
+  ASSERT_TRUE(index);
+  check_matcher_find(index);
+  index->release_ref();
+  unlink(path.c_str());
+}
+
+TEST_F(KVIndex_test, LongKey)
+{
+  ASSERT_EQ(PmBTree_max_key_len, _kvindex->max_key_length());
+  ASSERT_THROW(_kvindex->insert(std::string(PmBTree_max_key_len + 1, 'x')), API_exception);
+  ASSERT_EQ(_keys.size(), _kvindex->count());
+}
+
+TEST_F(KVIndex_test, UncleanReopen)
+{
+  const std::string path = std::string(index_path()) + ".unclean";
+  unlink(path.c_str());
+
+  /* a process that dies with the index open for update leaves it dirty */
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    auto index = open_index(path);
+    if (index == nullptr) _exit(1);
+    index->insert("abc");
+    index->insert("def");
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  auto index = open_index(path);
+  ASSERT_TRUE(index);
+  ASSERT_EQ(0, index->count());
+
+  /* whereas a closed index keeps its keys */
+  index->insert("ghi");
+  index->release_ref();
+  index = open_index(path);
+  ASSERT_EQ(1, index->count());
+  ASSERT_EQ("ghi", index->get(0));
+  index->release_ref();
+  unlink(path.c_str());
+}
+
+TEST_F(KVIndex_test, Clear)
+{
+  _kvindex->clear();
+  ASSERT_EQ(0, _kvindex->count());
+  _kvindex->insert("abc");
+  ASSERT_EQ("abc", _kvindex->get(0));
+  _kvindex->release_ref();
+  unlink(index_path());
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
@@ -1,7 +1,5 @@
 #include "ramrbtree.h"
 #include <stdlib.h>
-#include <regex>
-#include <set>
 
 #define SINGLE_THREADED
 
@@ -32,9 +30,7 @@ string RamRBTree::get(offset_t position) const
     throw out_of_range("Position out of range");
   }
 
-  auto it = _index.begin();
-  advance(it, position);
-  return *it;
+  return *_index.find_by_order(position);
 }
 
 size_t RamRBTree::count() const { return _index.size(); }
@@ -46,58 +42,72 @@ status_t RamRBTree::find(const std::string& key_expression,
                          std::string&       out_matched_key,
                          unsigned           max_comparisons)
 {
-  std::regex r(key_expression);
   if (begin_position >= _index.size()) {
     throw std::out_of_range("begin_postion out of bounds");
   }
 
-  offset_t end_position = _index.size();
-  unsigned attempts =0;
-  switch (find_type) {
-    case FIND_TYPE_REGEX:
-      for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-        string key = RamRBTree::get(out_matched_pos);
-        if (regex_match(key, r)) {
-          out_matched_key = key;
-          return S_OK;
-        }
-        else {
-          if(++attempts > max_comparisons)
-            return E_MAX_REACHED;
-        }
-      }
-      break;
-    case FIND_TYPE_EXACT:
-      for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-        string key = RamRBTree::get(out_matched_pos);
-        if (key.compare(key_expression) == 0) {
-          out_matched_key = key;
-          return S_OK;
-        }
-        else {
-          if(++attempts > max_comparisons)
-            return E_MAX_REACHED;
-        }
-      }
-      break;
-    case FIND_TYPE_PREFIX:
-      for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-        string key = RamRBTree::get(out_matched_pos);
-        if (key.find(key_expression) != string::npos) {
-          out_matched_key = key;
-          return S_OK;
-        }
-      }
-      break;
-    case FIND_TYPE_NEXT:
-      out_matched_key = get(begin_position);
+  if (find_type == FIND_TYPE_NEXT) {
+    out_matched_pos = begin_position;
+    out_matched_key = get(begin_position);
+    return S_OK;
+  }
+
+  /* callers that do not compile their own expression usually repeat
+     the same one */
+  auto type = matcher_type(find_type);
+  if (!_matcher || _matcher->type() != type || _matcher->expression() != key_expression)
+    _matcher.reset(new Common::Key_matcher(type, key_expression));
+
+  return find(*_matcher, begin_position, out_matched_pos, out_matched_key, max_comparisons);
+}
+
+status_t RamRBTree::find(const Common::Key_matcher& matcher,
+                         offset_t                   begin_position,
+                         offset_t&                  out_matched_pos,
+                         std::string&               out_matched_key,
+                         unsigned                   max_comparisons)
+{
+  if (begin_position >= _index.size()) {
+    throw std::out_of_range("begin_postion out of bounds");
+  }
+
+  const auto& prefix   = matcher.prefix();
+  auto        it       = _index.find_by_order(begin_position);
+  offset_t    position = begin_position;
+
+  /* seek over keys that sort before the required prefix */
+  if (*it < prefix) {
+    it = _index.lower_bound(prefix);
+    if (it == _index.end()) return E_FAIL;
+    position = _index.order_of_key(*it);
+  }
+
+  unsigned attempts = 0;
+  for (; it != _index.end(); it++, position++) {
+    if (it->compare(0, prefix.size(), prefix) != 0)
+      break; /* past the keys that can match */
+
+    out_matched_pos = position;
+    if (matcher.match(*it)) {
+      out_matched_key = *it;
       return S_OK;
-      break;
+    }
+    if (matcher.exact()) break;
+    if (++attempts > max_comparisons) return E_MAX_REACHED;
   }
 
   return E_FAIL;
 }
 
+status_t RamRBTree::scan(const std::string& start_key,
+                         std::function<bool(const std::string& key)> function)
+{
+  for (auto it = _index.lower_bound(start_key); it != _index.end(); it++) {
+    if (!function(*it)) break;
+  }
+  return S_OK;
+}
+
 /**
  * Factory entry point
  *
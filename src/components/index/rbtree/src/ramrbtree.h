@@ -13,8 +13,11 @@
 #ifndef __RAMRBTREE_COMPONENT_H__
 #define __RAMRBTREE_COMPONENT_H__
 
-#include <set>
+#include <memory>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
 #include <api/kvindex_itf.h>
+#include <common/key_matcher.h>
 
 using namespace std;
 
@@ -50,8 +53,23 @@ class RamRBTree : public Component::IKVIndex {
                            offset_t&          out_end_position,
                            std::string&       out_matched_key,
                            unsigned           max_comparisons = 0) override;
+  virtual status_t    find(const Common::Key_matcher& matcher,
+                           offset_t                   begin_position,
+                           offset_t&                  out_matched_position,
+                           std::string&               out_matched_key,
+                           unsigned                   max_comparisons) override;
+  virtual status_t    scan(const std::string& start_key,
+                           std::function<bool(const std::string& key)> function) override;
 private:
-  std::set<string> _index;
+  /* red-black tree with subtree sizes, so that positions are O(log n) */
+  using index_t = __gnu_pbds::tree<std::string,
+                                   __gnu_pbds::null_type,
+                                   std::less<std::string>,
+                                   __gnu_pbds::rb_tree_tag,
+                                   __gnu_pbds::tree_order_statistics_node_update>;
+
+  index_t                              _index;
+  std::unique_ptr<Common::Key_matcher> _matcher; /* last expression given to find */
 };
 
 class RamRBTree_factory : public Component::IKVIndex_factory {
@@ -1,6 +1,7 @@
 /* note: we do not include component source, only the API definition */
 #include <api/components.h>
 #include <api/kvindex_itf.h>
+#include <common/key_matcher.h>
 #include <common/str_utils.h>
 #include <common/utils.h>
 #include <gtest/gtest.h>
@@ -39,6 +40,62 @@ class KVIndex_test : public ::testing::Test {
 
 Component::IKVIndex *KVIndex_test::_kvindex;
 
+/* small fixed key set: car1 car10 car2 cat dog key-1 key-22 key-x */
+void check_matcher_find(IKVIndex *index)
+{
+  for (auto k : {"key-x", "car2", "dog", "car10", "key-1", "cat", "car1", "key-22"})
+    index->insert(k);
+  ASSERT_EQ(8, index->count());
+
+  IKVIndex::offset_t pos;
+  string             key;
+
+  ASSERT_EQ(S_OK, index->find("car", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("car1", key);
+  ASSERT_EQ(0, pos);
+  ASSERT_EQ(S_OK, index->find("car", 2, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("car2", key);
+  ASSERT_EQ(2, pos);
+  ASSERT_EQ(E_FAIL, index->find("car", 3, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ(S_OK, index->find("key", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key, 100));
+  ASSERT_EQ("key-1", key);
+  ASSERT_EQ(5, pos);
+
+  ASSERT_EQ(S_OK, index->find("key-\\d+", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key-1", key);
+  ASSERT_EQ(5, pos);
+  ASSERT_EQ(S_OK, index->find("key-\\d+", 6, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key-22", key);
+  ASSERT_EQ(6, pos);
+  ASSERT_EQ(E_FAIL, index->find("key-\\d+", 7, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ(S_OK, index->find("car\\d{2}", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("car10", key);
+  ASSERT_EQ(1, pos);
+  ASSERT_EQ(S_OK, index->find(".*g", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("dog", key);
+  ASSERT_EQ(4, pos);
+
+  ASSERT_EQ(S_OK, index->find("cat", 0, IKVIndex::FIND_TYPE_EXACT, pos, key, 100));
+  ASSERT_EQ(3, pos);
+  ASSERT_EQ(E_FAIL, index->find("cab", 0, IKVIndex::FIND_TYPE_EXACT, pos, key, 100));
+
+  /* precompiled expression */
+  Key_matcher matcher(Key_matcher::Type::REGEX, "ca[rt]2?");
+  ASSERT_EQ("ca", matcher.prefix());
+  ASSERT_EQ(S_OK, index->find(matcher, 0, pos, key, 100));
+  ASSERT_EQ("car2", key);
+  ASSERT_EQ(2, pos);
+  ASSERT_EQ(S_OK, index->find(matcher, 3, pos, key, 100));
+  ASSERT_EQ("cat", key);
+
+  /* failed comparisons are bounded */
+  Key_matcher bounded(Key_matcher::Type::REGEX, "c.*t");
+  ASSERT_EQ(E_MAX_REACHED, index->find(bounded, 0, pos, key, 1));
+  ASSERT_EQ(1, pos);
+  ASSERT_EQ(S_OK, index->find(bounded, 0, pos, key, 3));
+  ASSERT_EQ("cat", key);
+}
+
 TEST_F(KVIndex_test, Instantiate)
 {
   /* create object instance through factory */
@@ -106,6 +163,12 @@ TEST_F(KVIndex_test, Erase) { _kvindex->erase("MyKey"); }
 
 TEST_F(KVIndex_test, Count) { PINF("Size: %lu", _kvindex->count()); }
 
+TEST_F(KVIndex_test, FindMatcher)
+{
+  _kvindex->clear();
+  check_matcher_find(_kvindex);
+}
+
 
 }  // namespace
 
@@ -78,10 +78,10 @@ struct __md_record
     strncpy(id, id_param, 63); id[63]='\0';
   }
   inline void set_owner(const char * owner_param) {
-    strncpy(owner, owner_param, 63); id[63]='\0';
+    strncpy(owner, owner_param, 63); owner[63]='\0';
   }
   inline void set_datatype(const char * param) {
-    strncpy(datatype, param, 31); id[31]='\0';
+    strncpy(datatype, param, 31); datatype[31]='\0';
   }
   inline void set_used() { status = MD_STATUS_USED; }
   inline void set_free() { status = MD_STATUS_FREE; }
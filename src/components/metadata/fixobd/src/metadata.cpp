@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <regex>
 #include <sstream>
@@ -107,6 +108,7 @@ index_t Metadata::allocate(uint64_t start_lba,
 
   unlock(precord->index);
 
+  index_insert(*precord);
   flush_record(precord);
 
   return precord->index;
@@ -146,6 +148,8 @@ void Metadata::wipe_initialize()
 {
   assert(_vi.block_size == 512 ||
          _vi.block_size == 4096);
+
+  _index.clear();
   
   apply([=](struct __md_record& record, size_t index, bool& keep_going)
         {
@@ -168,13 +172,22 @@ void Metadata::initialize()
   assert(_vi.block_size == 512 ||
          _vi.block_size == 4096);
   
+  _index.clear();
+  
   apply([=](struct __md_record& record, size_t index, bool& keep_going)
         {
           if(record.is_free()) {
             _free_list.push(&record);
-          }          
+          }
+          else if(record.is_used()) {
+            _index.emplace(std::string(record.id, strnlen(record.id, sizeof(record.id))),
+                           static_cast<uint32_t>(index));
+          }
         }
         , 0, _n_records);
+
+  if(option_DEBUG)
+    PLOG("Metadata: rebuilt index (%lu entries)", _index.size());
   
   _block->write(_iob,
                 0, // offset
@@ -252,11 +265,68 @@ size_t Metadata::get_record_count()
   return _n_records - _free_list.unsafe_size();
 }
 
+/** 
+ * Compiled filter expression. Literal and literal-prefix expressions
+ * (e.g., "foo" or "foo.*") are matched without the regex engine.
+ * 
+ */
+struct Filter
+{
+  enum {
+    MATCH_NONE,
+    MATCH_EXACT,
+    MATCH_PREFIX,
+    MATCH_REGEX,
+  };
+
+  int         type = MATCH_NONE;
+  std::string literal;
+  std::regex  regex;
+
+  static bool is_literal(const std::string& s) {
+    return s.find_first_of(".[]{}()\\*+?^$|") == std::string::npos;
+  }
+
+  void compile(const std::string& expr) {
+    if(is_literal(expr)) {
+      type = MATCH_EXACT;
+      literal = expr;
+    }
+    else if(expr.size() >= 2 &&
+            expr.compare(expr.size() - 2, 2, ".*") == 0 &&
+            is_literal(expr.substr(0, expr.size() - 2))) {
+      type = MATCH_PREFIX;
+      literal = expr.substr(0, expr.size() - 2);
+    }
+    else {
+      type = MATCH_REGEX;
+      regex = std::regex(expr);
+    }
+  }
+
+  bool match(const char * field, size_t max_len) const {
+    switch(type) {
+    case MATCH_EXACT:
+      return strnlen(field, max_len) == literal.size() &&
+        literal.compare(0, literal.size(), field, literal.size()) == 0;
+    case MATCH_PREFIX:
+      return strnlen(field, max_len) >= literal.size() &&
+        literal.compare(0, literal.size(), field, literal.size()) == 0;
+    case MATCH_REGEX:
+      return std::regex_match(std::string(field, strnlen(field, max_len)), regex);
+    default:
+      return false;
+    }
+  }
+};
+
 struct __iterator_t
 {
-  size_t     pos;
-  std::regex id_filter;
-  std::regex owner_filter;
+  size_t                pos;
+  Filter                id_filter;
+  Filter                owner_filter;
+  bool                  use_candidates; /*< iterate index hits rather than scan */
+  std::vector<uint32_t> candidates;
 };
 
 IMetadata::iterator_t Metadata::open_iterator(std::string filter)
@@ -274,19 +344,34 @@ IMetadata::iterator_t Metadata::open_iterator(std::string filter)
 
     i = new __iterator_t;
     i->pos = 0;
+    i->use_candidates = false;
     
     if(doc.HasMember("id") && doc["id"].IsString()) {
-      i->id_filter = std::regex(doc["id"].GetString());
+      i->id_filter.compile(doc["id"].GetString());
 
       if(option_DEBUG)
         PLOG("id_filter (%s)", doc["id"].GetString());
     }
-    
+
+    if(doc.HasMember("owner") && doc["owner"].IsString()) {
+      i->owner_filter.compile(doc["owner"].GetString());
+
+      if(option_DEBUG)
+        PLOG("owner_filter (%s)", doc["owner"].GetString());
+    }
   }
   catch(...) {
     throw API_exception("invalid filter string");
   }
 
+  /* exact id with no owner alternative: take hits from the index */
+  if(i->id_filter.type == Filter::MATCH_EXACT &&
+     i->owner_filter.type == Filter::MATCH_NONE) {
+    i->use_candidates = true;
+    index_lookup(i->id_filter.literal, std::string(), i->candidates);
+    std::sort(i->candidates.begin(), i->candidates.end());
+  }
+
   return static_cast<void*>(i);
 }
 
@@ -297,60 +382,120 @@ status_t Metadata::iterator_get(IMetadata::iterator_t iter,
                                 uint64_t* lba_count)
 {
   __iterator_t * i = static_cast<__iterator_t*>(iter);
+  const size_t limit = i->use_candidates ? i->candidates.size() : _n_records;
 
-  do {
-    if(i->pos >= _n_records) {
-      break;
-    }
+  while(i->pos < limit) {
 
-    auto& record = _records[i->pos];
+    const size_t index = i->use_candidates ? i->candidates[i->pos] : i->pos;
+    auto& record = _records[index];
 
     i->pos ++;
-    if(record.is_free()) continue;
-        
-    std::smatch id_match, owner_match;
-    const std::string id_target = record.id;
-    const std::string owner_target = record.owner;
-
-    if(std::regex_match(id_target, id_match, i->id_filter) ||
-       std::regex_match(owner_target, owner_match, i->owner_filter)) {
-      /* create JSON result */
-      std::stringstream ss;
-      ss << "{\"id\": \"" << record.id << "\",\"owner\":\"" << record.owner << "\","
-         << "\"datatype\":\"" << record.datatype << "\",\"utc_modified\":\"" << record.utc_modified
-         << "\",\"utc_created\":\"" << record.utc_created << "\"}";
+
+    lock(index);
+    
+    if(!record.is_used() ||
+       !(i->id_filter.match(record.id, sizeof(record.id)) ||
+         i->owner_filter.match(record.owner, sizeof(record.owner)))) {
+      unlock(index);
+      continue;
+    }
+
+    /* create JSON result */
+    std::stringstream ss;
+    ss << "{\"id\": \"" << record.id << "\",\"owner\":\"" << record.owner << "\","
+       << "\"datatype\":\"" << record.datatype << "\",\"utc_modified\":\"" << record.utc_modified
+       << "\",\"utc_created\":\"" << record.utc_created << "\"}";
       
-      out_metadata = ss.str();
-      out_index = i->pos - 1;
+    out_metadata = ss.str();
+    out_index = index;
       
-      if(lba) *lba = record.start_lba;
-      if(lba_count) *lba_count = record.lba_count;
-      return S_OK;
-    }
+    if(lba) *lba = record.start_lba;
+    if(lba_count) *lba_count = record.lba_count;
+
+    unlock(index);
+    return S_OK;
   }
-  while(i->pos < _n_records);
   
   return E_EMPTY;
 }
 
+static bool owner_match(const struct __md_record& record, const std::string& owner)
+{
+  return owner.empty() ||
+    owner.compare(0, std::string::npos, record.owner,
+                  strnlen(record.owner, sizeof(record.owner))) == 0;
+}
+
 bool Metadata::check_exists(const std::string& id, const std::string& owner, size_t& out_size)
 {
-  bool check_owner = owner.empty() ? false : true;
-  
-  /* this is an unsafe scan! */
-  for(unsigned long i=0;i<_n_records;i++) {
-    auto& record = _records[i];
-    if(id.compare(record.id) == 0) {
-      if(!check_owner || owner.compare(record.owner) == 0) {
-        out_size = record.block_size ? (record.lba_count * 512) : (record.lba_count * 4096);
-        PLOG("Metadata: returning size=%lu", out_size);
-        return true;
-      }
+  std::vector<uint32_t> hits;
+  index_lookup(id, owner, hits);
+
+  for(auto index : hits) {
+    lock(index);
+    auto& record = _records[index];
+    /* recheck: the record may have been freed since the lookup */
+    bool used = record.is_used() && owner_match(record, owner);
+    if(used)
+      out_size = record.block_size ? (record.lba_count * 512) : (record.lba_count * 4096);
+    unlock(index);
+
+    if(used) {
+      PLOG("Metadata: returning size=%lu", out_size);
+      return true;
     }
   }
   return false;
 }
 
+void Metadata::index_insert(const struct __md_record& record)
+{
+  Common::RWLock_guard g(_index_lock, Common::RWLock_guard::WRITE);
+  _index.emplace(std::string(record.id, strnlen(record.id, sizeof(record.id))),
+                 record.index);
+}
+
+void Metadata::index_erase(const struct __md_record& record)
+{
+  Common::RWLock_guard g(_index_lock, Common::RWLock_guard::WRITE);
+  auto range = _index.equal_range(std::string(record.id, strnlen(record.id, sizeof(record.id))));
+  for(auto i = range.first; i != range.second; i++) {
+    if(i->second == record.index) {
+      _index.erase(i);
+      return;
+    }
+  }
+}
+
+void Metadata::index_lookup(const std::string& id,
+                            const std::string& owner,
+                            std::vector<uint32_t>& out_indices)
+{
+  /* ids are stored truncated to the record field */
+  const std::string key = id.substr(0, sizeof(__md_record::id) - 1);
+  std::vector<uint32_t> hits;
+  {
+    Common::RWLock_guard g(_index_lock);
+    auto range = _index.equal_range(key);
+    for(auto i = range.first; i != range.second; i++)
+      hits.push_back(i->second);
+  }
+
+  /* compare owners under the record lock, taken outside the index
+     lock since free() nests them the other way */
+  for(auto index : hits) {
+    bool match = true;
+    if(!owner.empty()) {
+      lock(index);
+      auto& record = _records[index];
+      match = record.is_used() && owner_match(record, owner);
+      unlock(index);
+    }
+    if(match)
+      out_indices.push_back(index);
+  }
+}
+
 
 std::string Metadata::get_metadata(index_t index)
 {
@@ -389,6 +534,7 @@ void Metadata::free(index_t index)
   if(record->is_free())
     throw API_exception("invalid parameter; record already free");
 
+  index_erase(*record);
   record->set_free();
   _free_list.push(record); /* ok, list is thread safe */
  
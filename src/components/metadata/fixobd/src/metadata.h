@@ -13,7 +13,11 @@
 #ifndef __METADATA_COMPONENT_H__
 #define __METADATA_COMPONENT_H__
 
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <tbb/concurrent_queue.h>
+#include <common/rwlock.h>
 #include <api/metadata_itf.h>
 #include "md_record.h"
 
@@ -26,6 +30,9 @@ struct __md_record;
  * thus O(N).  Scan is dynamically evaluated so allocations can be
  * made during scan - no locks are held.  Each metadata record is 256
  * bytes. Locking is fine-grained (per metadata block) ticket-locks.
+ * An in-memory hash index (id -> record index) is rebuilt on open and
+ * kept up to date by allocate/free so that existence checks and
+ * exact-id iteration do not scan.
  */
 
 class Metadata : public Component::IMetadata
@@ -218,6 +225,22 @@ private:
    */
   void flush_record(struct __md_record* record);
 
+  /** 
+   * Add/remove record to/from the in-memory id index
+   * 
+   */
+  void index_insert(const struct __md_record& record);
+  void index_erase(const struct __md_record& record);
+
+  /** 
+   * Collect indices of used records with a given id (and owner if
+   * non-empty)
+   * 
+   */
+  void index_lookup(const std::string& id,
+                    const std::string& owner,
+                    std::vector<uint32_t>& out_indices);
+
 private:
   Component::IBlock_device * _block;
   size_t                     _n_records;  /*< number of records */
@@ -229,6 +252,9 @@ private:
   Lock_array *               _lock_array; /*< manages per-record fine grained locking */
 
   tbb::concurrent_queue<struct __md_record *> _free_list;
+
+  Common::RWLock                                 _index_lock;
+  std::unordered_multimap<std::string, uint32_t> _index;      /*< id -> record index */
 };
 
 
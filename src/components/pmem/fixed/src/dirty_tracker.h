@@ -0,0 +1,238 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __PMEM_FIXED_DIRTY_TRACKER_H__
+#define __PMEM_FIXED_DIRTY_TRACKER_H__
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <common/exceptions.h>
+#include <common/logging.h>
+#include <common/utils.h>
+
+/**
+ * Page-granularity dirty tracking based on write-protection faults.
+ * The tracked range is mapped read-only; the first store to a page
+ * raises SIGSEGV, the handler marks the page dirty and re-enables
+ * writes for that page.  collect() harvests dirty pages and
+ * re-protects them so that the next store is caught again.
+ *
+ * The signal handler only uses a fixed-size registration table and
+ * atomics (no locks or allocation).  Faults outside any tracked range
+ * are passed on to the previously installed handler.
+ *
+ * Only user-mode stores are caught.  A system call that writes into a
+ * clean (protected) page, e.g. read(2) or recv(2) into the region,
+ * fails with EFAULT instead of faulting; touch each page with a store
+ * first (see prepare_write) so that it is writable and marked dirty.
+ */
+class Dirty_tracker
+{
+private:
+  static constexpr unsigned MAX_TRACKERS = 64;
+
+  struct registration_t {
+    std::atomic<addr_t>          start;
+    std::atomic<addr_t>          end;
+    std::atomic<Dirty_tracker *> tracker;
+  };
+
+public:
+  /* run of dirty pages */
+  struct run_t {
+    size_t first_page;
+    size_t page_count;
+  };
+
+  Dirty_tracker(void * base, size_t size)
+    : _base(reinterpret_cast<addr_t>(base)),
+      _size(size),
+      _n_pages(size / PAGE_SIZE),
+      _n_words((_n_pages + 63) / 64),
+      _bitmap(new std::atomic<uint64_t>[_n_words])
+  {
+    if(_base % PAGE_SIZE || size % PAGE_SIZE)
+      throw API_exception("%s: range must be page aligned", __PRETTY_FUNCTION__);
+
+    for(size_t i=0;i<_n_words;i++)
+      _bitmap[i].store(0);
+
+    install_handler();
+
+    /* register before protecting so that no fault can be missed */
+    {
+      static std::mutex registration_lock;
+      std::lock_guard<std::mutex> g(registration_lock);
+      unsigned slot = 0;
+      while(slot < MAX_TRACKERS && _table()[slot].tracker.load() != nullptr)
+        slot++;
+      if(slot == MAX_TRACKERS)
+        throw General_exception("%s: too many tracked regions", __PRETTY_FUNCTION__);
+      _table()[slot].start.store(_base);
+      _table()[slot].end.store(_base + _size);
+      _table()[slot].tracker.store(this);
+      _slot = slot;
+    }
+
+    if(::mprotect(base, size, PROT_READ))
+      throw General_exception("%s: mprotect failed (%d)", __PRETTY_FUNCTION__, errno);
+  }
+
+  ~Dirty_tracker()
+  {
+    ::mprotect(reinterpret_cast<void*>(_base), _size, PROT_READ | PROT_WRITE);
+    _table()[_slot].tracker.store(nullptr);
+  }
+
+  /**
+   * Harvest dirty pages and re-arm write protection on them
+   *
+   * @param out_runs [out] Runs of contiguous dirty pages
+   *
+   * @return Number of dirty pages
+   */
+  size_t collect(std::vector<run_t>& out_runs)
+  {
+    size_t count = 0;
+    run_t current = {0,0};
+
+    for(size_t w=0;w<_n_words;w++) {
+      /* take bits before protecting; a racing store before the
+         mprotect is still captured by the subsequent write-out */
+      uint64_t bits = _bitmap[w].exchange(0);
+
+      for(unsigned b=0;b<64;b++) {
+        size_t page = (w * 64) + b;
+        if(bits & (1ULL << b)) {
+          if(current.page_count > 0 &&
+             current.first_page + current.page_count == page) {
+            current.page_count++;
+          }
+          else {
+            if(current.page_count > 0)
+              flush_run(current, out_runs);
+            current = {page, 1};
+          }
+          count++;
+        }
+      }
+    }
+    if(current.page_count > 0)
+      flush_run(current, out_runs);
+
+    return count;
+  }
+
+  /**
+   * Make pages writable by the kernel (e.g. as a read(2) target) by
+   * storing to each one, which also marks them dirty
+   *
+   * @param p Start address
+   * @param len Length in bytes
+   */
+  static void prepare_write(void * p, size_t len)
+  {
+    if(len == 0) return;
+    addr_t first = reinterpret_cast<addr_t>(p);
+    addr_t end = first + len;
+    for(addr_t a = round_down(first, PAGE_SIZE); a < end; a += PAGE_SIZE) {
+      /* atomic no-op store: must not lose a concurrent write */
+      __atomic_fetch_or(reinterpret_cast<byte *>(std::max(a, first)), 0, __ATOMIC_RELAXED);
+    }
+  }
+
+private:
+
+  void flush_run(const run_t& run, std::vector<run_t>& out_runs)
+  {
+    ::mprotect(reinterpret_cast<void*>(_base + (run.first_page * PAGE_SIZE)),
+               run.page_count * PAGE_SIZE,
+               PROT_READ);
+    out_runs.push_back(run);
+  }
+
+  /* async-signal-safe */
+  void on_fault(addr_t addr)
+  {
+    addr_t page_addr = round_down(addr, PAGE_SIZE);
+    size_t page = (page_addr - _base) / PAGE_SIZE;
+    /* unprotect before marking so that a concurrent collect() that
+       takes the bit always re-protects after us */
+    ::mprotect(reinterpret_cast<void*>(page_addr), PAGE_SIZE, PROT_READ | PROT_WRITE);
+    _bitmap[page / 64].fetch_or(1ULL << (page % 64));
+  }
+
+  static registration_t * _table() {
+    static registration_t table[MAX_TRACKERS];
+    return table;
+  }
+
+  static struct sigaction& _previous_action() {
+    static struct sigaction sa;
+    return sa;
+  }
+
+  static void install_handler()
+  {
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = segv_handler;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if(::sigaction(SIGSEGV, &sa, &_previous_action()))
+          throw General_exception("Dirty_tracker: sigaction failed");
+      });
+  }
+
+  static void segv_handler(int sig, siginfo_t * si, void * context)
+  {
+    addr_t addr = reinterpret_cast<addr_t>(si->si_addr);
+
+    for(unsigned i=0;i<MAX_TRACKERS;i++) {
+      Dirty_tracker * t = _table()[i].tracker.load();
+      if(t && addr >= _table()[i].start.load() && addr < _table()[i].end.load()) {
+        t->on_fault(addr);
+        return;
+      }
+    }
+
+    /* not ours: chain */
+    struct sigaction& prev = _previous_action();
+    if(prev.sa_flags & SA_SIGINFO) {
+      prev.sa_sigaction(sig, si, context);
+    }
+    else if(prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+      prev.sa_handler(sig);
+    }
+    else {
+      signal(SIGSEGV, SIG_DFL); /* re-fault with default action */
+    }
+  }
+
+private:
+  const addr_t                           _base;
+  const size_t                           _size;
+  const size_t                           _n_pages;
+  const size_t                           _n_words;
+  std::unique_ptr<std::atomic<uint64_t>[]> _bitmap;
+  unsigned                               _slot = 0;
+};
+
+#endif
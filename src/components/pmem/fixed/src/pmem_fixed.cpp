@@ -208,6 +208,21 @@ open(std::string id, size_t size, int numa_node, bool& reused, void*& vptr)
 
   /* read in data */
   bd->read(iob, 0, 0 /* lba */ , size / _block_size /* lba count */);
+
+  /* create handle */
+  struct mem_handle * h = new mem_handle;
+  h->size = size;
+  h->iob = iob;
+  h->bd = bd;
+  h->id = id;
+  h->tracker = nullptr;
+  h->tx_active = false;
+  h->redo_bd = nullptr;
+  h->redo_iob = 0;
+
+  /* replay any committed but not written-back transaction */
+  if(reused && open_redo_log(h, false))
+    recover(h);
   
   /* map region to physical memory */
   void  * ptr = ::mmap((void*) vaddr,
@@ -223,13 +238,10 @@ open(std::string id, size_t size, int numa_node, bool& reused, void*& vptr)
 
   PLOG("XMS: mmap returned %p", ptr);
   vptr = ptr;
-  
-  /* create handle */
-  struct mem_handle * h = new mem_handle;
   h->ptr = ptr;
-  h->size = size;
-  h->iob = iob;
-  h->bd = bd;
+
+  /* write-protect and start tracking dirty pages */
+  h->tracker = new Dirty_tracker(ptr, size);
 
   std::lock_guard<std::mutex> g(_handle_list_lock);
   _handle_list.push_back(h);
@@ -252,10 +264,21 @@ close(IPersistent_memory::pmem_t handle, int flags)
 
   struct mem_handle * h = static_cast<struct mem_handle*>(handle);
 
-  if(!(flags & IPersistent_memory::FLAGS_NOFLUSH)) {
+  if(h->tx_active) {
+    PWRN("Pmem-fixed: closing region with active transaction; discarding");
+    h->tx_active = false;
+  }
+  else if(!(flags & IPersistent_memory::FLAGS_NOFLUSH)) {
     this->persist(handle);
   }
 
+  delete h->tracker;
+
+  if(h->redo_bd) {
+    _block_device->free_io_buffer(h->redo_iob);
+    h->redo_bd->release_ref();
+  }
+
   _block_device->free_io_buffer(h->iob);
   assert(h);
   assert(h->bd);
@@ -320,12 +343,76 @@ persist(pmem_t handle)
      h->iob == 0)
     throw API_exception("%s: bad handle", __PRETTY_FUNCTION__);
 
-  /* synchronously write out whole block */
-  size_t nblocks = h->size / _block_size;
-  if(h->size % _block_size) nblocks++;
+  /* transaction changes are written back by tx_commit */
+  if(h->tx_active)
+    return;
+
+  /* write out only pages modified since the last persist */
+  std::vector<Dirty_tracker::run_t> runs;
+  size_t npages = h->tracker->collect(runs);
+  if(npages == 0)
+    return;
+
+  if(option_DEBUG)
+    PLOG("Pmem-fixed: persist writing %lu dirty pages (%lu runs)", npages, runs.size());
 
-  PMAJOR("writing %ld blocks", nblocks);
-  h->bd->write(h->iob, 0, 0, nblocks);
+  write_back(h, runs);
+}
+
+void
+Pmem_fixed_component::
+write_back(struct mem_handle * h, const std::vector<Dirty_tracker::run_t>& runs)
+{
+  assert(PAGE_SIZE % _block_size == 0);
+  const size_t blocks_per_page = PAGE_SIZE / _block_size;
+
+  /* keep a bounded window of writes in flight and wait on each one;
+     devices may complete out of order */
+  std::vector<workid_t> wids;
+  auto wait_all = [&]() {
+    for(auto wid : wids)
+      while(!h->bd->check_completion(wid))
+        cpu_relax();
+    wids.clear();
+  };
+
+  for(auto& run : runs) {
+    size_t page = run.first_page;
+    size_t remaining = run.page_count;
+    while(remaining > 0) {
+      size_t n = std::min(remaining, static_cast<size_t>(MAX_IO_PAGES));
+      wids.push_back(h->bd->async_write(h->iob,
+                                        page * PAGE_SIZE, /* offset */
+                                        page * blocks_per_page, /* lba */
+                                        n * blocks_per_page));
+      if(wids.size() == MAX_OUTSTANDING_IO)
+        wait_all();
+      page += n;
+      remaining -= n;
+    }
+  }
+  wait_all();
+}
+
+void
+Pmem_fixed_component::
+roll_back(struct mem_handle * h, const std::vector<Dirty_tracker::run_t>& runs)
+{
+  const size_t blocks_per_page = PAGE_SIZE / _block_size;
+
+  /* the home blocks still hold the pre-transaction image (tx_begin
+     persisted); the reads go through the I/O buffer mapping, so the
+     re-protected region mapping does not fault */
+  for(auto& run : runs) {
+    size_t page = run.first_page;
+    size_t remaining = run.page_count;
+    while(remaining > 0) {
+      size_t n = std::min(remaining, static_cast<size_t>(MAX_IO_PAGES));
+      h->bd->read(h->iob, page * PAGE_SIZE, page * blocks_per_page, n * blocks_per_page);
+      page += n;
+      remaining -= n;
+    }
+  }
 }
 
 void
@@ -355,6 +442,10 @@ persist_scoped(pmem_t handle, void *ptr, size_t size)
   
   size_t nblocks = size / _block_size;
   if(size % _block_size) nblocks++;
+
+  /* transaction changes are written back by tx_commit */
+  if(h->tx_active)
+    return;
   
   /* synchronously write out whole block */
   h->bd->write(h->iob, offset, lba_offset, nblocks); 
@@ -375,29 +466,170 @@ get_size(pmem_t handle)
 }
 
 /** 
- * Start transaction
+ * Start transaction. Outstanding changes are persisted so that the
+ * dirty set at commit is exactly the transaction's write set.
  * 
  */
 void
 Pmem_fixed_component::
 tx_begin(pmem_t handle)
 {
-  throw API_exception("%s: not supported", __FUNCTION__);
+  struct mem_handle * h = static_cast<struct mem_handle*>(handle);
+  if(h==nullptr || h->tracker == nullptr)
+    throw API_exception("%s: bad handle", __PRETTY_FUNCTION__);
+
+  if(h->tx_active)
+    throw API_exception("%s: transaction already active", __PRETTY_FUNCTION__);
+
+  persist(handle);
+
+  if(h->redo_bd == nullptr)
+    open_redo_log(h, true);
+
+  h->tx_active = true;
 }
 
 /** 
- * Commit transaction
+ * Commit transaction. Dirty pages are written to the redo log and
+ * the log is marked committed before the pages are written home.  A
+ * transaction that dirtied more than REDO_LOG_MAX_PAGES pages is
+ * rolled back to its tx_begin image and nothing is written.
  * 
  * 
- * @return S_OK or E_FAIL
+ * @return S_OK or E_FAIL (transaction rolled back)
  */
 status_t
 Pmem_fixed_component::
 tx_commit(pmem_t handle)
 {
-  throw API_exception("%s: not supported", __FUNCTION__);
+  struct mem_handle * h = static_cast<struct mem_handle*>(handle);
+  if(h==nullptr || h->tracker == nullptr)
+    throw API_exception("%s: bad handle", __PRETTY_FUNCTION__);
+
+  if(!h->tx_active)
+    throw API_exception("%s: no active transaction", __PRETTY_FUNCTION__);
+
+  h->tx_active = false;
+
+  std::vector<Dirty_tracker::run_t> runs;
+  size_t npages = h->tracker->collect(runs);
+  if(npages == 0)
+    return S_OK;
+
+  /* too large to commit atomically: discard the transaction rather
+     than write it home piecemeal */
+  if(npages > REDO_LOG_MAX_PAGES) {
+    PWRN("Pmem-fixed: transaction (%lu pages) exceeds redo log (%lu pages); rolled back",
+         npages, REDO_LOG_MAX_PAGES);
+    roll_back(h, runs);
+    return E_FAIL;
+  }
+
+  /* stage descriptors and page images */
+  byte * log = static_cast<byte*>(_block_device->virt_addr(h->redo_iob));
+  uint64_t * desc = reinterpret_cast<uint64_t*>(log + PAGE_SIZE);
+  byte * data = log + REDO_DATA_OFFSET;
+  size_t i = 0;
+  for(auto& run : runs) {
+    for(size_t p = run.first_page; p < run.first_page + run.page_count; p++) {
+      desc[i] = p;
+      memcpy(data + (i * PAGE_SIZE), static_cast<byte*>(h->ptr) + (p * PAGE_SIZE), PAGE_SIZE);
+      i++;
+    }
+  }
+
+  /* log body, then commit record, then home locations */
+  size_t log_bytes = REDO_DATA_OFFSET + (npages * PAGE_SIZE) - PAGE_SIZE;
+  h->redo_bd->write(h->redo_iob, PAGE_SIZE, PAGE_SIZE / _block_size, log_bytes / _block_size);
+  write_redo_state(h, REDO_STATE_COMMITTED, npages);
+
+  /* crash injection for recovery testing */
+  if(option_DEBUG && ::getenv("PMEM_FIXED_TEST_CRASH_AFTER_COMMIT"))
+    return S_OK;
+
+  write_back(h, runs);
+
+  write_redo_state(h, REDO_STATE_EMPTY, 0);
+  return S_OK;
+}
+
+bool
+Pmem_fixed_component::
+open_redo_log(struct mem_handle * h, bool create)
+{
+  const std::string redo_id = h->id + ".redo";
+  const size_t nblocks = REDO_LOG_SIZE / _block_size;
+  addr_t vaddr = 0;
+  bool reused = true;
+
+  if(create) {
+    h->redo_bd = _rm->reuse_or_allocate_region(nblocks, _owner_id, redo_id, vaddr, reused);
+  }
+  else {
+    IRegion_manager::REGION_INFO ri;
+    if(!_rm->get_region_info(_owner_id, redo_id, ri))
+      return false;
+    h->redo_bd = _rm->open_region(nblocks, _owner_id, redo_id, vaddr);
+  }
+
+  if(!h->redo_bd)
+    throw General_exception("%s: unable to open redo log region", __PRETTY_FUNCTION__);
+
+  h->redo_iob = _block_device->allocate_io_buffer(REDO_LOG_SIZE, PAGE_SIZE, NUMA_NODE_ANY);
+  assert(h->redo_iob);
+
+  if(!reused)
+    write_redo_state(h, REDO_STATE_EMPTY, 0);
+
+  return true;
 }
 
+void
+Pmem_fixed_component::
+recover(struct mem_handle * h)
+{
+  byte * log = static_cast<byte*>(_block_device->virt_addr(h->redo_iob));
+  h->redo_bd->read(h->redo_iob, 0, 0, 1);
+
+  auto hdr = reinterpret_cast<redo_header_t*>(log);
+  if(hdr->magic != REDO_MAGIC || hdr->state != REDO_STATE_COMMITTED)
+    return;
+
+  const size_t npages = hdr->page_count;
+  if(npages > REDO_LOG_MAX_PAGES)
+    throw General_exception("%s: corrupt redo log", __PRETTY_FUNCTION__);
+
+  PLOG("Pmem-fixed: replaying redo log for region %s (%lu pages)", h->id.c_str(), npages);
+
+  size_t log_bytes = REDO_DATA_OFFSET + (npages * PAGE_SIZE) - PAGE_SIZE;
+  h->redo_bd->read(h->redo_iob, PAGE_SIZE, PAGE_SIZE / _block_size, log_bytes / _block_size);
+
+  const uint64_t * desc = reinterpret_cast<const uint64_t*>(log + PAGE_SIZE);
+  const byte * data = log + REDO_DATA_OFFSET;
+  byte * home = static_cast<byte*>(_block_device->virt_addr(h->iob));
+  std::vector<Dirty_tracker::run_t> runs;
+
+  for(size_t i=0;i<npages;i++) {
+    if((desc[i] + 1) * PAGE_SIZE > h->size)
+      throw General_exception("%s: corrupt redo log descriptor", __PRETTY_FUNCTION__);
+    memcpy(home + (desc[i] * PAGE_SIZE), data + (i * PAGE_SIZE), PAGE_SIZE);
+    runs.push_back({desc[i], 1});
+  }
+
+  write_back(h, runs);
+  write_redo_state(h, REDO_STATE_EMPTY, 0);
+}
+
+void
+Pmem_fixed_component::
+write_redo_state(struct mem_handle * h, uint32_t state, uint64_t page_count)
+{
+  auto hdr = static_cast<redo_header_t*>(_block_device->virt_addr(h->redo_iob));
+  hdr->magic = REDO_MAGIC;
+  hdr->state = state;
+  hdr->page_count = page_count;
+  h->redo_bd->write(h->redo_iob, 0, 0, 1);
+}
 
 
 /** 
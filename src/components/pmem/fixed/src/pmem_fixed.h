@@ -30,11 +30,23 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
+#include "dirty_tracker.h"
+
+/** 
+ * Regions are write-protected and dirty pages are tracked through
+ * faults, so that persist writes back only what changed.  A small
+ * per-region redo log (region "<id>.redo") provides tx_begin/tx_commit.
+ * 
+ */
 class Pmem_fixed_component : public Component::IPersistent_memory
 {  
 private:
   static constexpr bool option_DEBUG = true;
+  static constexpr size_t MAX_IO_PAGES = 256;         /*< max pages per async write */
+  static constexpr size_t MAX_OUTSTANDING_IO = 64;    /*< async writes in flight during write back */
+  static constexpr size_t REDO_LOG_MAX_PAGES = 1024;  /*< max dirty pages per transaction */
 
 
 public:
@@ -162,7 +174,8 @@ public:
    * Commit transaction
    * 
    * 
-   * @return S_OK or E_FAIL
+   * @return S_OK, or E_FAIL if the transaction was too large for the
+   * redo log (it is rolled back and nothing is written)
    */
   virtual status_t tx_commit(pmem_t handle) override;
   
@@ -183,8 +196,57 @@ private:
     size_t                     size;
     void *                     ptr;
     Component::IBlock_device * bd;
+    std::string                id;
+    Dirty_tracker *            tracker;
+    bool                       tx_active;
+    Component::IBlock_device * redo_bd;   /*< lazily opened redo log region */
+    Component::io_buffer_t     redo_iob;
   };
 
+  /* redo log layout (in pages): header, descriptors, data */
+  struct redo_header_t {
+    uint32_t magic;
+    uint32_t state;
+    uint64_t page_count;
+  };
+
+  static constexpr uint32_t REDO_MAGIC = 0x7ed0106;
+  static constexpr size_t   REDO_DESC_PAGES = (REDO_LOG_MAX_PAGES * sizeof(uint64_t)) / PAGE_SIZE;
+  static constexpr size_t   REDO_DATA_OFFSET = (1 + REDO_DESC_PAGES) * PAGE_SIZE;
+  static constexpr size_t   REDO_LOG_SIZE = REDO_DATA_OFFSET + (REDO_LOG_MAX_PAGES * PAGE_SIZE);
+
+  enum {
+    REDO_STATE_EMPTY = 0,
+    REDO_STATE_COMMITTED = 1,
+  };
+
+  /** 
+   * Write back runs of pages asynchronously and wait for completion
+   * 
+   */
+  void write_back(struct mem_handle * h, const std::vector<Dirty_tracker::run_t>& runs);
+
+  /** 
+   * Re-read runs of pages from their home blocks, discarding changes
+   * 
+   */
+  void roll_back(struct mem_handle * h, const std::vector<Dirty_tracker::run_t>& runs);
+
+  /** 
+   * Open redo log region (create if requested)
+   * 
+   * @return True if log is available
+   */
+  bool open_redo_log(struct mem_handle * h, bool create);
+
+  /** 
+   * Replay a committed redo log into the region (called before mapping)
+   * 
+   */
+  void recover(struct mem_handle * h);
+
+  void write_redo_state(struct mem_handle * h, uint32_t state, uint64_t page_count);
+
   std::list<struct mem_handle*>       _handle_list;
   std::mutex                          _handle_list_lock;
 };
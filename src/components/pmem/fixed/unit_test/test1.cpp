@@ -11,6 +11,7 @@
    limitations under the License.
 */
 #include <gtest/gtest.h>
+#include <stdlib.h>
 #include <string>
 #include <list>
 #include <common/cycles.h>
@@ -34,6 +35,7 @@
 #define DO_INTEGRITY
 #define DO_STRESS_MEMORY
 #define DO_STORE_RELOAD
+#define DO_TRANSACTIONS
 
 using namespace Component;
 
@@ -294,6 +296,134 @@ TEST_F(Pmem_fixed_test, IntegrityCheck)
 
 
 
+#ifdef DO_TRANSACTIONS
+/* region of 2048 pages; each page holds its index in the first word */
+static constexpr size_t TX_PAGES = 2048;
+static constexpr size_t TX_WORDS = KB(4) / sizeof(uint64_t);
+
+static void tx_fill(uint64_t * p, size_t first, size_t count, uint64_t val)
+{
+  for(size_t i=first;i<first+count;i++)
+    p[i * TX_WORDS] = val + i;
+}
+
+static bool tx_check(uint64_t * p, size_t first, size_t count, uint64_t val)
+{
+  for(size_t i=first;i<first+count;i++)
+    if(p[i * TX_WORDS] != val + i) return false;
+  return true;
+}
+
+TEST_F(Pmem_fixed_test, TxCommit)
+{
+  bool reused;
+  void * vptr = nullptr;
+  auto h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  uint64_t * p = static_cast<uint64_t*>(vptr);
+
+  tx_fill(p, 0, TX_PAGES, 0);
+  _pmem->persist(h);
+
+  _pmem->tx_begin(h);
+  tx_fill(p, 100, 50, 1000);
+  tx_fill(p, 1500, 3, 1000);
+  ASSERT_EQ(S_OK, _pmem->tx_commit(h));
+  _pmem->close(h, IPersistent_memory::FLAGS_NOFLUSH);
+
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  ASSERT_TRUE(reused);
+  ASSERT_TRUE(tx_check(p, 0, 100, 0));
+  ASSERT_TRUE(tx_check(p, 100, 50, 1000));
+  ASSERT_TRUE(tx_check(p, 150, 1350, 0));
+  ASSERT_TRUE(tx_check(p, 1500, 3, 1000));
+  ASSERT_TRUE(tx_check(p, 1503, TX_PAGES - 1503, 0));
+  _pmem->close(h);
+}
+
+TEST_F(Pmem_fixed_test, TxAbort)
+{
+  bool reused;
+  void * vptr = nullptr;
+  auto h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  uint64_t * p = static_cast<uint64_t*>(vptr);
+
+  tx_fill(p, 0, TX_PAGES, 0);
+  _pmem->persist(h);
+
+  /* closing with an open transaction discards it */
+  _pmem->tx_begin(h);
+  tx_fill(p, 10, 10, 2000);
+  _pmem->close(h);
+
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  ASSERT_TRUE(tx_check(p, 0, TX_PAGES, 0));
+  _pmem->close(h);
+}
+
+TEST_F(Pmem_fixed_test, TxTooLarge)
+{
+  bool reused;
+  void * vptr = nullptr;
+  auto h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  uint64_t * p = static_cast<uint64_t*>(vptr);
+
+  tx_fill(p, 0, TX_PAGES, 0);
+  _pmem->persist(h);
+
+  /* more pages than the redo log holds: rolled back, nothing written */
+  _pmem->tx_begin(h);
+  tx_fill(p, 0, TX_PAGES, 3000);
+  ASSERT_EQ(E_FAIL, _pmem->tx_commit(h));
+  ASSERT_TRUE(tx_check(p, 0, TX_PAGES, 0));
+  _pmem->close(h, IPersistent_memory::FLAGS_NOFLUSH);
+
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  ASSERT_TRUE(tx_check(p, 0, TX_PAGES, 0));
+  _pmem->close(h);
+}
+
+TEST_F(Pmem_fixed_test, TxRecovery)
+{
+  bool reused;
+  void * vptr = nullptr;
+  auto h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  uint64_t * p = static_cast<uint64_t*>(vptr);
+
+  tx_fill(p, 0, TX_PAGES, 0);
+  _pmem->persist(h);
+
+  /* crash after the commit record, before any page is written home */
+  _pmem->tx_begin(h);
+  tx_fill(p, 700, 300, 4000);
+  setenv("PMEM_FIXED_TEST_CRASH_AFTER_COMMIT", "1", 1);
+  ASSERT_EQ(S_OK, _pmem->tx_commit(h));
+  unsetenv("PMEM_FIXED_TEST_CRASH_AFTER_COMMIT");
+  _pmem->close(h, IPersistent_memory::FLAGS_NOFLUSH);
+
+  /* reopen replays the redo log */
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  ASSERT_TRUE(tx_check(p, 0, 700, 0));
+  ASSERT_TRUE(tx_check(p, 700, 300, 4000));
+  ASSERT_TRUE(tx_check(p, 1000, TX_PAGES - 1000, 0));
+  _pmem->close(h);
+
+  /* the log was cleared by the replay */
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  tx_fill(p, 700, 300, 0);
+  _pmem->close(h);
+  h = _pmem->open("txregion", TX_PAGES * KB(4), NUMA_NODE_ANY, reused, vptr);
+  p = static_cast<uint64_t*>(vptr);
+  ASSERT_TRUE(tx_check(p, 0, TX_PAGES, 0));
+  _pmem->close(h);
+}
+#endif // DO_TRANSACTIONS
+
+
 TEST_F(Pmem_fixed_test, ReleaseBlockDevice)
 {
   ASSERT_TRUE(_pmem);
@@ -0,0 +1,154 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
+#include "../src/dirty_tracker.h"
+
+namespace {
+
+const size_t NPAGES = 256;
+
+class Dirty_tracker_test : public ::testing::Test {
+
+ protected:
+
+  virtual void SetUp() {
+    _base = static_cast<byte*>(::mmap(nullptr, NPAGES * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ASSERT_NE(MAP_FAILED, static_cast<void*>(_base));
+  }
+
+  virtual void TearDown() {
+    ::munmap(_base, NPAGES * PAGE_SIZE);
+  }
+
+  byte * page(size_t i) { return _base + (i * PAGE_SIZE); }
+
+  byte * _base;
+};
+
+TEST_F(Dirty_tracker_test, Clean)
+{
+  Dirty_tracker t(_base, NPAGES * PAGE_SIZE);
+  std::vector<Dirty_tracker::run_t> runs;
+
+  /* loads do not dirty */
+  volatile byte sum = 0;
+  for(size_t i=0;i<NPAGES;i++)
+    sum += *page(i);
+  (void) sum;
+
+  ASSERT_EQ(0, t.collect(runs));
+  ASSERT_TRUE(runs.empty());
+}
+
+TEST_F(Dirty_tracker_test, Runs)
+{
+  Dirty_tracker t(_base, NPAGES * PAGE_SIZE);
+  std::vector<Dirty_tracker::run_t> runs;
+
+  /* 3-5, 63-65 (across a bitmap word), 200 */
+  for(size_t i : {3, 4, 5, 63, 64, 65, 200})
+    page(i)[17] = byte(i);
+  page(4)[1000] = 1; /* second store to a dirty page */
+
+  ASSERT_EQ(7, t.collect(runs));
+  ASSERT_EQ(3, runs.size());
+  ASSERT_EQ(3, runs[0].first_page);
+  ASSERT_EQ(3, runs[0].page_count);
+  ASSERT_EQ(63, runs[1].first_page);
+  ASSERT_EQ(3, runs[1].page_count);
+  ASSERT_EQ(200, runs[2].first_page);
+  ASSERT_EQ(1, runs[2].page_count);
+
+  ASSERT_EQ(byte(64), page(64)[17]);
+  ASSERT_EQ(1, page(4)[1000]);
+}
+
+TEST_F(Dirty_tracker_test, Rearm)
+{
+  Dirty_tracker t(_base, NPAGES * PAGE_SIZE);
+  std::vector<Dirty_tracker::run_t> runs;
+
+  page(10)[0] = 1;
+  ASSERT_EQ(1, t.collect(runs));
+
+  /* collected pages are protected again and fault on the next store */
+  runs.clear();
+  ASSERT_EQ(0, t.collect(runs));
+  page(10)[0] = 2;
+  ASSERT_EQ(1, t.collect(runs));
+  ASSERT_EQ(10, runs[0].first_page);
+  ASSERT_EQ(2, page(10)[0]);
+}
+
+TEST_F(Dirty_tracker_test, ConcurrentStores)
+{
+  Dirty_tracker t(_base, NPAGES * PAGE_SIZE);
+  std::vector<Dirty_tracker::run_t> runs;
+  const unsigned NTHREADS = 4;
+
+  std::vector<std::thread> threads;
+  for(unsigned n=0;n<NTHREADS;n++) {
+    threads.emplace_back([this, n]() {
+        for(size_t i=n;i<NPAGES;i+=NTHREADS)
+          page(i)[n] = byte(n + 1);
+      });
+  }
+  for(auto& th : threads)
+    th.join();
+
+  ASSERT_EQ(NPAGES, t.collect(runs));
+  ASSERT_EQ(1, runs.size());
+  for(size_t i=0;i<NPAGES;i++)
+    ASSERT_EQ(byte((i % NTHREADS) + 1), page(i)[i % NTHREADS]);
+}
+
+TEST_F(Dirty_tracker_test, SyscallWrite)
+{
+  Dirty_tracker t(_base, NPAGES * PAGE_SIZE);
+  std::vector<Dirty_tracker::run_t> runs;
+
+  int fd = ::open("/dev/zero", O_RDONLY);
+  ASSERT_GE(fd, 0);
+
+  /* the kernel does not raise SIGSEGV for a protected target */
+  page(20)[0] = 1;
+  t.collect(runs);
+  ASSERT_EQ(-1, ::read(fd, page(20), PAGE_SIZE * 2));
+  ASSERT_EQ(EFAULT, errno);
+
+  /* once the pages are touched the read succeeds and is tracked */
+  runs.clear();
+  Dirty_tracker::prepare_write(page(20) + 100, PAGE_SIZE * 2);
+  ASSERT_EQ(ssize_t(PAGE_SIZE * 2), ::read(fd, page(20) + 100, PAGE_SIZE * 2));
+  ASSERT_EQ(0, page(20)[100]);
+  ASSERT_EQ(1, page(20)[0]);
+  ASSERT_EQ(3, t.collect(runs));
+  ASSERT_EQ(20, runs[0].first_page);
+  ASSERT_EQ(3, runs[0].page_count);
+
+  ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
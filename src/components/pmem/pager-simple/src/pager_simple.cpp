@@ -73,6 +73,14 @@ public:
     return vaddr;
   }
 
+  bool contains(addr_t vaddr) {
+    for(range_t& r: _table) {
+      if(vaddr >= r.start && vaddr <= r.end)
+        return true;
+    }
+    return false;
+  }
+
   IBlock_device * lookup(addr_t vaddr, addr_t& lba) {
 
     if(!vaddr)
@@ -148,6 +156,10 @@ Simple_pager_component(size_t nr_pages,
 
 Simple_pager_component::~Simple_pager_component()
 {
+  /* drain staged write-backs before rewriting any page */
+  for(unsigned s=0;s<NUM_SIDE_SLOTS;s++)
+    side_slot_wait(s);
+
   /* flush active pages */  
   for(unsigned slot=0;slot<_nr_pages;slot++) {
     if(_pages[slot].vaddr) {
@@ -158,6 +170,8 @@ Simple_pager_component::~Simple_pager_component()
       bd->write(_iob, buffer_offset, lba, 1);
     }
   }
+
+  _block_dev->free_io_buffer(_side_iob);
   
   delete _tracker;
 
@@ -187,15 +201,31 @@ init_memory(size_t nr_pages)
   addr_t phys = _phys_base;
   _pages = new struct page_descriptor [_nr_pages];
   
+  _frames_vaddr = static_cast<byte*>(_block_dev->virt_addr(_iob));
+  assert(_frames_vaddr);
+
   for(unsigned i=0;i<nr_pages;i++) {
-    _pages[i].gwid  = 0;
     _pages[i].paddr  = phys;
     _pages[i].vaddr  = 0;
+    _pages[i].hot    = false;
     //    _pages.push_back(phys);
     PLOG("[simple-pager]: added phys page %lx", phys);
     phys+= PAGE_SIZE;
   }
 
+  /* at most 3/4 of the frames are hot so that new pages have room */
+  _max_hot = (nr_pages * 3) / 4;
+  _resident.reserve(nr_pages);
+
+  /* side buffer for write-back staging and read-ahead */
+  _side_iob = _block_dev->allocate_io_buffer(PAGE_SIZE * NUM_SIDE_SLOTS,
+                                             PAGE_SIZE,
+                                             NUMA_NODE_ANY);
+  _side_vaddr = static_cast<byte*>(_block_dev->virt_addr(_side_iob));
+  assert(_side_vaddr);
+  for(unsigned s=0;s<NUM_SIDE_SLOTS;s++)
+    _side[s] = {SIDE_FREE, 0, 0, nullptr};
+
   if(option_DEBUG) {
     PINF("[simple-pager]: allocated %ld pages starting at %lx",
          _nr_pages,_phys_base);
@@ -228,88 +258,274 @@ request_page(addr_t virt_addr_faulted,
   if(option_DEBUG) {
     PLOG("request page: fault=%lx", virt_addr_faulted);
   }
+
+  std::lock_guard<std::mutex> g(_lock);
+  _request_num++;
+
+  /* re-fault within the history window promotes to hot */
+  bool hot = ghost_test_and_remove(virt_addr_faulted) && (_nr_hot < _max_hot);
   
   /* select page to evict */
-  unsigned slot = _request_num % _nr_pages;
-  _request_num++;
+  unsigned slot = select_victim();
+  addr_t victim = _pages[slot].vaddr;
+  *out_virt_addr_evict = victim;
 
-  //#define FORCE_SYNC // TESTING ONLY
-#ifndef FORCE_SYNC // TESTING ONLY
-  if(_pages[slot].gwid) {
-#ifndef DISABLE_IO
-    //    PLOG("waiting for completion gwid=%ld",_pages[slot].gwid);
-    while(!_block_dev->check_completion(_pages[slot].gwid)) {
-      cpu_relax();
-    }
-    _pages[slot].gwid = 0;
-#endif
+  /* swap out: stage copy and write back asynchronously */
+  if(victim) {
     if(option_DEBUG)
-      PLOG("swapping out: vaddr evict=%p", (void*) *out_virt_addr_evict);
+      PLOG("swapping out: vaddr evict=%p", (void*) victim);
+
+    _resident.erase(victim);
+    if(_pages[slot].hot) _nr_hot--;
+    ghost_insert(victim);
+    stage_writeback(victim, frame_ptr(slot));
   }
-#endif
-  *out_virt_addr_evict = _pages[slot].vaddr;
 
-  
-#ifndef DISABLE_IO
-  addr_t lba;
-  IBlock_device * bd = nullptr;
-  uint64_t buffer_offset = PAGE_SIZE * slot;
-  /* swap out */
-  {
-    if(_pages[slot].vaddr > 0) {
-      bd = _tracker->lookup(_pages[slot].vaddr, lba);
-      
-      /* issue async write-back */
-#ifndef FORCE_SYNC // TESTING only.
-      // TODO: io buffer not protected!
-      _pages[slot].gwid = bd->async_write(_iob, buffer_offset, lba,1);
-#else
-      bd->write(_iob, buffer_offset, lba, 1);
-#endif
+  /* swap in: side buffer hit or synchronous read */
+  auto side = _side_map.find(virt_addr_faulted);
+  if(side != _side_map.end()) {
+    unsigned s = side->second;
+    if(_side[s].state == SIDE_READAHEAD) {
+      side_slot_wait(s);
+      memcpy(frame_ptr(slot), side_ptr(s), PAGE_SIZE);
+      side_slot_release(s);
+    }
+    else {
+      /* write-back copy is current; its write may still be in flight */
+      memcpy(frame_ptr(slot), side_ptr(s), PAGE_SIZE);
     }
   }
-  /* swap in */
-  {
-    //    _tracker->dump_info();
-    /* issue synchronous read */
-    bd = _tracker->lookup(virt_addr_faulted, lba);
+  else {
+#ifndef DISABLE_IO
+    addr_t lba;
+    IBlock_device * bd = _tracker->lookup(virt_addr_faulted, lba);
     if(option_DEBUG)
       PLOG("swapping in: vaddr=0x%lx lba=0x%lx", virt_addr_faulted, lba);
-
-    // TODO: io buffer can be corrupted
-    bd->read(_iob, buffer_offset, lba, 1);
-  }
+    bd->read(_iob, PAGE_SIZE * slot, lba, 1);
 #endif
+  }
   
   _pages[slot].vaddr = virt_addr_faulted;
+  _pages[slot].hot = hot;
+  if(hot) _nr_hot++;
+  _resident[virt_addr_faulted] = slot;
+
   *out_phys_addr_map = _pages[slot].paddr;
   assert(*out_phys_addr_map > 0);
+
+  /* sequential fault detection */
+  if(virt_addr_faulted == _last_fault + PAGE_SIZE) {
+    if(++_seq_run >= SEQ_THRESHOLD)
+      prefetch(virt_addr_faulted);
+  }
+  else {
+    _seq_run = 0;
+  }
+  _last_fault = virt_addr_faulted;
   
   if(option_DEBUG) {
      PLOG("resolve pf response: phys=%lx evict=%lx", *out_phys_addr_map, *out_virt_addr_evict);
   }
 }
 
+/** 
+ * CLOCK sweep: empty frames are taken immediately, hot frames are
+ * demoted to cold and skipped, the first cold frame is the victim.
+ * Terminates within two revolutions.
+ */
+unsigned
+Simple_pager_component::
+select_victim()
+{
+  for(;;) {
+    unsigned slot = _hand;
+    _hand = (_hand + 1) % _nr_pages;
+
+    if(_pages[slot].vaddr == 0)
+      return slot;
+
+    if(_pages[slot].hot) {
+      _pages[slot].hot = false;
+      _nr_hot--;
+      continue;
+    }
+    return slot;
+  }
+}
+
+bool
+Simple_pager_component::
+ghost_test_and_remove(addr_t vaddr)
+{
+  /* stale FIFO entries are skipped when trimming */
+  return _ghost.erase(vaddr) > 0;
+}
 
 void
 Simple_pager_component::
-clear_mappings(addr_t vaddr, size_t size)
+ghost_insert(addr_t vaddr)
 {
-  addr_t vaddr_end = vaddr + size;
-  for(unsigned i=0;i<_nr_pages;i++) {
-    if(_pages[i].vaddr >= vaddr && _pages[i].vaddr < vaddr_end) {
+  /* history covers as many non-resident pages as there are frames */
+  if(!_ghost.insert(vaddr).second) return;
+  _ghost_fifo.push_back(vaddr);
+  while(_ghost.size() > _nr_pages) {
+    _ghost.erase(_ghost_fifo.front());
+    _ghost_fifo.pop_front();
+  }
+  if(_ghost_fifo.size() > (_nr_pages * 2)) {
+    std::deque<addr_t> live;
+    for(auto v : _ghost_fifo)
+      if(_ghost.count(v)) live.push_back(v);
+    _ghost_fifo.swap(live);
+  }
+}
 
-      if(_pages[i].vaddr && _pages[i].gwid) {
+bool
+Simple_pager_component::
+side_slot_done(unsigned s)
+{
+  if(_side[s].gwid == 0)
+    return true;
 #ifndef DISABLE_IO
-        while(!_block_dev->check_completion(_pages[i].gwid)) {
-          //          PWRN("waiting on completions: queue too short?");
-          cpu_relax();
-        }
+  if(!_side[s].bd->check_completion(_side[s].gwid))
+    return false;
 #endif
-      }
+  _side[s].gwid = 0;
+  return true;
+}
 
-      _pages[i].gwid  = 0;
+void
+Simple_pager_component::
+side_slot_wait(unsigned s)
+{
+  while(!side_slot_done(s))
+    cpu_relax();
+}
+
+void
+Simple_pager_component::
+side_slot_release(unsigned s)
+{
+  assert(_side[s].gwid == 0);
+  if(_side[s].state != SIDE_FREE)
+    _side_map.erase(_side[s].vaddr);
+  _side[s] = {SIDE_FREE, 0, 0, nullptr};
+}
+
+/** 
+ * Allocate a side slot: free or completed slots are recycled in
+ * round-robin order (oldest first). If wait is set and every slot
+ * has IO in flight, wait for the oldest.
+ * 
+ * @return Slot index or -1
+ */
+int
+Simple_pager_component::
+alloc_side_slot(bool wait)
+{
+  for(unsigned i=0;i<NUM_SIDE_SLOTS;i++) {
+    unsigned s = (_side_hand + i) % NUM_SIDE_SLOTS;
+    if(_side[s].state == SIDE_FREE || side_slot_done(s)) {
+      side_slot_release(s);
+      _side_hand = (s + 1) % NUM_SIDE_SLOTS;
+      return s;
+    }
+  }
+
+  if(!wait)
+    return -1;
+
+  unsigned s = _side_hand;
+  side_slot_wait(s);
+  side_slot_release(s);
+  _side_hand = (s + 1) % NUM_SIDE_SLOTS;
+  return s;
+}
+
+void
+Simple_pager_component::
+stage_writeback(addr_t vaddr, const void * frame)
+{
+  int s;
+  auto existing = _side_map.find(vaddr);
+  if(existing != _side_map.end()) {
+    /* never have two writes to the same block in flight */
+    s = existing->second;
+    side_slot_wait(s);
+    side_slot_release(s);
+  }
+  else {
+    s = alloc_side_slot(true);
+  }
+  assert(s >= 0);
+
+  memcpy(side_ptr(s), frame, PAGE_SIZE);
+
+  addr_t lba;
+  IBlock_device * bd = _tracker->lookup(vaddr, lba);
+  _side[s].state = SIDE_WRITEBACK;
+  _side[s].vaddr = vaddr;
+  _side[s].bd = bd;
+#ifndef DISABLE_IO
+  _side[s].gwid = bd->async_write(_side_iob, PAGE_SIZE * s, lba, 1);
+#else
+  _side[s].gwid = 0;
+#endif
+  _side_map[vaddr] = s;
+}
+
+void
+Simple_pager_component::
+prefetch(addr_t vaddr)
+{
+  for(unsigned i=1;i<=PREFETCH_DEPTH;i++) {
+    addr_t next = vaddr + (PAGE_SIZE * i);
+    if(!_tracker->contains(next))
+      break;
+
+    if(_resident.count(next) || _side_map.count(next))
+      continue;
+
+    int s = alloc_side_slot(false);
+    if(s < 0)
+      break; /* side buffer busy; don't stall the fault */
+
+    addr_t lba;
+    IBlock_device * bd = _tracker->lookup(next, lba);
+    _side[s].state = SIDE_READAHEAD;
+    _side[s].vaddr = next;
+    _side[s].bd = bd;
+#ifndef DISABLE_IO
+    _side[s].gwid = bd->async_read(_side_iob, PAGE_SIZE * s, lba, 1);
+#else
+    _side[s].gwid = 0;
+#endif
+    _side_map[next] = s;
+  }
+}
+
+
+void
+Simple_pager_component::
+clear_mappings(addr_t vaddr, size_t size)
+{
+  std::lock_guard<std::mutex> g(_lock);
+  addr_t vaddr_end = vaddr + size;
+
+  for(unsigned i=0;i<_nr_pages;i++) {
+    if(_pages[i].vaddr >= vaddr && _pages[i].vaddr < vaddr_end) {
+      _resident.erase(_pages[i].vaddr);
+      if(_pages[i].hot) _nr_hot--;
       _pages[i].vaddr  = 0;
+      _pages[i].hot    = false;
+    }
+  }
+
+  for(unsigned s=0;s<NUM_SIDE_SLOTS;s++) {
+    if(_side[s].state != SIDE_FREE &&
+       _side[s].vaddr >= vaddr && _side[s].vaddr < vaddr_end) {
+      side_slot_wait(s);
+      side_slot_release(s);
     }
   }
 }
@@ -320,18 +536,26 @@ flush(addr_t vaddr, size_t size)
 {
   assert(vaddr);
   assert(size);
+
+  std::lock_guard<std::mutex> g(_lock);
+  addr_t first = round_down(vaddr, PAGE_SIZE);
+  addr_t last = round_up(vaddr + size, PAGE_SIZE);
   
-  for(unsigned slot=0;slot<_nr_pages;slot++) {
-    if(_pages[slot].vaddr &&
-       (vaddr >= _pages[slot].vaddr) &&
-       (vaddr < (_pages[slot].vaddr + PAGE_SIZE)))
-    {
-      uint64_t buffer_offset = PAGE_SIZE * slot;
-      addr_t lba;
-      IBlock_device * bd = _tracker->lookup(_pages[slot].vaddr, lba);
-      assert(bd);
-      bd->write(_iob, buffer_offset, lba, 1);
-    }
+  for(addr_t page = first; page < last; page += PAGE_SIZE) {
+    auto r = _resident.find(page);
+    if(r == _resident.end())
+      continue;
+
+    /* an older staged write of this page must land first */
+    auto side = _side_map.find(page);
+    if(side != _side_map.end())
+      side_slot_wait(side->second);
+
+    unsigned slot = r->second;
+    addr_t lba;
+    IBlock_device * bd = _tracker->lookup(page, lba);
+    assert(bd);
+    bd->write(_iob, PAGE_SIZE * slot, lba, 1);
   }    
 }
 
@@ -22,7 +22,11 @@
 #ifndef __SIMPLE_PAGER_H__
 #define __SIMPLE_PAGER_H__
 
+#include <deque>
 #include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <common/logging.h>
 #include <common/utils.h>
@@ -34,11 +38,22 @@ using namespace Component;
 
 class Range_tracker;
 
+/** 
+ * Simple pager with CLOCK-Pro style replacement.  Frames are hot or
+ * cold; pages enter cold unless they re-fault while still in the
+ * non-resident (ghost) history, so one-off scans only displace cold
+ * frames.  Victims are copied into a side buffer and written back
+ * asynchronously, so a fault costs one read.  The side buffer also
+ * serves as a victim cache and holds sequential read-ahead.
+ */
 class Simple_pager_component : public Component::IPager
 {
 
 private:
   static constexpr bool option_DEBUG = false;
+  static constexpr unsigned NUM_SIDE_SLOTS = 64;  /*< write-back/read-ahead pages */
+  static constexpr unsigned PREFETCH_DEPTH = 8;   /*< pages read ahead on sequential faults */
+  static constexpr unsigned SEQ_THRESHOLD  = 2;   /*< consecutive faults before read-ahead */
 
 public:
 
@@ -143,12 +158,41 @@ public:
 
 private:
   void init_memory(size_t nr_pages);
+
+  /* replacement */
+  unsigned select_victim();
+  bool ghost_test_and_remove(addr_t vaddr);
+  void ghost_insert(addr_t vaddr);
+
+  /* side buffer (write-back staging, victim cache, read-ahead) */
+  int  alloc_side_slot(bool wait);
+  bool side_slot_done(unsigned s);
+  void side_slot_wait(unsigned s);
+  void side_slot_release(unsigned s);
+  void stage_writeback(addr_t vaddr, const void * frame);
+  void prefetch(addr_t vaddr);
+
+  inline byte * frame_ptr(unsigned slot) const { return _frames_vaddr + (PAGE_SIZE * slot); }
+  inline byte * side_ptr(unsigned s) const { return _side_vaddr + (PAGE_SIZE * s); }
   
 private:
   struct page_descriptor {
-    uint64_t gwid;
     addr_t vaddr;
     addr_t paddr;
+    bool   hot;
+  };
+
+  enum {
+    SIDE_FREE      = 0,
+    SIDE_WRITEBACK = 1, /*< evicted page; clean copy once write completes */
+    SIDE_READAHEAD = 2,
+  };
+
+  struct side_slot {
+    int             state;
+    addr_t          vaddr;
+    uint64_t        gwid;
+    IBlock_device * bd;
   };
 
   IBlock_device *        _block_dev;
@@ -161,6 +205,24 @@ private:
   Component::io_buffer_t _iob;
   std::string            _heap_set_id;
   addr_t                 _phys_base;
+  byte *                 _frames_vaddr = nullptr;
+
+  std::mutex                           _lock;
+  std::unordered_map<addr_t, unsigned> _resident;    /*< vaddr -> frame */
+  unsigned                             _hand = 0;    /*< clock hand */
+  size_t                               _nr_hot = 0;
+  size_t                               _max_hot = 0;
+  std::unordered_set<addr_t>           _ghost;       /*< non-resident history */
+  std::deque<addr_t>                   _ghost_fifo;
+
+  Component::io_buffer_t               _side_iob;
+  byte *                               _side_vaddr = nullptr;
+  struct side_slot                     _side[NUM_SIDE_SLOTS];
+  unsigned                             _side_hand = 0;
+  std::unordered_map<addr_t, unsigned> _side_map;    /*< vaddr -> side slot */
+
+  addr_t                               _last_fault = 0;
+  unsigned                             _seq_run = 0;
 
 };
 
@@ -24,7 +24,9 @@
 /*
  * The schema for the JSON "dax_map" parameter, in Draft 7 form as
  * described at https://json-schema.org. The addr is a string
- * convertable to a number by std::stoull(addr,0,0).
+ * convertable to a number by std::stoull(addr,0,0). A path which is not a
+ * devdax device is mapped as a file (e.g. on hugetlbfs or fsdax); size,
+ * also a number or such a string, sizes a new file.
  *
  * {
  *   "type": "array",
@@ -34,6 +36,7 @@
  *       "region_id": { "type": "integer", "minimum": 0 },
  *       "path": { "type": "string" },
  *       "addr": { "type": "string" },
+ *       "size": { "type": [ "integer", "string" ] },
  *     },
  *     "required" : [ "region_id", "path", "addr" ]
  *   }
@@ -57,7 +60,8 @@ namespace
 					"\"properties\": {\n"
 						"\"region_id\": { \"type\": \"integer\", \"minimum\": 0 },\n"
 						"\"path\": { \"type\": \"string\" },\n"
-						"\"addr\": { \"type\": \"string\" }\n"
+						"\"addr\": { \"type\": \"string\" },\n"
+						"\"size\": { \"type\": [ \"integer\", \"string\" ] }\n"
 					"},\n"
 					"\"required\" : [ \"region_id\", \"path\", \"addr\" ]\n"
 				"}\n"
@@ -143,6 +147,7 @@ namespace
 		{ "region_id", SET_SCALAR(nupm::Devdax_manager::config_t, region_id) },
 		{ "path", SET_SCALAR(nupm::Devdax_manager::config_t, path) },
 		{ "addr", SET_SCALAR(nupm::Devdax_manager::config_t, addr) },
+		{ "size", SET_SCALAR(nupm::Devdax_manager::config_t, size) },
 	};
 
 	std::vector<nupm::Devdax_manager::config_t> parse_devdax_string(const std::string &dax_map_)
@@ -614,6 +614,24 @@ auto hstore::map_keys(
     ;
 }
 
+auto hstore::map_keys_slice(
+                 pool_t pool,
+                 std::uint64_t &cursor,
+                 std::size_t max_keys,
+                 std::function
+                 <
+                   int(const std::string &key)
+                 > f_
+                 ) -> status_t
+{
+  const auto session = static_cast<session_t *>(locate_session(pool));
+
+  return session
+    ? session->map_keys_slice(cursor, max_keys, f_)
+    : int(Component::IKVStore::E_POOL_NOT_FOUND)
+    ;
+}
+
 auto hstore::free_memory(void * p) -> status_t
 {
   scalable_free(p);
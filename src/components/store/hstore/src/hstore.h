@@ -247,6 +247,11 @@ public:
   status_t map_keys(pool_t pool,
                std::function<int(const std::string& key)> function) override;
 
+  status_t map_keys_slice(pool_t pool,
+               std::uint64_t& cursor,
+               std::size_t max_keys,
+               std::function<int(const std::string& key)> function) override;
+
   status_t free_memory(void * p) override;
 
   void debug(pool_t pool, unsigned cmd, uint64_t arg) override;
@@ -406,6 +406,43 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 
 		}
 
+		/* cursor holds the bucket count (high 32 bits) and the next bucket */
+		auto map_keys_slice(
+			std::uint64_t &cursor
+			, std::size_t max_keys
+			, std::function<int(const std::string &key)> function
+		) -> status_t
+		{
+			const std::uint64_t buckets = this->map().bucket_count();
+			const std::uint64_t shape = (buckets & 0xffffffffULL) << 32;
+			if ( cursor == 0 )
+			{
+				cursor = shape;
+			}
+			else if ( (cursor & ~0xffffffffULL) != shape )
+			{
+				/* resized: keys moved between buckets */
+				cursor = 0;
+				return E_BAD_OFFSET;
+			}
+
+			auto next = cursor & 0xffffffffULL;
+			std::size_t visited = 0;
+			for ( ; next < buckets && visited < max_keys; ++next )
+			{
+				auto last = this->map().end(next);
+				for ( auto first = this->map().begin(next); first != last; ++first )
+				{
+					const auto &pstring = first->first;
+					std::string s(static_cast<const char *>(pstring.data()), pstring.size());
+					function(s);
+					++visited;
+				}
+			}
+			cursor = shape | next;
+			return next < buckets ? int(Component::IKVStore::S_MORE) : S_OK;
+		}
+
 		void atomic_update_inner(
 			key_t &key
 			, const std::vector<Component::IKVStore::Operation *> &op_vector
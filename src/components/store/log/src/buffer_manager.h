@@ -14,26 +14,63 @@
 #define __BUFFER_MANAGER_H__
 
 //#define DISABLE_IO
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <common/utils.h>
 #include <api/memory_itf.h>
 #include <api/block_itf.h>
 
+/**
+ * Buffer manager for the log tail.  The log is a sequence of
+ * IO_BUFFER_SIZE buffers; buffer 'seq' covers log bytes
+ * [seq*IO_BUFFER_SIZE, (seq+1)*IO_BUFFER_SIZE) and lives in IO slot
+ * (seq % NUM_IO_BUFFERS).
+ *
+ * Writers reserve log space with a compare-and-swap on the tail and
+ * copy into the slots without holding a lock. The writer whose copy
+ * completes a buffer submits it asynchronously on its own queue, so
+ * writers on different queues spread the IO across them. A slot
+ * becomes available to the next buffer that maps onto it when the
+ * write completes.
+ *
+ * Devices that only retire a request when its completion is checked
+ * (e.g., block-posix AIO descriptors) have each slot's last request
+ * checked before the slot is posted again and on flush.
+ */
 class Buffer_manager
 {
+  static constexpr bool option_DEBUG = false;
+
 public:
   static constexpr size_t IO_BUFFER_SIZE        = KB(4);
 private:
   static constexpr size_t IO_BUFFER_ALIGNMENT   = KB(4);
   static constexpr size_t NUM_IO_BUFFERS        = 256;
-  
+
+  struct Slot
+  {
+    std::atomic<uint64_t> seq;     /*< buffer sequence that currently owns the slot */
+    std::atomic<size_t>   filled;  /*< bytes copied into the slot */
+    std::mutex            io_lock; /*< orders partial (flush) and full write-outs */
+    Component::workid_t   gwid = 0; /*< last async write not yet checked (under io_lock) */
+    unsigned              queue_id = 0;
+  };
+
 public:
-  Buffer_manager(Component::IBlock_device * block, unsigned queue_id, Header& hdr)
+  Buffer_manager(Component::IBlock_device * block, Header& hdr)
     : _block(block),
       _hdr(hdr),
-      _queue_id(queue_id),
-      _index_ring(NUM_IO_BUFFERS),
-      _shadow_tail(hdr.get_tail())
+      _slots(new Slot[NUM_IO_BUFFERS])
   {
     assert(block);
+
+    Component::VOLUME_INFO vi;
+    _block->get_volume_info(vi);
+    _block_size = vi.block_size;
+    _capacity = hdr.capacity();
+    assert(IO_BUFFER_SIZE % _block_size == 0);
+
     /* create IO buffers */
     _iob_buffer = _block->allocate_io_buffer(IO_BUFFER_SIZE *  NUM_IO_BUFFERS,
                                              IO_BUFFER_ALIGNMENT,
@@ -42,161 +79,263 @@ public:
 
     _iob_vaddr = static_cast<byte*>(_block->virt_addr(_iob_buffer));
     assert(_iob_vaddr);
-  
-    for(uint64_t i=1;i<=NUM_IO_BUFFERS;i++)
-      _index_ring.sp_enqueue(i);
 
-    ready_buffer();
+    /* continue from the durable tail */
+    const index_t tail = hdr.get_tail();
+    const uint64_t base_seq = tail / IO_BUFFER_SIZE;
+    _tail = tail;
+    _durable = tail;
+
+    for(uint64_t i=0;i<NUM_IO_BUFFERS;i++) {
+      uint64_t seq = base_seq + ((i + NUM_IO_BUFFERS - (base_seq % NUM_IO_BUFFERS)) % NUM_IO_BUFFERS);
+      _slots[i].seq.store(seq);
+      _slots[i].filled.store(0);
+    }
+
+    /* reload partially written tail buffer so that appends continue in place */
+    if(tail % IO_BUFFER_SIZE) {
+#ifndef DISABLE_IO
+      _block->read(_iob_buffer,
+                   slot_offset(base_seq),
+                   lba(base_seq),
+                   IO_BUFFER_SIZE / _block_size,
+                   0);
+#endif
+      slot(base_seq).filled.store(tail % IO_BUFFER_SIZE);
+    }
   }
 
   ~Buffer_manager() {
-    flush_buffer();
-    _block->check_completion(0);
+    flush_buffer(0);
+    _block->free_io_buffer(_iob_buffer);
   }
 
   static void release_buffer(uint64_t guid, void * arg0, void* arg1)
   {
     assert(arg0);
     Buffer_manager * pThis = reinterpret_cast<Buffer_manager*>(arg0);
-    uint64_t buffer_index = reinterpret_cast<uint64_t>(arg1);
-    pThis->free_index(buffer_index);
+    uint64_t seq = reinterpret_cast<uint64_t>(arg1);
+    pThis->free_slot(seq);
   }
 
-  void ready_buffer()
+  void dump_info()
   {
-    _index_ring.mc_dequeue(_current_buffer_index);
-    _current_buffer_ptr = static_cast<byte*>(_iob_vaddr +
-                                             ((_current_buffer_index-1) * IO_BUFFER_SIZE));
-    _current_buffer_remaining = IO_BUFFER_SIZE;
+    _hdr.dump_info();
+    PINF("      : reserved tail=%lu durable tail=%lu",
+         _tail.load(), _durable);
   }
 
-  inline void free_index(uint64_t index) {
-    assert(index <= NUM_IO_BUFFERS);
-    _index_ring.mp_enqueue(index);
+  /**
+   * Get the reserved (not necessarily durable) tail
+   *
+   */
+  index_t get_tail() const { return _tail.load(); }
+
+  /**
+   * Append a record made up of an optional prefix (e.g., len/crc
+   * header) and a payload. Safe to call from many threads; space is
+   * reserved atomically so the record is contiguous in the log.
+   *
+   * @param prefix Prefix data (may be nullptr)
+   * @param prefix_len Length of prefix in bytes
+   * @param data Payload
+   * @param data_len Length of payload in bytes
+   * @param queue_id Queue used for buffers this record completes
+   *
+   * @return Byte offset of the start of the record
+   */
+  index_t write_out(const void * prefix, const size_t prefix_len,
+                    const void * data, const size_t data_len,
+                    unsigned queue_id)
+  {
+    const index_t record_len = static_cast<index_t>(prefix_len + data_len);
+
+    /* never reserve past capacity; flush waits on every reserved byte */
+    index_t offset = _tail.load();
+    do {
+      if(offset + record_len > _capacity)
+        throw API_exception("Log-store: no more blocks");
+    } while(!_tail.compare_exchange_weak(offset, offset + record_len));
+
+    if(prefix_len > 0)
+      copy_in(offset, prefix, prefix_len, queue_id);
+    copy_in(offset + prefix_len, data, data_len, queue_id);
+
+    return offset;
   }
 
-  void dump_info()
+  /**
+   * Group-commit barrier. Makes everything reserved before the call
+   * durable, including the partially filled tail buffer, and records
+   * the new tail in the header. Concurrent callers whose writes are
+   * already covered by a preceding barrier return without doing IO.
+   *
+   * @param queue_id Queue used for the tail buffer write
+   *
+   * @return Durable tail
+   */
+  index_t flush_buffer(unsigned queue_id)
   {
-    _hdr.dump_info();
+    const index_t target = _tail.load();
+
+    std::lock_guard<std::mutex> g(_flush_lock);
+    if(target <= _durable)
+      return _durable;
+
+    const uint64_t last_seq = target / IO_BUFFER_SIZE;
+
+    /* full buffers are submitted by the writers; wait for them to land */
+    const uint64_t first_seq = _durable / IO_BUFFER_SIZE;
+    for(uint64_t seq = first_seq; seq < last_seq; seq++)
+      wait_written(seq);
+
+    /* the newest write retires the older ones on in-order devices */
+    if(last_seq > first_seq) {
+      Slot& s = slot(last_seq - 1);
+      std::lock_guard<std::mutex> g(s.io_lock);
+      retire(s);
+    }
+
+    if(target % IO_BUFFER_SIZE)
+      write_partial(last_seq, target, queue_id);
+
+    _hdr.commit(target);
+    _hdr.flush();
+    _durable = target;
+    return target;
   }
 
 private:
-  void post_buffer(unsigned queue_id)
+
+  inline Slot& slot(uint64_t seq) { return _slots[seq % NUM_IO_BUFFERS]; }
+
+  inline size_t slot_offset(uint64_t seq) const {
+    return (seq % NUM_IO_BUFFERS) * IO_BUFFER_SIZE;
+  }
+
+  inline lba_t lba(uint64_t seq) const {
+    return 1 + ((seq * IO_BUFFER_SIZE) / _block_size); /* block 0 is the header */
+  }
+
+  void free_slot(uint64_t seq)
   {
-    size_t n_blocks = 0;
-    index_t index;
-    lba_t lba = _hdr.allocate(IO_BUFFER_SIZE, n_blocks);
-    assert(_current_buffer_index <= NUM_IO_BUFFERS);
-    assert(_current_buffer_index > 0);
-    //PLOG("$$>(%s) @ %ld", (char*)_block->virt_addr(_iob_buffer), lba);
+    Slot& s = slot(seq);
+    assert(s.seq.load() == seq);
+    s.filled.store(0, std::memory_order_relaxed);
+    s.seq.store(seq + NUM_IO_BUFFERS, std::memory_order_release);
+  }
 
-#ifndef DISABLE_IO
-    auto wid = _block->async_write(_iob_buffer,
-                        (_current_buffer_index-1) * IO_BUFFER_SIZE, /* buffer offset */
-                        lba,
-                        n_blocks,
-                        queue_id, /* queue id */
-                        release_buffer,
-                        (void*) this,
-                        (void*) _current_buffer_index);
-    
-    _block->check_completion(wid); /* gratuitous completion - will this impact performance? */
-#else
-    free_index(_current_buffer_index);
-#endif
+  void wait_slot(uint64_t seq)
+  {
+    Slot& s = slot(seq);
+    while(s.seq.load(std::memory_order_acquire) != seq)
+      cpu_relax(); /* previous occupant still in flight */
+  }
 
-    ready_buffer();
+  void wait_written(uint64_t seq)
+  {
+    Slot& s = slot(seq);
+    while(s.seq.load(std::memory_order_acquire) <= seq)
+      cpu_relax();
   }
 
-public:
-  void flush_buffer()
+  void copy_in(index_t offset, const void * src, size_t len, unsigned queue_id)
   {
-    size_t n_blocks = 0;
-    lba_t lba = _hdr.allocate(IO_BUFFER_SIZE, n_blocks);
-    assert(_current_buffer_index <= NUM_IO_BUFFERS);
+    const byte * ptr = static_cast<const byte*>(src);
+    while(len > 0) {
+      const uint64_t seq = offset / IO_BUFFER_SIZE;
+      const size_t pos = offset % IO_BUFFER_SIZE;
+      const size_t chunk = std::min(len, IO_BUFFER_SIZE - pos);
+
+      wait_slot(seq);
+      memcpy(_iob_vaddr + slot_offset(seq) + pos, ptr, chunk);
 
-    /* write zeros to excess tail */
-    memset(_current_buffer_ptr, 0,_current_buffer_remaining);
-    
-    //PLOG("$$>(%s) @ %ld", (char*)_block->virt_addr(_iob_buffer), lba);
+      /* last copier into a buffer posts it */
+      if(slot(seq).filled.fetch_add(chunk, std::memory_order_acq_rel) + chunk == IO_BUFFER_SIZE)
+        post_buffer(seq, queue_id);
 
+      ptr += chunk;
+      offset += chunk;
+      len -= chunk;
+    }
+  }
+
+  void post_buffer(uint64_t seq, unsigned queue_id)
+  {
+    if(option_DEBUG)
+      PLOG("Log-store: posting buffer %lu @ lba %lu", seq, lba(seq));
+
+    Slot& s = slot(seq);
+    std::lock_guard<std::mutex> g(s.io_lock);
 #ifndef DISABLE_IO
-    _block->write(_iob_buffer,
-                  (_current_buffer_index-1) * IO_BUFFER_SIZE, /* buffer offset */
-                  lba,
-                  n_blocks,
-                  0);
+    retire(s); /* previous occupant has completed (wait_slot) */
+    s.gwid = _block->async_write(_iob_buffer,
+                                 slot_offset(seq), /* buffer offset */
+                                 lba(seq),
+                                 IO_BUFFER_SIZE / _block_size,
+                                 queue_id,
+                                 release_buffer,
+                                 (void*) this,
+                                 (void*) seq);
+    s.queue_id = queue_id;
 #else
-    free_index(_current_buffer_index);
+    free_slot(seq);
 #endif
   }
 
-
-  index_t write_out(uint32_t value, unsigned queue_id)
+  /* caller holds s.io_lock; does not wait */
+  void retire(Slot& s)
   {
-    auto ds = sizeof(uint32_t);
-    if(_current_buffer_remaining == ds) {
-      memcpy(_current_buffer_ptr, &value, ds);
-      post_buffer(queue_id);
-    }
-    else if(_current_buffer_remaining > ds) {
-      memcpy(_current_buffer_ptr, &value, ds);
-      _current_buffer_ptr += ds;
-      _current_buffer_remaining -= ds;
-    }
-    else { /* tail-split */
-      unsigned next_seg_len = ds - _current_buffer_remaining;
-      byte * ptr = (byte*) &value;
-      memcpy(_current_buffer_ptr, ptr, _current_buffer_remaining);
-      ptr += _current_buffer_remaining;
-      post_buffer(queue_id);
-      memcpy(_current_buffer_ptr, ptr, next_seg_len);
-      _current_buffer_ptr += next_seg_len;
-      assert(next_seg_len > _current_buffer_remaining);
-      _current_buffer_remaining -= next_seg_len;
-    }
-    _shadow_tail += 4;
-    return _shadow_tail;
+    if(s.gwid && _block->check_completion(s.gwid, s.queue_id))
+      s.gwid = 0;
   }
-  
-  index_t write_out(const void * data, const size_t data_len, unsigned queue_id)
-  {    
-    if(_current_buffer_remaining == data_len) {
-      memcpy(_current_buffer_ptr, data, data_len);
-      post_buffer(queue_id);
-    }
-    else if(_current_buffer_remaining > data_len) {
-      memcpy(_current_buffer_ptr, data, data_len);
-      _current_buffer_ptr += data_len;
-      _current_buffer_remaining -= data_len;
-    }
-    else { /* tail-split */
-      unsigned next_seg_len = data_len - _current_buffer_remaining;
-      byte * ptr = (byte*) data;
-      memcpy(_current_buffer_ptr, ptr, _current_buffer_remaining);
-      ptr += _current_buffer_remaining;
-      post_buffer(queue_id);
-      memcpy(_current_buffer_ptr, ptr, next_seg_len);
-      _current_buffer_ptr += next_seg_len;
-      _current_buffer_remaining -= next_seg_len;
+
+  void write_partial(uint64_t seq, index_t target, unsigned queue_id)
+  {
+    Slot& s = slot(seq);
+    const index_t start = seq * IO_BUFFER_SIZE;
+    const index_t end = start + IO_BUFFER_SIZE;
+
+    /* wait for in-flight copies below the target to finish; the tail
+       is monotonic and 'filled' never runs ahead of it, so equality
+       between two identical tail reads means the buffer is quiescent */
+    for(;;) {
+      if(s.seq.load(std::memory_order_acquire) != seq) return; /* written in full */
+      index_t r1 = _tail.load();
+      size_t f = s.filled.load(std::memory_order_acquire);
+      if(f == IO_BUFFER_SIZE) { wait_written(seq); return; }
+      index_t r2 = _tail.load();
+      if(r1 == r2 && static_cast<index_t>(f) == (std::min(r1, end) - start)) break;
+      cpu_relax();
     }
-    _shadow_tail += data_len;
-    return _shadow_tail;
-  }
 
+    std::lock_guard<std::mutex> g(s.io_lock);
+    if(s.filled.load() == IO_BUFFER_SIZE) /* completed while we waited for the lock */
+      return;
+
+    size_t n_blocks = round_up(target - start, _block_size) / _block_size;
+#ifndef DISABLE_IO
+    _block->write(_iob_buffer,
+                  slot_offset(seq), /* buffer offset */
+                  lba(seq),
+                  n_blocks,
+                  queue_id);
+#endif
+  }
 
 private:
   Component::IBlock_device *  _block;
-  unsigned                    _queue_id;
   Header&                     _hdr;
-  index_t                     _shadow_tail;
-  
-  Core::Ring_buffer<uint64_t> _index_ring;
+  std::unique_ptr<Slot[]>     _slots;
+  unsigned                    _block_size = 0;
+  index_t                     _capacity = 0;
+
   Component::io_buffer_t      _iob_buffer = 0;
   byte *                      _iob_vaddr = 0;
-  uint64_t                    _current_buffer_index = 0;
-  byte *                      _current_buffer_ptr = nullptr;
-  size_t                      _current_buffer_remaining = 0;
+
+  std::atomic<index_t>        _tail;     /*< reserved tail */
+  std::mutex                  _flush_lock;
+  index_t                     _durable;  /*< tail recorded in header (under _flush_lock) */
 };
 
 #endif
@@ -16,6 +16,7 @@
 #define __STORE_HEADER_H__
 
 #include <mutex>
+#include <common/utils.h>
 #include <common/cycles.h>
 #include <api/block_itf.h>
 
@@ -125,25 +126,29 @@ public:
   
   size_t block_size() const { return _vi.block_size; }
   
-  lba_t allocate(size_t n_bytes, size_t& n_blocks) {
-
-    if(unlikely(n_bytes % _vi.block_size))
-      throw API_exception("allocate must round to block size");
-
-    n_blocks = n_bytes / _vi.block_size;   
+  /** 
+   * Capacity of the log in bytes (excluding header block)
+   * 
+   */
+  index_t capacity() const { return (_mb->max_lba - 1) * _vi.block_size; }
+
+  /** 
+   * Record a new durable tail; written out on the next flush
+   * 
+   * @param tail Byte offset of durable tail
+   */
+  void commit(index_t tail) {
+    std::lock_guard<std::mutex> g(_lock);
 
-    lba_t result;
+    if(tail < _mb->tail)
+      throw API_exception("Log-store: tail cannot move backwards");
 
-    if((_mb->max_lba - _mb->next_free_lba) < n_blocks)
-      throw API_exception("Log-store: no more blocks");
-    
-    result = _mb->next_free_lba;
-    _mb->next_free_lba += n_blocks;
-    _mb->tail += n_bytes; /* increment tail by number of written bytes */
+    _mb->tail = tail;
+    _mb->next_free_lba = 1 + (round_up(tail, _vi.block_size) / _vi.block_size);
+    assert(_mb->next_free_lba <= _mb->max_lba);
 
     if(option_DEBUG)
-      PLOG("header: allocating %lu", result);
-    return result;
+      PLOG("header: commit tail=%lu next_free_lba=%lu", tail, _mb->next_free_lba);
   }
 
 private:
@@ -31,7 +31,7 @@ Log_store::Log_store(std::string owner,
                      bool use_crc)
   : _hdr(owner, name, block, fixed_size, flags & FLAGS_FORMAT),
     _use_crc(use_crc),
-    _bm(block, 0, _hdr),
+    _bm(block, _hdr),
     _fixed_size(fixed_size)
 {
   int rc;
@@ -52,6 +52,7 @@ Log_store::Log_store(std::string owner,
 
   _max_io_blocks = _vi.max_dma_len / _vi.block_size;
   _max_io_bytes  = _vi.max_dma_len;
+  _num_io_queues = _vi.sw_queue_count + 1;
   assert(_vi.max_dma_len % _vi.block_size == 0);
 
   assert(_vi.max_dma_len == 0 || Buffer_manager::IO_BUFFER_SIZE <= _vi.max_dma_len);
@@ -87,43 +88,22 @@ index_t Log_store::write(const void * data,
   if(option_DEBUG)
     PLOG("Log_store: write %s", (char*)data);
 
-  uint32_t crc;
+  uint32_t prefix[2];
+  size_t prefix_len = 0;
+
+  if(_fixed_size == 0)
+    prefix[prefix_len++] = static_cast<uint32_t>(data_len);
 
   if(_use_crc)
-    crc = crc32(0UL, (const Bytef*) data, data_len); /* don't hold lock doing this */
-
-  {
-    std::lock_guard<std::mutex> g(_lock);
-
-    if(_use_crc) {
-      if(_fixed_size > 0) {
-        /* write crc and data */
-        index = _bm.write_out(crc, queue_id);
-        _bm.write_out(data, data_len, queue_id);
-        return index / _fixed_size; /*< return record index */
-      }
-      else {
-        /* write len, crc, data */
-        index = _bm.write_out(data_len, queue_id);
-        _bm.write_out(crc, queue_id);
-        _bm.write_out(data, data_len, queue_id);
-        return index;
-      }
-    }
-    else { /* no CRC */
-      if(_fixed_size > 0) {
-        /* write data only */
-        index = _bm.write_out(data, data_len, queue_id);
-        return index / _fixed_size; /*< return record index */
-      }
-      else {
-        /* len + data */
-        index = _bm.write_out(data_len, queue_id);
-        _bm.write_out(data, data_len, queue_id);
-        return index;
-      }
-    }    
-  }  
+    prefix[prefix_len++] = crc32(0UL, (const Bytef*) data, data_len);
+
+  /* space is reserved atomically; no lock is held during the copy */
+  index = _bm.write_out(prefix, prefix_len * sizeof(uint32_t), data, data_len, queue_id);
+
+  if(_fixed_size > 0)
+    return index / _fixed_size; /*< return record index */
+
+  return index;
 }
 
 
@@ -191,9 +171,7 @@ std::string Log_store::read(const index_t index)
 
 status_t Log_store::flush(unsigned queue_id)
 {
-  _bm.flush_buffer();
-  _hdr.flush(); /* flush metadata */
-  _lower_layer->check_completion(0, queue_id); /* wait for all pending */
+  _bm.flush_buffer(queue_id); /* waits for pending buffers and flushes metadata */
   return S_OK;
 }
 
@@ -22,8 +22,10 @@
 #include "buffer_manager.h"
 
 /** 
- * Log store is single threaded so that ordering can be maintained.  Currently, it is memcpy
- * based, but this could be improved to use zero-copy IO buffers.
+ * Log store is multi-writer: each record reserves contiguous log space
+ * atomically and is copied in outside of any lock; flush is a
+ * group-commit barrier.  Currently, it is memcpy based, but this could
+ * be improved to use zero-copy IO buffers.
  * 
  */
 class Log_store : public Core::Zerocopy_passthrough_impl<Component::ILog>
@@ -109,7 +111,8 @@ public:
   virtual std::string read(const index_t index) override;
   
   /** 
-   * Flush queued IO and wait for completion
+   * Flush queued IO and wait for completion (group commit of all
+   * records written before the call)
    * 
    * 
    * @return S_OK on success
@@ -123,9 +126,8 @@ public:
    * @return Index (byte offset)
    */
   virtual index_t get_tail() override {
-    std::lock_guard<std::mutex> g(_lock);
-    if(_fixed_size) return ((_hdr.get_tail()) / _fixed_size);
-    return (_hdr.get_tail());
+    if(_fixed_size) return (_bm.get_tail() / _fixed_size);
+    return _bm.get_tail();
   }
 
   /** 
@@ -160,7 +162,6 @@ private:
   bool                   _use_crc;
   Header                 _hdr;
   Component::io_buffer_t _iob;
-  std::mutex             _lock;
   Component::VOLUME_INFO _vi;
   Buffer_manager         _bm;
 };
@@ -15,6 +15,9 @@
 #include <string>
 #include <list>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
 #include <omp.h>
 #include <chrono>
 #include <common/cycles.h>
@@ -144,7 +147,6 @@ TEST_F(Log_store_test, Instantiate)
   fact->release_ref();
 }
 
-#if 0
 TEST_F(Log_store_test, CreateEntries)
 {
   void* p = malloc(RECORD_LEN);
@@ -154,18 +156,18 @@ TEST_F(Log_store_test, CreateEntries)
   auto started = std::chrono::high_resolution_clock::now();
 
   index_t idx;
-  index_t last_index = _log->get_tail() - RECORD_LEN;
+  index_t last_index = _log->get_tail() - 1; /* write returns record index */
   PLOG("last index: %lu", last_index);
 
   unsigned long items = 0;
-  for(unsigned i=0;i<GB(1)/len;i++) {
+  for(unsigned i=0;i<MB(64)/len;i++) {
     //    _log->write(p, len, (omp_get_thread_num() % 2)+12);
     sprintf((char*)p,"Hello-%u",i);
     idx = _log->write(p, len); //, IO_QUEUE_CORE_BASE);//(i % 2) + 12);
 
-    if(idx != (last_index + RECORD_LEN))
+    if(idx != (last_index + 1))
       throw General_exception("CreateEntries test failed; bad index (%ld expect %ld)",
-                              idx, last_index+RECORD_LEN);
+                              idx, last_index + 1);
     last_index = idx;
     items++;
   }
@@ -177,7 +179,6 @@ TEST_F(Log_store_test, CreateEntries)
   _log->flush();
   free(p);
 }
-#endif
 
 TEST_F(Log_store_test, ReadEntries)
 {
@@ -224,6 +225,72 @@ TEST_F(Log_store_test, ReleaseBlockDevice)
   _block->release_ref();
 }
 
+/* appends from several threads over block-posix, enough of them to
+   cycle its 2048 AIO descriptors a few times */
+TEST_F(Log_store_test, ConcurrentAppendPosix)
+{
+  const unsigned THREADS = 4;
+  const unsigned RECORDS_PER_THREAD = 64000; /* ~3000 4K log buffers */
+  const char * path = "./log-posix-test.dat";
+
+  unlink(path);
+  Component::IBase * comp = Component::load_component("libcomanche-blkposix.so",
+                                                      Component::block_posix_factory);
+  ASSERT_TRUE(comp);
+  IBlock_device_factory * bfact = (IBlock_device_factory *) comp->query_interface(IBlock_device_factory::iid());
+  std::string config_string = "{\"path\":\"";
+  config_string += path;
+  config_string += "\",\"size_in_blocks\":8192}";
+  IBlock_device * block = bfact->create(config_string);
+  ASSERT_TRUE(block);
+  bfact->release_ref();
+
+  comp = Component::load_component("libcomanche-storelog.so",
+                                   Component::store_log_factory);
+  ASSERT_TRUE(comp);
+  ILog_factory * lfact = (ILog_factory *) comp->query_interface(ILog_factory::iid());
+  ILog * log = lfact->create("owner", "posixlog", block, FLAGS_FORMAT, RECORD_LEN, false);
+  ASSERT_TRUE(log);
+  lfact->release_ref();
+
+  const index_t base = log->get_tail();
+  const size_t total = THREADS * RECORDS_PER_THREAD;
+  std::vector<index_t> indices(total);
+
+#pragma omp parallel for num_threads(THREADS)
+  for(unsigned t=0;t<THREADS;t++) {
+    char record[RECORD_LEN];
+    for(unsigned i=0;i<RECORDS_PER_THREAD;i++) {
+      memset(record, 0, RECORD_LEN);
+      snprintf(record, RECORD_LEN, "T%u-%u", t, i);
+      indices[t * RECORDS_PER_THREAD + i] = log->write(record, RECORD_LEN);
+    }
+  }
+  log->flush();
+  ASSERT_EQ(base + total, log->get_tail());
+
+  /* every record got its own slot, and the slots are contiguous */
+  std::vector<index_t> sorted(indices);
+  std::sort(sorted.begin(), sorted.end());
+  for(size_t i=0;i<total;i++)
+    ASSERT_EQ(base + i, sorted[i]);
+
+  /* each returned index holds the record that was written */
+  auto iob = log->allocate_io_buffer(KB(16), KB(4), NUMA_NODE_ANY);
+  char expect[RECORD_LEN];
+  for(unsigned t=0;t<THREADS;t++) {
+    for(unsigned i=0;i<RECORDS_PER_THREAD;i++) {
+      snprintf(expect, RECORD_LEN, "T%u-%u", t, i);
+      char * r = reinterpret_cast<char*>(log->read(indices[t * RECORDS_PER_THREAD + i], iob));
+      ASSERT_STREQ(expect, r);
+    }
+  }
+  log->free_io_buffer(iob);
+
+  log->release_ref();
+  block->release_ref();
+  unlink(path);
+}
 
 } // namespace
 
@@ -88,6 +88,10 @@ public:
                                  const size_t value_len)> function);
 
   status_t map_keys(std::function<int(const std::string& key)> function);
+
+  status_t map_keys_slice(uint64_t& cursor,
+                          size_t max_keys,
+                          std::function<int(const std::string& key)> function);
 };
 
 struct Pool_session
@@ -344,7 +348,10 @@ size_t Pool_handle::count() {
 status_t Pool_handle::map(std::function<int(const std::string& key,
                                             const void * value,
                                             const size_t value_len)> function)
-{  
+{
+#ifndef SINGLE_THREADED
+  RWLock_guard guard(map_lock);
+#endif
   for(auto& pair : _map) {
     auto val = pair.second;
     function(pair.first, val.ptr, val.length);
@@ -355,12 +362,43 @@ status_t Pool_handle::map(std::function<int(const std::string& key,
 
 status_t Pool_handle::map_keys(std::function<int(const std::string& key)> function)
 {
+#ifndef SINGLE_THREADED
+  RWLock_guard guard(map_lock);
+#endif
   for(auto& pair : _map)
     function(pair.first);
   
   return S_OK;
 }
 
+/* cursor holds the bucket count (high 32 bits) and the next bucket */
+status_t Pool_handle::map_keys_slice(uint64_t& cursor,
+                                     size_t max_keys,
+                                     std::function<int(const std::string& key)> function)
+{
+#ifndef SINGLE_THREADED
+  RWLock_guard guard(map_lock);
+#endif
+  const uint64_t buckets = _map.bucket_count();
+  const uint64_t shape = (buckets & 0xffffffffULL) << 32;
+  if(cursor == 0)
+    cursor = shape;
+  else if((cursor & ~0xffffffffULL) != shape) {
+    cursor = 0;
+    return E_BAD_OFFSET; /* rehashed; keys moved between buckets */
+  }
+
+  uint64_t next = cursor & 0xffffffffULL;
+  size_t visited = 0;
+  for(; next < buckets && visited < max_keys; next++) {
+    for(auto i = _map.begin(next); i != _map.end(next); ++i) {
+      function(i->first);
+      visited++;
+    }
+  }
+  cursor = shape | next;
+  return next < buckets ? IKVStore::S_MORE : S_OK;
+}
 
 /** Main class */
 
@@ -641,6 +679,17 @@ status_t Map_store::map_keys(const IKVStore::pool_t pool,
   return session->pool->map_keys(function);  
 }
 
+status_t Map_store::map_keys_slice(const IKVStore::pool_t pool,
+                                   uint64_t& cursor,
+                                   size_t max_keys,
+                                   std::function<int(const std::string& key)> function)
+{
+  auto session = get_session(pool);
+  if(!session) return IKVStore::E_POOL_NOT_FOUND;
+
+  return session->pool->map_keys_slice(cursor, max_keys, function);
+}
+
 /** 
  * Factory entry point
  * 
@@ -65,7 +65,14 @@ public:
 public:
 
   /* IKVStore */
-  virtual int thread_safety() const { return THREAD_MODEL_RWLOCK_PER_POOL; }
+  virtual int thread_safety() const {
+#ifdef SINGLE_THREADED
+    /* only lock/unlock take the pool lock; other operations do not */
+    return THREAD_MODEL_SINGLE_PER_POOL;
+#else
+    return THREAD_MODEL_RWLOCK_PER_POOL;
+#endif
+  }
 
   virtual int get_capability(Capability cap) const;
   
@@ -135,6 +142,11 @@ public:
   virtual status_t map_keys(const pool_t pool,
                             std::function<int(const std::string& key)> function) override;
 
+  virtual status_t map_keys_slice(const pool_t pool,
+                                  uint64_t& cursor,
+                                  size_t max_keys,
+                                  std::function<int(const std::string& key)> function) override;
+
   virtual void debug(const pool_t pool, unsigned cmd, uint64_t arg) override;
 
 private:
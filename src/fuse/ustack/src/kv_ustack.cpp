@@ -313,14 +313,18 @@ static int kvfs_ustack_read(const char *path, char *buf, size_t size, off_t offs
 	(void) fi;
 
 
-  (void) offset;
   kv_ustack_info_t *info = reinterpret_cast<kv_ustack_info_t *>(fuse_get_context()->private_data);
+
+  size_t file_size = info->get_item_size(fi->fh);
+  if(size_t(offset) >= file_size) return 0;
+  size = std::min(size, file_size - offset);
+
   if(S_OK!=info->read(fi->fh, buf , size, offset)){
     PERR("[%s]: read error", __func__);
     return -1;
   }
 
-  PLOG("[%s]: read value %s from path %s ", __func__, buf, path);
+  PLOG("[%s]: read %lu bytes from path %s ", __func__, size, path);
 
   return size;
 }
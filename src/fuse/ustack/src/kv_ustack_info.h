@@ -13,9 +13,15 @@
 
 #include <unordered_map>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <api/components.h>
 #include <api/kvstore_itf.h>
+#include <common/rwlock.h>
 #include <set>
 
 using namespace Component;
@@ -165,9 +171,16 @@ class KV_ustack_info{
 #endif
 
 
+enum page_state_t {
+  PAGE_EMPTY,   /** object not locked yet*/
+  PAGE_LOADING, /** being locked by some thread*/
+  PAGE_LOADED,
+};
+
 struct page_cache_entry{
   size_t pg_offset;
   bool is_dirty;
+  page_state_t state = PAGE_EMPTY;
 
   void * vaddr = nullptr; /** pointer to this locked object*/
   IKVStore::key_t locked_key = nullptr;
@@ -176,12 +189,31 @@ struct page_cache_entry{
   page_cache_entry(size_t pg_offset = 0): pg_offset(pg_offset), is_dirty(false){}
 };
 
-/** Use lock/unlock to provide page cache*/
+/**
+ * Use lock/unlock to provide page cache.
+ *
+ * Each cache page is one locked object ("filename#seg-N"). A file's page
+ * size is picked from its first extending write, between the configured
+ * page size and k_max_page_size, so that a file written in large chunks
+ * needs one lock call per chunk instead of one per small page. Pages are
+ * locked on first access.
+ *
+ * Every file has its own lock; the file table is under a reader/writer
+ * lock, so the multi-threaded FUSE loop and the ustack workers can work
+ * on different files in parallel.
+ *
+ * A background thread reads ahead of sequential readers and syncs pages
+ * that sequential writers have moved past, in runs of at least
+ * k_writebehind_bytes, so that fsync and close find little left to do.
+ */
 class KV_ustack_info_cached{
 
   using pool_t     = uint64_t;
   using fuse_fd_t = uint64_t;
   static constexpr size_t k_pool_size = MB(256); /** To save all objs in this mount*/
+  static constexpr size_t k_max_page_size = MB(2); /** Largest adaptive page*/
+  static constexpr size_t k_readahead_max_bytes = MB(2); /** Largest readahead window*/
+  static constexpr size_t k_writebehind_bytes = MB(1); /** Smallest run synced in background*/
   size_t PAGE_CACHE_SIZE;
 
   public:
@@ -190,135 +222,280 @@ class KV_ustack_info_cached{
     struct File_meta{
       using page_id_t= unsigned int;
       File_meta() = delete;
-      File_meta(std::string name, IKVStore * store, IKVStore::pool_t pool, size_t page_cache_sz): filename(name), _store(store), _pool(pool), PAGE_CACHE_SIZE(page_cache_sz){}
+      File_meta(std::string name, IKVStore * store, IKVStore::pool_t pool, size_t page_cache_sz): filename(name), _store(store), _pool(pool), MIN_PAGE_SIZE(page_cache_sz){}
 
-      ~File_meta(){}
+      ~File_meta(){
+        for(auto entry : _cached_pages) delete entry;
+      }
+
+      /** Page size of this file; 0 until the file first grows*/
+      size_t page_size(){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        return _page_size;
+      }
 
-      /** lock objects as page cache*/
-      inline status_t cache_add_entry(size_t nr_entries = 1){
-        for(auto i = 0; i < nr_entries ; i++){
-          page_cache_entry * entry = new page_cache_entry();
-          std::string obj_key = filename + "#seg-" + std::to_string(_nr_cached_pages);
-          size_t value_len = PAGE_CACHE_SIZE;
+      size_t get_size(){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        return size;
+      }
+
+      /**
+       * Address of a cached page, locking its object if needed
+       *
+       * @param wait If false, return nullptr rather than wait for a page
+       * another thread is loading
+       */
+      void * page_addr(page_id_t page_id, bool wait = true){
+        std::unique_lock<std::mutex> g(_cache_lock);
+        page_cache_entry * entry = _cached_pages.at(page_id);
+
+        while(entry->state != PAGE_LOADED){
+          if(entry->state == PAGE_LOADING){
+            if(!wait) return nullptr;
+            _cache_cv.wait(g);
+            continue;
+          }
+          entry->state = PAGE_LOADING;
+          size_t value_len = _page_size;
+          g.unlock();
 
           // If same file is opened again, contents shall be the same
-          if(S_OK!= _store->lock(_pool, obj_key, IKVStore::STORE_LOCK_WRITE, entry->vaddr, value_len, entry->locked_key)){
+          std::string obj_key = filename + "#seg-" + std::to_string(entry->pg_offset);
+          status_t rc = _store->lock(_pool, obj_key, IKVStore::STORE_LOCK_WRITE, entry->vaddr, value_len, entry->locked_key);
+          PDBG("%s: filename (%s): \n\t get locked_key[%lu] 0x%lx", __func__, filename.c_str(), entry->pg_offset, uint64_t(entry->locked_key));
+
+          g.lock();
+          entry->state = (rc == S_OK) ? PAGE_LOADED : PAGE_EMPTY;
+          _cache_cv.notify_all();
+          if(rc != S_OK)
             throw General_exception("lock file cached failed");
-            }
-
-          PDBG("%s: filename (%s): \n\t get locked_key[%lu] 0x%lx", __func__, filename.c_str(), _nr_cached_pages, uint64_t(entry->locked_key));
-          _cached_pages.push_back(entry);
-          _nr_cached_pages += 1;
         }
-        return S_OK;
+        return entry->vaddr;
       }
 
-      status_t populate_cache(){
-        size_t requested_nr_pages = 1; // for new file use one page 
-        if(size){ // a previous file
-          requested_nr_pages = (size + PAGE_CACHE_SIZE -1) / PAGE_CACHE_SIZE;
-          assert(requested_nr_pages > 0);
-        }
-        return  cache_add_entry(requested_nr_pages);
+      /** First open populates the cache; returns the number of opens*/
+      unsigned open(int flags){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        if(_open_count++ == 0 && size)
+          add_pages(pages_for(size) - _nr_cached_pages);
+        open_flags = flags;
+        return _open_count;
       }
 
-      /** Need to expand current file*/
-      status_t might_enlarge_file(size_t new_size){
-        status_t ret = E_FAIL;
-        if(new_size <= size) return S_OK;
-        if(new_size <= allocated_space()) {
-          size = new_size;
-          return S_OK;
-        }
+      /** Last close flushes the cache*/
+      status_t close(){
+        std::unique_lock<std::mutex> g(_cache_lock);
+        if(_open_count == 0) return E_FAIL;
+        if(--_open_count == 0) flush_cache(g);
+        return S_OK;
+      }
 
-        // actually lock more objs
-        size_t requested_nr_pages = (new_size + PAGE_CACHE_SIZE -1) / PAGE_CACHE_SIZE - _nr_cached_pages;
-        assert(requested_nr_pages > 0);
+      /**
+       * Need to expand current file
+       *
+       * @param new_size New file size
+       * @param io_size Size of the access; picks the page size of a new file
+       */
+      status_t might_enlarge_file(size_t new_size, size_t io_size){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        if(new_size <= size) return S_OK;
 
-        try{
-        ret =  cache_add_entry(requested_nr_pages);
-        }catch(...){
-          PERR("failed in lock more objs, %lu + %lu", _nr_cached_pages, requested_nr_pages);
+        if(_page_size == 0){
+          size_t page_size = MIN_PAGE_SIZE;
+          while(page_size < io_size && page_size < k_max_page_size) page_size *= 2;
+          _page_size = page_size;
+          PDBG("%s: filename (%s) uses %lu byte pages", __func__, filename.c_str(), _page_size);
         }
+
+        size_t requested_nr_pages = pages_for(new_size);
+        if(requested_nr_pages > _nr_cached_pages)
+          add_pages(requested_nr_pages - _nr_cached_pages);
         size = new_size;
-        return ret;
+        return S_OK;
       }
 
       // TODO: i need previously control cache here.
       status_t  truncate_file(size_t new_size){
-        if(new_size <= size)
-          size = new_size;
-        else{
-          might_enlarge_file(new_size);
+        {
+          std::lock_guard<std::mutex> g(_cache_lock);
+          if(new_size <= size){
+            size = new_size;
+            return S_OK;
+          }
         }
-        return S_OK;
-      }
-
-
-      /* This will only be used when closing a file!*/
-      status_t flush_cache(){
-        // while(! _cached_pages.empty()){
-        int i = 0;
-        for(auto it = _cached_pages.begin(); it != _cached_pages.end();){
-
-          auto entry = *it;
-          PDBG("%s:filename:(%s): \n\t trying to unlock locked_key[%d] 0x%lx", __func__,  filename.c_str(), i++ ,uint64_t(entry->locked_key));
-          _store->unlock(_pool, entry->locked_key);
-          _cached_pages.erase(it);
-          _nr_cached_pages --;
-        }
-        assert(_nr_cached_pages == 0);
-        PDBG("%s:filename:(%s): \n\t All flushed", __func__, filename.c_str());
-        return S_OK;
+        return might_enlarge_file(new_size, new_size - size);
       }
 
       /** Mark a cached page dirty*/
       status_t mark_page_dirty(page_id_t page_id){
+        std::lock_guard<std::mutex> g(_cache_lock);
         _dirty_pages.insert(page_id);
         return S_OK;
       }
 
+      /* Sync one page if it is still dirty*/
+      status_t sync_page(page_id_t page_id){
+        IKVStore::key_t key;
+        {
+          std::lock_guard<std::mutex> g(_cache_lock);
+          if(_dirty_pages.erase(page_id) == 0) return S_OK;
+          key = _cached_pages[page_id]->locked_key;
+        }
+        unsigned cmd = 1993;// NVMESTORE_CMD_SYNC
+        _store->debug(_pool, cmd, (uint64_t)(key));
+        return S_OK;
+      }
+
       /* Sync dirty pages to kvstore*/
       status_t sync_cache(){
-        // while(! _cached_pages.empty()){
-        int i = 0;
-        for(const page_id_t &pageid : _dirty_pages){
-          auto entry = _cached_pages[pageid];
-          unsigned cmd = 1993;// NVMESTORE_CMD_SYNC
-          _store->debug(_pool, cmd, (uint64_t)(entry->locked_key));
+        std::vector<page_id_t> dirty;
+        {
+          /* pages taken by write-behind are synced once it finishes */
+          std::unique_lock<std::mutex> g(_cache_lock);
+          while(_pending_work) _cache_cv.wait(g);
+          dirty.assign(_dirty_pages.begin(), _dirty_pages.end());
         }
-        _dirty_pages.clear();
+        for(const page_id_t &pageid : dirty)
+          sync_page(pageid);
         return S_OK;
       }
 
+      /**
+       * Pages to read ahead after a read; the window doubles while the
+       * reader stays sequential and collapses on a seek
+       *
+       * @return [first, last) of pages to load
+       */
+      std::pair<page_id_t, page_id_t> readahead_range(size_t file_offset, size_t io_size, size_t max_bytes){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        bool sequential = (file_offset == _rd_next_off);
+        _rd_next_off = file_offset + io_size;
+        if(!sequential || _page_size == 0){
+          _ra_window = 0;
+          _ra_queued_end = 0;
+          return {0, 0};
+        }
+        size_t max_pages = std::max<size_t>(1, max_bytes / _page_size);
+        _ra_window = std::min(_ra_window ? _ra_window * 2 : 1, max_pages);
+
+        page_id_t next = (_rd_next_off + _page_size - 1) / _page_size;
+        page_id_t first = std::max(next, _ra_queued_end);
+        page_id_t last = std::min<size_t>(next + _ra_window, _nr_cached_pages);
+        if(first >= last) return {0, 0};
+        _ra_queued_end = last;
+        _pending_work++;
+        return {first, last};
+      }
+
+      /**
+       * Pages a sequential writer has moved past, once at least
+       * min_bytes of them have built up
+       *
+       * @return [first, last) of pages to sync
+       */
+      std::pair<page_id_t, page_id_t> writebehind_range(size_t file_offset, size_t io_size, size_t min_bytes){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        if(file_offset != _wr_next_off)
+          _wb_next = file_offset / _page_size;
+        _wr_next_off = file_offset + io_size;
+
+        size_t min_pages = std::max<size_t>(1, min_bytes / _page_size);
+        page_id_t done = _wr_next_off / _page_size; // pages fully behind the writer
+        if(done < _wb_next + min_pages) return {0, 0};
+        page_id_t first = _wb_next;
+        _wb_next = done;
+        _pending_work++;
+        return {first, done};
+      }
+
+      /** Background work on this file has finished*/
+      void work_done(){
+        std::lock_guard<std::mutex> g(_cache_lock);
+        assert(_pending_work > 0);
+        if(--_pending_work == 0) _cache_cv.notify_all();
+      }
+
       std::string filename;
       int open_flags;
-      size_t size = 0;
 
-      size_t _nr_cached_pages = 0;
-      std::vector<page_cache_entry *> _cached_pages; /** just an array of locked regions*/
-      std::set<page_id_t> _dirty_pages;
-      std::mutex file_mutex;
+      private:
+      /* callers hold _cache_lock */
+      size_t pages_for(size_t bytes) const {
+        return (bytes + _page_size - 1) / _page_size;
+      }
 
-      inline size_t allocated_space(){
-        return _nr_cached_pages* PAGE_CACHE_SIZE;
+      /** Add page cache entries; objects are locked on first access*/
+      void add_pages(size_t nr_entries){
+        for(size_t i = 0; i < nr_entries ; i++){
+          _cached_pages.push_back(new page_cache_entry(_nr_cached_pages));
+          _nr_cached_pages += 1;
+        }
+      }
+
+      /* This will only be used when closing a file!*/
+      void flush_cache(std::unique_lock<std::mutex>& g){
+        /* background work holds no reference once _pending_work drops */
+        while(_pending_work) _cache_cv.wait(g);
+
+        int i = 0;
+        for(auto entry : _cached_pages){
+          if(entry->state == PAGE_LOADED){
+            PDBG("%s:filename:(%s): \n\t trying to unlock locked_key[%d] 0x%lx", __func__,  filename.c_str(), i ,uint64_t(entry->locked_key));
+            _store->unlock(_pool, entry->locked_key);
+          }
+          delete entry;
+          i++;
+        }
+        _cached_pages.clear();
+        _dirty_pages.clear();
+        _nr_cached_pages = 0;
+        _rd_next_off = _wr_next_off = 0;
+        _ra_window = 0;
+        _ra_queued_end = _wb_next = 0;
+        PDBG("%s:filename:(%s): \n\t All flushed", __func__, filename.c_str());
       }
 
-      private:
       IKVStore * _store;
       IKVStore::pool_t _pool;
-      size_t PAGE_CACHE_SIZE;
+      const size_t MIN_PAGE_SIZE;
+
+      std::mutex _cache_lock; /** protects everything below*/
+      std::condition_variable _cache_cv;
+      size_t size = 0;
+      size_t _page_size = 0;
+      unsigned _open_count = 0;
+      unsigned _pending_work = 0; /** queued background work*/
+
+      size_t _nr_cached_pages = 0;
+      std::vector<page_cache_entry *> _cached_pages; /** just an array of locked regions*/
+      std::set<page_id_t> _dirty_pages;
+
+      size_t _rd_next_off = 0; /** where a sequential read would continue*/
+      size_t _wr_next_off = 0;
+      size_t _ra_window = 0; /** readahead window, in pages*/
+      page_id_t _ra_queued_end = 0; /** end of pages already queued for readahead*/
+      page_id_t _wb_next = 0; /** first page not yet queued for write-behind*/
     }; // end of File_meta
 
+    /** I/O paths hold a reference, so an unlink cannot free a file under them*/
+    using File_ptr = std::shared_ptr<File_meta>;
+
     KV_ustack_info_cached(const std::string ustack_name, const std::string owner, const std::string name, Component::IKVStore *store, size_t page_cache_sz = MB(2)): 
       _owner(owner), _name(name), _store(store), _assigned_ids(0), PAGE_CACHE_SIZE(page_cache_sz){
       _pool = _store->create_pool(name, k_pool_size);
       if(IKVStore::POOL_ERROR == _pool){
         throw General_exception("%s: initial pool creation failed", __func__);
       }
+      _cache_thread = std::thread([=]() { cache_thread_entry(); });
     };
 
     ~KV_ustack_info_cached(){
+      {
+        std::lock_guard<std::mutex> g(_work_lock);
+        _exit = true;
+      }
+      _work_cv.notify_all();
+      _cache_thread.join();
       _store->close_pool(_pool);
     }
 
@@ -328,6 +505,7 @@ class KV_ustack_info_cached{
 
     /* All files in this mount*/
     std::vector<std::string> get_filenames(){
+      Common::RWLock_guard g(_files_lock);
       std::vector<std::string> filenames;
       for(auto item = _files.begin(); item!= _files.end(); item++){
         filenames.push_back(item->second->filename);
@@ -340,20 +518,23 @@ class KV_ustack_info_cached{
 
       assert(id > 0);
       assert(_pool);
-      _files.insert(std::make_pair(id, new File_meta(filename, _store, _pool, PAGE_CACHE_SIZE)));
+      Common::RWLock_guard g(_files_lock, Common::RWLock_guard::WRITE);
+      _files.insert(std::make_pair(id, std::make_shared<File_meta>(filename, _store, _pool, PAGE_CACHE_SIZE)));
+      _ids[filename] = id;
       return id;
     }
 
     status_t remove_item(uint64_t id){
-      status_t ret;
-      std::string key =  _files.at(id)->filename;
+      File_ptr fileinfo;
+      {
+        Common::RWLock_guard g(_files_lock, Common::RWLock_guard::WRITE);
+        fileinfo = _files.at(id);
+        _files.erase(id);
+        _ids.erase(fileinfo->filename);
+      }
 
-      ret = _store->erase(_pool, key);
-      delete _files.at(id);
-      _files.erase(id);
-      assert(_assigned_ids > 0);
-      --_assigned_ids;
-      return ret;
+      /* the last reference, possibly an in-flight I/O, frees the file */
+      return _store->erase(_pool, fileinfo->filename);
     }
 
     /*
@@ -362,60 +543,47 @@ class KV_ustack_info_cached{
      * @return 0 if not found
      */
     fuse_fd_t get_id(std::string item){
-      for(const auto & i : _files){
-        if(i.second->filename == item)
-          return i.first;
-      }
-      return 0;
+      Common::RWLock_guard g(_files_lock);
+      auto i = _ids.find(item);
+      return i == _ids.end() ? 0 : i->second;
     }
 
     /* get the file size 
      */
     size_t get_item_size(fuse_fd_t id){
-      return _files.at(id)->size;
+      return file(id)->get_size();
     }
 
-    void set_item_size(fuse_fd_t id, size_t size){
-      _files.at(id)->size = size;
-    }
-
-    // Currently cannot open before previous close is not persistent
     status_t open_file(fuse_fd_t id, int flags)
     {
-      File_meta* fileinfo = _files.at(id);
-      fileinfo->file_mutex.lock();
-      fileinfo->populate_cache();
-      fileinfo->open_flags = flags;
+      file(id)->open(flags);
       return S_OK;
     }
 
 
     int get_flags(fuse_fd_t id){
-      return _files.at(id)->open_flags;
+      return file(id)->open_flags;
     }
 
     /* This will unlock the obj, thus writing persist data to pool*/
     status_t close_file(fuse_fd_t id){
       PDBG("close cached file called");
-      File_meta* fileinfo;
+      File_ptr fileinfo;
       try{
-        fileinfo = _files.at(id);
+        fileinfo = file(id);
       }
       catch(std::out_of_range e){
         PERR("close failed");
         return E_FAIL;
       }
-      fileinfo->flush_cache();
-
-      fileinfo->file_mutex.unlock();
-      return S_OK;
+      return fileinfo->close();
     }
 
     status_t fsync_file(fuse_fd_t id){
       PDBG("fsync cached file called");
-      File_meta* fileinfo;
+      File_ptr fileinfo;
       try{
-        fileinfo = _files.at(id);
+        fileinfo = file(id);
       }
       catch(std::out_of_range e){
         PERR("try to sync an unmanaged file");
@@ -427,13 +595,11 @@ class KV_ustack_info_cached{
     }
 
     status_t fallocate(fuse_fd_t id,size_t size, size_t file_offset){
-      File_meta* fileinfo = _files.at(id);
-      return fileinfo->might_enlarge_file(size + file_offset);
+      return file(id)->might_enlarge_file(size + file_offset, size);
     }
 
     status_t ftruncate(fuse_fd_t id,size_t size){
-      File_meta* fileinfo = _files.at(id);
-      return fileinfo->truncate_file(size);
+      return file(id)->truncate_file(size);
     }
 
 
@@ -441,43 +607,34 @@ class KV_ustack_info_cached{
     status_t write(fuse_fd_t id, const void * value, size_t size, size_t file_offset){
       PDBG("cached write called");
 
-      File_meta* fileinfo = _files.at(id);
-      fileinfo->might_enlarge_file(size + file_offset);
+      File_ptr fileinfo = file(id);
+      if(size == 0) return S_OK;
+      fileinfo->might_enlarge_file(size + file_offset, size);
+      const size_t page_size = fileinfo->page_size();
 
       size_t bytes_left = size;
-      char * p = (char *)value;
-      size_t io_size;
-
-      size_t cur_pageid = file_offset/PAGE_CACHE_SIZE;
-      size_t cur_pageoff = file_offset%PAGE_CACHE_SIZE;
+      const char * p = (const char *)value;
 
+      size_t cur_pageid = file_offset/page_size;
+      size_t cur_pageoff = file_offset%page_size;
 
       while(bytes_left > 0){
-        char * target_addr;
-        if(cur_pageoff){
-          size_t page_leftover = PAGE_CACHE_SIZE - (file_offset%PAGE_CACHE_SIZE);
-          io_size = size < page_leftover? size: page_leftover;
-          target_addr =  (char *)((fileinfo->_cached_pages[cur_pageid])->vaddr) + cur_pageoff;
-          cur_pageoff = 0;
-        }
-        else{
-          io_size = bytes_left<PAGE_CACHE_SIZE? bytes_left:PAGE_CACHE_SIZE;
-          target_addr =  (char *)((fileinfo->_cached_pages[cur_pageid])->vaddr);
-        }
+        size_t io_size = std::min(bytes_left, page_size - cur_pageoff);
+        char * target_addr = (char *)fileinfo->page_addr(cur_pageid) + cur_pageoff;
 
+        memcpy(target_addr, p, io_size);
         // Add Dirty_pages
         fileinfo->mark_page_dirty(cur_pageid);
-        memcpy(target_addr, p, io_size);
-
-/*        if(((char*)target_addr)[0] == 0 ){*/
-          //PWRN("zero value written!");
-        /*}*/
 
         cur_pageid += 1;
+        cur_pageoff = 0;
         p += io_size;
         bytes_left -= io_size;
       }
 
+      auto range = fileinfo->writebehind_range(file_offset, size, k_writebehind_bytes);
+      if(range.first != range.second)
+        queue_work(fileinfo, range.first, range.second, WORK_SYNC);
       return S_OK;
     }
 
@@ -485,36 +642,31 @@ class KV_ustack_info_cached{
 
       PDBG("cached read called");
 
-      File_meta* fileinfo = _files.at(id);
+      File_ptr fileinfo = file(id);
+      if(size == 0) return S_OK;
+      const size_t page_size = fileinfo->page_size();
 
       size_t bytes_left = size;
       char * p = (char *)value;
-      size_t io_size;
 
-      size_t cur_pageid = file_offset/PAGE_CACHE_SIZE;
-      size_t cur_pageoff = file_offset%PAGE_CACHE_SIZE;
+      size_t cur_pageid = file_offset/page_size;
+      size_t cur_pageoff = file_offset%page_size;
 
       while(bytes_left > 0){
-        char * source_addr;
-        if(cur_pageoff){
-          size_t page_leftover = PAGE_CACHE_SIZE - (file_offset%PAGE_CACHE_SIZE);
-          io_size = size < page_leftover? size: page_leftover;
-          source_addr =  (char *)((fileinfo->_cached_pages[cur_pageid++])->vaddr) + cur_pageoff;
-          cur_pageoff = 0;
-        }
-        else{
-          io_size = bytes_left<PAGE_CACHE_SIZE? bytes_left:PAGE_CACHE_SIZE;
-          source_addr =  (char *)((fileinfo->_cached_pages[cur_pageid++])->vaddr);
-        }
+        size_t io_size = std::min(bytes_left, page_size - cur_pageoff);
+        char * source_addr = (char *)fileinfo->page_addr(cur_pageid) + cur_pageoff;
 
-        //if(((char*)source_addr)[0]== 0){
-          //PWRN("zero value read!");
-        /*}*/
         memcpy(p, source_addr, io_size);
 
+        cur_pageid += 1;
+        cur_pageoff = 0;
         p += io_size;
         bytes_left -= io_size;
       }
+
+      auto range = fileinfo->readahead_range(file_offset, size, k_readahead_max_bytes);
+      if(range.first != range.second)
+        queue_work(fileinfo, range.first, range.second, WORK_READAHEAD);
       return S_OK;
     }
 
@@ -526,7 +678,64 @@ class KV_ustack_info_cached{
 
       Component::IKVStore *_store;
       pool_t _pool;
-      std::map<fuse_fd_t, File_meta *> _files;  
-      std::atomic<fuse_fd_t> _assigned_ids; //current assigned ids, to identify each file
+      Common::RWLock _files_lock; /** protects _files and _ids*/
+      std::map<fuse_fd_t, File_ptr> _files;
+      std::unordered_map<std::string, fuse_fd_t> _ids; /** filename to id*/
+      std::atomic<fuse_fd_t> _assigned_ids; //last assigned id, to identify each file
+
+      File_ptr file(fuse_fd_t id){
+        Common::RWLock_guard g(_files_lock);
+        return _files.at(id);
+      }
+
+      enum work_type_t { WORK_READAHEAD, WORK_SYNC };
+
+      struct Cache_work {
+        File_ptr file;
+        File_meta::page_id_t first; /** [first, last) pages*/
+        File_meta::page_id_t last;
+        work_type_t type;
+      };
+
+      void queue_work(const File_ptr& file, File_meta::page_id_t first, File_meta::page_id_t last, work_type_t type){
+        {
+          std::lock_guard<std::mutex> g(_work_lock);
+          _work.push_back({file, first, last, type});
+        }
+        _work_cv.notify_one();
+      }
+
+      void cache_thread_entry(){
+        std::unique_lock<std::mutex> g(_work_lock);
+        while(true){
+          _work_cv.wait(g, [this]() { return _exit || !_work.empty(); });
+          if(_work.empty()) break; // exiting
+
+          Cache_work work = _work.front();
+          _work.pop_front();
+          g.unlock();
+
+          for(auto page = work.first; page < work.last; page++){
+            try{
+              if(work.type == WORK_READAHEAD)
+                work.file->page_addr(page, false);
+              else
+                work.file->sync_page(page);
+            }
+            catch(...){
+              PWRN("%s: background work on page %u failed", __func__, page);
+            }
+          }
+          work.file->work_done();
+          work.file.reset();
+          g.lock();
+        }
+      }
+
+      std::thread _cache_thread; /** readahead and write-behind*/
+      std::mutex _work_lock;
+      std::condition_variable _work_cv;
+      std::deque<Cache_work> _work;
+      bool _exit = false;
 };
 #endif
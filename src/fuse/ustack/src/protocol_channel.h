@@ -7,6 +7,8 @@ enum {
   /* client request */
   IO_TYPE_READ = 1,
   IO_TYPE_WRITE = 2,
+  IO_TYPE_FSYNC = 5,
+  IO_TYPE_GETSIZE = 6, /* result is the file size */
 
   /* server response*/
   IO_WRONG_TYPE = -1,
@@ -47,6 +47,9 @@ Ustack::~Ustack()
     channel->_channel->unblock_threads();
   }
 
+  for(auto& i: _ring_map)
+    i.second->_exit = true;
+
   for(auto& t_vector: _threads) {
     for(auto& t : t_vector.second) {
       t->join();
@@ -59,6 +62,9 @@ Ustack::~Ustack()
     delete channel;
   }
 
+  for(auto& i: _ring_map)
+    delete i.second;
+
   for(auto& i: _shmem_map) {
     for(auto& shmem: i.second)
       delete shmem;
@@ -151,6 +157,34 @@ int Ustack::process_message(void* msg,
         PLOG("ustack: pid = %ld creating iomem instance at %p", sender_id, iomem);
         break;
       }      
+    case MessageType_IO_ring_request:
+      {
+        assert(pmsg->element_type() == Element_ElementIORingRequest);
+        uint32_t depth = pmsg->element_as_ElementIORingRequest()->depth();
+        if(depth == 0 || depth > MAX_RING_DEPTH || (depth & (depth - 1)))
+          throw General_exception("invalid IO ring depth (%u)", depth);
+        if(_ring_map.find(sender_id) != _ring_map.end())
+          throw General_exception("IO ring already set up for pid %ld", sender_id);
+
+        size_t size_in_pages = round_up(IO_ring::size_bytes(depth), PAGE_SIZE) / PAGE_SIZE;
+        std::stringstream ss;
+        ss << "ring-" << sender_id;
+
+        flatbuffers::FlatBufferBuilder fbb(1024);
+        auto response = CreateMessage(fbb,
+                                      MessageType_IO_ring_reply,
+                                      getpid(),
+                                      Element_ElementMemoryReply,
+                                      CreateElementMemoryReply(fbb,
+                                                               size_in_pages,
+                                                               fbb.CreateString(ss.str())).Union());
+        FinishMessageBuffer(fbb, response);
+        memcpy(reply, fbb.GetBufferPointer(), fbb.GetSize());
+
+        /* defer creation of the segment until the client is waiting for it */
+        _pending_rings.push_back(new IO_ring_instance(new Shared_memory_instance(ss.str(), size_in_pages, sender_id), depth));
+        break;
+      }
     case MessageType_Shutdown:
       {
         release_resources(sender_id);
@@ -175,6 +209,9 @@ void Ustack::release_resources(pid_t client_id)
     channel->_channel->unblock_threads();
   }
 
+  if(_ring_map.find(client_id) != _ring_map.end())
+    _ring_map[client_id]->_exit = true;
+
   /* release threads */
   if(_threads.find(client_id) != _threads.end()) {
     for(auto& t : _threads[client_id]) {
@@ -195,6 +232,13 @@ void Ustack::release_resources(pid_t client_id)
   }
   _channel_map.erase(client_id);
 
+  /* release rings */
+  if(_ring_map.find(client_id) != _ring_map.end()) {
+    delete _ring_map[client_id];
+    PLOG("Ustack: deleted IO ring for pid %d", client_id);
+  }
+  _ring_map.erase(client_id);
+
   /* release shmem */
   if(_shmem_map.find(client_id) != _shmem_map.end()) {
     auto memory_v = _shmem_map[client_id];
@@ -298,6 +342,19 @@ void Ustack::post_reply(void * reply_msg)
     _threads[c->_client_id].push_back(new std::thread([=]() { uipc_channel_thread_entry(c->_channel, c->_client_id); }));
   }
   _pending_channels.clear();
+
+  /* connect pending IO rings */
+  for(auto& r: _pending_rings) {
+    auto shmem = r->_shmem;
+    PLOG("ustack: creating IO ring (%s, %lu)", shmem->_id.c_str(), shmem->_size);
+    shmem->_shmem = new Core::UIPC::Shared_memory(shmem->_id, shmem->_size);
+    r->_ring = new IO_ring(shmem->_shmem->get_addr());
+    r->_ring->format(r->_depth);
+    _ring_map[shmem->_client_id] = r;
+
+    _threads[shmem->_client_id].push_back(new std::thread([=]() { io_ring_thread_entry(r, shmem->_client_id); }));
+  }
+  _pending_rings.clear();
 }
 
 void Ustack::uipc_channel_thread_entry(Core::UIPC::Channel * channel, pid_t client_id)
@@ -343,5 +400,41 @@ void Ustack::uipc_channel_thread_entry(Core::UIPC::Channel * channel, pid_t clie
   PLOG("worker (%p) exiting", channel);
 }
 
+/*
+ * Poll the submission ring while it is busy; after RING_SPIN_POLLS empty
+ * polls, sleep until the client submits again.
+ */
+void Ustack::io_ring_thread_entry(IO_ring_instance * instance, pid_t client_id)
+{
+  auto ring = instance->_ring;
+  unsigned idle = 0;
+
+  PLOG("ring worker (%p) starting", ring);
+  while(!_shutdown && !instance->_exit) {
+    uint32_t first;
+    uint32_t n = ring->peek_sqes(first, RING_BATCH);
+
+    if(n == 0) {
+      if(++idle < RING_SPIN_POLLS) {
+        cpu_relax();
+      }
+      else {
+        ring->wait_for_submission(RING_SLEEP_USEC);
+        idle = 0;
+      }
+      continue;
+    }
+    idle = 0;
+
+    for(uint32_t i = 0; i < n; i++) {
+      const IO_sqe& sqe = ring->sqe(first + i);
+      int64_t result = do_ring_io(client_id, sqe);
+      ring->post_cqe(sqe.user_data, result, sqe.flags);
+    }
+    ring->complete(n);
+  }
+  PLOG("ring worker (%p) exiting", ring);
+}
+
 // static members
 Core::Physical_memory Ustack::IO_memory_instance::_allocator;
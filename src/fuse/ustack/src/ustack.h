@@ -12,6 +12,7 @@
 #include <api/blob_itf.h>
 
 #include "protocol_channel.h"
+#include "ustack_ring.h"
 
 class KV_ustack_info_cached;
 
@@ -32,9 +33,11 @@ protected:
   virtual void post_reply(void * reply_msg);
 
 private:
+  struct IO_ring_instance;
 
   /* TODO: client id should be accessible from the channel*/
   void uipc_channel_thread_entry(Core::UIPC::Channel * channel, pid_t client_id);
+  void io_ring_thread_entry(IO_ring_instance * ring, pid_t client_id);
   void release_resources(pid_t client_id);
 
   /* actually do the io */
@@ -52,7 +55,20 @@ private:
    * @param file_off offset of the file
    */
   status_t do_kv_write(pid_t client_id, uint64_t fuse_fh, size_t buffer_offset, size_t io_sz, size_t file_off );
-  status_t do_kv_read(pid_t client_id, uint64_t fuse_fh, size_t buffer_offset, size_t io_sz, size_t file_off); 
+
+  /*
+   * Do the read through the kvfs daemon; reads are cut short at the end of file
+   *
+   * @param out_bytes bytes actually read
+   */
+  status_t do_kv_read(pid_t client_id, uint64_t fuse_fh, size_t buffer_offset, size_t io_sz, size_t file_off, size_t * out_bytes = nullptr);
+
+  /*
+   * Carry out a submission ring entry
+   *
+   * @return completion result: bytes, file size, 0 or -1
+   */
+  int64_t do_ring_io(pid_t client_id, const IO_sqe& sqe);
 
   struct Shared_memory_instance
   {
@@ -84,6 +100,22 @@ private:
     Core::UIPC::Channel * _channel;
   };
 
+  struct IO_ring_instance
+  {
+    IO_ring_instance(Shared_memory_instance * shmem, uint32_t depth) :
+      _shmem(shmem), _depth(depth), _ring(nullptr) {
+    }
+    ~IO_ring_instance() {
+      if(_ring) delete _ring;
+      delete _shmem;
+    }
+
+    Shared_memory_instance * _shmem;
+    uint32_t                 _depth;
+    IO_ring *                _ring;
+    std::atomic<bool>        _exit{false};
+  };
+
   struct IO_memory_instance
   {
     IO_memory_instance(size_t n_pages) : _n_pages(n_pages) {
@@ -111,16 +143,22 @@ private:
 
   static constexpr unsigned MAX_MESSAGE_SIZE = sizeof(IO_command);
   static constexpr unsigned MESSAGE_QUEUE_SIZE = 16;
+  static constexpr unsigned MAX_RING_DEPTH = 4096;
+  static constexpr unsigned RING_BATCH = 32; /*< submissions taken per poll */
+  static constexpr unsigned RING_SPIN_POLLS = 100000; /*< empty polls before sleeping */
+  static constexpr unsigned RING_SLEEP_USEC = 10000;
 
   //  typedef unsigned long pid_t;
   bool _shutdown = false;
   std::thread *                                          _ipc_thread;
   std::vector<Shared_memory_instance*>                   _pending_shmem;
   std::vector<Channel_instance*>                         _pending_channels;
+  std::vector<IO_ring_instance*>                         _pending_rings;
 
   std::map<pid_t, std::vector<std::thread *>>            _threads;
   std::map<pid_t, std::vector<Shared_memory_instance *>> _shmem_map;
   std::map<pid_t, Channel_instance *>                    _channel_map;
+  std::map<pid_t, IO_ring_instance *>                    _ring_map;
   std::map<pid_t, std::vector<IO_memory_instance*>>      _iomem_map;
 
   kv_ustack_info_t * _kv_ustack_info; // where ustack will invoke file opers
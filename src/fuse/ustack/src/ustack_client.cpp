@@ -5,6 +5,8 @@ static constexpr int k_nr_files   = 64; /** Intial capacity(num of files)*/
 static Ustack_client *  _this_client = NULL;
 
 static int *_fd_array = NULL;
+static off_t *_fd_pos = NULL;   /** file position of each tracked fd*/
+static int *_fd_flags = NULL;   /** open flags of each tracked fd*/
 
 enum {
   FD_ARRAY_INVALID = -1,
@@ -20,10 +22,16 @@ typedef int (*close_t)(int);
 typedef int (*open64_t)(const char *pathname, int flags, ...);
 typedef void *(*malloc_t)(size_t size);
 typedef void (*free_t)(void *ptr);
-/*typedef ssize_t (*read_t)(int fd, void *buf, size_t count);*/
-/*typedef ssize_t (*write_t)(int fd, const void *buf, size_t count);*/
+typedef ssize_t (*read_t)(int fd, void *buf, size_t count);
+typedef ssize_t (*write_t)(int fd, const void *buf, size_t count);
 typedef ssize_t (*pread_t)(int fd, void *buf, size_t count, off_t offset);
 typedef ssize_t (*pwrite_t)(int fd, const void *buf, size_t count, off_t offset);
+typedef ssize_t (*readv_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*writev_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*preadv_t)(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+typedef ssize_t (*pwritev_t)(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+typedef off_t (*lseek_t)(int fd, off_t offset, int whence);
+typedef int (*fsync_t)(int fd);
 typedef void *(*mmap_t)(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 typedef int (*munmap_t)(void *addr, size_t length);
 
@@ -32,13 +40,39 @@ open64_t orig_open64;
 close_t  orig_close;
 malloc_t orig_malloc;
 free_t   orig_free;
-/*read_t   orig_read;*/
-/*write_t  orig_write;*/
+read_t   orig_read;
+write_t  orig_write;
 pread_t   orig_pread;
 pwrite_t  orig_pwrite;
+readv_t   orig_readv;
+writev_t  orig_writev;
+preadv_t  orig_preadv;
+pwritev_t orig_pwritev;
+lseek_t   orig_lseek;
+fsync_t   orig_fsync;
+fsync_t   orig_fdatasync;
 mmap_t orig_mmap;
 munmap_t orig_munmap;
 
+/**
+ * Original libc entry point, resolved on first use: calls can be
+ * intercepted before ustack_ctor() has run (e.g. from libc start-up or
+ * other libraries' constructors).  Racing resolvers store the same value.
+ */
+template <typename F>
+static inline F resolve_orig(F &fn, const char *name)
+{
+  F f = __atomic_load_n(&fn, __ATOMIC_ACQUIRE);
+  if (!f) {
+    f = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+    assert(f);
+    __atomic_store_n(&fn, f, __ATOMIC_RELEASE);
+  }
+  return f;
+}
+
+#define ORIG(name) resolve_orig(orig_##name, #name)
+
 /** Constructor*/
 void __attribute__((constructor)) ustack_ctor();
 
@@ -50,35 +84,23 @@ void ustack_ctor()
   size_t fd_array_size;
 
   /* Save default calls*/
-  orig_close = (close_t)(dlsym(RTLD_NEXT, "close"));
-  assert(orig_close);
-
-  orig_open64 = (open64_t)(dlsym(RTLD_NEXT, "open64"));
-  assert(orig_open64);
-
-  orig_malloc = (malloc_t)(dlsym(RTLD_NEXT, "malloc"));
-  assert(orig_malloc);
-
-  orig_free = (free_t)(dlsym(RTLD_NEXT, "free"));
-  assert(orig_free);
-
-/*  orig_read = (read_t)(dlsym(RTLD_NEXT, "read"));*/
-  //assert(orig_read);
-
-  //orig_write = (write_t)(dlsym(RTLD_NEXT, "write"));
-  /*assert(orig_write);*/
-
-  orig_pread = (pread_t)(dlsym(RTLD_NEXT, "pread"));
-  assert(orig_pread);
-
-  orig_pwrite = (pwrite_t)(dlsym(RTLD_NEXT, "pwrite"));
-  assert(orig_pwrite);
-
-  orig_mmap = (mmap_t)(dlsym(RTLD_NEXT, "mmap"));
-  assert(orig_mmap);
-
-  orig_munmap = (munmap_t)(dlsym(RTLD_NEXT, "munmap"));
-  assert(orig_munmap);
+  ORIG(close);
+  ORIG(open64);
+  ORIG(malloc);
+  ORIG(free);
+  ORIG(read);
+  ORIG(write);
+  ORIG(readv);
+  ORIG(writev);
+  ORIG(preadv);
+  ORIG(pwritev);
+  ORIG(lseek);
+  ORIG(fsync);
+  ORIG(fdatasync);
+  ORIG(pread);
+  ORIG(pwrite);
+  ORIG(mmap);
+  ORIG(munmap);
 
   PMAJOR("Original open64/close/malloc intialized, trying to connect to kvfs-ustack server");
 
@@ -90,20 +112,44 @@ void ustack_ctor()
 
   /* Allocate space for fd mappings*/
   fd_array_size = k_nr_files * sizeof(int);
-  _fd_array     = (int *) orig_malloc(fd_array_size);
+  _fd_array     = (int *) ORIG(malloc)(fd_array_size);
   assert(_fd_array);
   memset((void *) (_fd_array), 0xff, fd_array_size);
 
+  _fd_pos   = (off_t *) ORIG(malloc)(k_nr_files * sizeof(off_t));
+  _fd_flags = (int *) ORIG(malloc)(k_nr_files * sizeof(int));
+  assert(_fd_pos && _fd_flags);
+
   _fd_array_initialized = FD_ARRAY_OK;
   PDBG("fd_array init at %p", _fd_array);
 
   assert(_this_client->get_uipc_channel());
+  _this_client->get_io_ring();
+}
+
+/**
+ * fuse file handle of an fd opened in the mount, or FUSE_FD_INVALID
+ */
+static inline int tracked_fuse_fh(int fd)
+{
+  if (_fd_array_initialized != FD_ARRAY_OK || fd < 0 || fd >= k_nr_files)
+    return FUSE_FD_INVALID;
+  return _fd_array[fd];
+}
+
+static inline size_t iov_length(const struct iovec *iov, int iovcnt)
+{
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; i++) len += iov[i].iov_len;
+  return len;
 }
 
 void ustack_dtor()
 {
   _fd_array_initialized = FD_ARRAY_INVALID;
   if (_fd_array) orig_free(_fd_array);
+  if (_fd_pos) orig_free(_fd_pos);
+  if (_fd_flags) orig_free(_fd_flags);
   PINF("ustack preload --unloading");
   delete _this_client;
 }
@@ -131,10 +177,10 @@ int open64(const char *pathname, int flags, ...)
     mode = (mode_t)va_arg(vl, mode_t);
     va_end(vl);
 
-    fd = orig_open64(pathname, flags, mode);
+    fd = ORIG(open64)(pathname, flags, mode);
   }
   else{
-    fd = orig_open64(pathname, flags);
+    fd = ORIG(open64)(pathname, flags);
   }
 
 
@@ -153,6 +199,8 @@ int open64(const char *pathname, int flags, ...)
          pathname, fd, fuse_fh);
     PINF("fd_array is at %p", _fd_array);
     assert(fuse_fh > 0);
+    _fd_pos[fd]   = 0;
+    _fd_flags[fd] = flags;
     _fd_array[fd] = fuse_fh;
   }
 
@@ -195,12 +243,15 @@ int close(int fd)
 {
   int ret = -1;
 
-  ret = orig_close(fd);
+  ret = ORIG(close)(fd);
 
   PLOG("Ustack close intercepted for fd (%d)", fd);
 
-  if (ret == 0 && fd >= 0 && _fd_array_initialized == FD_ARRAY_OK) {
+  /* untracked or out-of-range fds have no slot */
+  if (ret == 0 && tracked_fuse_fh(fd) != FUSE_FD_INVALID) {
     _fd_array[fd] = FUSE_FD_INVALID;
+    _fd_pos[fd]   = 0;
+    _fd_flags[fd] = 0;
   }
   return ret;
 };
@@ -217,7 +268,7 @@ void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
   }
   else{
     PLOG("[mmap]: fall back mmap with flags(%x) size(%ld)", flags, length);
-    ret =  orig_mmap(addr, length, prot, flags, fd, offset);
+    ret =  ORIG(mmap)(addr, length, prot, flags, fd, offset);
   }
   return ret;
 }
@@ -226,7 +277,7 @@ int munmap(void *addr, size_t length){
   int ret = -1;
 
   PLOG("[munmap with addr %p, length = %ld", addr, length);
-  ret =  orig_munmap(addr, length);
+  ret =  ORIG(munmap)(addr, length);
   if(ret){ // is ustack-managed
     _this_client->free(addr);
     ret = 0;
@@ -237,14 +288,15 @@ int munmap(void *addr, size_t length){
 
 /**
  * File write and read
- * TODO: intercept posix ops
  *
+ * Files in the mount are read and written through the ustack rings;
+ * positional calls use the given offset, the others use and advance a
+ * per-fd file position kept here (the kernel's position is not used).
  */
 ssize_t pwrite(int fd, const void *buf, size_t count, off_t file_off)
 {
   int search;
-  if (_fd_array_initialized == FD_ARRAY_OK &&
-      (search = _fd_array[fd]) != FUSE_FD_INVALID) {
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID) {
     uint64_t fuse_fh = search;
     PLOG("[stack-write]: try to write from %p to fuse_fh %lu, size %lu, offset %lu", buf,
          fuse_fh, count, file_off);
@@ -253,15 +305,14 @@ ssize_t pwrite(int fd, const void *buf, size_t count, off_t file_off)
   else {
     /* regular file */
     PLOG("[stack-write]: fall back to orig_pwrite fd(%d)", fd);
-    return orig_pwrite(fd, buf, count, file_off);
+    return ORIG(pwrite)(fd, buf, count, file_off);
   }
 }
 
 ssize_t pread(int fd, void *buf, size_t count, off_t file_off)
 {
   int search;
-  if (_fd_array_initialized == FD_ARRAY_OK &&
-      (search = _fd_array[fd]) != FUSE_FD_INVALID) {
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID) {
     uint64_t fuse_fh = search;
 
     PLOG("[stack-read]: try to write from %p to fuse_fh %lu, size %lu, offset %lu", buf,
@@ -271,6 +322,184 @@ ssize_t pread(int fd, void *buf, size_t count, off_t file_off)
   else {
     /* regular file */
     PLOG("[stack-read]: fall back to orig_read fd(%d), buf(%p), count(%ld)", fd, buf, count);
-    return orig_pread(fd, buf, count, file_off);
+    return ORIG(pread)(fd, buf, count, file_off);
   }
 }
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return _this_client->readv_writev(IO_TYPE_WRITE, search, iov, iovcnt, file_off);
+  return ORIG(pwritev)(fd, iov, iovcnt, file_off);
+}
+
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return _this_client->readv_writev(IO_TYPE_READ, search, iov, iovcnt, file_off);
+  return ORIG(preadv)(fd, iov, iovcnt, file_off);
+}
+
+/**
+ * Write at the file position: the range is claimed up front so that
+ * threads sharing an fd do not overlap; O_APPEND writes go to the end
+ * of file as the daemon sees it.
+ */
+static ssize_t positioned_write(int fd, uint64_t fuse_fh, const struct iovec *iov, int iovcnt)
+{
+  size_t  count = iov_length(iov, iovcnt);
+  off_t   file_off;
+  ssize_t ret;
+
+  if (_fd_flags[fd] & O_APPEND) {
+    if ((file_off = _this_client->file_size(fuse_fh)) < 0) return -1;
+    ret = _this_client->readv_writev(IO_TYPE_WRITE, fuse_fh, iov, iovcnt, file_off);
+    if (ret > 0) __atomic_store_n(&_fd_pos[fd], file_off + ret, __ATOMIC_RELAXED);
+    return ret;
+  }
+
+  file_off = __atomic_fetch_add(&_fd_pos[fd], count, __ATOMIC_RELAXED);
+  ret      = _this_client->readv_writev(IO_TYPE_WRITE, fuse_fh, iov, iovcnt, file_off);
+  if (ret < ssize_t(count))
+    __atomic_fetch_sub(&_fd_pos[fd], count - (ret > 0 ? ret : 0), __ATOMIC_RELAXED);
+  return ret;
+}
+
+static ssize_t positioned_read(int fd, uint64_t fuse_fh, const struct iovec *iov, int iovcnt)
+{
+  off_t   file_off = __atomic_load_n(&_fd_pos[fd], __ATOMIC_RELAXED);
+  ssize_t ret      = _this_client->readv_writev(IO_TYPE_READ, fuse_fh, iov, iovcnt, file_off);
+  if (ret > 0) __atomic_fetch_add(&_fd_pos[fd], ret, __ATOMIC_RELAXED);
+  return ret;
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID) {
+    struct iovec iov = {const_cast<void *>(buf), count};
+    return positioned_write(fd, search, &iov, 1);
+  }
+  return ORIG(write)(fd, buf, count);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID) {
+    struct iovec iov = {buf, count};
+    return positioned_read(fd, search, &iov, 1);
+  }
+  return ORIG(read)(fd, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return positioned_write(fd, search, iov, iovcnt);
+  return ORIG(writev)(fd, iov, iovcnt);
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return positioned_read(fd, search, iov, iovcnt);
+  return ORIG(readv)(fd, iov, iovcnt);
+}
+
+off_t lseek(int fd, off_t offset, int whence)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) == FUSE_FD_INVALID)
+    return ORIG(lseek)(fd, offset, whence);
+
+  off_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = __atomic_load_n(&_fd_pos[fd], __ATOMIC_RELAXED);
+      break;
+    case SEEK_END:
+      if ((base = _this_client->file_size(search)) < 0) return -1;
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  if (base + offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  __atomic_store_n(&_fd_pos[fd], base + offset, __ATOMIC_RELAXED);
+  return base + offset;
+}
+
+int fsync(int fd)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return _this_client->fsync(search);
+  return ORIG(fsync)(fd);
+}
+
+int fdatasync(int fd)
+{
+  int search;
+  if ((search = tracked_fuse_fh(fd)) != FUSE_FD_INVALID)
+    return _this_client->fsync(search);
+  return ORIG(fdatasync)(fd);
+}
+
+/**
+ * Large-file variants.  Built with _FILE_OFFSET_BITS=64, the
+ * definitions above are bound to the *64 symbols (lseek64, pread64,
+ * ...); export the plain names as well so that callers built either
+ * way are tracked.  off_t and off64_t are the same type here.
+ */
+static_assert(sizeof(off_t) == 8, "ustack client needs a 64-bit off_t");
+
+#ifdef __USE_FILE_OFFSET64
+#define USTACK_ALT_SYMBOL(name) #name
+#else
+#define USTACK_ALT_SYMBOL(name) #name "64"
+#endif
+
+extern "C" {
+off_t   ustack_alt_lseek(int fd, off_t offset, int whence) __asm__(USTACK_ALT_SYMBOL(lseek));
+ssize_t ustack_alt_pread(int fd, void *buf, size_t count, off_t file_off)
+    __asm__(USTACK_ALT_SYMBOL(pread));
+ssize_t ustack_alt_pwrite(int fd, const void *buf, size_t count, off_t file_off)
+    __asm__(USTACK_ALT_SYMBOL(pwrite));
+ssize_t ustack_alt_preadv(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+    __asm__(USTACK_ALT_SYMBOL(preadv));
+ssize_t ustack_alt_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+    __asm__(USTACK_ALT_SYMBOL(pwritev));
+}
+
+off_t ustack_alt_lseek(int fd, off_t offset, int whence) { return lseek(fd, offset, whence); }
+
+ssize_t ustack_alt_pread(int fd, void *buf, size_t count, off_t file_off)
+{
+  return pread(fd, buf, count, file_off);
+}
+
+ssize_t ustack_alt_pwrite(int fd, const void *buf, size_t count, off_t file_off)
+{
+  return pwrite(fd, buf, count, file_off);
+}
+
+ssize_t ustack_alt_preadv(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+{
+  return preadv(fd, iov, iovcnt, file_off);
+}
+
+ssize_t ustack_alt_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t file_off)
+{
+  return pwritev(fd, iov, iovcnt, file_off);
+}
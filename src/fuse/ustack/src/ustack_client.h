@@ -7,11 +7,16 @@
 #include <core/uipc.h>
 #include <core/xms.h>
 #include <dlfcn.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 
 #include "protocol_channel.h"
 #include "protocol_generated.h"
 #include "ustack_client_ioctl.h"
+#include "ustack_ring.h"
 
 /**
  * IO Memory mapper for client.
@@ -72,6 +77,13 @@ class IO_memory_allocator : private Core::Region_allocator {
     return reinterpret_cast<addr_t>(vaddr) - _virt_base;
   }
 
+  /* true if [vaddr, vaddr+n_bytes) lies in IO memory */
+  bool contains(const void *vaddr, size_t n_bytes) const
+  {
+    addr_t a = reinterpret_cast<addr_t>(vaddr);
+    return a >= _virt_base && a + n_bytes <= _virt_base + _size;
+  }
+
  private:
   addr_t  _virt_base;
   addr_t  _phys_base;
@@ -98,6 +110,7 @@ class Ustack_client : public Core::IPC_client {
     /* send shutdown message */
     send_shutdown();
 
+    if (_ring) delete _ring;
     for (auto &s : _shmem) delete s;
 
     if (_channel) delete _channel;
@@ -220,6 +233,96 @@ class Ustack_client : public Core::IPC_client {
     PMAJOR("[client]: got shared memory");
   }
 
+  /**
+   * Set up the submission/completion rings. Reads and writes go
+   * through the rings once this returns.
+   *
+   * @param depth Entries per ring, power of 2
+   */
+  void get_io_ring(uint32_t depth = IO_RING_DEPTH)
+  {
+    using namespace Protocol;
+    using namespace flatbuffers;
+    flatbuffers::FlatBufferBuilder fbb(256);
+
+    auto msg = CreateMessage(fbb, MessageType_IO_ring_request, getpid(),
+                             Element_ElementIORingRequest,
+                             CreateElementIORingRequest(fbb, depth).Union());
+
+    FinishMessageBuffer(fbb, msg);
+
+    assert(fbb.GetSize() > 0);
+    size_t reply_len = 0;
+    void * reply     = send_and_wait((const char *) fbb.GetBufferPointer(),
+                                fbb.GetSize(), &reply_len);
+
+    const Message *reply_msg = Protocol::GetMessage(reply);
+    if (reply_msg->type() != MessageType_IO_ring_reply ||
+        reply_msg->element_type() != Element_ElementMemoryReply)
+      throw General_exception("bad response to IO_ring_request");
+
+    std::string shmem_id =
+        reply_msg->element_as_ElementMemoryReply()->shmem_id()->str();
+    _shmem.push_back(new Core::UIPC::Shared_memory(shmem_id));
+
+    /* the daemon formats the rings after mapping the segment */
+    auto ring = new IO_ring(_shmem.back()->get_addr());
+    while (!ring->ready()) cpu_relax();
+    _ring = ring;
+    PMAJOR("[client]: IO rings connected (%s, depth %u)", shmem_id.c_str(),
+           _ring->depth());
+  }
+
+  /**
+   * Queue a read or write without waiting for it. Queued entries are
+   * handed to the daemon by submit_io().
+   *
+   * @param type IO_TYPE_READ or IO_TYPE_WRITE
+   * @param fuse_fh Fuse file handle
+   * @param buf Buffer in IO memory
+   * @param count Bytes to transfer
+   * @param file_off File offset
+   * @param user_data Returned in the completion
+   *
+   * @return S_OK or E_FULL if the submission ring is full
+   */
+  status_t post_io(int type, uint64_t fuse_fh, const void *buf, size_t count,
+                   off_t file_off, uint64_t user_data)
+  {
+    assert(_ring);
+    std::lock_guard<std::mutex> g(_sq_lock);
+    return fill_sqe(type, 0, fuse_fh, buf, count, file_off, user_data);
+  }
+
+  /* hand queued entries to the daemon */
+  void submit_io()
+  {
+    assert(_ring);
+    std::lock_guard<std::mutex> g(_sq_lock);
+    _ring->submit();
+  }
+
+  /**
+   * Collect completions of entries queued with post_io
+   *
+   * @param out Completions
+   * @param max Size of out
+   *
+   * @return Number of completions written to out
+   */
+  unsigned reap_io(IO_cqe *out, unsigned max)
+  {
+    assert(_ring);
+    std::lock_guard<std::mutex> g(_cq_lock);
+    drain_cq();
+    unsigned n = 0;
+    for (; n < max && !_completions.empty(); n++) {
+      out[n] = _completions.front();
+      _completions.pop_front();
+    }
+    return n;
+  }
+
   void send_command()
   {
     assert(_channel);
@@ -242,6 +345,7 @@ class Ustack_client : public Core::IPC_client {
    ********************************/
   void *malloc(size_t n_bytes)
   {
+    std::lock_guard<std::mutex> g(_iomem_lock);
     void *virt_addr;
     try {
       virt_addr = _iomem_allocator.malloc(n_bytes);
@@ -254,16 +358,137 @@ class Ustack_client : public Core::IPC_client {
     return virt_addr;
   }
 
-  void free(void *ptr) { _iomem_allocator.free(ptr); }
+  void free(void *ptr)
+  {
+    std::lock_guard<std::mutex> g(_iomem_lock);
+    _iomem_allocator.free(ptr);
+  }
+
+  /**
+   * Read or write consecutive file ranges through the rings. Buffers
+   * outside IO memory are staged through a small set of bounce
+   * buffers, so large requests run in bounded batches of segments.
+   *
+   * @param type IO_TYPE_READ or IO_TYPE_WRITE
+   * @param fuse_fh Fuse file handle
+   * @param iov Buffers
+   * @param iovcnt Number of buffers
+   * @param file_off File offset of the first buffer
+   *
+   * @return Bytes transferred (short at end of file or when IO memory
+   * runs out part way) or -1
+   */
+  ssize_t readv_writev(int type, uint64_t fuse_fh, const struct iovec *iov,
+                       int iovcnt, off_t file_off)
+  {
+    assert(_ring);
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+
+    const size_t         bounce_size = std::min(total, size_t(MAX_SEGMENT_SIZE));
+    std::vector<char *>  bounce; /* reused by every batch */
+    std::vector<Segment> segs;
+    segs.reserve(MAX_INFLIGHT_SEGMENTS); /* waiters must not move */
+
+    ssize_t ret  = 0;
+    bool    stop = false;
+    int     i    = 0;
+    size_t  pos  = 0; /* within iov[i] */
+
+    while (!stop && i < iovcnt) {
+      /* gather a batch */
+      segs.clear();
+      size_t used = 0;
+      while (i < iovcnt && segs.size() < MAX_INFLIGHT_SEGMENTS) {
+        if (pos == iov[i].iov_len) {
+          i++;
+          pos = 0;
+          continue;
+        }
+        Segment seg;
+        seg.user = static_cast<char *>(iov[i].iov_base) + pos;
+        seg.len  = std::min(iov[i].iov_len - pos, size_t(MAX_SEGMENT_SIZE));
+        seg.io   = seg.user;
+        seg.off  = file_off;
+        if (!_iomem_allocator.contains(seg.user, seg.len)) {
+          if (used == bounce.size()) {
+            char *b = static_cast<char *>(malloc(bounce_size));
+            if (!b) break; /* go with what we have */
+            bounce.push_back(b);
+          }
+          seg.io = bounce[used++];
+          if (type == IO_TYPE_WRITE) memcpy(seg.io, seg.user, seg.len);
+        }
+        segs.push_back(seg);
+        pos += seg.len;
+        file_off += seg.len;
+      }
+
+      if (segs.empty()) { /* no IO memory for even one bounce buffer */
+        if (ret == 0) ret = -1;
+        break;
+      }
+
+      for (size_t k = 0; k < segs.size();) {
+        {
+          std::lock_guard<std::mutex> g(_sq_lock);
+          for (; k < segs.size(); k++) {
+            auto &seg = segs[k];
+            if (fill_sqe(type, IO_SQE_FLAG_WAITER, fuse_fh, seg.io, seg.len,
+                         seg.off, reinterpret_cast<uint64_t>(&seg.waiter)) != S_OK)
+              break;
+          }
+          _ring->submit();
+        }
+        if (k < segs.size()) {
+          poll_cq(); /* ring full; make room */
+          cpu_relax();
+        }
+      }
+
+      /* every segment is waited for before its bounce buffer is reused */
+      for (auto &seg : segs) {
+        wait(seg.waiter);
+        if (stop) continue;
+        if (seg.waiter.result < 0) {
+          ret  = -1;
+          stop = true;
+          continue;
+        }
+        if (type == IO_TYPE_READ && seg.io != seg.user)
+          memcpy(seg.user, seg.io, seg.waiter.result);
+        ret += seg.waiter.result;
+        stop = size_t(seg.waiter.result) < seg.len;
+      }
+    }
+
+    for (auto b : bounce) free(b);
+
+    if (ret < 0) PERR("[%s]: ustack io failed", __func__);
+    return ret;
+  }
+
+  /* persist written data of a file */
+  int fsync(uint64_t fuse_fh)
+  {
+    return sync_cmd(IO_TYPE_FSYNC, fuse_fh) < 0 ? -1 : 0;
+  }
+
+  /* file size as seen by the daemon, or -1 */
+  off_t file_size(uint64_t fuse_fh) { return sync_cmd(IO_TYPE_GETSIZE, fuse_fh); }
 
   /**
    * File write and read
-   * TODO: intercept posix ops
    *
    * the message will be like(fd, phys(buf), count)
    */
   ssize_t write(int fuse_fh, const void *buf, size_t count, off_t file_off)
   {
+    if (_ring) {
+      struct iovec iov = {const_cast<void *>(buf), count};
+      return readv_writev(IO_TYPE_WRITE, fuse_fh, &iov, 1, file_off);
+    }
+
     int ret = -1;
     /* ustack tracked file */
     assert(_channel);
@@ -301,6 +526,11 @@ class Ustack_client : public Core::IPC_client {
 
   ssize_t read(int fuse_fh, void *buf, size_t count, off_t file_off)
   {
+    if (_ring) {
+      struct iovec iov = {buf, count};
+      return readv_writev(IO_TYPE_READ, fuse_fh, &iov, 1, file_off);
+    }
+
     int ret = -1;
     /* ustack tracked file */
     assert(_channel);
@@ -343,11 +573,107 @@ class Ustack_client : public Core::IPC_client {
   }
   */
 
+ private:
+  static constexpr uint32_t IO_RING_DEPTH = 1024;
+
+  static constexpr size_t   MAX_SEGMENT_SIZE = MB(1); /*< largest single ring entry */
+  static constexpr size_t   MAX_INFLIGHT_SEGMENTS = 16; /*< per readv_writev batch */
+
+  /* completion slot of a thread blocked in read/write */
+  struct Waiter {
+    std::atomic<bool> done{false};
+    int64_t           result = -1;
+  };
+
+  struct Segment {
+    char * user; /*< caller's buffer */
+    char * io;   /*< buffer in IO memory; user or a bounce buffer */
+    size_t len;
+    off_t  off;
+    Waiter waiter;
+
+    Segment() = default;
+    Segment(const Segment &s) : user(s.user), io(s.io), len(s.len), off(s.off) {}
+  };
+
+  status_t fill_sqe(int type, uint8_t flags, uint64_t fuse_fh, const void *buf,
+                    size_t count, off_t file_off, uint64_t user_data)
+  {
+    if (count > UINT32_MAX) PWRN("32bit field for sz_bytes is not enough");
+
+    IO_sqe *sqe = _ring->get_sqe();
+    if (!sqe) return E_FULL;
+    sqe->type      = type;
+    sqe->flags     = flags;
+    sqe->sz_bytes  = count;
+    sqe->offset    = buf ? _iomem_allocator.get_offset(buf) : 0;
+    sqe->file_off  = file_off;
+    sqe->fuse_fh   = fuse_fh;
+    sqe->user_data = user_data;
+    return S_OK;
+  }
+
+  /* caller holds _cq_lock */
+  void drain_cq()
+  {
+    while (IO_cqe *cqe = _ring->peek_cqe()) {
+      if (cqe->flags & IO_SQE_FLAG_WAITER) {
+        auto w    = reinterpret_cast<Waiter *>(cqe->user_data);
+        w->result = cqe->result;
+        w->done.store(true, std::memory_order_release);
+      }
+      else
+        _completions.push_back(*cqe);
+      _ring->cqe_seen();
+    }
+  }
+
+  /* any thread may reap; the others keep spinning on their own slot */
+  void poll_cq()
+  {
+    std::unique_lock<std::mutex> g(_cq_lock, std::try_to_lock);
+    if (g.owns_lock()) drain_cq();
+  }
+
+  void wait(Waiter &w)
+  {
+    while (!w.done.load(std::memory_order_acquire)) {
+      poll_cq();
+      cpu_relax();
+    }
+  }
+
+  /* a request without data; returns the completion result */
+  int64_t sync_cmd(int type, uint64_t fuse_fh)
+  {
+    assert(_ring);
+    Waiter w;
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> g(_sq_lock);
+        if (fill_sqe(type, IO_SQE_FLAG_WAITER, fuse_fh, nullptr, 0, 0,
+                     reinterpret_cast<uint64_t>(&w)) == S_OK) {
+          _ring->submit();
+          break;
+        }
+      }
+      poll_cq(); /* ring full; make room */
+      cpu_relax();
+    }
+    wait(w);
+    return w.result;
+  }
+
  private:
   IO_memory_allocator _iomem_allocator;  // IO memory allocated from server and
                                          // mmaped to this client
   std::vector<Core::UIPC::Shared_memory *> _shmem;
   Core::UIPC::Channel *                    _channel = nullptr;
+  IO_ring *                                _ring    = nullptr;
+  std::mutex                               _iomem_lock;
+  std::mutex                               _sq_lock;
+  std::mutex                               _cq_lock;
+  std::deque<IO_cqe>                       _completions; /* reaped, not yet returned */
 };  // end of UStack_Client
 
 #endif  // __USTACK_CLIENT_H__
@@ -27,7 +27,7 @@
     void *buf; //the mapped io mem
 
     // TODO: need to control offset 
-    auto iomem_list = _iomem_map[client_id] ;
+    auto& iomem_list = _iomem_map[client_id];
     if(iomem_list.empty()){
       PERR("iomem for pid %d is empty", client_id);
       return -1;
@@ -56,11 +56,11 @@
     return S_OK;
   }
 
-  status_t Ustack::do_kv_read(pid_t client_id, uint64_t fuse_fh, size_t offset, size_t io_sz, size_t file_off){
+  status_t Ustack::do_kv_read(pid_t client_id, uint64_t fuse_fh, size_t offset, size_t io_sz, size_t file_off, size_t * out_bytes){
     PDBG("[%s]: fuse_fh=%lu, offset=%lu, io_sz=%lu, file_off=%lu", __func__, fuse_fh, offset, io_sz, file_off);
     void *buf; //the mapped io mem
 
-    auto iomem_list = _iomem_map[client_id] ;
+    auto& iomem_list = _iomem_map[client_id];
     if(iomem_list.empty()){
       PERR("iomem for pid %d is empty", client_id);
       return -1;
@@ -76,10 +76,8 @@
     PDBG("mapped to virtual address %p", buf);
 
     size_t file_size = _kv_ustack_info->get_item_size(fuse_fh);
-    if(io_sz > file_size){
-      PERR("write size larger than file size");
-      return -1;
-    }
+    io_sz = file_off < file_size ? std::min(io_sz, file_size - file_off) : 0;
+    if(out_bytes) *out_bytes = io_sz;
 
     if(io_sz >0){
       _kv_ustack_info->read(fuse_fh, buf, io_sz, file_off);
@@ -90,3 +88,31 @@
     return S_OK;
   }
 
+  int64_t Ustack::do_ring_io(pid_t client_id, const IO_sqe& sqe){
+    size_t bytes;
+
+    try {
+      switch(sqe.type) {
+      case IO_TYPE_WRITE:
+        if(S_OK == do_kv_write(client_id, sqe.fuse_fh, sqe.offset, sqe.sz_bytes, sqe.file_off))
+          return sqe.sz_bytes;
+        break;
+      case IO_TYPE_READ:
+        if(S_OK == do_kv_read(client_id, sqe.fuse_fh, sqe.offset, sqe.sz_bytes, sqe.file_off, &bytes))
+          return bytes;
+        break;
+      case IO_TYPE_FSYNC:
+        if(S_OK == _kv_ustack_info->fsync_file(sqe.fuse_fh))
+          return 0;
+        break;
+      case IO_TYPE_GETSIZE:
+        return _kv_ustack_info->get_item_size(sqe.fuse_fh);
+      default:
+        PWRN("ring worker: wrong io type (%d)", sqe.type);
+      }
+    }
+    catch(...) {
+      PWRN("ring worker: io on fuse_fh %lu failed", sqe.fuse_fh);
+    }
+    return -1;
+  }
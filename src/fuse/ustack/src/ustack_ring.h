@@ -0,0 +1,226 @@
+#ifndef __USTACK_RING_H__
+#define __USTACK_RING_H__
+
+#include <common/utils.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+/**
+ * Submission/completion ring pair for intercepted I/O.
+ *
+ * The rings live in a shared memory segment mapped by the client and
+ * the daemon. The client is the only producer of submission entries
+ * and the only consumer of completion entries; the daemon is the
+ * reverse. Indices are free running and masked with depth-1.
+ *
+ * The daemon polls the submission ring and sleeps on the submission
+ * tail once it has been idle for a while; it sets IO_RING_NEED_WAKEUP
+ * first, and a client that sees the flag after publishing entries
+ * wakes it.
+ */
+
+enum {
+  IO_RING_MAGIC        = 0x474e4952, /* 'RING' */
+  IO_RING_NEED_WAKEUP  = 0x1,
+  IO_SQE_FLAG_WAITER   = 0x1, /*< user_data is a waiting thread's slot */
+};
+
+struct IO_sqe {
+  uint8_t  type; /*< IO_TYPE_xxx */
+  uint8_t  flags;
+  uint16_t resvd;
+  uint32_t sz_bytes;
+  uint64_t offset; /*< offset of the buffer in IO memory */
+  uint64_t file_off;
+  uint64_t fuse_fh;
+  uint64_t user_data;
+};
+
+struct IO_cqe {
+  uint64_t user_data;
+  int64_t  result; /*< bytes transferred (or file size) or -1 */
+  uint32_t flags;  /*< flags of the submission */
+  uint32_t resvd;
+};
+
+class IO_ring {
+ public:
+  /* bytes needed for a ring pair of the given depth */
+  static size_t size_bytes(uint32_t depth)
+  {
+    return sizeof(Header) + depth * (sizeof(IO_sqe) + sizeof(IO_cqe));
+  }
+
+  /**
+   * Attach to a ring pair
+   *
+   * @param base Start of the shared segment
+   */
+  explicit IO_ring(void *base)
+      : _hdr(static_cast<Header *>(base)),
+        _sq(reinterpret_cast<IO_sqe *>(_hdr + 1)),
+        _cq(nullptr)
+  {
+  }
+
+  /**
+   * Initialize an empty ring pair; called by the daemon once the
+   * segment is mapped. The magic is written last so that the client
+   * can wait for it.
+   *
+   * @param depth Entries per ring, power of 2
+   */
+  void format(uint32_t depth)
+  {
+    assert(depth && !(depth & (depth - 1)));
+    _hdr->depth = depth;
+    _cq         = reinterpret_cast<IO_cqe *>(_sq + depth);
+    _hdr->sq_head.store(0, std::memory_order_relaxed);
+    _hdr->sq_tail.store(0, std::memory_order_relaxed);
+    _hdr->cq_head.store(0, std::memory_order_relaxed);
+    _hdr->cq_tail.store(0, std::memory_order_relaxed);
+    _hdr->flags.store(0, std::memory_order_relaxed);
+    _hdr->magic.store(IO_RING_MAGIC, std::memory_order_release);
+  }
+
+  /* true once format() has completed on the other side */
+  bool ready()
+  {
+    if (_hdr->magic.load(std::memory_order_acquire) != IO_RING_MAGIC)
+      return false;
+    _cq = reinterpret_cast<IO_cqe *>(_sq + _hdr->depth);
+    return true;
+  }
+
+  uint32_t depth() const { return _hdr->depth; }
+
+  /********************************
+   * Client side
+   ********************************/
+
+  /* next free submission entry, or nullptr if the ring is full */
+  IO_sqe *get_sqe()
+  {
+    uint32_t tail = _hdr->sq_tail.load(std::memory_order_relaxed);
+    if (tail + _pending - _hdr->sq_head.load(std::memory_order_acquire) >=
+        _hdr->depth)
+      return nullptr;
+    return &_sq[(tail + _pending++) & (_hdr->depth - 1)];
+  }
+
+  /* publish entries filled since the last submit; wake the daemon if needed */
+  void submit()
+  {
+    if (!_pending) return;
+    _hdr->sq_tail.fetch_add(_pending, std::memory_order_seq_cst);
+    _pending = 0;
+    if (_hdr->flags.load(std::memory_order_seq_cst) & IO_RING_NEED_WAKEUP)
+      futex(&_hdr->sq_tail, FUTEX_WAKE, 1, nullptr);
+  }
+
+  /* oldest unconsumed completion, or nullptr */
+  IO_cqe *peek_cqe()
+  {
+    uint32_t head = _hdr->cq_head.load(std::memory_order_relaxed);
+    if (head == _hdr->cq_tail.load(std::memory_order_acquire)) return nullptr;
+    return &_cq[head & (_hdr->depth - 1)];
+  }
+
+  void cqe_seen() { _hdr->cq_head.fetch_add(1, std::memory_order_release); }
+
+  /********************************
+   * Daemon side
+   ********************************/
+
+  /**
+   * Take up to max submissions, bounded by free completion slots
+   *
+   * @param out_first Index of the first submission
+   *
+   * @return Number of submissions available
+   */
+  uint32_t peek_sqes(uint32_t &out_first, uint32_t max)
+  {
+    uint32_t head  = _hdr->sq_head.load(std::memory_order_relaxed);
+    uint32_t n     = _hdr->sq_tail.load(std::memory_order_acquire) - head;
+    uint32_t space = _hdr->depth - (_hdr->cq_tail.load(std::memory_order_relaxed) -
+                                    _hdr->cq_head.load(std::memory_order_acquire));
+    out_first = head;
+    return std::min(std::min(n, space), max);
+  }
+
+  const IO_sqe &sqe(uint32_t index) const
+  {
+    return _sq[index & (_hdr->depth - 1)];
+  }
+
+  /* post a completion; visible after complete() */
+  void post_cqe(uint64_t user_data, int64_t result, uint32_t flags)
+  {
+    auto &cqe = _cq[(_hdr->cq_tail.load(std::memory_order_relaxed) + _posted++) &
+                    (_hdr->depth - 1)];
+    cqe.user_data = user_data;
+    cqe.result    = result;
+    cqe.flags     = flags;
+  }
+
+  /* retire n submissions and publish the completions posted for them */
+  void complete(uint32_t n)
+  {
+    _hdr->cq_tail.fetch_add(_posted, std::memory_order_release);
+    _hdr->sq_head.fetch_add(n, std::memory_order_release);
+    _posted = 0;
+  }
+
+  /**
+   * Sleep until the client submits or the timeout expires
+   *
+   * @param timeout_usec Timeout in microseconds
+   */
+  void wait_for_submission(unsigned timeout_usec)
+  {
+    uint32_t tail = _hdr->sq_tail.load(std::memory_order_relaxed);
+    _hdr->flags.fetch_or(IO_RING_NEED_WAKEUP, std::memory_order_seq_cst);
+    if (_hdr->sq_tail.load(std::memory_order_seq_cst) == tail) {
+      struct timespec ts = {0, long(timeout_usec) * 1000};
+      futex(&_hdr->sq_tail, FUTEX_WAIT, tail, &ts);
+    }
+    _hdr->flags.fetch_and(~uint32_t(IO_RING_NEED_WAKEUP), std::memory_order_relaxed);
+  }
+
+ private:
+  struct Header {
+    std::atomic<uint32_t> magic;
+    uint32_t              depth;
+    alignas(64) std::atomic<uint32_t> sq_tail; /*< written by client */
+    alignas(64) std::atomic<uint32_t> sq_head; /*< written by daemon */
+    alignas(64) std::atomic<uint32_t> cq_tail; /*< written by daemon */
+    alignas(64) std::atomic<uint32_t> cq_head; /*< written by client */
+    alignas(64) std::atomic<uint32_t> flags;
+  } __attribute__((aligned(64)));
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be a plain 32-bit integer");
+
+  static long futex(std::atomic<uint32_t> *addr, int op, uint32_t val,
+                    const struct timespec *ts)
+  {
+    /* shared, not FUTEX_PRIVATE: the word is mapped by two processes */
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), op, val, ts,
+                   nullptr, 0);
+  }
+
+  Header * _hdr;
+  IO_sqe * _sq;
+  IO_cqe * _cq;
+  uint32_t _pending = 0; /* client: entries filled but not submitted */
+  uint32_t _posted  = 0; /* daemon: completions not yet published */
+};
+
+#endif  // __USTACK_RING_H__
@@ -0,0 +1,118 @@
+#ifndef __COMMON_HDR_HISTOGRAM_H__
+#define __COMMON_HDR_HISTOGRAM_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Log-linear (HDR style) latency histogram. Values below
+ * SUB_BUCKET_COUNT are counted exactly; each power-of-two range above
+ * that is split into SUB_BUCKET_COUNT/2 linear buckets, which bounds
+ * the relative error to about 0.1% (three significant digits).
+ * Values are expected in nanoseconds and saturate at 2^MAX_VALUE_BITS.
+ */
+class HdrHistogram
+{
+  static constexpr unsigned SUB_BUCKET_BITS = 11;
+  static constexpr unsigned MAX_VALUE_BITS = 40; /* ~18 minutes in ns */
+  static constexpr std::uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+  static constexpr std::uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+  static constexpr std::uint64_t MAX_VALUE = (1ULL << MAX_VALUE_BITS) - 1;
+
+  std::vector<std::uint64_t> _counts;
+  std::uint64_t _total;
+  std::uint64_t _min;
+  std::uint64_t _max;
+
+  static std::size_t index_of(std::uint64_t v)
+  {
+    if ( v < SUB_BUCKET_COUNT )
+    {
+      return v;
+    }
+    const unsigned msb = 63U - unsigned(__builtin_clzll(v));
+    const unsigned shift = msb - (SUB_BUCKET_BITS - 1);
+    return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + ((v >> shift) - SUB_BUCKET_HALF);
+  }
+
+  /* highest value that maps to the same bucket as index i */
+  static std::uint64_t highest_equivalent(std::size_t i)
+  {
+    if ( i < SUB_BUCKET_COUNT )
+    {
+      return i;
+    }
+    i -= SUB_BUCKET_COUNT;
+    const unsigned shift = unsigned(i / SUB_BUCKET_HALF) + 1;
+    const std::uint64_t sub = (i % SUB_BUCKET_HALF) + SUB_BUCKET_HALF;
+    return ((sub + 1) << shift) - 1;
+  }
+
+public:
+  HdrHistogram()
+    : _counts(index_of(MAX_VALUE) + 1, 0)
+    , _total(0)
+    , _min(UINT64_MAX)
+    , _max(0)
+  {
+  }
+
+  void record(std::uint64_t value)
+  {
+    value = std::min(value, MAX_VALUE);
+    ++_counts[index_of(value)];
+    ++_total;
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+  }
+
+  void add(const HdrHistogram &other)
+  {
+    for ( std::size_t i = 0; i != _counts.size(); ++i )
+    {
+      _counts[i] += other._counts[i];
+    }
+    _total += other._total;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+  }
+
+  void reset()
+  {
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _total = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+  }
+
+  std::uint64_t count() const { return _total; }
+  std::uint64_t min() const { return _total ? _min : 0; }
+  std::uint64_t max() const { return _max; }
+
+  /* value at or below which pct percent of the recorded values fall */
+  std::uint64_t percentile(double pct) const
+  {
+    if ( _total == 0 )
+    {
+      return 0;
+    }
+    auto target = std::uint64_t(std::ceil(std::min(pct, 100.0) / 100.0 * double(_total)));
+    target = std::max(target, std::uint64_t(1));
+
+    std::uint64_t seen = 0;
+    for ( std::size_t i = 0; i != _counts.size(); ++i )
+    {
+      seen += _counts[i];
+      if ( seen >= target )
+      {
+        return std::min(highest_equivalent(i), _max);
+      }
+    }
+    return _max;
+  }
+};
+
+#endif
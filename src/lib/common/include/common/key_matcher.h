@@ -0,0 +1,87 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __COMMON_KEY_MATCHER_H__
+#define __COMMON_KEY_MATCHER_H__
+
+#include <memory>
+#include <string>
+
+namespace Common
+{
+/**
+ * Compiled key search expression; compile once per search and reuse
+ * for every key compared.
+ *
+ * Regular expressions (ECMAScript syntax, matched against the whole key
+ * as std::regex_match does) are compiled to an NFA and run as a lazily
+ * built DFA, one table lookup per key byte. Expressions a DFA cannot
+ * express (back-references, assertions, POSIX classes) fall back to
+ * std::regex. Invalid expressions throw std::regex_error.
+ *
+ * Every key that can match starts with prefix(), so an ordered index
+ * can seek to the prefix and stop once keys no longer start with it.
+ *
+ * match() updates the DFA cache and is not thread safe.
+ */
+class Key_matcher {
+ public:
+  enum class Type {
+    EXACT,  /*< key equals expression */
+    PREFIX, /*< key starts with expression */
+    REGEX,  /*< key matches regular expression */
+  };
+
+  Key_matcher(Type type, const std::string &expression);
+  ~Key_matcher();
+
+  Key_matcher(const Key_matcher &) = delete;
+  Key_matcher &operator=(const Key_matcher &) = delete;
+
+  /**
+   * Test a key
+   *
+   * @param key Key
+   *
+   * @return True if the key matches
+   */
+  bool match(const std::string &key) const;
+
+  /**
+   * Literal that every matching key starts with; may be empty
+   *
+   */
+  const std::string &prefix() const { return _prefix; }
+
+  /**
+   * True if the only key that can match is prefix()
+   *
+   */
+  bool exact() const { return _exact; }
+
+  Type type() const { return _type; }
+
+  const std::string &expression() const { return _expression; }
+
+ private:
+  struct Impl;
+
+  Type                  _type;
+  std::string           _expression;
+  std::string           _prefix;
+  bool                  _exact = false;
+  std::unique_ptr<Impl> _impl; /* regex only */
+};
+}  // namespace Common
+
+#endif  // __COMMON_KEY_MATCHER_H__
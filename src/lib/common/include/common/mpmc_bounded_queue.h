@@ -64,7 +64,11 @@
 #include <atomic>
 
 #include <common/utils.h>
-#include <semaphore.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <climits>
 #include <sstream>
 #include "memory.h"
 
@@ -328,48 +332,121 @@ class Mpmc_bounded_lfq {
   node_t *_buffer;
 };
 
+/**
+ * Spin-then-sleep wait primitive. Waiters poll a condition with
+ * cpu_relax() for a bounded number of iterations and then sleep on a
+ * futex. Wakers only make the futex system call when somebody is
+ * actually sleeping. The futex is not process-private, so an event
+ * placed in shared memory works across processes.
+ *
+ */
+class Futex_event {
+ public:
+  Futex_event() : _seq(0), _waiters(0) {}
+
+  /**
+   * Wait for a condition
+   *
+   * @param ready Condition; may have side effects (e.g. a dequeue)
+   * @param spin_count Polls before sleeping
+   * @param timeout_usec Longest sleep; 0 never sleeps
+   *
+   * @return Last result of ready()
+   */
+  template <typename F>
+  bool wait(F ready, unsigned spin_count, unsigned timeout_usec) {
+    for (unsigned i = 0; i < spin_count; i++) {
+      if (ready()) return true;
+      cpu_relax();
+    }
+
+    if (timeout_usec == 0) return ready();
+
+    uint32_t seq = _seq.load(std::memory_order_acquire);
+    _waiters.fetch_add(1, std::memory_order_seq_cst);
+    /* re-check after registering: a waker that missed us saw our update */
+    bool result = ready();
+    if (!result) {
+      struct timespec ts = {long(timeout_usec / 1000000),
+                            long(timeout_usec % 1000000) * 1000};
+      futex(FUTEX_WAIT, seq, &ts);
+      result = ready();
+    }
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  /**
+   * Wake one sleeping waiter, if any; call after making the condition true
+   *
+   */
+  void wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_relaxed) == 0) return;
+    _seq.fetch_add(1, std::memory_order_release);
+    futex(FUTEX_WAKE, 1, nullptr);
+  }
+
+  /**
+   * Wake all sleeping waiters
+   *
+   */
+  void wake_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _seq.fetch_add(1, std::memory_order_release);
+    futex(FUTEX_WAKE, INT_MAX, nullptr);
+  }
+
+ private:
+  long futex(int op, uint32_t val, const struct timespec *ts) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&_seq), op, val, ts,
+                   nullptr, 0);
+  }
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be a plain 32-bit integer");
+
+  std::atomic<uint32_t> _seq __cacheline_aligned;
+  std::atomic<uint32_t> _waiters;
+};
+
 /**
  * Multi-producer, multi-consumer class based on Vyukov's algorithm.
  * This version implements a sleep on the consumer when the queue is
- * empty.
+ * empty: consumers spin for a while and then sleep on a futex.
+ * Producers only make a system call when a consumer is asleep.
  *
  */
 template <typename T>
 class Mpmc_bounded_lfq_sleeping {
- private:
-  enum ConsumerState {
-    SLEEPING = 1,
-    AWAKE = 2,
-  };
-
-  static const int RETRY_THRESHOLD = 100000;  // # of retries before sleeping
-  static const long TIMEOUT_NS = 1000000;     // 1ms
+ public:
+  static constexpr unsigned DEFAULT_SPIN_COUNT = 4096; /* pause iterations */
+  static constexpr unsigned TIMEOUT_USEC = 1000;       /* 1ms */
 
+ private:
   Mpmc_bounded_lfq<T> queue_;
-  bool exit_;
-  sem_t sem_;
-  volatile ConsumerState consumer_state_;
+  volatile bool exit_;
+  Futex_event not_empty_;
 
  public:
   Mpmc_bounded_lfq_sleeping(size_t size, Base_memory_allocator *allocator)
-      : queue_(size, allocator), exit_(false), consumer_state_(AWAKE) {
-    sem_init(&sem_, 1, 0);  // shared, 0 count
-  }
+      : queue_(size, allocator), exit_(false) {}
 
+  /**
+   * Constructor requiring buffer address
+   *
+   * @param size Size of queue in elements.
+   * @param buf_addr The node array starting address.
+   *
+   */
   Mpmc_bounded_lfq_sleeping(size_t size, void *buf_addr)
-      : queue_(size, buf_addr), exit_(false), consumer_state_(AWAKE) {
-    sem_init(&sem_, 1, 0);  // shared, 0 count
-  }
+      : queue_(size, buf_addr), exit_(false) {}
 
   /**
-   * Destructor. Clears up waker thread.
+   * Destructor. Releases sleeping threads.
    *
    */
-  ~Mpmc_bounded_lfq_sleeping() {
-    exit_ = true;
-    sem_post(&sem_);
-    sem_destroy(&sem_);
-  }
+  ~Mpmc_bounded_lfq_sleeping() { exit_threads(); }
 
   /**
    * Enqueue an item
@@ -379,9 +456,9 @@ class Mpmc_bounded_lfq_sleeping {
    * @return True if enqueued OK. False if blocked, or full.
    */
   bool enqueue(const T &elem) {
-    if (consumer_state_ == SLEEPING) sem_post(&sem_);  // wake up waker thread
-
-    return queue_.enqueue(elem); /* we don't sleep on the producer side */
+    if (!queue_.enqueue(elem)) return false; /* we don't sleep on the producer side */
+    not_empty_.wake();
+    return true;
   }
 
   /**
@@ -390,148 +467,93 @@ class Mpmc_bounded_lfq_sleeping {
    *
    * @param data Item to copy-dequeue to.
    *
-   * @return Return true on success. False on empty queue.
+   * @return Return true on success. False if exit_threads was called.
    */
   bool dequeue(T &elem) {
-    unsigned retries = 0;
-    while (!queue_.dequeue(elem)) {
-      retries++;
-      if (retries < RETRY_THRESHOLD) continue;
-
-      // go to sleep
-      consumer_state_ = SLEEPING;
-
-      // timed semaphore to avoid race-condition
-      {
-        struct timespec ts;
-        if (clock_gettime(CLOCK_REALTIME, &ts) == -1) {
-          PERR("bad clock_gettime call");
-          assert(0);
-          return false;
-        }
-        ts.tv_nsec += TIMEOUT_NS;  // lets not worry about wrap arounds, shorter
-                                   // timeout is ok
-
-        int s;
-        while ((s = sem_timedwait(&sem_, &ts)) == -1 && errno == EINTR)
-          continue; /* Restart if interrupted by handler */
-      }
-
+    while (!dequeue_wait(elem, DEFAULT_SPIN_COUNT, TIMEOUT_USEC)) {
       if (exit_) return false;
     }
-    consumer_state_ = AWAKE;
     return true;
   }
 
+  /**
+   * Dequeue an object, waiting a bounded time for one to arrive.
+   *
+   * @param elem Item to copy-dequeue to.
+   * @param spin_count Polls before sleeping
+   * @param timeout_usec Longest sleep; 0 never sleeps
+   *
+   * @return True on success. False on empty queue.
+   */
+  bool dequeue_wait(T &elem, unsigned spin_count, unsigned timeout_usec) {
+    bool got = false;
+    not_empty_.wait([&]() { return (got = queue_.dequeue(elem)) || exit_; },
+                    spin_count, timeout_usec);
+    return got;
+  }
+
   /**
    * Signal deque threads to return even without element
    *
    */
   void exit_threads() {
     exit_ = true;
-    sem_post(&sem_);
+    not_empty_.wake_all();
   }
 
   inline bool empty() { return queue_.empty(); }
 
   static size_t memory_footprint(size_t queue_size) {
-    return sizeof(Common::Mpmc_bounded_lfq<void *>) +
-           (sizeof(Common::Mpmc_bounded_lfq<void *>::aligned_node_t) *
-            queue_size);
+    return sizeof(Mpmc_bounded_lfq_sleeping<T>) +
+           (sizeof(typename Mpmc_bounded_lfq<T>::aligned_node_t) * queue_size);
   }
 };
 
 /**
  * Multi-producer, multi-consumer class based on Vyukov's algorithm.  This
- * version
- * implements a sleep on the consumer when the queue is empty.
+ * version implements a spin-then-sleep wait on the consumer when the
+ * queue is empty and on the producer when it is full.
  *
  */
 template <typename T>
 class Mpmc_bounded_lfq_sleeping_dual {
- private:
-  enum ThreadState {
-    SLEEPING = 1,
-    AWAKE = 2,
-  };
-
-  static const int RETRY_THRESHOLD = 1000;  // # of retries before dual_sleeping
-  static const long TIMEOUT_NS = 10000000;  // 10ms
+ public:
+  static constexpr unsigned DEFAULT_SPIN_COUNT = 1000; /* pause iterations */
+  static constexpr unsigned TIMEOUT_USEC = 10000;      /* 10ms */
 
+ private:
   Mpmc_bounded_lfq<T> queue_;
-  bool exit_;
-
-  sem_t consumer_sem_;
-  sem_t producer_sem_;
-  ThreadState consumer_state_;
-  ThreadState producer_state_;
+  volatile bool exit_;
+  Futex_event not_empty_;
+  Futex_event not_full_;
 
  public:
   Mpmc_bounded_lfq_sleeping_dual(size_t size, Base_memory_allocator *allocator)
-      : queue_(size, allocator),
-        exit_(false),
-        consumer_state_(AWAKE),
-        producer_state_(AWAKE) {
-    sem_init(&consumer_sem_, 1, 0);  // shared, 0 count
-    sem_init(&producer_sem_, 1, 0);  // shared, 0 count
-  }
+      : queue_(size, allocator), exit_(false) {}
 
   Mpmc_bounded_lfq_sleeping_dual(size_t size, void *buf_addr)
-      : queue_(size, buf_addr),
-        exit_(false),
-        consumer_state_(AWAKE),
-        producer_state_(AWAKE) {
-    sem_init(&consumer_sem_, 1, 0);  // shared, 0 count
-    sem_init(&producer_sem_, 1, 0);  // shared, 0 count
-  }
+      : queue_(size, buf_addr), exit_(false) {}
 
   /**
-   * Destructor. Clears up waker thread.
+   * Destructor. Releases sleeping threads.
    *
    */
-  ~Mpmc_bounded_lfq_sleeping_dual() {
-    exit_ = true;
-    sem_post(&producer_sem_);
-    sem_post(&consumer_sem_);
-    sem_destroy(&producer_sem_);
-    sem_destroy(&consumer_sem_);
-  }
+  ~Mpmc_bounded_lfq_sleeping_dual() { exit_threads(); }
 
   /**
-   * Enqueue an item
+   * Enqueue an item. When the queue is full, the calling thread sleeps
+   * until there is space.
    *
    * @param data Item to enqueue
    *
-   * @return True if enqueued OK. False if blocked, or full.
+   * @return True if enqueued OK. False if exit_threads was called.
    */
   bool enqueue(T &elem) {
-    if (consumer_state_ == SLEEPING) sem_post(&consumer_sem_);
-
-    unsigned retries = 0;
-    while (!queue_.enqueue(elem)) {
-      if (retries < RETRY_THRESHOLD) {
-        cpu_relax();
-        continue;
-      }
-
-      producer_state_ = SLEEPING;
-
-      // timed semaphore to avoid race-condition
-      {
-        struct timespec ts;
-        if (clock_gettime(CLOCK_REALTIME, &ts) == -1) {
-          PERR("bad clock_gettime call");
-          assert(0);
-          return false;
-        }
-        ts.tv_nsec += TIMEOUT_NS;  // lets not worry about wrap arounds, shorter
-                                   // timeout is ok
-
-        int s;
-        while ((s = sem_timedwait(&producer_sem_, &ts)) == -1 && errno == EINTR)
-          continue; /* Restart if interrupted by handler */
-      }
+    while (!not_full_.wait([&]() { return queue_.enqueue(elem); },
+                           DEFAULT_SPIN_COUNT, TIMEOUT_USEC)) {
+      if (exit_) return false;
     }
+    not_empty_.wake();
     return true;
   }
 
@@ -541,40 +563,14 @@ class Mpmc_bounded_lfq_sleeping_dual {
    *
    * @param data Item to copy-dequeue to.
    *
-   * @return Return true on success. False on empty queue.
+   * @return Return true on success. False if exit_threads was called.
    */
   bool dequeue(T &elem) {
-    if (producer_state_ == SLEEPING) {
-      sem_post(&producer_sem_);  // wake up waker thread
-    }
-
-    unsigned retries = 0;
-    while (!queue_.dequeue(elem)) {
-      retries++;
-      if (retries < RETRY_THRESHOLD) continue;
-
-      // go to sleep
-      consumer_state_ = SLEEPING;
-
-      // timed semaphore to avoid race-condition
-      {
-        struct timespec ts;
-        if (clock_gettime(CLOCK_REALTIME, &ts) == -1) {
-          PERR("bad clock_gettime call");
-          assert(0);
-          return false;
-        }
-        ts.tv_nsec += TIMEOUT_NS;  // lets not worry about wrap arounds, shorter
-                                   // timeout is ok
-
-        int s;
-        while ((s = sem_timedwait(&consumer_sem_, &ts)) == -1 && errno == EINTR)
-          continue; /* Restart if interrupted by handler */
-      }
-
+    while (!not_empty_.wait([&]() { return queue_.dequeue(elem); },
+                            DEFAULT_SPIN_COUNT, TIMEOUT_USEC)) {
       if (exit_) return false;
     }
-    consumer_state_ = AWAKE;
+    not_full_.wake();
     return true;
   }
 
@@ -584,16 +580,15 @@ class Mpmc_bounded_lfq_sleeping_dual {
    */
   void exit_threads() {
     exit_ = true;
-    sem_post(&producer_sem_);
-    sem_post(&consumer_sem_);
+    not_full_.wake_all();
+    not_empty_.wake_all();
   }
 
   inline bool empty() { return queue_.empty(); }
 
   static size_t memory_footprint(size_t queue_size) {
-    return sizeof(Common::Mpmc_bounded_lfq<void *>) +
-           (sizeof(Common::Mpmc_bounded_lfq<void *>::aligned_node_t) *
-            queue_size);
+    return sizeof(Mpmc_bounded_lfq_sleeping_dual<T>) +
+           (sizeof(typename Mpmc_bounded_lfq<T>::aligned_node_t) * queue_size);
   }
 };
 }  // namespace Common
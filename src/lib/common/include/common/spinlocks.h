@@ -165,7 +165,7 @@ class Spin_lock {
   //   }
   // }
 
-  INLINE void unlock() { _l = UNLOCKED; }
+  INLINE void unlock() { __sync_lock_release(&_l); } /* release barrier */
 
   /**
    * Try to take lock.  Do not block.
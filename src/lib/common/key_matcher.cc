@@ -0,0 +1,595 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <common/key_matcher.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <map>
+#include <regex>
+#include <vector>
+
+namespace
+{
+using charset_t = std::bitset<256>;
+
+constexpr unsigned INF             = ~0u;
+constexpr unsigned MAX_REPEAT      = 1000;
+constexpr size_t   MAX_NFA_STATES  = 10000;
+constexpr size_t   MAX_DFA_STATES  = 2048; /* cache is flushed beyond this */
+constexpr size_t   MAX_PREFIX      = 1024;
+constexpr int      DFA_DEAD        = -1;
+constexpr int      DFA_UNKNOWN     = -2;
+
+/* construct that the DFA cannot express; std::regex is used instead */
+struct Unsupported {
+};
+
+struct Ast {
+  enum Kind { SET, CAT, ALT, REP };
+
+  explicit Ast(Kind k) : kind(k), set(), kids(), min(0), max(0) {}
+
+  Kind                              kind;
+  charset_t                         set;
+  std::vector<std::unique_ptr<Ast>> kids;
+  unsigned                          min, max; /* REP; max is INF if unbounded */
+};
+
+using ast_ptr = std::unique_ptr<Ast>;
+
+charset_t digit_set()
+{
+  charset_t s;
+  for (int c = '0'; c <= '9'; c++) s.set(size_t(c));
+  return s;
+}
+
+charset_t word_set()
+{
+  charset_t s = digit_set();
+  for (int c = 'a'; c <= 'z'; c++) s.set(size_t(c));
+  for (int c = 'A'; c <= 'Z'; c++) s.set(size_t(c));
+  s.set('_');
+  return s;
+}
+
+charset_t space_set()
+{
+  charset_t s;
+  for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) s.set(size_t(static_cast<unsigned char>(c)));
+  return s;
+}
+
+int single_member(const charset_t& s)
+{
+  if (s.count() != 1) return -1;
+  for (int c = 0; c < 256; c++)
+    if (s.test(size_t(c))) return c;
+  return -1;
+}
+
+int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * Recursive descent parser for the ECMAScript subset that maps onto a
+ * DFA under whole-string matching.
+ */
+class Parser {
+ public:
+  explicit Parser(const std::string& s) : _s(s), _pos(0) {}
+
+  ast_ptr parse()
+  {
+    if (peek('^')) _pos++; /* implied by whole-key matching */
+    auto a = alternation();
+    if (_pos != _s.size()) throw Unsupported(); /* e.g. stray ')' */
+    return a;
+  }
+
+ private:
+  bool at_end() const { return _pos >= _s.size(); }
+  bool peek(char c) const { return !at_end() && _s[_pos] == c; }
+  unsigned char next() { return static_cast<unsigned char>(_s[_pos++]); }
+
+  static ast_ptr set_node(const charset_t& s)
+  {
+    ast_ptr a(new Ast(Ast::SET));
+    a->set = s;
+    return a;
+  }
+
+  ast_ptr alternation()
+  {
+    auto first = sequence();
+    if (!peek('|')) return first;
+
+    ast_ptr a(new Ast(Ast::ALT));
+    a->kids.push_back(std::move(first));
+    while (peek('|')) {
+      _pos++;
+      a->kids.push_back(sequence());
+    }
+    return a;
+  }
+
+  ast_ptr sequence()
+  {
+    ast_ptr a(new Ast(Ast::CAT));
+    while (!at_end() && !peek('|') && !peek(')')) {
+      if (peek('$')) {
+        /* only meaningful as the final character */
+        if (_pos + 1 != _s.size()) throw Unsupported();
+        _pos++;
+        break;
+      }
+      a->kids.push_back(quantified(atom()));
+    }
+    return a;
+  }
+
+  ast_ptr atom()
+  {
+    unsigned char c = next();
+    switch (c) {
+      case '(': {
+        if (peek('?')) {
+          _pos++;
+          if (!peek(':')) throw Unsupported(); /* lookahead */
+          _pos++;
+        }
+        auto a = alternation();
+        if (!peek(')')) throw Unsupported();
+        _pos++;
+        return a;
+      }
+      case '[':
+        return set_node(bracket());
+      case '.': {
+        charset_t s;
+        s.set();
+        s.reset('\n');
+        s.reset('\r');
+        return set_node(s);
+      }
+      case '\\':
+        return set_node(escape(false));
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+      case '^':
+        throw Unsupported(); /* let std::regex report it */
+      default: {
+        charset_t s;
+        s.set(c);
+        return set_node(s);
+      }
+    }
+  }
+
+  charset_t escape(bool in_class)
+  {
+    if (at_end()) throw Unsupported();
+    unsigned char c = next();
+    charset_t     s;
+    switch (c) {
+      case 'd': return digit_set();
+      case 'D': return ~digit_set();
+      case 'w': return word_set();
+      case 'W': return ~word_set();
+      case 's': return space_set();
+      case 'S': return ~space_set();
+      case 't': s.set('\t'); return s;
+      case 'n': s.set('\n'); return s;
+      case 'r': s.set('\r'); return s;
+      case 'f': s.set('\f'); return s;
+      case 'v': s.set('\v'); return s;
+      case '0':
+        if (!at_end() && isdigit(_s[_pos])) throw Unsupported();
+        s.set(0);
+        return s;
+      case 'x': {
+        if (_pos + 2 > _s.size()) throw Unsupported();
+        int hi = hex_value(_s[_pos]), lo = hex_value(_s[_pos + 1]);
+        if (hi < 0 || lo < 0) throw Unsupported();
+        _pos += 2;
+        s.set(size_t(hi * 16 + lo));
+        return s;
+      }
+      case 'b':
+        if (!in_class) throw Unsupported(); /* word boundary */
+        s.set('\b');
+        return s;
+      default:
+        /* back-references, \B, \c, \u ... */
+        if (isalnum(c)) throw Unsupported();
+        s.set(c);
+        return s;
+    }
+  }
+
+  charset_t bracket()
+  {
+    bool negate = false;
+    if (peek('^')) {
+      _pos++;
+      negate = true;
+    }
+
+    charset_t s;
+    for (;;) {
+      if (at_end()) throw Unsupported();
+      unsigned char c = next();
+      if (c == ']') break;
+      if (c == '[' && (peek(':') || peek('.') || peek('='))) throw Unsupported();
+
+      charset_t item;
+      if (c == '\\')
+        item = escape(true);
+      else
+        item.set(c);
+
+      int lo = single_member(item);
+      if (lo >= 0 && peek('-') && _pos + 1 < _s.size() && _s[_pos + 1] != ']') {
+        _pos++;
+        unsigned char d  = next();
+        int           hi = d;
+        if (d == '\\') hi = single_member(escape(true));
+        if (hi < lo) throw Unsupported();
+        for (int i = lo; i <= hi; i++) s.set(size_t(i));
+      }
+      else {
+        s |= item;
+      }
+    }
+    return negate ? ~s : s;
+  }
+
+  bool number(unsigned& out)
+  {
+    size_t start = _pos;
+    out          = 0;
+    while (!at_end() && isdigit(_s[_pos])) {
+      out = out * 10 + unsigned(_s[_pos++] - '0');
+      if (out > MAX_REPEAT) throw Unsupported();
+    }
+    return _pos != start;
+  }
+
+  ast_ptr quantified(ast_ptr a)
+  {
+    if (at_end()) return a;
+
+    unsigned min, max;
+    switch (_s[_pos]) {
+      case '*': min = 0; max = INF; _pos++; break;
+      case '+': min = 1; max = INF; _pos++; break;
+      case '?': min = 0; max = 1; _pos++; break;
+      case '{':
+        _pos++;
+        if (!number(min)) throw Unsupported();
+        max = min;
+        if (peek(',')) {
+          _pos++;
+          if (!number(max)) max = INF;
+        }
+        if (!peek('}') || max < min) throw Unsupported();
+        _pos++;
+        break;
+      default:
+        return a;
+    }
+    if (peek('?')) _pos++; /* lazy; same result for a whole-key match */
+    if (!at_end() && (peek('*') || peek('+') || peek('?') || peek('{')))
+      throw Unsupported();
+
+    ast_ptr r(new Ast(Ast::REP));
+    r->min = min;
+    r->max = max;
+    r->kids.push_back(std::move(a));
+    return r;
+  }
+
+  const std::string& _s;
+  size_t             _pos;
+};
+
+struct Nfa_state {
+  enum Type { SET, SPLIT, EPS, MATCH };
+  Type      type;
+  charset_t set;
+  int       out, out1;
+};
+
+/**
+ * Thompson construction
+ */
+class Nfa_builder {
+ public:
+  explicit Nfa_builder(std::vector<Nfa_state>& states) : _st(states) {}
+
+  int build(const Ast& a)
+  {
+    auto f = fragment(a);
+    int  m = add(Nfa_state::MATCH);
+    patch(f, m);
+    return f.start;
+  }
+
+ private:
+  using outs_t = std::vector<std::pair<int, int>>; /* state, which out */
+
+  struct Frag {
+    int    start;
+    outs_t outs;
+  };
+
+  int add(Nfa_state::Type t, const charset_t& s = charset_t())
+  {
+    if (_st.size() >= MAX_NFA_STATES) throw Unsupported();
+    _st.push_back(Nfa_state{t, s, -1, -1});
+    return int(_st.size() - 1);
+  }
+
+  void patch(const Frag& f, int target)
+  {
+    for (auto& o : f.outs) {
+      if (o.second)
+        _st[size_t(o.first)].out1 = target;
+      else
+        _st[size_t(o.first)].out = target;
+    }
+  }
+
+  Frag empty()
+  {
+    int e = add(Nfa_state::EPS);
+    return Frag{e, outs_t{{e, 0}}};
+  }
+
+  Frag concat(std::vector<Frag>& parts)
+  {
+    if (parts.empty()) return empty();
+    Frag f = parts[0];
+    for (size_t i = 1; i < parts.size(); i++) {
+      patch(f, parts[i].start);
+      f.outs = parts[i].outs;
+    }
+    return f;
+  }
+
+  Frag fragment(const Ast& a)
+  {
+    switch (a.kind) {
+      case Ast::SET: {
+        int s = add(Nfa_state::SET, a.set);
+        return Frag{s, outs_t{{s, 0}}};
+      }
+      case Ast::CAT: {
+        std::vector<Frag> parts;
+        for (auto& k : a.kids) parts.push_back(fragment(*k));
+        return concat(parts);
+      }
+      case Ast::ALT: {
+        Frag f = fragment(*a.kids.back());
+        for (size_t i = a.kids.size() - 1; i-- > 0;) {
+          Frag g  = fragment(*a.kids[i]);
+          int  sp = add(Nfa_state::SPLIT);
+          _st[size_t(sp)].out  = g.start;
+          _st[size_t(sp)].out1 = f.start;
+          g.outs.insert(g.outs.end(), f.outs.begin(), f.outs.end());
+          f = Frag{sp, g.outs};
+        }
+        return f;
+      }
+      case Ast::REP: {
+        const Ast&        kid = *a.kids[0];
+        std::vector<Frag> parts;
+        for (unsigned i = 0; i < a.min; i++) parts.push_back(fragment(kid));
+        if (a.max == INF) {
+          int  sp = add(Nfa_state::SPLIT);
+          Frag g  = fragment(kid);
+          _st[size_t(sp)].out = g.start;
+          patch(g, sp);
+          parts.push_back(Frag{sp, outs_t{{sp, 1}}});
+        }
+        else {
+          for (unsigned i = a.min; i < a.max; i++) {
+            int  sp = add(Nfa_state::SPLIT);
+            Frag g  = fragment(kid);
+            _st[size_t(sp)].out = g.start;
+            g.outs.push_back({sp, 1});
+            parts.push_back(Frag{sp, g.outs});
+          }
+        }
+        return concat(parts);
+      }
+    }
+    throw Unsupported();
+  }
+
+  std::vector<Nfa_state>& _st;
+};
+}  // namespace
+
+namespace Common
+{
+struct Key_matcher::Impl {
+  struct Dfa_state {
+    std::vector<int>    nfa; /* SET and MATCH states, sorted */
+    bool                accept;
+    std::array<int, 256> next;
+  };
+
+  /* DFA path */
+  std::vector<Nfa_state>          nfa;
+  std::vector<int>                start_set;
+  std::vector<Dfa_state>          dfa;
+  std::map<std::vector<int>, int> dfa_index;
+
+  /* fallback */
+  std::unique_ptr<std::regex> regex;
+
+  std::vector<int> closure(const std::vector<int>& seeds) const
+  {
+    std::vector<char> seen(nfa.size(), 0);
+    std::vector<int>  stack(seeds), result;
+    while (!stack.empty()) {
+      int s = stack.back();
+      stack.pop_back();
+      if (s < 0 || seen[size_t(s)]) continue;
+      seen[size_t(s)] = 1;
+      auto& st        = nfa[size_t(s)];
+      switch (st.type) {
+        case Nfa_state::SPLIT:
+          stack.push_back(st.out1);
+          stack.push_back(st.out);
+          break;
+        case Nfa_state::EPS:
+          stack.push_back(st.out);
+          break;
+        default:
+          result.push_back(s);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  int intern(const std::vector<int>& set)
+  {
+    auto i = dfa_index.find(set);
+    if (i != dfa_index.end()) return i->second;
+
+    if (dfa.size() >= MAX_DFA_STATES) {
+      /* start again rather than grow without bound */
+      dfa.clear();
+      dfa_index.clear();
+      generation++;
+      intern(start_set);
+    }
+
+    Dfa_state d;
+    d.nfa    = set;
+    d.accept = false;
+    for (int s : set)
+      if (nfa[size_t(s)].type == Nfa_state::MATCH) d.accept = true;
+    d.next.fill(DFA_UNKNOWN);
+    dfa.push_back(std::move(d));
+    int id         = int(dfa.size() - 1);
+    dfa_index[set] = id;
+    return id;
+  }
+
+  int step(int d, unsigned char c)
+  {
+    int n = dfa[size_t(d)].next[c];
+    if (n != DFA_UNKNOWN) return n;
+
+    std::vector<int> seeds;
+    for (int s : dfa[size_t(d)].nfa) {
+      auto& st = nfa[size_t(s)];
+      if (st.type == Nfa_state::SET && st.set.test(c)) seeds.push_back(st.out);
+    }
+    auto target = closure(seeds);
+
+    unsigned g = generation;
+    n          = target.empty() ? DFA_DEAD : intern(target);
+    if (g == generation) /* otherwise d no longer exists */
+      dfa[size_t(d)].next[c] = n;
+    return n;
+  }
+
+  unsigned generation = 0;
+};
+
+Key_matcher::Key_matcher(Type type, const std::string& expression)
+    : _type(type), _expression(expression), _prefix(), _impl()
+{
+  if (type != Type::REGEX) {
+    _prefix = expression;
+    _exact  = (type == Type::EXACT);
+    return;
+  }
+
+  _impl.reset(new Impl());
+  try {
+    auto ast   = Parser(expression).parse();
+    int  start = Nfa_builder(_impl->nfa).build(*ast);
+    _impl->start_set = _impl->closure(std::vector<int>{start});
+    _impl->intern(_impl->start_set);
+  }
+  catch (const Unsupported&) {
+    _impl->nfa.clear();
+    _impl->regex.reset(new std::regex(expression));
+    return;
+  }
+
+  /* follow the chain of states with a single way forward; those bytes
+     start every matching key */
+  int d = 0;
+  while (!_impl->dfa[size_t(d)].accept && _prefix.size() < MAX_PREFIX) {
+    int only = -1, target = DFA_DEAD;
+    for (int c = 0; c < 256; c++) {
+      int n = _impl->step(d, static_cast<unsigned char>(c));
+      if (n == DFA_DEAD) continue;
+      if (only >= 0) {
+        only = -2;
+        break;
+      }
+      only   = c;
+      target = n;
+    }
+    if (only < 0) break;
+    _prefix += static_cast<char>(only);
+    d = target;
+  }
+
+  if (_impl->dfa[size_t(d)].accept) {
+    _exact = true;
+    for (int c = 0; c < 256 && _exact; c++)
+      _exact = (_impl->step(d, static_cast<unsigned char>(c)) == DFA_DEAD);
+  }
+}
+
+Key_matcher::~Key_matcher() {}
+
+bool Key_matcher::match(const std::string& key) const
+{
+  switch (_type) {
+    case Type::EXACT:
+      return key == _expression;
+    case Type::PREFIX:
+      return key.compare(0, _expression.size(), _expression) == 0;
+    case Type::REGEX:
+      break;
+  }
+
+  if (_impl->regex) return std::regex_match(key, *_impl->regex);
+
+  int d = 0; /* start state survives cache flushes as id 0 */
+  for (unsigned char c : key) {
+    d = _impl->step(d, c);
+    if (d == DFA_DEAD) return false;
+  }
+  return _impl->dfa[size_t(d)].accept;
+}
+}  // namespace Common
@@ -0,0 +1,185 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <common/key_matcher.h>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+using Common::Key_matcher;
+
+namespace
+{
+/* short keys over a small alphabet, so that most patterns see both
+   matches and near misses */
+std::vector<std::string> key_corpus()
+{
+  std::vector<std::string> keys{"",         "a",       "b",        "ab",      "abc",
+                                "abcd",     "aaab",    "abab",     "abcabc",  "cab",
+                                "key-17",   "key-",    "key-1x",   "KEY-17",  "x_y",
+                                "foo bar",  "foo\tbar", "foo\nbar", "a.b",     "a*b",
+                                "0x1f",     "\x01\xff", "zzzz",     "abcdefgh", "car17"};
+
+  const std::string alphabet = "abc1-_.\n";
+  std::mt19937      rng(1234);
+  for (unsigned i = 0; i < 2000; i++) {
+    std::string k(rng() % 9, ' ');
+    for (auto& c : k) c = alphabet[rng() % alphabet.size()];
+    keys.push_back(k);
+  }
+  return keys;
+}
+
+void expect_same_as_std_regex(const std::string& pattern, const std::vector<std::string>& keys)
+{
+  Key_matcher m(Key_matcher::Type::REGEX, pattern);
+  std::regex  r(pattern);
+  for (auto& k : keys) {
+    ASSERT_EQ(std::regex_match(k, r), m.match(k)) << "pattern (" << pattern << ") key (" << k << ")";
+    if (m.match(k)) ASSERT_EQ(0, k.compare(0, m.prefix().size(), m.prefix())) << "pattern (" << pattern << ")";
+  }
+}
+
+TEST(Key_matcher, MatchesStdRegex)
+{
+  const std::vector<std::string> patterns{"abc",
+                                          "a.c",
+                                          "a.*",
+                                          ".*c",
+                                          ".*",
+                                          "a+b*",
+                                          "(ab)+",
+                                          "(a|b)*c",
+                                          "a|ab|abc",
+                                          "ab(c|d)?",
+                                          "a{3}b",
+                                          "a{1,2}b?",
+                                          "[abc]+",
+                                          "[^abc]*",
+                                          "[a-c1]{2,}",
+                                          "[.-]\\d",
+                                          "key-\\d+",
+                                          "key-[0-9]{1,3}",
+                                          "\\w+",
+                                          "\\W",
+                                          "\\s*\\S+",
+                                          "foo\\sbar",
+                                          "foo.bar",
+                                          "a\\.b",
+                                          "a\\*b",
+                                          "\\x30x1f",
+                                          "0x[0-9a-f]+",
+                                          "(?:ab)+c?",
+                                          "a*?b",
+                                          "^abc$",
+                                          "^a.*$",
+                                          "((a|b)c?)+",
+                                          "(a|)b",
+                                          "[\\d_-]+",
+                                          "car\\d*|key-1."};
+  const auto keys = key_corpus();
+  for (auto& p : patterns) expect_same_as_std_regex(p, keys);
+}
+
+TEST(Key_matcher, Prefix)
+{
+  struct {
+    const char* pattern;
+    const char* prefix;
+    bool        exact;
+  } cases[] = {
+      {"abc", "abc", true},       {"abc.*", "abc", false},  {"ab(c|d)", "ab", false},
+      {"(?:foo)bar", "foobar", true}, {"a{3}b", "aaab", true}, {"x[y]z\\d", "xyz", false},
+      {".*abc", "", false},       {"^abc$", "abc", true},   {"key-\\d+", "key-", false},
+      {"ab?", "a", false},        {"a\\.b", "a.b", true},   {"(ab|ac)d", "a", false},
+  };
+
+  for (auto& c : cases) {
+    Key_matcher m(Key_matcher::Type::REGEX, c.pattern);
+    EXPECT_EQ(c.prefix, m.prefix()) << c.pattern;
+    EXPECT_EQ(c.exact, m.exact()) << c.pattern;
+  }
+}
+
+TEST(Key_matcher, PrefixAndExactTypes)
+{
+  Key_matcher p(Key_matcher::Type::PREFIX, "car");
+  ASSERT_EQ("car", p.prefix());
+  ASSERT_FALSE(p.exact());
+  ASSERT_TRUE(p.match("car"));
+  ASSERT_TRUE(p.match("car17"));
+  ASSERT_FALSE(p.match("ca"));
+  ASSERT_FALSE(p.match("xcar"));
+
+  /* not a regular expression */
+  Key_matcher d(Key_matcher::Type::PREFIX, "a.*");
+  ASSERT_TRUE(d.match("a.*b"));
+  ASSERT_FALSE(d.match("ab"));
+
+  Key_matcher e(Key_matcher::Type::EXACT, "car");
+  ASSERT_EQ("car", e.prefix());
+  ASSERT_TRUE(e.exact());
+  ASSERT_TRUE(e.match("car"));
+  ASSERT_FALSE(e.match("car17"));
+  ASSERT_FALSE(e.match("ca"));
+}
+
+TEST(Key_matcher, Fallback)
+{
+  /* back-references, assertions and POSIX classes go to std::regex */
+  const std::vector<std::string> patterns{"(a+)b\\1", "(?=a)\\w+", "(?!ab)[abc]+", "\\bab.*",
+                                          "a\\B.*",   "[[:alpha:]]+", "[[:digit:]-]+"};
+  const auto keys = key_corpus();
+  for (auto& p : patterns) {
+    expect_same_as_std_regex(p, keys);
+    Key_matcher m(Key_matcher::Type::REGEX, p);
+    ASSERT_EQ("", m.prefix()) << p;
+    ASSERT_FALSE(m.exact()) << p;
+  }
+
+  Key_matcher m(Key_matcher::Type::REGEX, "(a+)b\\1");
+  ASSERT_TRUE(m.match("aabaa"));
+  ASSERT_FALSE(m.match("aaba"));
+}
+
+TEST(Key_matcher, Invalid)
+{
+  for (auto p : {"(abc", "abc)", "[abc", "*a", "a{2,1}", "a\\", "+"})
+    ASSERT_THROW(Key_matcher(Key_matcher::Type::REGEX, p), std::regex_error) << p;
+
+  /* only regular expressions are parsed */
+  ASSERT_NO_THROW(Key_matcher(Key_matcher::Type::PREFIX, "(abc"));
+  ASSERT_NO_THROW(Key_matcher(Key_matcher::Type::EXACT, "(abc"));
+}
+
+TEST(Key_matcher, CacheFlush)
+{
+  /* (a|b)*a(a|b){11} needs more DFA states than the cache holds */
+  const std::string pattern = "(a|b)*a(a|b){11}";
+  Key_matcher       m(Key_matcher::Type::REGEX, pattern);
+  std::regex        r(pattern);
+  std::mt19937      rng(99);
+  for (unsigned i = 0; i < 5000; i++) {
+    std::string k(12 + rng() % 20, 'a');
+    for (auto& c : k) c = (rng() & 1) ? 'a' : 'b';
+    ASSERT_EQ(std::regex_match(k, r), m.match(k)) << k;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
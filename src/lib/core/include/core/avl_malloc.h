@@ -27,10 +27,15 @@
 #error("This is a C++ header")
 #endif
 
+#include <common/rwlock.h>
+#include <common/spinlocks.h>
 #include <common/stack.h>
 #include <common/types.h>
 #include <common/utils.h>
+#include <core/magazine.h>
 #include <core/slab.h>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include "avl_tree.h"
 
@@ -450,12 +455,15 @@ class AVL_range_allocator {
     Memory_region* region = root->find_free_region(root, size, alignment);
 
     if (region == nullptr) {
-      
+
+      if (alignment == 0)
+        throw General_exception("AVL_range_allocator: failed to allocate (size=%ld free=%lu)",
+                                size, get_free());
+
       /* OK, maybe there is space, but alignment isn't there.  Now we need
          to three-way split a large enough block */
 
       assert(root->find_free_region(root, size, alignment) == nullptr);
-      assert(alignment > 0);
 
       Memory_region* region = root->find_free_region(root, size + alignment, 8);
       if (region == nullptr)
@@ -534,7 +542,7 @@ class AVL_range_allocator {
     }
 
     assert(region->_size >= size);
-    assert(check_aligned(region->_addr, alignment));
+    assert(alignment == 0 || check_aligned(region->_addr, alignment));
     
     /* we did find an aligned region */
     if (region->_size == size) {
@@ -818,8 +826,26 @@ class AVL_range_allocator {
  * explicitly passed to the constructor.  This should allow the use of memory
  * allocated for SPDK IO buffers etc.
  *
+ * Small allocations are rounded up to a size class and served from
+ * per-core magazines backed by per-class free lists, so the hot path
+ * does not touch (or split) the tree.  Cached blocks stay allocated
+ * in the tree until an allocation fails, when all of them are freed
+ * back (and coalesced) before retrying.  Thread-safe.
+ *
  */
 class Arena_allocator : public Common::Base_memory_allocator {
+ private:
+  static constexpr size_t SIZE_CLASS_GRANULE = 32;
+  static constexpr unsigned NUM_SIZE_CLASSES = 32; /* up to 1KiB */
+  static constexpr size_t MAX_CACHED_SIZE = SIZE_CLASS_GRANULE * NUM_SIZE_CLASSES;
+  static constexpr unsigned MAGAZINE_SIZE = 16;
+  static constexpr size_t DEPOT_LIMIT = 1024; /* blocks kept per class */
+
+  struct Core_cache {
+    Common::Spin_lock lock;
+    Magazine<void*, MAGAZINE_SIZE> blocks[NUM_SIZE_CLASSES];
+  };
+
  public:
   /**
    * Constructor
@@ -853,16 +879,33 @@ class Arena_allocator : public Common::Base_memory_allocator {
   void* alloc(size_t size, int numa_node = -1, size_t alignment = 0) {
     if (size == 0) size = 1;
 
-    Memory_region* mr;
+    for (bool reclaimed = false;; reclaimed = true) {
+      void* p = nullptr;
+      if (size <= MAX_CACHED_SIZE) {
+        unsigned sc = unsigned((size - 1) / SIZE_CLASS_GRANULE);
+        Core_cache& cache = _caches.local();
+        std::lock_guard<Common::Spin_lock> g(cache.lock);
+        auto& mag = cache.blocks[sc];
+        if (mag.empty()) refill(sc, mag);
+        if (!mag.empty()) {
+          _cached_bytes -= class_size(sc);
+          p = mag.pop();
+        }
+      }
+      else {
+        Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
+        p = tree_alloc(size);
+      }
+      if (p) return p;
 
-    try {
-      mr = _range_allocator.alloc(size);
-    } catch (General_exception &e) {
-      PERR("Arena_allocator: out of memory %s", e.cause());
-      exit(0);
+      /* the tree is exhausted or too fragmented; blocks cached by other
+         cores and the class free lists may coalesce into enough space */
+      if (reclaimed) {
+        PERR("Arena_allocator: out of memory (%lu bytes)", size);
+        exit(0);
+      }
+      reclaim();
     }
-    assert(mr);
-    return (void*) mr->addr();
   }
 
   /**
@@ -872,7 +915,27 @@ class Arena_allocator : public Common::Base_memory_allocator {
    */
   size_t free(void* ptr) {
     assert(ptr);
-    return _range_allocator.free((addr_t) ptr);
+
+    size_t size;
+    {
+      Common::RWLock_guard g(_tree_lock);
+      const Core::Memory_region* region = _range_allocator.find((addr_t) ptr);
+      size = region ? region->size() : 0;
+    }
+
+    if (size == 0 || size > MAX_CACHED_SIZE || size % SIZE_CLASS_GRANULE) {
+      Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
+      return _range_allocator.free((addr_t) ptr);
+    }
+
+    unsigned sc = unsigned(size / SIZE_CLASS_GRANULE) - 1;
+    Core_cache& cache = _caches.local();
+    std::lock_guard<Common::Spin_lock> g(cache.lock);
+    auto& mag = cache.blocks[sc];
+    if (mag.full()) flush(sc, mag);
+    mag.push(ptr);
+    _cached_bytes += size;
+    return size;
   }
 
   /**
@@ -880,10 +943,11 @@ class Arena_allocator : public Common::Base_memory_allocator {
    *
    * @param ptr Pointer to allocated block
    *
-   * @return Size of allocation in bytes
+   * @return Size of allocation in bytes (small sizes are rounded up)
    */
   size_t get_size(void* ptr) {
     assert(ptr);
+    Common::RWLock_guard g(_tree_lock);
     const Core::Memory_region* region = _range_allocator.find((addr_t) ptr);
     if (region == nullptr)
       return -1;
@@ -895,14 +959,14 @@ class Arena_allocator : public Common::Base_memory_allocator {
    * Get free space capacity in bytes
    *
    *
-   * @return Unused space in bytes
+   * @return Unused space in bytes, including cached small blocks
    */
   size_t free_space() {
     size_t free_bytes = 0;
     apply([&free_bytes](addr_t a, size_t s, bool is_free) {
       if (is_free) free_bytes += s;
     });
-    return free_bytes;
+    return free_bytes + _cached_bytes;
   }
 
   /**
@@ -922,15 +986,18 @@ class Arena_allocator : public Common::Base_memory_allocator {
    *
    */
   void dump_info(std::string * out_str = nullptr) {
+    Common::RWLock_guard g(_tree_lock);
     _range_allocator.dump_info(out_str);
   }
 
   /**
-   * Apply functor to elements of the tree
+   * Apply functor to elements of the tree.  Cached small blocks are
+   * reported as allocated.
    *
    * @param functor
    */
   void apply(std::function<void(addr_t, size_t, bool)> functor) {
+    Common::RWLock_guard g(_tree_lock);
     _range_allocator.apply(functor);
   }
 
@@ -941,6 +1008,7 @@ class Arena_allocator : public Common::Base_memory_allocator {
    * @param size Size of region in bytes
    */
   void add_new_region(void* vaddr, size_t size) {
+    Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
     _range_allocator.add_new_region((addr_t) vaddr, size);
   }
 
@@ -952,6 +1020,7 @@ class Arena_allocator : public Common::Base_memory_allocator {
    * @return Upper limit in bytes
    */
   size_t used_zone_limit() {
+    Common::RWLock_guard g(_tree_lock);
     Memory_region* r = _range_allocator.rightmost_region();
 
     if (r->is_free())
@@ -960,8 +1029,111 @@ class Arena_allocator : public Common::Base_memory_allocator {
       return r->addr() + r->size() - _range_allocator.base();
   }
 
+ private:
+  static size_t class_size(unsigned sc) { return (sc + 1) * SIZE_CLASS_GRANULE; }
+
+  /* call with the tree write lock held; nullptr if there is no space */
+  void* tree_alloc(size_t size) {
+    Memory_region* mr;
+
+    try {
+      mr = _range_allocator.alloc(size);
+    } catch (General_exception &e) {
+      return nullptr;
+    }
+    assert(mr);
+    return (void*) mr->addr();
+  }
+
+  /**
+   * Fill an empty magazine with half a magazine of blocks from the
+   * class free list, or from the tree if the list is empty.  Called
+   * with the core cache lock held.  The magazine is left empty if the
+   * tree has no space.
+   */
+  void refill(unsigned sc, Magazine<void*, MAGAZINE_SIZE>& mag) {
+    {
+      std::lock_guard<Common::Spin_lock> g(_depot_lock);
+      auto& list = _depot[sc];
+      while (!list.empty() && mag.count() < MAGAZINE_SIZE / 2) {
+        mag.push(list.back());
+        list.pop_back();
+      }
+    }
+    if (!mag.empty()) return;
+
+    Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
+    for (unsigned i = 0; i < MAGAZINE_SIZE / 2; i++) {
+      void* p = tree_alloc(class_size(sc));
+      if (p == nullptr) break;
+      mag.push(p);
+      _cached_bytes += class_size(sc);
+    }
+  }
+
+  /**
+   * Free every block cached by the cores and the class free lists back
+   * into the tree, where they coalesce with their neighbours.  Called
+   * with no lock held; core cache locks are taken one at a time.
+   */
+  void reclaim() {
+    std::vector<void*> blocks;
+    size_t bytes = 0;
+    for (unsigned i = 0; i < _caches.size(); i++) {
+      std::lock_guard<Common::Spin_lock> g(_caches[i].lock);
+      for (unsigned sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
+        auto& mag = _caches[i].blocks[sc];
+        bytes += mag.count() * class_size(sc);
+        while (!mag.empty()) blocks.push_back(mag.pop());
+      }
+    }
+    {
+      std::lock_guard<Common::Spin_lock> g(_depot_lock);
+      for (unsigned sc = 0; sc < NUM_SIZE_CLASSES; sc++) {
+        bytes += _depot[sc].size() * class_size(sc);
+        blocks.insert(blocks.end(), _depot[sc].begin(), _depot[sc].end());
+        _depot[sc].clear();
+      }
+    }
+    if (blocks.empty()) return;
+
+    _cached_bytes -= bytes;
+    Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
+    for (auto p : blocks) _range_allocator.free((addr_t) p);
+  }
+
+  /**
+   * Move half of a full magazine to the class free list; trim the
+   * list back to the tree if it grows too long.  Called with the core
+   * cache lock held.
+   */
+  void flush(unsigned sc, Magazine<void*, MAGAZINE_SIZE>& mag) {
+    std::vector<void*> excess;
+    {
+      std::lock_guard<Common::Spin_lock> g(_depot_lock);
+      auto& list = _depot[sc];
+      while (mag.count() > MAGAZINE_SIZE / 2) list.push_back(mag.pop());
+      if (list.size() > DEPOT_LIMIT) {
+        while (list.size() > DEPOT_LIMIT / 2) {
+          excess.push_back(list.back());
+          list.pop_back();
+        }
+      }
+    }
+    if (excess.empty()) return;
+
+    _cached_bytes -= excess.size() * class_size(sc);
+    Common::RWLock_guard g(_tree_lock, Common::RWLock_guard::WRITE);
+    for (auto p : excess) _range_allocator.free((addr_t) p);
+  }
+
  private:
   Core::AVL_range_allocator _range_allocator;
+  Common::RWLock            _tree_lock; /*< find vs. split/coalesce */
+  Common::Spin_lock         _depot_lock;
+  std::vector<void*>        _depot[NUM_SIZE_CLASSES]; /*< per size class free lists */
+  Per_core<Core_cache>      _caches;
+  std::atomic<size_t>       _cached_bytes{0};
 };
 
 /**
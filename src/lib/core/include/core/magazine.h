@@ -0,0 +1,85 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __CORE_MAGAZINE_H__
+#define __CORE_MAGAZINE_H__
+
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace Core
+{
+/**
+ * Fixed capacity stack of cached objects, used as a per-core
+ * front-end to an allocator.  Not thread-safe; the owner supplies the
+ * lock.
+ *
+ */
+template <typename T, unsigned N>
+class Magazine {
+ public:
+  static constexpr unsigned CAPACITY = N;
+
+  bool empty() const { return _count == 0; }
+  bool full() const { return _count == N; }
+  unsigned count() const { return _count; }
+
+  void push(T item) {
+    assert(_count < N);
+    _items[_count++] = item;
+  }
+
+  T pop() {
+    assert(_count > 0);
+    return _items[--_count];
+  }
+
+ private:
+  unsigned _count = 0;
+  T _items[N];
+};
+
+/**
+ * One instance of T per configured CPU, picked by the CPU the caller
+ * is running on.  A thread can migrate between picking its instance
+ * and using it, so instances still need a (normally uncontended)
+ * lock.
+ *
+ */
+template <typename T>
+class Per_core {
+ public:
+  Per_core()
+      : _count(unsigned(std::max(1L, sysconf(_SC_NPROCESSORS_CONF)))),
+        _instances(new T[_count]) {}
+
+  T& local() {
+    int cpu = sched_getcpu();
+    return _instances[unsigned(cpu < 0 ? 0 : cpu) % _count];
+  }
+
+  T& operator[](unsigned i) { return _instances[i]; }
+
+  unsigned size() const { return _count; }
+
+ private:
+  const unsigned _count;
+  std::unique_ptr<T[]> _instances;
+};
+
+}  // namespace Core
+
+#endif  // __CORE_MAGAZINE_H__
@@ -25,11 +25,14 @@
 
 #include <common/chksum.h>
 #include <common/memory.h>
+#include <common/spinlocks.h>
 #include <core/lazy_region.h>
+#include <core/magazine.h>
 #include <algorithm>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <vector>
@@ -78,15 +81,24 @@ class __BasicElement { /**< order and packing is important */
 
 /**
  * Serializable slab allocator which can be re-initialized from a block
- * of memory (persistent or not)
+ * of memory (persistent or not).  Thread-safe: each core caches free
+ * slots in a magazine and only goes to the shared free list (the
+ * depot) in batches.  When the region is used up, slots cached by
+ * other cores are returned to the depot before failing.
  *
  */
 template <typename T = void*,
           template <typename U> class Element = Slab::__BasicElement>
 class Allocator : public Common::Base_slab_allocator {
  private:
-  static const bool option_DEBUG = true;    /**< toggle to activate debugging */
+  static const bool option_DEBUG = false;   /**< toggle to activate debugging */
   static const unsigned MIN_ELEMENTS = 128; /**< sanity bounds */
+  static const unsigned MAGAZINE_SIZE = 32; /**< slots cached per core */
+
+  struct Core_cache {
+    Common::Spin_lock lock;
+    Magazine<Element<T>*, MAGAZINE_SIZE> slots;
+  };
 
   // 64 byte header
   struct Header {
@@ -105,6 +117,8 @@ class Allocator : public Common::Base_slab_allocator {
   Element<T>* _slot_array; /**< data that can be implicitly serialized */
   Header* _header;
   bool _reconstructed;
+  Common::Spin_lock _depot_lock; /**< protects _free_slots and _header->slots */
+  Per_core<Core_cache> _caches;
 
  public:
   /**
@@ -245,41 +259,38 @@ class Allocator : public Common::Base_slab_allocator {
    * Allocate an element from the slab
    *
    *
-   * @return Pointer to newly allocated element. NULL when memory runs out.
+   * @return Pointer to newly allocated element. Throws API_exception when memory runs out.
    */
   void* alloc() {
     assert(_header);
     assert(_header->max_slots > 0);
 
-    if (_free_slots.size() > 0) {
-      Element<T>* slot = _free_slots.back();
-      if (option_DEBUG)
-        PDBG("picked up free slot (%p, flags=%x)", (void*) slot,
-             slot->hdr.flags);
-      assert(slot);
-      assert(slot->hdr.used == false);
-      slot->hdr.used = true;
-      _free_slots.pop_back();
-      return &slot->val;
-    }
-    else {
-      if (option_DEBUG)
-        PLOG("adding new slot (array_len=%ld)...", _header->slots);
-      if (_header->slots >= _header->max_slots) {
+    Element<T>* slot = nullptr;
+    for (bool reclaimed = false; slot == nullptr; reclaimed = true) {
+      {
+        Core_cache& cache = _caches.local();
+        std::lock_guard<Common::Spin_lock> g(cache.lock);
+        if (cache.slots.empty()) refill(cache);
+        if (!cache.slots.empty()) slot = cache.slots.pop();
+      }
+      if (slot) break;
+
+      /* region used up; free slots may still sit in other cores'
+         magazines */
+      if (reclaimed) {
         PERR("max slots (%ld) exceeded", _header->max_slots);
         throw API_exception("Slab allocator (%s) run out of memory!",
                             _header->label);
       }
-
-      Element<T>* slot = &_slot_array[_header->slots];
-      assert(slot);
-      memset((void*) slot, 0, sizeof(Element<T>));  // could be removed.
-      slot->hdr.used = true;
-      _header->slots++;
-
-      return &slot->val;
+      reclaim();
     }
-    assert(0);
+
+    if (option_DEBUG)
+      PDBG("picked up free slot (%p, flags=%x)", (void*) slot,
+           slot->hdr.flags);
+    assert(slot->hdr.used == false);
+    slot->hdr.used = true;
+    return &slot->val;
   }
 
   /**
@@ -300,7 +311,15 @@ class Allocator : public Common::Base_slab_allocator {
     Element<T>* slot = (Element<T>*) (((addr_t) pval) - sizeof(slot->hdr));
     slot->hdr.used = false;
 
-    _free_slots.push_back(slot);
+    Core_cache& cache = _caches.local();
+    std::lock_guard<Common::Spin_lock> g(cache.lock);
+    if (cache.slots.full()) {
+      /* return half, so that alternating alloc/free does not thrash */
+      std::lock_guard<Common::Spin_lock> dg(_depot_lock);
+      while (cache.slots.count() > MAGAZINE_SIZE / 2)
+        _free_slots.push_back(cache.slots.pop());
+    }
+    cache.slots.push(slot);
     return sizeof(Element<T>);
   }
 
@@ -322,7 +341,15 @@ class Allocator : public Common::Base_slab_allocator {
    *
    * @return Number of free slots
    */
-  size_t free_slots() const { return _free_slots.size(); }
+  size_t free_slots() {
+    size_t count = 0;
+    for (unsigned i = 0; i < _caches.size(); i++) {
+      std::lock_guard<Common::Spin_lock> g(_caches[i].lock);
+      count += _caches[i].slots.count();
+    }
+    std::lock_guard<Common::Spin_lock> g(_depot_lock);
+    return count + _free_slots.size();
+  }
 
   void* get_first_element() { return &_slot_array[0].val; }
 
@@ -413,6 +440,52 @@ class Allocator : public Common::Base_slab_allocator {
    * @return
    */
   std::vector<Element<T>*>& __dbg_slots() { return _free_slots; }
+
+ private:
+  /**
+   * Move up to half a magazine of slots from the depot into a core's
+   * magazine, carving new slots from the region if the depot is
+   * empty.  Called with the magazine lock held.
+   *
+   * @param cache Empty core cache; left empty if the region is used up
+   */
+  void refill(Core_cache& cache) {
+    std::lock_guard<Common::Spin_lock> g(_depot_lock);
+
+    while (!_free_slots.empty() && cache.slots.count() < MAGAZINE_SIZE / 2) {
+      cache.slots.push(_free_slots.back());
+      _free_slots.pop_back();
+    }
+    if (!cache.slots.empty()) return;
+
+    if (_header->slots >= _header->max_slots) return;
+
+    size_t n = std::min(size_t(MAGAZINE_SIZE / 2),
+                        size_t(_header->max_slots - _header->slots));
+    if (option_DEBUG)
+      PLOG("adding %lu new slots (array_len=%ld)...", n, _header->slots);
+
+    Element<T>* first = &_slot_array[_header->slots];
+    memset((void*) first, 0, sizeof(Element<T>) * n);
+    _header->slots += n;
+
+    /* push in reverse so that slots are handed out in address order;
+       AVL_range_allocator relies on the first allocation being slot 0 */
+    for (size_t i = n; i > 0; i--) cache.slots.push(&first[i - 1]);
+  }
+
+  /**
+   * Return the slots cached by every core to the depot.  Called with
+   * no magazine lock held; magazine locks are taken one at a time.
+   */
+  void reclaim() {
+    for (unsigned i = 0; i < _caches.size(); i++) {
+      std::lock_guard<Common::Spin_lock> g(_caches[i].lock);
+      std::lock_guard<Common::Spin_lock> dg(_depot_lock);
+      while (!_caches[i].slots.empty())
+        _free_slots.push_back(_caches[i].slots.pop());
+    }
+  }
 };
 
 }  // namespace Slab
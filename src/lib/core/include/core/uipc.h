@@ -37,8 +37,8 @@ typedef void* channel_t;
 
 /**
  * Channel is bi-directional, user-level, lock-free exchange of
- * fixed sized messages (zero-copy).  Receiving is polling-based (it
- * can be configured as sleeping. It does not define the message
+ * fixed sized messages (zero-copy).  Receiving spins and then sleeps
+ * on a futex (the split is tunable per channel). It does not define the message
  * protocol which can be Protobuf etc.  Channel is a lock-free FIFO
  * (MPMC) in shared memory for passing pointers together with a slab
  * allocator (also lock-free and thread-safe across both sides) for
@@ -116,6 +116,18 @@ status_t uipc_send(channel_t channel, void* data);
  * @return S_OK or E_EMPTY
  */
 status_t uipc_recv(channel_t channel, void*& data_out);
+
+/**
+ * Set how long recv waits for a message
+ *
+ * @param channel Channel handle
+ * @param spin_count Number of polls before sleeping
+ * @param sleep_usec Longest sleep; 0 is pure polling
+ *
+ * @return S_OK
+ */
+status_t uipc_set_recv_wait(channel_t channel, unsigned spin_count,
+                            unsigned sleep_usec);
 }
 
 namespace Core
@@ -156,9 +168,13 @@ class Shared_memory {
 class Channel {
  private:
   static constexpr bool option_DEBUG = false;
-  typedef Common::Mpmc_bounded_lfq<void*> queue_t;
+  typedef Common::Mpmc_bounded_lfq_sleeping<void*> queue_t;
+  typedef Common::Mpmc_bounded_lfq<void*> slab_ring_t;
 
  public:
+  static constexpr unsigned DEFAULT_SPIN_COUNT = 4096;
+  static constexpr unsigned DEFAULT_SLEEP_USEC = 1000;
+
   /**
    * Master-side constructor
    *
@@ -195,7 +211,8 @@ class Channel {
   status_t send(void* msg);
 
   /**
-   * Receive message from channel
+   * Receive message from channel. When the channel is empty, spin
+   * and then sleep (see set_recv_wait) before giving up.
    *
    * @param out_msg Out message
    *
@@ -203,6 +220,18 @@ class Channel {
    */
   status_t recv(void*& recvd_msg);
 
+  /**
+   * Tune the recv wait. Latency-critical users spin longer; mostly
+   * idle channels sleep sooner.
+   *
+   * @param spin_count Number of polls (with pause) before sleeping
+   * @param sleep_usec Longest sleep before recv returns E_EMPTY; 0 never sleeps
+   */
+  void set_recv_wait(unsigned spin_count, unsigned sleep_usec) {
+    _spin_count = spin_count;
+    _sleep_usec = sleep_usec;
+  }
+
   /**
    * Allocate message (in shared memory) for
    * exchange on channel
@@ -253,7 +282,9 @@ class Channel {
 
   queue_t* _in_queue = nullptr;
   queue_t* _out_queue = nullptr;
-  queue_t* _slab_ring = nullptr;
+  slab_ring_t* _slab_ring = nullptr;
+  unsigned _spin_count = DEFAULT_SPIN_COUNT;
+  unsigned _sleep_usec = DEFAULT_SLEEP_USEC;
 };
 
 }  // namespace UIPC
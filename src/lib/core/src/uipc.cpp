@@ -58,7 +58,7 @@ Channel::Channel(std::string name, size_t message_size, size_t queue_size)
   PLOG("pages per FIFO queue: %u", pages_per_queue);
 
   size_t slab_queue_pages =
-      round_up(queue_t::memory_footprint(queue_size * 2), PAGE_SIZE) /
+      round_up(slab_ring_t::memory_footprint(queue_size * 2), PAGE_SIZE) /
       PAGE_SIZE;
 
   PLOG("slab_queue_pages: %ld", slab_queue_pages);
@@ -82,8 +82,8 @@ Channel::Channel(std::string name, size_t message_size, size_t queue_size)
       queue_size, ((char*) _shmem_fifo_s2m->get_addr()) + sizeof(queue_t));
 
   unsigned slab_slots = queue_size * 2;
-  _slab_ring = new (_shmem_slab_ring->get_addr()) queue_t(
-      slab_slots, ((char*) _shmem_slab_ring->get_addr()) + sizeof(queue_t));
+  _slab_ring = new (_shmem_slab_ring->get_addr()) slab_ring_t(
+      slab_slots, ((char*) _shmem_slab_ring->get_addr()) + sizeof(slab_ring_t));
   byte* slot_addr = (byte*) _shmem_slab->get_addr();
   for (unsigned i = 0; i < slab_slots; i++) {
     _slab_ring->enqueue(slot_addr);
@@ -110,7 +110,7 @@ Channel::Channel(std::string name) : _master(false) {
 
   _in_queue = reinterpret_cast<queue_t*>(_shmem_fifo_m2s->get_addr());
   _out_queue = reinterpret_cast<queue_t*>(_shmem_fifo_s2m->get_addr());
-  _slab_ring = reinterpret_cast<queue_t*>(_shmem_slab_ring->get_addr());
+  _slab_ring = reinterpret_cast<slab_ring_t*>(_shmem_slab_ring->get_addr());
 
   usleep(500000); /* hack to let master get ready - could improve with state in
                      shared memory */
@@ -137,7 +137,7 @@ status_t Channel::send(void* msg) {
 
 status_t Channel::recv(void*& recvd_msg) {
   assert(_in_queue);
-  if (_in_queue->dequeue(recvd_msg))
+  if (_in_queue->dequeue_wait(recvd_msg, _spin_count, _sleep_usec))
     return S_OK;
   else
     return E_EMPTY;
@@ -462,3 +462,11 @@ extern "C" status_t uipc_recv(channel_t channel, void*& data_out) {
   assert(ch);
   return ch->recv(data_out);
 }
+
+extern "C" status_t uipc_set_recv_wait(channel_t channel, unsigned spin_count,
+                                       unsigned sleep_usec) {
+  auto ch = static_cast<Core::UIPC::Channel*>(channel);
+  assert(ch);
+  ch->set_recv_wait(spin_count, sleep_usec);
+  return S_OK;
+}
@@ -16,14 +16,20 @@
 #include <common/exceptions.h>
 #include <common/logging.h>
 #include <common/utils.h>
+#include <core/avl_malloc.h>
 #include <core/conc_avl_tree.h>
 #include <core/dpdk.h>
 #include <core/physical_memory.h>
 #include <core/postbox.h>
 #include <core/uipc.h>
 #include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
+#include <functional>
+#include <set>
 #include <string>
+#include <thread>
 
 #include <core/rlf_bitmap.h>
 
@@ -77,6 +83,166 @@ TEST_F(Core_test, Bitmap)
 }
 #endif
 
+TEST_F(Core_test, SlabConcurrent)
+{
+  using slab_t = Core::Slab::Allocator<Core::Memory_region>;
+  const unsigned THREADS = 4;
+  const unsigned PER_THREAD = 10000;
+
+  size_t size = slab_t::determine_size(THREADS * PER_THREAD);
+  void * region = malloc(size);
+  slab_t slab(region, size, "test-slab", true);
+
+  std::vector<std::thread> threads;
+  std::vector<std::vector<void*>> results(THREADS);
+  for(unsigned t=0;t<THREADS;t++) {
+    threads.emplace_back([&, t]() {
+        for(unsigned round=0;round<4;round++) {
+          for(unsigned i=0;i<PER_THREAD;i++)
+            results[t].push_back(slab.alloc());
+          if(round < 3) {
+            for(auto p : results[t]) slab.free(p);
+            results[t].clear();
+          }
+        }
+      });
+  }
+  for(auto& t : threads) t.join();
+
+  std::set<void*> unique;
+  for(auto& r : results) unique.insert(r.begin(), r.end());
+  ASSERT_EQ(THREADS * PER_THREAD, unique.size());
+  ASSERT_EQ(THREADS * PER_THREAD, slab.used_slots());
+
+  free(region);
+}
+
+TEST_F(Core_test, ArenaConcurrent)
+{
+  const unsigned THREADS = 4;
+  const unsigned ITERATIONS = 20000;
+  const size_t ARENA_SIZE = MB(64);
+
+  void * arena_mem = malloc(ARENA_SIZE);
+  Core::Slab::CRuntime<Core::Memory_region> slab;
+  Core::Arena_allocator arena(slab, arena_mem, ARENA_SIZE);
+
+  std::vector<std::thread> threads;
+  for(unsigned t=0;t<THREADS;t++) {
+    threads.emplace_back([&, t]() {
+        std::vector<std::pair<char*, size_t>> live;
+        for(unsigned i=0;i<ITERATIONS;i++) {
+          size_t s = (i % 7 == 0) ? KB(4) + (i % 100) : 1 + (i * 37 % 1024);
+          char * p = static_cast<char*>(arena.alloc(s));
+          memset(p, t, s);
+          live.push_back({p, s});
+          if(live.size() > 64) {
+            auto victim = live[i % live.size()];
+            for(size_t j=0;j<victim.second;j++)
+              ASSERT_EQ(char(t), victim.first[j]);
+            ASSERT_GE(arena.free(victim.first), victim.second);
+            live[i % live.size()] = live.back();
+            live.pop_back();
+          }
+        }
+        for(auto& l : live) arena.free(l.first);
+      });
+  }
+  for(auto& t : threads) t.join();
+
+  ASSERT_EQ(ARENA_SIZE, arena.free_space());
+  free(arena_mem);
+}
+
+/* run fn on a thread pinned to cpu */
+static void run_on_cpu(int cpu, std::function<void()> fn)
+{
+  std::thread t([cpu, &fn]() {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      ASSERT_EQ(0, pthread_setaffinity_np(pthread_self(), sizeof(set), &set));
+      fn();
+    });
+  t.join();
+}
+
+/* two cpus this process may run on, or false */
+static bool two_cpus(int& a, int& b)
+{
+  cpu_set_t set;
+  if(sched_getaffinity(0, sizeof(set), &set)) return false;
+  a = b = -1;
+  for(int i=0;i<CPU_SETSIZE && b < 0;i++) {
+    if(!CPU_ISSET(i, &set)) continue;
+    if(a < 0) a = i; else b = i;
+  }
+  return b >= 0;
+}
+
+TEST_F(Core_test, SlabExhaustAcrossCores)
+{
+  using slab_t = Core::Slab::Allocator<Core::Memory_region>;
+  int cpu_a, cpu_b;
+  if(!two_cpus(cpu_a, cpu_b)) {
+    PWRN("SlabExhaustAcrossCores needs two cpus; skipped");
+    return;
+  }
+
+  size_t size = slab_t::determine_size(1000);
+  void * region = malloc(size);
+  slab_t slab(region, size, "test-slab", true);
+
+  /* leave free slots in the other core's magazine */
+  run_on_cpu(cpu_b, [&]() {
+      std::vector<void*> v;
+      for(unsigned i=0;i<100;i++) v.push_back(slab.alloc());
+      for(auto p : v) slab.free(p);
+    });
+
+  std::set<void*> unique;
+  run_on_cpu(cpu_a, [&]() {
+      for(size_t i=0;i<slab.num_slots();i++)
+        ASSERT_NO_THROW(unique.insert(slab.alloc()));
+      ASSERT_THROW(slab.alloc(), API_exception);
+    });
+  ASSERT_EQ(slab.num_slots(), unique.size());
+
+  free(region);
+}
+
+TEST_F(Core_test, ArenaExhaustAcrossCores)
+{
+  const size_t ARENA_SIZE = KB(64);
+  int cpu_a, cpu_b;
+  if(!two_cpus(cpu_a, cpu_b)) {
+    PWRN("ArenaExhaustAcrossCores needs two cpus; skipped");
+    return;
+  }
+
+  void * arena_mem = malloc(ARENA_SIZE);
+  Core::Slab::CRuntime<Core::Memory_region> slab;
+  Core::Arena_allocator arena(slab, arena_mem, ARENA_SIZE);
+
+  /* cache small blocks on the other core and in the class free list;
+     they stay allocated in the tree, spread through the arena */
+  run_on_cpu(cpu_b, [&]() {
+      std::vector<void*> v;
+      for(unsigned i=0;i<512;i++) v.push_back(arena.alloc(64));
+      for(auto p : v) arena.free(p);
+    });
+
+  /* a whole-arena allocation only fits once they are coalesced */
+  run_on_cpu(cpu_a, [&]() {
+      void * p = arena.alloc(ARENA_SIZE);
+      ASSERT_EQ(arena_mem, p);
+      arena.free(p);
+    });
+  ASSERT_EQ(ARENA_SIZE, arena.free_space());
+
+  free(arena_mem);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -17,12 +17,16 @@
 #include <common/exceptions.h>
 #include <common/utils.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <linux/magic.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include <fstream>
 #include <mutex>
 #include <set>
@@ -107,7 +111,7 @@ Devdax_manager::Devdax_manager(const std::vector<config_t>& dax_configs,
     if(register_instance(config.path) == false) /*< only one instance of this class per dax path */
       throw Constructor_exception("Devdax_manager instance already managing path (%s)", pathstr);
 
-    void *p = map_region(pathstr,config.addr);
+    void *p = map_region(config);
 
     if(dax_map::use_dram > 0) /* for DRAM, we always reset */
       force_reset = true;
@@ -226,8 +230,10 @@ void *Devdax_manager::get_devdax_region(const char *device_path,
   return r.iov_base;
 }
 
-void *Devdax_manager::map_region(const char *path, addr_t base_addr)
+void *Devdax_manager::map_region(const config_t &config)
 {
+  const char *path      = config.path.c_str();
+  addr_t      base_addr = config.addr;
   assert(base_addr);
   assert(check_aligned(base_addr, GB(1)));
 
@@ -252,6 +258,13 @@ void *Devdax_manager::map_region(const char *path, addr_t base_addr)
     return p;
   }
   
+  /* anything but a devdax device is mapped as a file */
+  {
+    struct stat statbuf;
+    if (stat(path, &statbuf) == -1 || !S_ISCHR(statbuf.st_mode))
+      return map_file_region(path, base_addr, config.size);
+  }
+
   /* open device */
   int fd = open(path, O_RDWR, 0666);
 
@@ -264,7 +277,10 @@ void *Devdax_manager::map_region(const char *path, addr_t base_addr)
   {
     struct stat statbuf;
     int         rc = fstat(fd, &statbuf);
-    if (rc == -1) throw ND_control_exception("fstat call failed");
+    if (rc == -1) {
+      close(fd);
+      throw ND_control_exception("fstat call failed");
+    }
     char spath[PATH_MAX];
     snprintf(spath, PATH_MAX, "/sys/dev/char/%u:%u/size",
              major(statbuf.st_rdev), minor(statbuf.st_rdev));
@@ -293,17 +309,81 @@ void *Devdax_manager::map_region(const char *path, addr_t base_addr)
 
   if (p != (void *) base_addr) {
     perror("");
+    close(fd);
     throw General_exception("mmap failed on devdax (request %p, got %p)", base_addr, p);
   }
 
+  close(fd);
+
   if(madvise(p, size, MADV_DONTFORK) != 0)
     throw General_exception("madvise 'don't fork' failed unexpectedly (%p %lu)",
 			    base_addr, size);
   
   _mapped_regions[std::string(path)] = {p, size};
 
+  return p;
+}
+void *Devdax_manager::map_file_region(const char *path,
+                                      addr_t      base_addr,
+                                      size_t      size)
+{
+  /* only a configured size may create the file; a mistyped device path
+     must not turn into a stray file */
+  int fd = open(path, size > 0 ? O_RDWR | O_CREAT : O_RDWR, 0666);
+
+  if (fd == -1) {
+    if (errno == ENOENT && size == 0)
+      throw General_exception("map_region: no such device (%s)", path);
+    throw General_exception("map_region: inaccessible region file (%s)", path);
+  }
+
+  struct statfs fsbuf;
+  struct stat   statbuf;
+  if (fstatfs(fd, &fsbuf) == -1 || fstat(fd, &statbuf) == -1) {
+    close(fd);
+    throw General_exception("map_region: stat failed on region file (%s)", path);
+  }
+
+  const bool hugetlb = (fsbuf.f_type == HUGETLBFS_MAGIC);
+
+  /* never shrink an existing file; regions are allocated in GB units, which
+     is also a multiple of either huge page size */
+  size = round_up(std::max(size, size_t(statbuf.st_size)), GB(1));
+  if (size < GB(2)) {
+    close(fd);
+    throw General_exception("map_region: region file (%s) needs a size of at least 2GB", path);
+  }
+
+  if (size != size_t(statbuf.st_size) && ftruncate(fd, size) == -1) {
+    close(fd);
+    throw General_exception("map_region: could not size region file (%s) to %lu", path, size);
+  }
+
+  PLOG(DEBUG_PREFIX "%s size=%lu (%s)", path, size, hugetlb ? "hugetlbfs" : "file");
+
+  /* MAP_SYNC makes CPU stores durable without fsync on fsdax; other file
+     systems refuse it and are mapped without */
+  void *p = (void *) -1;
+  if (!hugetlb)
+    p = mmap((void *) base_addr, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED_VALIDATE | MAP_FIXED | MAP_SYNC, fd, 0);
+
+  if (p == ((void *) -1))
+    p = mmap((void *) base_addr, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0);
+
   close(fd);
 
+  if (p != (void *) base_addr) {
+    perror("");
+    throw General_exception("mmap failed on region file (request %p, got %p)", base_addr, p);
+  }
+
+  if (madvise(p, size, MADV_DONTFORK) != 0)
+    throw General_exception("madvise 'don't fork' failed unexpectedly (%p %lu)",
+                            base_addr, size);
+
+  _mapped_regions[std::string(path)] = {p, size};
   return p;
 }
 }  // namespace nupm
@@ -37,6 +37,9 @@ class DM_region_header;
  * Lowest level persisent manager for devdax devices. See dax_map.cc for static
  * configuration.
  *
+ * A config path which is not a character device is mapped as a file
+ * instead: a file on hugetlbfs gives huge-page backed DRAM, and a file on
+ * fsdax (or tmpfs) lets the PM code path run without devdax hardware.
  */
 class Devdax_manager {
  private:
@@ -48,8 +51,9 @@ class Devdax_manager {
     std::string path;
     addr_t addr;
     unsigned region_id;
+    size_t size; /* file-backed only: size to create, 0 to use the file's size */
     /* Through no fault of its own, config_t may begin life with no proper values */
-    config_t() : path(), addr(0), region_id(0) {}
+    config_t() : path(), addr(0), region_id(0), size(0) {}
   };
   
   /** 
@@ -117,7 +121,8 @@ class Devdax_manager {
 
  private:
   void *get_devdax_region(const char *device_path, size_t *out_length);
-  void *map_region(const char *path, addr_t base_addr);
+  void *map_region(const config_t &config);
+  void *map_file_region(const char *path, addr_t base_addr, size_t size);
   void  recover_metadata(const char *device_path,
                          void *      p,
                          size_t      p_len,
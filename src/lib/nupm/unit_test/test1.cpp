@@ -58,6 +58,7 @@ class Libnupm_test : public ::testing::Test {
 // #define RUN_RPALLOCATOR_TESTS
 // #define RUN_VMEM_ALLOCATOR_TESTS
 #define RUN_DEVDAX_TEST
+#define RUN_FILE_REGION_TEST
 // #define RUN_AVL_RCA_TEST
 // #define RUN_AVL_STRESS_TEST
 // #define RUN_AVL_RECONST_TEST
@@ -554,6 +555,43 @@ TEST_F(Libnupm_test, DevdaxManager)
 }
 #endif
 
+#ifdef RUN_FILE_REGION_TEST
+TEST_F(Libnupm_test, FileRegion)
+{
+  /* a hugetlbfs mount (e.g. /dev/hugepages) can be used instead of /tmp */
+  const char *path = "/tmp/nupm-test-region";
+  unlink(path);
+
+  nupm::Devdax_manager::config_t config;
+  config.path = path;
+  config.addr = 0x900000000;
+  config.region_id = 0;
+  config.size = GB(4); /* sparse; header takes the first GB */
+
+  uint64_t uuid = 1;
+  void *p;
+  {
+    nupm::Devdax_manager ddm({config});
+    p = ddm.create_region(uuid, 0, GB(2));
+    ASSERT_TRUE(p);
+    memset(p, 0xe, 4096);
+  }
+
+  /* reopen: the region and its contents survive */
+  config.size = 0;
+  {
+    nupm::Devdax_manager ddm({config});
+    size_t p_len = 0;
+    void *q = ddm.open_region(uuid, 0, &p_len);
+    ASSERT_TRUE(q == p);
+    ASSERT_EQ(GB(3), p_len);
+    ASSERT_EQ(0xe, static_cast<unsigned char *>(q)[4095]);
+    ddm.erase_region(uuid, 0);
+  }
+  unlink(path);
+}
+#endif
+
 #ifdef RUN_AVL_RCA_TEST
 TEST_F(Libnupm_test, RcAllocatorAVL)
 {
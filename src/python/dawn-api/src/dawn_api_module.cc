@@ -34,6 +34,7 @@ PyDoc_STRVAR(open_connection_doc,"open_connection(ipaddr:port) -> open connectio
 extern PyTypeObject ZcStringType;
 extern PyTypeObject SessionType;
 extern PyTypeObject PoolType;
+extern PyTypeObject ValueBufferType;
 
 static PyMethodDef dawn_methods[] = {
   {"open_connection", (PyCFunction) open_connection, METH_VARARGS | METH_KEYWORDS, open_connection_doc},
@@ -80,6 +81,12 @@ PyInit_dawn(void)
     return NULL;
   }
 
+  ValueBufferType.tp_base = 0; // no inheritance
+  if(PyType_Ready(&ValueBufferType) < 0) {
+    assert(0);
+    return NULL;
+  }
+
 
   /* register module */
 #if PY_MAJOR_VERSION >= 3
@@ -5,6 +5,7 @@
 #define NO_IMPORT_ARRAY
 #define PY_ARRAY_UNIQUE_SYMBOL DAWN_ARRAY_API
 
+#include <memory>
 #include <common/logging.h>
 #include <Python.h>
 #include <structmember.h>
@@ -14,7 +15,145 @@
 /* size of values created on demand from ADO invocation */
 static constexpr unsigned long DEFAULT_ADO_ONDEMAND_VALUE_SIZE = 64;
 
+/* alignment of client-side buffers registered for zero-copy get */
+static constexpr size_t DIRECT_BUFFER_ALIGNMENT = 4096;
+
 extern PyTypeObject PoolType;
+extern PyTypeObject ValueBufferType;
+
+/**
+ * Owner of client memory holding a value.  Exposed to Python through
+ * the buffer protocol so that results can be handed out as memoryviews
+ * without copying.  Memory is either allocated by the bindings and
+ * registered with the transport (get_direct), or allocated by the
+ * client library (get); it is released when the last view goes away.
+ */
+typedef struct {
+  PyObject_HEAD
+  Component::IDawn *                   _dawn;
+  void *                               _p;
+  size_t                               _len;
+  Component::IKVStore::memory_handle_t _handle; /*< nullptr if client-allocated */
+} Value_buffer;
+
+static void
+Value_buffer_dealloc(Value_buffer *self)
+{
+  assert(self);
+  if(self->_dawn) {
+    if(self->_handle) {
+      self->_dawn->unregister_direct_memory(self->_handle);
+      ::free(self->_p);
+    }
+    else if(self->_p) {
+      self->_dawn->free_memory(self->_p);
+    }
+    self->_dawn->release_ref();
+  }
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int
+Value_buffer_getbuffer(Value_buffer *self, Py_buffer *view, int flags)
+{
+  return PyBuffer_FillInfo(view, (PyObject *) self, self->_p, self->_len, 0 /* writable */, flags);
+}
+
+static PyBufferProcs Value_buffer_as_buffer = {
+  (getbufferproc) Value_buffer_getbuffer,
+  0, /* bf_releasebuffer */
+};
+
+PyTypeObject ValueBufferType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "dawn.ValueBuffer",      /* tp_name */
+  sizeof(Value_buffer),    /* tp_basicsize */
+  0,                       /* tp_itemsize */
+  (destructor) Value_buffer_dealloc, /* tp_dealloc */
+  0,                       /* tp_print */
+  0,                       /* tp_getattr */
+  0,                       /* tp_setattr */
+  0,                       /* tp_reserved */
+  0,                       /* tp_repr */
+  0,                       /* tp_as_number */
+  0,                       /* tp_as_sequence */
+  0,                       /* tp_as_mapping */
+  0,                       /* tp_hash */
+  0,                       /* tp_call */
+  0,                       /* tp_str */
+  0,                       /* tp_getattro */
+  0,                       /* tp_setattro */
+  &Value_buffer_as_buffer, /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,      /* tp_flags */
+  "Client memory holding a value", /* tp_doc */
+};
+
+/** 
+ * Wrap client memory in a memoryview. Takes ownership of the memory
+ * (also on failure).
+ * 
+ * @param dawn Client the memory belongs to
+ * @param p Memory
+ * @param len Length of value in bytes
+ * @param handle Registration handle or nullptr if allocated by the client
+ * 
+ * @return New memoryview or NULL on error
+ */
+static PyObject * make_value_view(Component::IDawn * dawn,
+                                  void * p,
+                                  size_t len,
+                                  Component::IKVStore::memory_handle_t handle)
+{
+  auto buffer = PyObject_New(Value_buffer, &ValueBufferType);
+  if(buffer == nullptr) {
+    if(handle) {
+      dawn->unregister_direct_memory(handle);
+      ::free(p);
+    }
+    else {
+      dawn->free_memory(p);
+    }
+    return NULL;
+  }
+
+  dawn->add_ref();
+  buffer->_dawn = dawn;
+  buffer->_p = p;
+  buffer->_len = len;
+  buffer->_handle = handle;
+
+  /* the memoryview holds the only reference to the owner */
+  auto view = PyMemoryView_FromObject((PyObject *) buffer);
+  Py_DECREF(buffer);
+  return view;
+}
+
+/** 
+ * Get a contiguous read-only view of a put value. Strings are written
+ * as their canonical representation, as before; anything else must
+ * support the buffer protocol (bytes, bytearray, memoryview, numpy
+ * arrays...). The caller must PyBuffer_Release the view.
+ * 
+ * @return true on success, otherwise a Python error is set
+ */
+static bool get_value_buffer(PyObject * value, Py_buffer * view)
+{
+  if(PyUnicode_Check(value)) {
+    PyBuffer_FillInfo(view, NULL,
+                      PyUnicode_DATA(value),
+                      PyUnicode_GET_SIZE(value),
+                      1, PyBUF_SIMPLE);
+    return true;
+  }
+
+  if(PyObject_CheckBuffer(value) &&
+     PyObject_GetBuffer(value, view, PyBUF_C_CONTIGUOUS) == 0)
+    return true;
+
+  PyErr_Clear();
+  PyErr_SetString(PyExc_RuntimeError,"bad value parameter");
+  return false;
+}
 
 static PyObject * pool_close(Pool* self);
 static PyObject * pool_count(Pool* self);
@@ -22,7 +161,10 @@ static PyObject * pool_put(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_get(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_put_direct(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_get_direct(Pool* self, PyObject *args, PyObject *kwds);
+static PyObject * pool_put_many(Pool* self, PyObject *args, PyObject *kwds);
+static PyObject * pool_get_many(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_invoke_ado(Pool* self, PyObject *args, PyObject *kwds);
+static PyObject * pool_atomic_update(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_get_size(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_erase(Pool* self, PyObject *args, PyObject *kwds);
 static PyObject * pool_configure(Pool* self, PyObject *args, PyObject *kwds);
@@ -62,11 +204,14 @@ static PyMemberDef Pool_members[] = {
 };
 
 PyDoc_STRVAR(type_doc,"Pool.type() -> Return type object.");
-PyDoc_STRVAR(put_doc,"Pool.put(key,value) -> Write key-value pair to pool.");
-PyDoc_STRVAR(put_direct_doc,"Pool.put_direct(key,value) -> Write bytearray value to pool using zero-copy.");
+PyDoc_STRVAR(put_doc,"Pool.put(key,value) -> Write key-value pair to pool. Value is a string or any buffer object.");
+PyDoc_STRVAR(put_direct_doc,"Pool.put_direct(key,value) -> Write buffer object value to pool using zero-copy.");
 PyDoc_STRVAR(get_doc,"Pool.get(key) -> Read value from pool.");
 PyDoc_STRVAR(get_size_doc,"Pool.get_size(key) -> Get size of a value.");
-PyDoc_STRVAR(get_direct_doc,"Pool.get_direct(key) -> Read bytearray value from pool using zero-copy.");
+PyDoc_STRVAR(get_direct_doc,"Pool.get_direct(key) -> Read value from pool using zero-copy. Returns memoryview.");
+PyDoc_STRVAR(put_many_doc,"Pool.put_many([(key,value),...]) -> Write key-value pairs to pool.");
+PyDoc_STRVAR(get_many_doc,"Pool.get_many([key,...]) -> Read values from pool. Returns list of memoryview (None if not found).");
+PyDoc_STRVAR(atomic_update_doc,"Pool.atomic_update(key,[op,...]) -> Apply operations to a value in place. Ops are ('write',offset,value), ('zero',offset,len), ('inc',offset,delta) or ('cas',offset,expected,desired). Returns (applied,[result,...]).");
 PyDoc_STRVAR(invoke_ado_doc,"Pool.invoke_ado(key,msg) -> Send ADO message.");
 PyDoc_STRVAR(close_doc,"Pool.close() -> Forces pool closure. Otherwise close happens on deletion.");
 PyDoc_STRVAR(count_doc,"Pool.count() -> Get number of objects in the pool.");
@@ -83,6 +228,9 @@ static PyMethodDef Pool_methods[] = {
   {"put_direct",(PyCFunction) pool_put_direct, METH_VARARGS | METH_KEYWORDS, put_direct_doc},
   {"get",(PyCFunction) pool_get, METH_VARARGS | METH_KEYWORDS, get_doc},
   {"get_direct",(PyCFunction) pool_get_direct, METH_VARARGS | METH_KEYWORDS, get_direct_doc},
+  {"put_many",(PyCFunction) pool_put_many, METH_VARARGS | METH_KEYWORDS, put_many_doc},
+  {"get_many",(PyCFunction) pool_get_many, METH_VARARGS | METH_KEYWORDS, get_many_doc},
+  {"atomic_update",(PyCFunction) pool_atomic_update, METH_VARARGS | METH_KEYWORDS, atomic_update_doc},
   {"invoke_ado",(PyCFunction) pool_invoke_ado, METH_VARARGS | METH_KEYWORDS, invoke_ado_doc},
   {"get_size",(PyCFunction) pool_get_size, METH_VARARGS | METH_KEYWORDS, get_size_doc},
   {"erase",(PyCFunction) pool_erase, METH_VARARGS | METH_KEYWORDS, erase_doc},
@@ -168,27 +316,24 @@ static PyObject * pool_put(Pool* self, PyObject *args, PyObject *kwds)
     return NULL;
   }
 
-  void * p = nullptr;
-  size_t p_len = 0;
-  if(PyByteArray_Check(value)) {
-    p = PyByteArray_AsString(value);
-    p_len = PyByteArray_Size(value);
-  }
-  else if(PyUnicode_Check(value)) {
-    p = PyUnicode_DATA(value);
-    p_len = PyUnicode_GET_SIZE(value);
-  }
-  else {
-    PyErr_SetString(PyExc_RuntimeError,"bad value parameter");
+  Py_buffer view;
+  if(!get_value_buffer(value, &view))
     return NULL;
-  }
 
+  const std::string k(key);
   unsigned int flags = 0;
-  auto hr = self->_dawn->put(self->_pool,
-                             key,
-                             p,
-                             p_len,
-                             flags);
+  status_t hr;
+
+  /* the client serializes its own calls; let other Python threads run */
+  Py_BEGIN_ALLOW_THREADS
+  hr = self->_dawn->put(self->_pool,
+                        k,
+                        view.buf,
+                        view.len,
+                        flags);
+  Py_END_ALLOW_THREADS
+
+  PyBuffer_Release(&view);
                                     
   if(hr != S_OK) {
     std::stringstream ss;
@@ -221,33 +366,37 @@ static PyObject * pool_put_direct(Pool* self, PyObject *args, PyObject *kwds)
     return NULL;
   }
 
-  void * p = nullptr;
-  size_t p_len = 0;
-  
-  if(PyByteArray_Check(value)) {
-    p = PyByteArray_AsString(value);
-    p_len = PyByteArray_Size(value);
-  }
-  else {
-    PyErr_SetString(PyExc_RuntimeError,"bad arguments");
+  Py_buffer view;
+  if(PyUnicode_Check(value) || !get_value_buffer(value, &view)) {
+    if(!PyErr_Occurred())
+      PyErr_SetString(PyExc_RuntimeError,"bad arguments");
     return NULL;
   }
 
+  const std::string k(key);
   unsigned int flags = 0;
-  status_t hr;
-  Component::IKVStore::memory_handle_t handle = self->_dawn->register_direct_memory(p, p_len);
+  status_t hr = S_OK;
+  Component::IKVStore::memory_handle_t handle;
+
+  Py_BEGIN_ALLOW_THREADS
+  handle = self->_dawn->register_direct_memory(view.buf, view.len);
+  if(handle) {
+    hr = self->_dawn->put_direct(self->_pool,
+                                 k,
+                                 view.buf,
+                                 view.len,
+                                 handle,
+                                 flags);
+    self->_dawn->unregister_direct_memory(handle);
+  }
+  Py_END_ALLOW_THREADS
+
+  PyBuffer_Release(&view);
 
   if(handle == nullptr) {
     PyErr_SetString(PyExc_RuntimeError,"RDMA memory registration failed");
     return NULL;
   }
-  
-  hr = self->_dawn->put_direct(self->_pool,
-                               key,
-                               p,
-                               p_len,
-                               handle,
-                               flags);
                                     
   if(hr != S_OK) {
     std::stringstream ss;
@@ -256,9 +405,6 @@ static PyObject * pool_put_direct(Pool* self, PyObject *args, PyObject *kwds)
     return NULL;
   }
 
-  /* unregister memory */
-  self->_dawn->unregister_direct_memory(handle);
-  
   Py_INCREF(self);
   return (PyObject *) self;
 }
@@ -288,12 +434,17 @@ static PyObject * pool_get(Pool* self, PyObject *args, PyObject *kwds)
     return NULL;
   }
 
+  const std::string k(key);
   void * out_p = nullptr;
   size_t out_p_len = 0;
-  auto hr = self->_dawn->get(self->_pool,
-                             key,
-                             out_p,
-                             out_p_len);
+  status_t hr;
+
+  Py_BEGIN_ALLOW_THREADS
+  hr = self->_dawn->get(self->_pool,
+                        k,
+                        out_p,
+                        out_p_len);
+  Py_END_ALLOW_THREADS
 
   if(hr == Component::IKVStore::E_KEY_NOT_FOUND) {
     Py_RETURN_NONE;
@@ -332,12 +483,43 @@ static PyObject * pool_get_direct(Pool* self, PyObject *args, PyObject *kwds)
   assert(self->_pool);
     
   std::vector<uint64_t> v;
-  std::string k(key);
-  
-  auto hr = self->_dawn->get_attribute(self->_pool,
-                                       Component::IKVStore::Attribute::VALUE_LEN,
-                                       v,
-                                       &k);
+  const std::string k(key);
+  void * p = nullptr;
+  size_t p_len = 0;
+  Component::IKVStore::memory_handle_t handle = nullptr;
+  status_t hr;
+  bool registration_failed = false;
+
+  /* size lookup, registration and transfer all run without the GIL;
+     the value lands directly in memory that is handed to Python */
+  Py_BEGIN_ALLOW_THREADS
+  hr = self->_dawn->get_attribute(self->_pool,
+                                  Component::IKVStore::Attribute::VALUE_LEN,
+                                  v,
+                                  &k);
+  if(hr == S_OK && v.size() == 1) {
+    p_len = v[0];
+    if(::posix_memalign(&p, DIRECT_BUFFER_ALIGNMENT, p_len > 0 ? p_len : 1) == 0)
+      handle = self->_dawn->register_direct_memory(p, p_len);
+
+    if(handle == nullptr) {
+      registration_failed = true;
+    }
+    else {
+      hr = self->_dawn->get_direct(self->_pool, k, p, p_len, handle);
+      if(hr != S_OK)
+        self->_dawn->unregister_direct_memory(handle);
+    }
+
+    if(registration_failed || hr != S_OK)
+      ::free(p);
+  }
+  Py_END_ALLOW_THREADS
+
+  if(registration_failed) {
+    PyErr_SetString(PyExc_RuntimeError,"RDMA memory registration failed");
+    return NULL;
+  }
 
   if(hr != S_OK || v.size() != 1) {
     std::stringstream ss;
@@ -345,33 +527,201 @@ static PyObject * pool_get_direct(Pool* self, PyObject *args, PyObject *kwds)
     PyErr_SetString(PyExc_RuntimeError,ss.str().c_str());
     return NULL;
   }
-  
-  /* now we have the buffer size, we can allocate accordingly */
-  size_t p_len = v[0];
-  PyObject * result = PyBytes_FromStringAndSize(NULL, p_len);
 
-  void * p = (void *) PyBytes_AsString(result);
+  return make_value_view(self->_dawn, p, p_len, handle);
+}
 
-  /* register memory */
-  Component::IKVStore::memory_handle_t handle = self->_dawn->register_direct_memory(p, p_len);
 
-  if(handle == nullptr) {
-    PyErr_SetString(PyExc_RuntimeError,"RDMA memory registration failed");
+static PyObject * pool_put_many(Pool* self, PyObject *args, PyObject *kwds)
+{
+  static const char *kwlist[] = {"items",
+                                 NULL};
+
+  PyObject * items = nullptr;
+  
+  if (! PyArg_ParseTupleAndKeywords(args,
+                                    kwds,
+                                    "O",
+                                    const_cast<char**>(kwlist),
+                                    &items)) {
+    PyErr_SetString(PyExc_RuntimeError,"bad arguments");
     return NULL;
   }
-  
-  /* now perform get_direct */
-  hr = self->_dawn->get_direct(self->_pool, k, p, p_len, handle);
+
+  if(self->_pool == 0) {
+    PyErr_SetString(PyExc_RuntimeError,"already closed");
+    return NULL;
+  }
+
+  PyObject * seq = PySequence_Fast(items, "put_many expects a sequence of (key,value) pairs");
+  if(seq == nullptr)
+    return NULL;
+
+  /* gather keys and buffer views while holding the GIL */
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  std::vector<std::string> keys;
+  std::vector<Py_buffer> views;
+  keys.reserve(count);
+  views.reserve(count);
+
+  auto release_views = [&views]() {
+    for(auto& view : views)
+      PyBuffer_Release(&view);
+  };
+
+  for(Py_ssize_t i=0;i<count;i++) {
+    PyObject * item = PySequence_Fast_GET_ITEM(seq, i);
+    const char * key = nullptr;
+    PyObject * value = nullptr;
+    Py_buffer view;
+
+    if(!PyTuple_Check(item) || !PyArg_ParseTuple(item, "sO", &key, &value)) {
+      PyErr_Clear();
+      PyErr_SetString(PyExc_RuntimeError,"bad (key,value) item");
+      release_views();
+      Py_DECREF(seq);
+      return NULL;
+    }
+
+    if(!get_value_buffer(value, &view)) {
+      release_views();
+      Py_DECREF(seq);
+      return NULL;
+    }
+    keys.push_back(key);
+    views.push_back(view);
+  }
+
+  status_t hr = S_OK;
+  Py_ssize_t failed = 0;
+
+  /* issue the whole batch with the GIL released */
+  Py_BEGIN_ALLOW_THREADS
+  for(Py_ssize_t i=0;i<count;i++) {
+    hr = self->_dawn->put(self->_pool,
+                          keys[i],
+                          views[i].buf,
+                          views[i].len,
+                          0 /* flags */);
+    if(hr != S_OK) {
+      failed = i;
+      break;
+    }
+  }
+  Py_END_ALLOW_THREADS
+
+  release_views();
+  Py_DECREF(seq);
+
   if(hr != S_OK) {
     std::stringstream ss;
-    ss << "pool.get_direct failed [status:" << hr << "]";
+    ss << "pool.put_many failed on item " << failed << " [status:" << hr << "]";
     PyErr_SetString(PyExc_RuntimeError,ss.str().c_str());
     return NULL;
   }
 
-  self->_dawn->unregister_direct_memory(handle);
+  Py_INCREF(self);
+  return (PyObject *) self;
+}
+
+
+static PyObject * pool_get_many(Pool* self, PyObject *args, PyObject *kwds)
+{
+  static const char *kwlist[] = {"keys",
+                                 NULL};
+
+  PyObject * keys_param = nullptr;
   
-  return result;
+  if (! PyArg_ParseTupleAndKeywords(args,
+                                    kwds,
+                                    "O",
+                                    const_cast<char**>(kwlist),
+                                    &keys_param)) {
+    PyErr_SetString(PyExc_RuntimeError,"bad arguments");
+    return NULL;
+  }
+
+  if(self->_pool == 0) {
+    PyErr_SetString(PyExc_RuntimeError,"already closed");
+    return NULL;
+  }
+
+  PyObject * seq = PySequence_Fast(keys_param, "get_many expects a sequence of keys");
+  if(seq == nullptr)
+    return NULL;
+
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  std::vector<std::string> keys;
+  keys.reserve(count);
+
+  for(Py_ssize_t i=0;i<count;i++) {
+    const char * key = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+    if(key == nullptr) {
+      Py_DECREF(seq);
+      return NULL;
+    }
+    keys.push_back(key);
+  }
+  Py_DECREF(seq);
+
+  struct result_t {
+    void *   p;
+    size_t   len;
+    status_t hr;
+  };
+  std::vector<result_t> results(count, result_t{nullptr, 0, S_OK});
+
+  Py_BEGIN_ALLOW_THREADS
+  for(Py_ssize_t i=0;i<count;i++) {
+    results[i].hr = self->_dawn->get(self->_pool,
+                                     keys[i],
+                                     results[i].p,
+                                     results[i].len);
+  }
+  Py_END_ALLOW_THREADS
+
+  /* values stay in client memory; each memoryview owns its value */
+  PyObject * list = PyList_New(count);
+  status_t failed_hr = S_OK;
+  for(Py_ssize_t i=0;i<count;i++) {
+    auto& r = results[i];
+    PyObject * item = nullptr;
+
+    if(r.hr == S_OK && r.p && list && failed_hr == S_OK) {
+      item = make_value_view(self->_dawn, r.p, r.len, nullptr);
+      r.p = nullptr;
+    }
+    else if(r.hr == Component::IKVStore::E_KEY_NOT_FOUND) {
+      Py_INCREF(Py_None);
+      item = Py_None;
+    }
+    else if(failed_hr == S_OK && (r.hr != S_OK || r.p == nullptr)) {
+      failed_hr = (r.hr != S_OK) ? r.hr : E_FAIL;
+    }
+
+    if(r.p)
+      self->_dawn->free_memory(r.p); /* not handed out */
+
+    if(list && item)
+      PyList_SET_ITEM(list, i, item);
+    else
+      Py_XDECREF(item);
+  }
+
+  if(list == nullptr)
+    return NULL;
+
+  if(failed_hr != S_OK || PyErr_Occurred()) {
+    Py_DECREF(list);
+    if(!PyErr_Occurred()) {
+      std::stringstream ss;
+      ss << "pool.get_many failed [status:" << failed_hr << "]";
+      PyErr_SetString(PyExc_RuntimeError,ss.str().c_str());
+    }
+    return NULL;
+  }
+
+  return list;
 }
 
 
@@ -425,6 +775,133 @@ static PyObject * pool_invoke_ado(Pool* self, PyObject *args, PyObject *kwds)
 }
 
 
+static PyObject * pool_atomic_update(Pool* self, PyObject *args, PyObject *kwds)
+{
+  using IKVStore = Component::IKVStore;
+
+  static const char *kwlist[] = {"key",
+                                 "ops",
+                                 NULL};
+
+  const char * key = nullptr;
+  PyObject * ops = nullptr;
+
+  if (! PyArg_ParseTupleAndKeywords(args,
+                                    kwds,
+                                    "sO",
+                                    const_cast<char**>(kwlist),
+                                    &key,
+                                    &ops)) {
+    PyErr_SetString(PyExc_RuntimeError,"bad arguments");
+    return NULL;
+  }
+
+  if(self->_pool == 0) {
+    PyErr_SetString(PyExc_RuntimeError,"already closed");
+    return NULL;
+  }
+
+  PyObject * seq = PySequence_Fast(ops, "atomic_update expects a sequence of operation tuples");
+  if(seq == nullptr)
+    return NULL;
+
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  std::vector<std::unique_ptr<IKVStore::Operation>> op_storage;
+  std::vector<IKVStore::Operation*> op_vector;
+  std::vector<Py_buffer> views;
+
+  auto release_views = [&views]() {
+    for(auto& view : views)
+      PyBuffer_Release(&view);
+  };
+
+  for(Py_ssize_t i=0;i<count;i++) {
+    PyObject * item = PySequence_Fast_GET_ITEM(seq, i);
+    const char * name = nullptr;
+    unsigned long long offset = 0, arg0 = 0, arg1 = 0;
+    PyObject * value = nullptr;
+
+    if(!PyTuple_Check(item) || PyTuple_Size(item) < 1 ||
+       (name = PyUnicode_AsUTF8(PyTuple_GET_ITEM(item, 0))) == nullptr) {
+      PyErr_Clear();
+      PyErr_SetString(PyExc_RuntimeError,"bad operation item");
+      release_views();
+      Py_DECREF(seq);
+      return NULL;
+    }
+
+    bool ok = false;
+    std::string op_name(name);
+
+    if(op_name == "write") {
+      Py_buffer view;
+      ok = PyArg_ParseTuple(item, "sKO", &name, &offset, &value) &&
+        get_value_buffer(value, &view);
+      if(ok) {
+        views.push_back(view);
+        op_storage.emplace_back(new IKVStore::Operation_write(offset, view.len, view.buf));
+      }
+    }
+    else if(op_name == "zero") {
+      ok = PyArg_ParseTuple(item, "sKK", &name, &offset, &arg0);
+      if(ok) op_storage.emplace_back(new IKVStore::Operation_zero(offset, arg0));
+    }
+    else if(op_name == "inc") {
+      ok = PyArg_ParseTuple(item, "sKK", &name, &offset, &arg0);
+      if(ok) op_storage.emplace_back(new IKVStore::Operation_increment_uint64(offset, arg0));
+    }
+    else if(op_name == "cas") {
+      ok = PyArg_ParseTuple(item, "sKKK", &name, &offset, &arg0, &arg1);
+      if(ok) op_storage.emplace_back(new IKVStore::Operation_cas_uint64(offset, arg0, arg1));
+    }
+
+    if(!ok) {
+      if(!PyErr_Occurred())
+        PyErr_SetString(PyExc_RuntimeError,"unknown operation");
+      release_views();
+      Py_DECREF(seq);
+      return NULL;
+    }
+    op_vector.push_back(op_storage.back().get());
+  }
+
+  status_t hr;
+  std::string k(key);
+
+  Py_BEGIN_ALLOW_THREADS
+  hr = self->_dawn->atomic_update(self->_pool, k, op_vector);
+  Py_END_ALLOW_THREADS
+
+  release_views();
+  Py_DECREF(seq);
+
+  if(hr != S_OK && hr != IKVStore::E_CAS_FAILED) {
+    std::stringstream ss;
+    ss << "pool.atomic_update failed [status:" << hr << "]";
+    PyErr_SetString(PyExc_RuntimeError,ss.str().c_str());
+    return NULL;
+  }
+
+  /* results for inc (previous value) and cas (observed value) */
+  PyObject * results = PyList_New(count);
+  for(Py_ssize_t i=0;i<count;i++) {
+    PyObject * r;
+    auto op = op_vector[i];
+    if(op->type() == IKVStore::Op_type::INCREMENT_UINT64)
+      r = PyLong_FromUnsignedLongLong(static_cast<IKVStore::Operation_increment_uint64*>(op)->result());
+    else if(op->type() == IKVStore::Op_type::CAS_UINT64)
+      r = PyLong_FromUnsignedLongLong(static_cast<IKVStore::Operation_cas_uint64*>(op)->result());
+    else {
+      Py_INCREF(Py_None);
+      r = Py_None;
+    }
+    PyList_SET_ITEM(results, i, r);
+  }
+
+  return Py_BuildValue("(NN)", PyBool_FromLong(hr == S_OK), results);
+}
+
+
 static PyObject * pool_get_size(Pool* self, PyObject *args, PyObject *kwds)
 {
   static const char *kwlist[] = {"key",
@@ -18,6 +18,7 @@
 #include <api/components.h>
 #include <api/fabric_itf.h>
 #include <api/kvstore_itf.h>
+#include <numa.h>
 #include <sys/mman.h>
 #include "dawn_config.h"
 
@@ -111,6 +112,10 @@ class Buffer_manager {
 
       assert(iov->iov_base);
       madvise(iov->iov_base, iov->iov_len, MADV_HUGEPAGE);
+      /* the shard thread is pinned; keep buffers on its node even if
+         the heap hands back pages first touched elsewhere */
+      if (numa_available() >= 0)
+        numa_setlocal_memory(iov->iov_base, iov->iov_len);
       memset(iov->iov_base, 0, iov->iov_len);
       return iov;
     };
@@ -43,20 +43,25 @@ int Connection_handler::tick()
 
   switch (_state) {
 
-  case POST_MSG_RECV: { /*< post buffer to receive new message */
-    if (option_DEBUG > 2)
-      PMAJOR("Shard State: %lu %p POST_MSG_RECV", _tick_count, this);
-    post_recv_buffer(allocate());
+  case POST_MSG_RECV: { /*< post buffers to receive new messages */
+    /* flow control: keep one receive posted for each credit not taken
+       by a request waiting for the scheduler */
+    while (posted_recv_count() + _pending_msgs.size() < _credits) {
+      if (option_DEBUG > 2)
+        PMAJOR("Shard State: %lu %p POST_MSG_RECV", _tick_count, this);
+      post_recv_buffer(allocate());
+    }
+    if (posted_recv_count() == 0) {
+      _stats.flow_control_stalls++;
+      break;
+    }
     set_state(WAIT_NEW_MSG_RECV);
     stall(); /* we can stall because we know that there will be a little while before the next request */
     break;
   }      
   case WAIT_NEW_MSG_RECV: {
       
-    if (check_for_posted_recv_complete()) { /*< check for recv completion */
-        
-      const auto iob = posted_recv();
-      assert(iob);
+    if (const auto iob = completed_recv()) { /*< check for recv completion */
         
       const Message *msg = Dawn::Protocol::message_cast(iob->base());
       assert(msg);
@@ -64,7 +69,10 @@ int Connection_handler::tick()
       switch (msg->type_id) {
       case MSG_TYPE_IO_REQUEST: {
         if (option_DEBUG > 2) PMAJOR("Shard: IO_REQUEST");
-        _pending_msgs.push_back(iob);
+        if (msg->resvd & MSG_RESVD_BATCH)
+          unpack_batch(iob);
+        else
+          _pending_msgs.push_back(iob);
         set_state(POST_MSG_RECV);
         break;
       }
@@ -76,7 +84,7 @@ int Connection_handler::tick()
       }
       case MSG_TYPE_CLOSE_SESSION: {
         if (option_DEBUG > 2) PMAJOR("Shard: CLOSE_SESSION!");
-        free_recv_buffer();
+        free_buffer(iob);
         response = TICK_RESPONSE_CLOSE;
         break;
       }
@@ -125,6 +133,12 @@ int Connection_handler::tick()
       delete _posted_value_buffer; /* delete descriptor */
       _posted_value_buffer = nullptr;
 
+      /* the client may reuse its value memory once it has the response */
+      if (_value_response) {
+        post_send_buffer(_value_response);
+        _value_response = nullptr;
+      }
+
       if (option_DEBUG > 2)
         PMAJOR("Shard State: %lu %p WAIT_RECV_VALUE_COMPLETE", _tick_count,
                this);
@@ -153,24 +167,23 @@ int Connection_handler::tick()
   }
   case WAIT_HANDSHAKE: {
         
-    if (check_for_posted_recv_complete()) {
+    if (const auto iob = completed_recv()) {
       if (option_DEBUG > 2)
         PMAJOR("Shard State: %lu %p WAIT_HANDSHAKE complete", _tick_count,
                this);
 
-      const auto iob = posted_recv();
-      assert(iob);
-
-      auto msg =
-        Dawn::Protocol::message_cast(iob->base())->ptr_cast<Message_handshake>();
+      /* throws unless the message is a handshake */
+      Dawn::Protocol::message_cast(iob->base())->ptr_cast<Message_handshake>();
+      free_buffer(iob);
 
       auto reply_iob = allocate();
       assert(reply_iob);
       auto reply_msg =
         new (reply_iob->base()) Dawn::Protocol::Message_handshake_reply(auth_id(),
                                                                         1 /* seq */,
+                                                                        (uint64_t) this,
                                                                         max_message_size(),
-                                                                        (uint64_t) this);
+                                                                        _credits);
       /* post response */
       reply_iob->set_length(reply_msg->msg_len);
       post_send_buffer(reply_iob);
@@ -195,12 +208,71 @@ int Connection_handler::tick()
   return response;
 }
 
+void Connection_handler::unpack_batch(buffer_t *iob)
+{
+  using namespace Dawn::Protocol;
+
+  /* the requests after the first are queued as descriptors into the
+     receive buffer, which is freed when the last of them is released */
+  assert(_batch_buffer == nullptr);
+  _batch_buffer    = iob;
+  _batch_remaining = 1;
+  _pending_msgs.push_back(iob);
+
+  auto   base   = static_cast<char *>(iob->base());
+  auto   msg    = message_cast(base);
+  size_t offset = 0;
+
+  while (msg->resvd & MSG_RESVD_BATCH) {
+    offset += batch_stride(msg->msg_len);
+    if (offset + sizeof(Message) > iob->original_length)
+      throw Protocol_exception("malformed request batch");
+
+    msg = message_cast(base + offset);
+    if (msg->type_id != MSG_TYPE_IO_REQUEST ||
+        offset + msg->msg_len > iob->original_length)
+      throw Protocol_exception("malformed request batch");
+
+    auto sub    = new buffer_t(msg->msg_len);
+    sub->iov    = new ::iovec{base + offset, msg->msg_len};
+    sub->region = iob->region;
+    sub->desc   = iob->desc;
+    sub->flags  = Buffer_manager<Fabric_connection_base>::BUFFER_FLAGS_EXTERNAL;
+
+    _pending_msgs.push_back(sub);
+    _batch_remaining++;
+    _stats.recv_msg_count++;
+    _stats.batched_msg_count++;
+  }
+}
+
+void Connection_handler::release_msg_buffer(buffer_t *iob)
+{
+  if (iob->is_external() || (_batch_remaining > 0 && iob == _batch_buffer)) {
+    if (iob != _batch_buffer) delete iob; /* descriptor only */
+
+    assert(_batch_remaining > 0);
+    if (--_batch_remaining == 0) {
+      iob = _batch_buffer;
+      _batch_buffer = nullptr;
+    }
+    else
+      return;
+  }
+
+  free_buffer(iob);
+}
+
 void Connection_handler::set_pending_value(void *          target,
                                            size_t          target_len,
-                                           memory_region_t region)
+                                           memory_region_t region,
+                                           uint64_t        remote_addr,
+                                           uint64_t        remote_key,
+                                           buffer_t *      response)
 {
   assert(target);
   assert(target_len);
+  assert(response);
 
   if (option_DEBUG > 2)
     PLOG("set_pending_value (target=%p, target_len=%lu, handle=%p)",
@@ -215,9 +287,9 @@ void Connection_handler::set_pending_value(void *          target,
   _posted_value_buffer->desc   = desc;
   _posted_value_buffer->flags =
     Buffer_manager<Fabric_connection_base>::BUFFER_FLAGS_EXTERNAL;
-  _posted_value_buffer_outstanding = true;
+  _value_response = response;
 
-  post_recv_value_buffer(_posted_value_buffer);
+  post_read_value_buffer(_posted_value_buffer, remote_addr, remote_key);
   set_state(State::WAIT_RECV_VALUE);
 }
 
@@ -22,6 +22,7 @@
 #include <common/logging.h>
 #include <common/cycles.h>
 #include <sys/mman.h>
+#include <deque>
 #include <map>
 #include <queue>
 #include <set>
@@ -50,6 +51,11 @@ class Connection_handler
 
   unsigned option_DEBUG = Dawn::Global::debug_level;
   static constexpr uint64_t STALL_TICKS = 20; /*< number of ticks to stall after post */
+  static constexpr unsigned DEFAULT_CREDITS = 3; /*< receives kept posted per session */
+  /* each queued request may also hold a response buffer, and a response
+     may still be in flight when its request buffer is reposted */
+  static_assert(2 * DEFAULT_CREDITS < Buffer_manager<Component::IFabric_server>::DEFAULT_BUFFER_COUNT,
+                "too few buffers for credits");
   
   /* Adaptor point for different transports */
   using Connection = Component::IFabric_server;
@@ -87,7 +93,6 @@ class Connection_handler
       : Connection_base(factory, connection), Region_manager(connection)
   {
     _pending_actions.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
-    _pending_msgs.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
     _freq_mhz = Common::get_rdtsc_frequency_mhz();
   }
 
@@ -146,13 +151,47 @@ class Connection_handler
   inline buffer_t* get_pending_msg(Dawn::Protocol::Message*& msg)
   {
     if (_pending_msgs.empty()) return nullptr;
-    auto iob = _pending_msgs.back();
+    auto iob = _pending_msgs.front();
     assert(iob);
-    _pending_msgs.pop_back();
+    _pending_msgs.pop_front();
     msg = static_cast<Dawn::Protocol::Message*>(iob->base());
     return iob;
   }
 
+  /**
+   * Release the buffer of a message taken with get_pending_msg
+   *
+   * @param iob Buffer returned by get_pending_msg
+   */
+  void release_msg_buffer(buffer_t* iob);
+
+  /**
+   * Look at the next pending message without dequeuing it. Messages
+   * wait while a value transfer is in flight, as it uses the
+   * connection's one value buffer.
+   *
+   * @return Pointer to message or null if there are none
+   */
+  inline const Dawn::Protocol::Message* peek_pending_msg() const
+  {
+    if (_pending_msgs.empty()) return nullptr;
+    if (_state == WAIT_RECV_VALUE || _state == WAIT_SEND_VALUE) return nullptr;
+    return static_cast<const Dawn::Protocol::Message*>(_pending_msgs.front()->base());
+  }
+
+  /**
+   * Number of requests the client may have outstanding. Advertised
+   * in the handshake; a receive is kept posted for each credit not
+   * taken by a request waiting to be scheduled.
+   */
+  inline unsigned credits() const { return _credits; }
+
+  /* deficit round-robin state, maintained by the shard scheduler */
+  inline uint64_t deficit() const { return _deficit; }
+  inline void add_deficit(uint64_t quantum) { _deficit += quantum; }
+  inline void consume_deficit(uint64_t cost) { _deficit -= cost; }
+  inline void reset_deficit() { _deficit = 0; }
+
   /**
    * Get deferrd action
    *
@@ -199,15 +238,22 @@ class Connection_handler
   }
 
   /**
-   * Set up for pending value send/recv
+   * Read a value from client memory into the store (see
+   * OP_PUT_ADVANCE). The response is posted once the read completes.
    *
    * @param target
    * @param target_len
    * @param region
+   * @param remote_addr Client address of the value
+   * @param remote_key Client memory key
+   * @param response Response to post on completion
    */
   void set_pending_value(void*  target,
                          size_t target_len,
-                         Component::IFabric_connection::memory_region_t region);
+                         Component::IFabric_connection::memory_region_t region,
+                         uint64_t  remote_addr,
+                         uint64_t  remote_key,
+                         buffer_t* response);
 
   void set_pending_send_value();
 
@@ -248,6 +294,8 @@ class Connection_handler
     uint64_t wait_recv_value_misses       = 0;
     uint64_t wait_msg_recv_misses         = 0;
     uint64_t wait_respond_complete_misses = 0;
+    uint64_t flow_control_stalls          = 0;
+    uint64_t batched_msg_count            = 0;
     uint64_t last_count                   = 0;
     uint64_t next_stamp                   = 0;
   } _stats __attribute__((aligned(8)));
@@ -265,17 +313,31 @@ class Connection_handler
     PINF("Response count              : %lu", _stats.response_count);
     PINF("WAIT_RECV_VALUE misses      : %lu", _stats.wait_recv_value_misses);
     PINF("WAIT_RESPOND_COMPLETE misses: %lu", _stats.wait_respond_complete_misses);
+    PINF("Flow control stalls         : %lu", _stats.flow_control_stalls);
+    PINF("Batched message count       : %lu", _stats.batched_msg_count);
     PINF("-----------------------------------------");
   }
 
  private:
 
+  /**
+   * Queue the requests of a batch (see MSG_RESVD_BATCH)
+   *
+   * @param iob Receive buffer holding the batch
+   */
+  void unpack_batch(buffer_t* iob);
+
   /* list of pre-registered memory regions; normally one region */
   std::vector<Component::IKVStore::memory_handle_t> _mr_vector;
   
   uint64_t               _tick_count __attribute((aligned(8))) = 0;
   uint64_t               _stall_tick __attribute((aligned(8))) = 0;  
-  std::vector<buffer_t*> _pending_msgs;
+  std::deque<buffer_t*>  _pending_msgs;
+  buffer_t*              _batch_buffer    = nullptr; /* freed with the last request of the batch */
+  unsigned               _batch_remaining = 0;
+  unsigned               _credits = DEFAULT_CREDITS;
+  buffer_t*              _value_response = nullptr; /* posted when the value read completes */
+  uint64_t               _deficit = 0;
   std::vector<action_t>  _pending_actions;
   float                  _freq_mhz;
   Pool_manager           _pool_manager; /* instance shared across connections */
@@ -13,6 +13,9 @@
 #ifndef __FABRIC_CONNECTION_BASE_H__
 #define __FABRIC_CONNECTION_BASE_H__
 
+#include <algorithm>
+#include <deque>
+#include <vector>
 #include "dawn_config.h"
 
 namespace Dawn
@@ -94,17 +97,21 @@ class Fabric_connection_base {
       throw Program_exception("RDMA operation failed unexpectedly (context=%p)",
                               context);
 
-    if (context == pThis->_posted_recv_buffer) {
-      assert(pThis->_posted_recv_buffer_outstanding);
-      assert(pThis->_posted_recv_buffer);
+    auto &recvs = pThis->_posted_recv_buffers;
+    auto &sends = pThis->_posted_send_buffers;
+    auto  recv  = std::find(recvs.begin(), recvs.end(), context);
+    auto  send  = std::find(sends.begin(), sends.end(), context);
+
+    if (recv != recvs.end()) {
       if (option_DEBUG) PLOG("Posted recv complete (%p).", context);
-      pThis->_posted_recv_buffer_outstanding = false; /* signal recv completion */
+      pThis->_completed_recv_buffers.push_back(*recv); /* signal recv completion */
+      recvs.erase(recv);
       return;
     }
-    else if (context == pThis->_posted_send_buffer) {
-      assert(pThis->_posted_send_buffer_outstanding);
+    else if (send != sends.end()) {
       if (option_DEBUG) PLOG("Posted send complete (%p).", context);
-      pThis->_posted_send_buffer_outstanding = false; /* signal send completion */
+      pThis->free_buffer(*send);
+      sends.erase(send);
       return;
     }
     else if (context == pThis->_posted_value_buffer) {
@@ -121,22 +128,29 @@ class Fabric_connection_base {
     }
   }
 
-  bool check_for_posted_send_complete()
+  inline bool check_for_posted_send_complete()
   {
-    if (_posted_send_buffer_outstanding) return false;
-
-    if (_posted_send_buffer) {
-      free_buffer(_posted_send_buffer);
-      _posted_send_buffer = nullptr;
-    }
+    /* send buffers are freed as they complete */
+    return _posted_send_buffers.empty();
+  }
 
-    return true;
+  /**
+   * Take the oldest completed receive; the caller frees the buffer
+   *
+   * @return Receive buffer or null if none has completed
+   */
+  buffer_t *completed_recv()
+  {
+    if (_completed_recv_buffers.empty()) return nullptr;
+    auto iob = _completed_recv_buffers.front();
+    _completed_recv_buffers.pop_front();
+    return iob;
   }
 
-  inline bool check_for_posted_recv_complete()
+  /* receives posted and not yet taken with completed_recv */
+  inline size_t posted_recv_count() const
   {
-    /* don't free buffer (such as above); it will be used for response */
-    return _posted_recv_buffer_outstanding == false;
+    return _posted_recv_buffers.size() + _completed_recv_buffers.size();
   }
 
   bool check_for_posted_value_complete(bool *added_deferred_unlock = nullptr)
@@ -154,30 +168,16 @@ class Fabric_connection_base {
   }
 
 
-  void free_recv_buffer()
-  {
-    assert(_posted_recv_buffer_outstanding == false);
-    assert(_posted_recv_buffer);
-
-    free_buffer(_posted_recv_buffer);
-    _posted_recv_buffer = nullptr;
-  }
-
   void post_recv_buffer(buffer_t *buffer)
   {
     assert(buffer);
-    assert(_posted_recv_buffer_outstanding == false);
-    _posted_recv_buffer             = buffer;
-    _posted_recv_buffer_outstanding = true;
-    _transport->post_recv(_posted_recv_buffer->iov,
-                          _posted_recv_buffer->iov + 1,
-                          &_posted_recv_buffer->desc, _posted_recv_buffer);
+    _posted_recv_buffers.push_back(buffer);
+    _transport->post_recv(buffer->iov, buffer->iov + 1, &buffer->desc, buffer);
   }
 
   void post_send_buffer(buffer_t *buffer, buffer_t *val_buffer = nullptr)
   {
     assert(buffer);
-    assert(_posted_send_buffer_outstanding == false);
     const auto iov = buffer->iov;
 
     if (!val_buffer) {
@@ -187,16 +187,12 @@ class Fabric_connection_base {
         free_buffer(buffer); /* buffer can be immediately freed; see fi_inject */
       }
       else {
-        _posted_send_buffer             = buffer;
-        _posted_send_buffer_outstanding = true;
-
-        _transport->post_send(iov, iov + 1, &_posted_send_buffer->desc,
-                              _posted_send_buffer);
+        _posted_send_buffers.push_back(buffer);
+        _transport->post_send(iov, iov + 1, &buffer->desc, buffer);
       }
     }
     else {
-      _posted_send_buffer             = buffer;
-      _posted_send_buffer_outstanding = true;
+      _posted_send_buffers.push_back(buffer);
 
       iovec v[2]   = {*buffer->iov, *val_buffer->iov};
       void *desc[] = {buffer->desc, val_buffer->desc};
@@ -233,48 +229,41 @@ class Fabric_connection_base {
 
   }
 
-  void post_recv_value_buffer(buffer_t *buffer = nullptr)
+  /**
+   * Read a value from client memory (see OP_PUT_ADVANCE)
+   *
+   * @param buffer Descriptor for the local target
+   * @param remote_addr Client address of the value
+   * @param key Client memory key
+   */
+  void post_read_value_buffer(buffer_t *buffer, uint64_t remote_addr, uint64_t key)
   {
-    if (buffer) {
-      _posted_value_buffer = buffer;
-    }
-    else {} /* buffer already set up */
-    
-    assert(_posted_value_buffer);
+    assert(buffer);
+    _posted_value_buffer             = buffer;
     _posted_value_buffer_outstanding = true;
-    _transport->post_recv(_posted_value_buffer->iov,
+    _transport->post_read(_posted_value_buffer->iov,
                           _posted_value_buffer->iov + 1,
                           &_posted_value_buffer->desc,
+                          remote_addr, key,
                           _posted_value_buffer);
 
-    
     if(option_DEBUG)
-      PLOG("posted recv value buffer (%p)(base=%p,len=%lu,desc=%p)",
-	   buffer,
-	   _posted_value_buffer->iov->iov_base,
-	   _posted_value_buffer->iov->iov_len,
-	   _posted_value_buffer->desc);
-
+      PLOG("posted read value buffer (%p)(base=%p,len=%lu,remote=%lx)",
+           buffer,
+           _posted_value_buffer->iov->iov_base,
+           _posted_value_buffer->iov->iov_len,
+           remote_addr);
   }
 
-  inline buffer_t *posted_recv() const { return _posted_recv_buffer; }
-  inline buffer_t *posted_send() const { return _posted_send_buffer; }
-
   Completion_state poll_completions()
   {
-    if( _posted_recv_buffer_outstanding ||
-        _posted_send_buffer_outstanding ||
+    if( !_posted_recv_buffers.empty() ||
+        !_posted_send_buffers.empty() ||
         _posted_value_buffer_outstanding)
       {       
         bool added_deferred_unlock = false;
         try {
           _transport->poll_completions(completion_callback, this);
-          /* Note: this test may be in error, as the function of
-	   * check_for_posted_send_complete is not to complete the
-	   * send but to free the buffer after the send completes. */
-          if(_posted_send_buffer_outstanding)
-            check_for_posted_send_complete();
-
           if(_posted_value_buffer_outstanding)
             check_for_posted_value_complete(&added_deferred_unlock);
         }
@@ -329,14 +318,14 @@ class Fabric_connection_base {
   std::vector<memory_region_t>       _registered_regions;
   void *                             _deferred_unlock = nullptr;
 
-  /* xx_buffer_outstanding is the signal for completion,
-     xx_buffer is the buffer pointer that needs to be freed (and set to null)
+  /* receives complete in posting order, so up to the session's credit
+     may be posted at once. Sends are freed as they complete.
+     _posted_value_buffer_outstanding is the signal for value completion,
+     _posted_value_buffer is the descriptor that needs to be freed (and set to null)
   */
-  buffer_t *_posted_recv_buffer             = nullptr;
-  bool      _posted_recv_buffer_outstanding = false;
-
-  buffer_t *_posted_send_buffer             = nullptr;
-  bool      _posted_send_buffer_outstanding = false;
+  std::deque<buffer_t *> _posted_recv_buffers;    /* in posting order */
+  std::deque<buffer_t *> _completed_recv_buffers; /* in completion order */
+  std::vector<buffer_t *> _posted_send_buffers;
 
   /* value for two-phase get & put - assumes get and put don't happen
      at the same time for the same FSM
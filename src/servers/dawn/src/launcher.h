@@ -18,6 +18,7 @@
 #include <string>
 
 #include "config_file.h"
+#include "numa_topology.h"
 #include "program_options.h"
 #include "shard.h"
 
@@ -34,6 +35,8 @@ class Shard_launcher : public Config_file {
       auto dax_config = get_shard_dax_config(i);
       std::string dax_config_json;
 
+      check_numa_placement(i, dax_config);
+
       /* handle DAX config if needed */
       if(dax_config.size() > 0) {
         std::stringstream ss;
@@ -86,6 +89,32 @@ class Shard_launcher : public Config_file {
   }
 
  private:
+  /** 
+   * Warn about shards whose network or storage device sits on a
+   * different NUMA node from the shard core.  Shard memory itself is
+   * bound to the core's node by the shard thread.
+   */
+  void check_numa_placement(unsigned i,
+                            const std::vector<std::pair<std::string, std::string>>& dax_config)
+  {
+    int node = Numa::core_node(get_shard_core(i));
+    if (node < 0) return;
+
+    PLOG("shard %u: core(%u) on NUMA node %d", i, get_shard_core(i), node);
+
+    auto net = get_shard("net", i);
+    Numa::check_local(i, node, "network device", net, Numa::net_device_node(net));
+
+    for (auto& d : dax_config)
+      Numa::check_local(i, node, "DAX device", d.first, Numa::dax_device_node(d.first));
+
+    auto nvme = get_shard("nvme_device", i);
+    Numa::check_local(i, node, "NVMe device", nvme, Numa::pci_device_node(nvme));
+
+    auto pm_path = get_shard("pm_path", i);
+    Numa::check_local(i, node, "pm_path device", pm_path, Numa::path_device_node(pm_path));
+  }
+
   std::vector<Dawn::Shard*> _shards;
 };
 }  // namespace Dawn
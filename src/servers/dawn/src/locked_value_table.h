@@ -0,0 +1,135 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __DAWN_LOCKED_VALUE_TABLE_H__
+#define __DAWN_LOCKED_VALUE_TABLE_H__
+
+#include <api/kvstore_itf.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dawn
+{
+/**
+ * Flat open-addressing table of locked values, keyed by value
+ * address.  Linear probing over a power-of-two array with
+ * backward-shift deletion, so there are no tombstones and no per-entry
+ * allocation.  The array only grows; it is sized for the peak number
+ * of outstanding two-stage operations.  Single-threaded (shard thread).
+ *
+ */
+class Locked_value_table {
+ public:
+  struct lock_info_t {
+    const void*                 target; /*< nullptr marks an empty slot */
+    Component::IKVStore::pool_t pool;
+    Component::IKVStore::key_t  key;
+    int                         count;
+  };
+
+  static constexpr size_t INITIAL_CAPACITY = 256;
+
+  Locked_value_table() : _slots(INITIAL_CAPACITY), _mask(INITIAL_CAPACITY - 1) {}
+
+  size_t size() const { return _size; }
+
+  /**
+   * Find entry for target
+   *
+   * @return Pointer to entry or nullptr if not present
+   */
+  lock_info_t* find(const void* target)
+  {
+    assert(target);
+    for (size_t i = hash(target);; i = (i + 1) & _mask) {
+      lock_info_t& s = _slots[i];
+      if (s.target == target) return &s;
+      if (s.target == nullptr) return nullptr;
+    }
+  }
+
+  /**
+   * Insert new entry with a count of one, or increment the count
+   * of an existing one
+   *
+   */
+  void add(const void*                 target,
+           Component::IKVStore::pool_t pool,
+           Component::IKVStore::key_t  key)
+  {
+    assert(target);
+    if ((_size + 1) * 4 > _slots.size() * 3) grow();
+
+    size_t i = hash(target);
+    while (_slots[i].target != nullptr) {
+      if (_slots[i].target == target) {
+        _slots[i].count++;
+        return;
+      }
+      i = (i + 1) & _mask;
+    }
+    _slots[i] = lock_info_t{target, pool, key, 1};
+    _size++;
+  }
+
+  /**
+   * Remove entry; closes the gap by shifting back later entries of
+   * the same probe run
+   *
+   */
+  void erase(lock_info_t* entry)
+  {
+    assert(entry && entry->target);
+    size_t hole = size_t(entry - _slots.data());
+    for (size_t i = (hole + 1) & _mask; _slots[i].target != nullptr; i = (i + 1) & _mask) {
+      size_t home = hash(_slots[i].target);
+      /* move if home is not cyclically in (hole, i] */
+      if (((i - home) & _mask) >= ((i - hole) & _mask)) {
+        _slots[hole] = _slots[i];
+        hole         = i;
+      }
+    }
+    _slots[hole].target = nullptr;
+    _size--;
+  }
+
+ private:
+  size_t hash(const void* target) const
+  {
+    /* value buffers are at least cache-line aligned; mix the high bits down */
+    uint64_t h = reinterpret_cast<uint64_t>(target) * 0x9E3779B97F4A7C15ULL;
+    return size_t(h >> 32) & _mask;
+  }
+
+  void grow()
+  {
+    std::vector<lock_info_t> old(_slots.size() * 2);
+    old.swap(_slots);
+    _mask = _slots.size() - 1;
+    for (auto& s : old) {
+      if (s.target == nullptr) continue;
+      size_t i = hash(s.target);
+      while (_slots[i].target != nullptr) i = (i + 1) & _mask;
+      _slots[i] = s;
+    }
+  }
+
+  std::vector<lock_info_t> _slots;
+  size_t                   _mask;
+  size_t                   _size = 0;
+};
+
+}  // namespace Dawn
+
+#endif  // __DAWN_LOCKED_VALUE_TABLE_H__
@@ -0,0 +1,137 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __DAWN_NUMA_TOPOLOGY_H__
+#define __DAWN_NUMA_TOPOLOGY_H__
+
+#include <common/logging.h>
+#include <numa.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <algorithm>
+#include <string>
+
+namespace Dawn
+{
+/**
+ * NUMA node lookup for shard resources.  All functions return -1
+ * when the node is unknown (no NUMA support, no such device, or the
+ * platform does not report an affinity).
+ *
+ */
+namespace Numa
+{
+inline int read_node_file(const std::string& path)
+{
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) return -1;
+  int node = -1;
+  if (fscanf(fp, "%d", &node) != 1) node = -1;
+  fclose(fp);
+  return node;
+}
+
+inline std::string basename_of(const std::string& path)
+{
+  auto pos = path.find_last_of('/');
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+/**
+ * Node of a CPU core
+ *
+ */
+inline int core_node(unsigned core)
+{
+  if (numa_available() < 0) return -1;
+  return numa_node_of_cpu(int(core));
+}
+
+/**
+ * Node of the network device named by a shard "net" setting, either
+ * an RDMA device (e.g. mlx5_0) or a network interface (e.g. eth0)
+ *
+ */
+inline int net_device_node(const std::string& net)
+{
+  if (net.empty()) return -1;
+  int node = read_node_file("/sys/class/infiniband/" + net + "/device/numa_node");
+  if (node < 0) node = read_node_file("/sys/class/net/" + net + "/device/numa_node");
+  return node;
+}
+
+/**
+ * Node of a PCI device, e.g. an NVMe drive given as "0b:00.0" or
+ * "0000:0b:00.0"
+ *
+ */
+inline int pci_device_node(const std::string& pci_addr)
+{
+  if (pci_addr.empty()) return -1;
+  std::string addr = pci_addr;
+  if (std::count(addr.begin(), addr.end(), ':') < 2) addr = "0000:" + addr;
+  return read_node_file("/sys/bus/pci/devices/" + addr + "/numa_node");
+}
+
+/**
+ * Node of a device-DAX character device, e.g. /dev/dax0.1
+ *
+ */
+inline int dax_device_node(const std::string& dax_path)
+{
+  if (dax_path.empty()) return -1;
+  auto name = basename_of(dax_path);
+  int  node = read_node_file("/sys/bus/dax/devices/" + name + "/numa_node");
+  if (node < 0) node = read_node_file("/sys/class/dax/" + name + "/device/numa_node");
+  return node;
+}
+
+/**
+ * Node of the block device backing a file system path (e.g. an
+ * fsdax mount)
+ *
+ */
+inline int path_device_node(const std::string& path)
+{
+  if (path.empty()) return -1;
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return -1;
+
+  std::string dev = "/sys/dev/block/" + std::to_string(major(st.st_dev)) + ":" +
+                    std::to_string(minor(st.st_dev));
+  int node = read_node_file(dev + "/device/numa_node");
+  if (node < 0) node = read_node_file(dev + "/../device/numa_node"); /* partition */
+  return node;
+}
+
+/**
+ * Warn if a resource is not on the shard's node
+ *
+ */
+inline void check_local(unsigned           shard,
+                        int                shard_node,
+                        const char*        what,
+                        const std::string& name,
+                        int                node)
+{
+  if (shard_node < 0 || node < 0) return;
+  if (node != shard_node)
+    PWRN("shard %u: %s (%s) is on NUMA node %d but the shard core is on node %d;"
+         " cross-socket traffic will reduce throughput",
+         shard, what, name.c_str(), node, shard_node);
+}
+
+}  // namespace Numa
+}  // namespace Dawn
+
+#endif  // __DAWN_NUMA_TOPOLOGY_H__
@@ -145,6 +145,25 @@ public:
       return false;
   }
 
+  /**
+   * Look up the name a pool was opened with
+   *
+   * @param pool Pool identifier
+   * @param out_name [out] Pool name
+   *
+   * @return True if the pool is registered
+   */
+  bool pool_name(pool_t pool, std::string& out_name) const
+  {
+    for (auto& i : _name_map) {
+      if (i.second == pool) {
+        out_name = i.first;
+        return true;
+      }
+    }
+    return false;
+  }
+
   inline const std::map<pool_t, unsigned>& open_pool_set()
   {
     return _open_pools;
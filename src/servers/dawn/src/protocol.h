@@ -58,8 +58,13 @@ enum {
 enum {
   MSG_RESVD_SCBE   = 0x2, /* indicates short-circuit function (testing only) */
   MSG_RESVD_DIRECT = 0x4, /* indicate get_direct from client side */
+  MSG_RESVD_BATCH  = 0x8, /* another request follows in the same buffer */
 };
 
+/* Requests coalesced into one buffer start on 8-byte boundaries; each
+   has its own response, matched to it by request id */
+inline size_t batch_stride(size_t msg_len) { return (msg_len + 7) & ~size_t(7); }
+
 enum {
   OP_NONE        = 0,
   OP_CREATE      = 1,
@@ -78,6 +83,8 @@ enum {
   OP_STATS       = 12,
   OP_SYNC        = 13,
   OP_ASYNC       = 14,
+  OP_SCAN        = 15, // ordered batch read of key-value pairs
+  OP_ATOMIC_UPDATE = 16, // apply operation vector to a value in place
   OP_INVALID     = 0xFE,
   OP_MAX         = 0xFF
 };
@@ -396,6 +403,66 @@ struct Message_IO_response : public Message {
   char     data[];
 } __attribute__((packed));
 
+////////////////////////////////////////////////////////////////////////
+// SCAN
+//
+// Request is a Message_IO_request with the start key (inclusive) as
+// key; the value holds a Scan_request_param followed by the (optional)
+// key prefix. Response data holds a Scan_response_header followed by
+// 'count' packed records (Scan_record_header, key, value). When 'more'
+// is set the scan continues after the last returned key. A batch ends
+// early at a write-locked key; the status is E_BUSY if that is the first.
+
+struct Scan_request_param {
+  uint64_t max_count; /*< maximum number of records (0 for no limit) */
+  uint64_t max_bytes; /*< byte budget for the batch (0 for buffer size) */
+} __attribute__((packed));
+
+struct Scan_response_header {
+  uint32_t count; /*< number of records */
+  uint32_t more;  /*< non-zero if further records are in range */
+} __attribute__((packed));
+
+struct Scan_record_header {
+  /* value does not fit in a response; fetch it with a get */
+  static constexpr uint32_t VALUE_OMITTED = 1U << 31;
+
+  uint32_t key_len;
+  uint32_t value_len;
+} __attribute__((packed));
+
+////////////////////////////////////////////////////////////////////////
+// ATOMIC UPDATE
+//
+// Request is a Message_IO_request with the target key; the value holds
+// a sequence of Atomic_update_op, each WRITE followed by its 'len' data
+// bytes. Response data holds one uint64_t result per operation (the
+// previous value for INCREMENT_UINT64 and CAS_UINT64, zero otherwise).
+
+struct Atomic_update_op {
+  uint32_t type;   /*< Component::IKVStore::Op_type */
+  uint32_t pad;
+  uint64_t offset; /*< offset in value */
+  uint64_t len;    /*< WRITE, ZERO: byte count */
+  uint64_t arg0;   /*< INCREMENT_UINT64: delta, CAS_UINT64: expected */
+  uint64_t arg1;   /*< CAS_UINT64: desired */
+} __attribute__((packed));
+
+////////////////////////////////////////////////////////////////////////
+// PUT ADVANCE
+//
+// Two-stage put of a value too large for a message buffer. Request is a
+// Message_IO_request with the key and the value length; a
+// Put_advance_param follows the key. The server reads the value from
+// client memory and responds once it is in place, so the value needs
+// no receive of its own (receives for further requests may be posted
+// ahead of it).
+
+struct Put_advance_param {
+  uint64_t addr; /*< client address of the value */
+  uint64_t key;  /*< remote key of the client memory region */
+} __attribute__((packed));
+
 ////////////////////////////////////////////////////////////////////////
 // INFO REQUEST/RESPONSE
 struct Message_INFO_request : public Message {
@@ -490,9 +557,10 @@ struct Message_handshake_reply : public Message {
   Message_handshake_reply(uint64_t auth_id,
                           uint64_t sequence,
                           uint64_t session_id,
-                          size_t   mms)
+                          size_t   mms,
+                          uint32_t credits)
       : Message(auth_id, id), seq(sequence),
-        session_id(session_id), max_message_size(mms)
+        session_id(session_id), max_message_size(mms), credits(credits)
   {
     msg_len = (sizeof *this);
   }
@@ -501,6 +569,7 @@ struct Message_handshake_reply : public Message {
   uint64_t seq;
   uint64_t session_id;
   size_t   max_message_size;
+  uint32_t credits; /*< max requests a client may have outstanding on the session */
 
 } __attribute__((packed));
 
@@ -26,6 +26,8 @@
 #include "shard.h"
 
 #include <algorithm> /* remove */
+#include <limits>
+#include <unistd.h> /* access, unlink */
 
 using namespace Dawn;
 
@@ -52,6 +54,14 @@ void Shard::thread_entry(const std::string& backend,
   mask.add_core(_core);
   set_cpu_affinity_mask(mask);
 
+  /* prefer memory local to the core for everything the shard thread
+     touches first: message buffers, value staging and DRAM backend pools */
+  int node = Numa::core_node(_core);
+  if (node >= 0) {
+    numa_set_preferred(node);
+    if (option_DEBUG > 2) PLOG("shard:%u memory bound to NUMA node %d", _core, node);
+  }
+
   try {
     initialize_components(backend, index, pci_addr, dax_config, pm_path, debug_level);
 
@@ -74,6 +84,8 @@ void Shard::initialize_components(const std::string& backend,
 {
   using namespace Component;
 
+  _pm_path = pm_path;
+
   /* STORE */
   {
     IBase* comp;
@@ -232,6 +244,9 @@ void Shard::main_loop()
               ado_itf->shutdown();
             }
 
+            abort_index_build(pool_id);
+            release_index(pool_id);
+            _pool_weights.erase(pool_id);
             _i_kvstore->close_pool(pool_id);
           }
           
@@ -246,44 +261,24 @@ void Shard::main_loop()
           switch (action.op) {
           case Connection_handler::ACTION_RELEASE_VALUE_LOCK:
             if (option_DEBUG > 2)
-              PLOG("releasing value lock (%p)", action.parm);
-            release_locked_value(action.parm);
+              PLOG("deferring value lock release (%p)", action.parm);
+            _deferred_unlocks.push_back(action.parm);
             break;
           default:
             throw Logic_exception("unknown action type");
           }
         }
 
-        /* collect ALL available messages */
-        buffer_t*          iob;
-        Protocol::Message* p_msg = nullptr;
-        while ((iob = handler->get_pending_msg(p_msg)) != nullptr) {
-          idle = 0;
-          assert(p_msg);
-          switch (p_msg->type_id) {
-          case MSG_TYPE_IO_REQUEST:
-            process_message_IO_request(handler,
-                                       static_cast<Protocol::Message_IO_request*>(p_msg));
-            break;
-          case MSG_TYPE_POOL_REQUEST:
-            process_message_pool_request(handler,
-                                         static_cast<Protocol::Message_pool_request*>(p_msg));
-            break;
-          case MSG_TYPE_INFO_REQUEST:
-            process_info_request(handler,
-                                 static_cast<Protocol::Message_INFO_request*>(p_msg));
-            break;
-          case MSG_TYPE_ADO_REQUEST:
-            process_ado_request(handler,
-                                static_cast<Protocol::Message_ado_request*>(p_msg));
-            break;
-          default:
-            throw General_exception("unrecognizable message type");
-          }
-          handler->free_recv_buffer();
-        }        
       }  // handler iter
 
+      /* unlock values released this tick as one batch */
+      if (!_deferred_unlocks.empty())
+        release_deferred_locks();
+
+      /* serve queued requests across sessions */
+      if (schedule_requests())
+        idle = 0;
+
       /* handle messages send back from ADO */
       process_messages_from_ado();
 
@@ -300,6 +295,11 @@ void Shard::main_loop()
             PLOG("Deleting handler (%p)", h);
           }
           assert(h);
+
+          /* outstanding tasks must not respond to a deleted session */
+          for(auto t : _tasks)
+            if(t->handler() == h) t->detach();
+
           delete h;
 
           if (option_DEBUG > 1)
@@ -372,6 +372,7 @@ void Shard::process_message_pool_request(Connection_handler* handler,
         handler->pool_manager().register_pool(pool_name, pool);
         response->pool_id = pool;
         response->status  = S_OK;
+        attach_persistent_index(pool, pool_name);
       }
 
       if (option_DEBUG > 2) PLOG("OP_CREATE: new pool id: %lx", pool);
@@ -420,6 +421,7 @@ void Shard::process_message_pool_request(Connection_handler* handler,
         /* register pool handle */
         handler->pool_manager().register_pool(pool_name, pool);
         response->pool_id = pool;
+        attach_persistent_index(pool, pool_name);
       }
     }
     if (option_DEBUG > 2) PLOG("OP_OPEN: pool id: %lx", pool);    
@@ -430,6 +432,9 @@ void Shard::process_message_pool_request(Connection_handler* handler,
     /* release reference, if its zero, we can close pool for real */
     if(handler->pool_manager().release_pool_reference(msg->pool_id)) {
       PLOG("actually closing pool %p", (void*) msg->pool_id);
+      abort_index_build(msg->pool_id);
+      release_index(msg->pool_id);
+      _pool_weights.erase(msg->pool_id);
       response->status = _i_kvstore->close_pool(msg->pool_id);
       assert(response->status == S_OK);
 
@@ -459,6 +464,8 @@ void Shard::process_message_pool_request(Connection_handler* handler,
     else {
       response->pool_id = 0;
       response->status = _i_kvstore->delete_pool(msg->pool_name());
+      if(response->status == S_OK && !_pm_path.empty())
+        ::unlink(persistent_index_path(pool_name).c_str());
     }
   }
   else
@@ -502,6 +509,14 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
     assert(target_len > 0);
     assert(msg->pool_id > 0);
 
+    if(msg->msg_len < sizeof(Protocol::Message_IO_request) + msg->key_len + 1 +
+       sizeof(Protocol::Put_advance_param)) {
+      status = E_INVAL;
+      PWRN("PUT_ADVANCE missing client memory parameters");
+      _stats.op_failed_request_count++;
+      goto send_response;
+    }
+
     /* can't support dont stomp flag */
     if(msg->flags & IKVStore::FLAGS_DONT_STOMP) {
       status = E_INVAL;
@@ -510,6 +525,13 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
       goto send_response;
     }
 
+    if(!index_accepts_key(msg->pool_id, msg->key_len)) {
+      status = E_LENGTH_EXCEEDED;
+      PWRN("PUT_ADVANCE key too long for pool index");
+      _stats.op_failed_request_count++;
+      goto send_response;
+    }
+
     std::string k(msg->key(), msg->key_len);
     /* create (if needed) and lock value */    
     Component::IKVStore::key_t key_handle;
@@ -542,9 +564,6 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
     /* register memory unless pre-registered */
     Connection_base::memory_region_t region = handler->ondemand_register(target, target_len);
 
-    /* set up value memory to receive value from network */
-    handler->set_pending_value(target, target_len, region);
-
     /* update index ; position OK? */
     add_index_key(msg->pool_id, k);
     
@@ -554,8 +573,11 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
     response->status     = S_OK;
 
     iob->set_length(response->msg_len);
-    
-    handler->post_send_buffer(iob);
+
+    /* read the value from the client; the response follows it */
+    Protocol::Put_advance_param param;
+    memcpy(&param, msg->value(), sizeof(param));
+    handler->set_pending_value(target, target_len, region, param.addr, param.key, iob);
 
     /* update stats */
     _stats.op_put_direct_count++;
@@ -583,6 +605,11 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
       status = S_OK;  // short-circuit backend
       if (option_DEBUG > 2) PLOG("PUT: short-circuited backend");
     }
+    else if (!index_accepts_key(msg->pool_id, msg->key_len)) {
+      /* refused before the store is touched, so store and index agree */
+      status = E_LENGTH_EXCEEDED;
+      _stats.op_failed_request_count++;
+    }
     else {
       const std::string k(msg->key(), msg->key_len);
 
@@ -764,12 +791,36 @@ void Shard::process_message_IO_request(Connection_handler*           handler,
     _stats.op_erase_count++;
   }
   /////////////////////////////////////////////////////////////////////////////
+  //   SCAN          //
+  /////////////////////
+  else if (msg->op == Protocol::OP_SCAN) {
+    status = process_scan(msg, response, iob->length());
+    if(status != S_OK)
+      _stats.op_failed_request_count++;
+    _stats.op_get_count++;
+  }
+  /////////////////////////////////////////////////////////////////////////////
+  //   ATOMIC UPDATE //
+  /////////////////////
+  else if (msg->op == Protocol::OP_ATOMIC_UPDATE) {
+    status = process_atomic_update(msg, response, iob->length());
+    if(status != S_OK)
+      _stats.op_failed_request_count++;
+    _stats.op_put_count++;
+  }
+  /////////////////////////////////////////////////////////////////////////////
   //   CONFIGURE     //
   /////////////////////  
   else if (msg->op == Protocol::OP_CONFIGURE) {
     if (option_DEBUG > 1)
       PMAJOR("Shard: pool CONFIGURE (%s)", msg->cmd());
-    status = process_configure(msg);
+    status = process_configure(handler, msg);
+
+    /* response is posted when the deferred work completes */
+    if(status == IKVStore::S_MORE) {
+      handler->free_buffer(iob);
+      return;
+    }
   }
   else {
     throw Protocol_exception("operation not implemented");
@@ -931,32 +982,48 @@ void Shard::process_tasks(unsigned& idle)
 
     status_t s = t->do_work();
     if(s != Component::IKVStore::S_MORE) {
+
+      complete_index_build(t, s);
       
-      auto handler = t->handler();
-      auto response_iob = handler->allocate();
-      assert(response_iob);
-      Protocol::Message_INFO_response* response = new (response_iob->base())
-        Protocol::Message_INFO_response(handler->auth_id());
+      auto handler = t->handler(); /* null if session has closed */
+      if(handler && t->io_response()) {
+        auto response_iob = handler->allocate();
+        assert(response_iob);
+        Protocol::Message_IO_response* response = new (response_iob->base())
+          Protocol::Message_IO_response(response_iob->length(), handler->auth_id());
+
+        response->request_id = t->request_id();
+        response->status     = s;
+        response_iob->set_length(response->msg_len);
+        handler->post_response(response_iob);
+      }
+      else if(handler) {
+        auto response_iob = handler->allocate();
+        assert(response_iob);
+        Protocol::Message_INFO_response* response = new (response_iob->base())
+          Protocol::Message_INFO_response(handler->auth_id());
+
+        if(s == S_OK) {
+          response->set_value(response_iob->length(),
+                              t->get_result(),
+                              t->get_result_length());
+          response->offset = t->matched_position();
 
-      if(s == S_OK) {
-        response->set_value(response_iob->length(),
-                            t->get_result(),
-                            t->get_result_length());
-        response->offset = t->matched_position();
+          response->status = S_OK;
+          response_iob->set_length(response->message_size());
+        }
+        else if(s == E_FAIL) {
+          response_iob->set_length(response->base_message_size());
+          response->status = E_FAIL;
+        }
+        else {
+          throw Logic_exception("unexpected task condition");
+        }
 
-        response->status = S_OK;
-        response_iob->set_length(response->message_size());
-      }
-      else if(s == E_FAIL) {
-        response_iob->set_length(response->base_message_size());
-        response->status = E_FAIL;
+        handler->post_send_buffer(response_iob);
       }
-      else {
-        throw Logic_exception("unexpected task condition");
-      }
-
-      handler->post_send_buffer(response_iob);
       _tasks.erase(i);
+      delete t;
 
       goto retry;
     }
@@ -964,6 +1031,213 @@ void Shard::process_tasks(unsigned& idle)
 }
 
 
+void Shard::complete_index_build(Shard_task* task, status_t status)
+{
+  for(auto i = _index_builds.begin(); i != _index_builds.end(); i++) {
+    if(i->second != task) continue;
+
+    if(status == S_OK) {
+      if(_index_map == nullptr)
+        _index_map = new index_map_t();
+
+      _index_map->insert(std::make_pair(i->first, i->second->release_index()));
+
+      if (option_DEBUG > 1)
+        PLOG("Shard: index on pool (%lx) ready", i->first);
+    }
+    else {
+      PWRN("Shard: index build on pool (%lx) failed (%d)", i->first, status);
+      _persistent_indices.erase(i->first);
+    }
+    _index_builds.erase(i);
+    return;
+  }
+}
+
+
+void Shard::abort_index_build(const pool_t pool_id)
+{
+  auto build = lookup_index_build(pool_id);
+  if(build)
+    build->abort(); /* task reports failure on its next slice */
+}
+
+
+std::string Shard::persistent_index_path(const std::string& pool_name) const
+{
+  /* one index file per pool, kept under the shard's pm_path */
+  std::string name(pool_name);
+  std::replace(name.begin(), name.end(), '/', '_');
+  return _pm_path + "/" + name + ".idx";
+}
+
+
+Component::IKVIndex* Shard::open_persistent_index(const std::string& path)
+{
+  using namespace Component;
+
+  IBase* comp = load_component("libcomanche-indexpmbtree.so", pmbtreeindex_factory);
+  if (!comp)
+    throw General_exception("unable to load libcomanche-indexpmbtree.so");
+  auto factory = static_cast<IKVIndex_factory*>(comp->query_interface(IKVIndex_factory::iid()));
+  assert(factory);
+
+  IKVIndex* index = nullptr;
+  try {
+    index = factory->create("shard", path);
+  }
+  catch(const General_exception& e) {
+    PWRN("Shard: unable to open persistent index (%s): %s", path.c_str(), e.cause());
+  }
+  factory->release_ref();
+  return index;
+}
+
+
+void Shard::attach_persistent_index(const pool_t pool_id, const std::string& pool_name)
+{
+  /* an index added in an earlier run is reattached when its pool is
+     opened, so that updates through this shard keep it current */
+  if(_pm_path.empty() || lookup_index(pool_id))
+    return;
+
+  auto path = persistent_index_path(pool_name);
+  if(::access(path.c_str(), F_OK) != 0)
+    return;
+
+  auto index = open_persistent_index(path);
+  if(index == nullptr)
+    return;
+
+  if(index->count() != _i_kvstore->count(pool_id)) {
+    /* pool was updated while the index was detached, or the index was
+       discarded after an unclean shutdown */
+    PWRN("Shard: persistent index for pool (%s) is stale; use AddIndex to rebuild",
+         pool_name.c_str());
+    index->release_ref();
+    ::unlink(path.c_str());
+    return;
+  }
+
+  /* equal counts do not mean equal keys; the index is compared with
+     the pool in the background and published once it matches (or has
+     been rebuilt).  No session waits on the result. */
+  auto task = new Index_build_task(nullptr, 0, _i_kvstore, pool_id, index, true);
+  _index_builds[pool_id] = task;
+  _persistent_indices[pool_id] = path;
+  add_task_list(task);
+
+  if (option_DEBUG > 1)
+    PLOG("Shard: verifying persistent index (%s) with %lu keys", path.c_str(), index->count());
+}
+
+
+void Shard::release_index(const pool_t pool_id, bool remove_persistent)
+{
+  if(_index_map) {
+    auto i = _index_map->find(pool_id);
+    if(i != _index_map->end()) {
+      i->second->release_ref();
+      _index_map->erase(i);
+    }
+  }
+
+  auto p = _persistent_indices.find(pool_id);
+  if(p != _persistent_indices.end()) {
+    if(remove_persistent)
+      ::unlink(p->second.c_str());
+    _persistent_indices.erase(p);
+  }
+}
+
+
+bool Shard::schedule_requests()
+{
+  using namespace Dawn::Protocol;
+
+  const size_t n_handlers = _handlers.size();
+  bool         work       = false;
+
+  /* deficit round robin: each backlogged session earns a quantum
+     (scaled by the QoS weight of the pool it is addressing) per round
+     and is served while its deficit covers the cost of its next
+     request. Starting position rotates so that no session is always
+     served first. */
+  for (size_t i = 0; i < n_handlers; i++) {
+    auto handler = _handlers[(_sched_start + i) % n_handlers];
+
+    const Protocol::Message* next = handler->peek_pending_msg();
+    if (next == nullptr) {
+      handler->reset_deficit(); /* idle sessions do not bank credit */
+      continue;
+    }
+
+    handler->add_deficit(SCHED_QUANTUM * pool_weight(next));
+
+    while (next && request_cost(next) <= handler->deficit()) {
+      handler->consume_deficit(request_cost(next));
+
+      Protocol::Message* p_msg = nullptr;
+      auto iob = handler->get_pending_msg(p_msg);
+      assert(p_msg);
+
+      switch (p_msg->type_id) {
+      case MSG_TYPE_IO_REQUEST:
+        process_message_IO_request(handler,
+                                   static_cast<Protocol::Message_IO_request*>(p_msg));
+        break;
+      case MSG_TYPE_POOL_REQUEST:
+        process_message_pool_request(handler,
+                                     static_cast<Protocol::Message_pool_request*>(p_msg));
+        break;
+      case MSG_TYPE_INFO_REQUEST:
+        process_info_request(handler,
+                             static_cast<Protocol::Message_INFO_request*>(p_msg));
+        break;
+      case MSG_TYPE_ADO_REQUEST:
+        process_ado_request(handler,
+                            static_cast<Protocol::Message_ado_request*>(p_msg));
+        break;
+      default:
+        throw General_exception("unrecognizable message type");
+      }
+      handler->release_msg_buffer(iob);
+      work = true;
+
+      next = handler->peek_pending_msg();
+    }
+  }
+
+  if (n_handlers > 0)
+    _sched_start = (_sched_start + 1) % n_handlers;
+
+  return work;
+}
+
+uint64_t Shard::request_cost(const Protocol::Message* msg) const
+{
+  /* one unit per request plus one per SCHED_COST_UNIT of inline value */
+  if (msg->type_id == Protocol::MSG_TYPE_IO_REQUEST) {
+    auto io = static_cast<const Protocol::Message_IO_request*>(msg);
+    return 1 + (io->get_value_len() / SCHED_COST_UNIT);
+  }
+  return 1;
+}
+
+unsigned Shard::pool_weight(const Protocol::Message* msg) const
+{
+  pool_t pool_id;
+  if (msg->type_id == Protocol::MSG_TYPE_IO_REQUEST)
+    pool_id = static_cast<const Protocol::Message_IO_request*>(msg)->pool_id;
+  else if (msg->type_id == Protocol::MSG_TYPE_ADO_REQUEST)
+    pool_id = static_cast<const Protocol::Message_ado_request*>(msg)->pool_id;
+  else
+    return 1;
+
+  auto i = _pool_weights.find(pool_id);
+  return i == _pool_weights.end() ? 1 : i->second;
+}
+
 void Shard::check_for_new_connections()
 {
   /* new connections are transferred from the connection handler
@@ -978,7 +1252,311 @@ void Shard::check_for_new_connections()
 }
 
 
-status_t Shard::process_configure(Protocol::Message_IO_request* msg)
+status_t Shard::process_scan(const Protocol::Message_IO_request* msg,
+                             Protocol::Message_IO_response* response,
+                             size_t buffer_size)
+{
+  using namespace Component;
+  using namespace Protocol;
+
+  if(msg->val_len < sizeof(Scan_request_param))
+    return E_BAD_PARAM;
+
+  Scan_request_param param;
+  memcpy(&param, msg->value(), sizeof(param));
+  const std::string prefix(msg->value() + sizeof(param), msg->val_len - sizeof(param));
+  std::string start(msg->key(), msg->key_len);
+  if(start < prefix)
+    start = prefix;
+
+  const size_t capacity = buffer_size - response->base_message_size();
+  const size_t budget = (param.max_bytes == 0 || param.max_bytes > capacity) ? capacity : param.max_bytes;
+  const size_t limit = param.max_count ? param.max_count : std::numeric_limits<size_t>::max();
+
+  auto header = reinterpret_cast<Scan_response_header*>(response->data);
+  size_t used = sizeof(Scan_response_header);
+  header->count = 0;
+  header->more = 0;
+  status_t status = S_OK;
+
+  /* called for keys >= start in order; returns false to stop */
+  auto pack = [&](const std::string& key) -> bool
+  {
+    if(key.compare(0, prefix.size(), prefix) != 0)
+      return false; /* past the prefix range */
+
+    if(header->count == limit) {
+      header->more = 1;
+      return false;
+    }
+
+    void*  value = nullptr;
+    size_t value_len = 0;
+    IKVStore::key_t key_handle;
+    if(_i_kvstore->lock(msg->pool_id, key, IKVStore::STORE_LOCK_READ,
+                        value, value_len, key_handle) != S_OK ||
+       key_handle == IKVStore::KEY_NONE) {
+      if(probe_key(msg->pool_id, key) == IKVStore::E_KEY_NOT_FOUND)
+        return true; /* erased underneath us */
+
+      /* write-locked by another session: end the batch before it so the
+         next one resumes here, or report it if nothing was packed */
+      if(header->count > 0)
+        header->more = 1;
+      else
+        status = E_BUSY;
+      return false;
+    }
+
+    Scan_record_header rec{static_cast<uint32_t>(key.size()),
+                           static_cast<uint32_t>(value_len)};
+    size_t rec_len = sizeof(rec) + key.size() + value_len;
+    bool fits = (used + rec_len <= budget);
+
+    if(!fits && header->count > 0) { /* continue in next batch */
+      _i_kvstore->unlock(msg->pool_id, key_handle);
+      header->more = 1;
+      return false;
+    }
+
+    if(!fits) { /* single large value; client gets it separately */
+      rec.value_len = Scan_record_header::VALUE_OMITTED;
+      rec_len = sizeof(rec) + key.size();
+      if(used + rec_len > capacity) {
+        _i_kvstore->unlock(msg->pool_id, key_handle);
+        status = E_INSUFFICIENT_SPACE;
+        return false;
+      }
+    }
+
+    char * p = response->data + used;
+    memcpy(p, &rec, sizeof(rec));
+    memcpy(p + sizeof(rec), key.data(), key.size());
+    if(fits)
+      memcpy(p + sizeof(rec) + key.size(), value, value_len);
+    _i_kvstore->unlock(msg->pool_id, key_handle);
+
+    used += rec_len;
+    header->count++;
+    return true;
+  };
+
+  auto index = lookup_index(msg->pool_id);
+  if(index == nullptr || index->scan(start, pack) == E_NOT_IMPL) {
+    /* no ordered index; select the next 'limit'+1 keys from a full key
+       walk. Costs O(n) per batch - add an index for large pools */
+    std::set<std::string> candidates;
+    auto select = [&](const std::string& key) {
+      if(key < start || key.compare(0, prefix.size(), prefix) != 0)
+        return 0;
+      candidates.insert(key);
+      if(candidates.size() - 1 > limit)
+        candidates.erase(std::prev(candidates.end()));
+      return 0;
+    };
+
+    status_t hr = _i_kvstore->map_keys(msg->pool_id, select);
+    if(hr != S_OK) {
+      hr = _i_kvstore->map(msg->pool_id,
+                           [&select](const std::string& key,
+                                     const void * value,
+                                     const size_t value_len) {
+                             return select(key);
+                           });
+    }
+    if(hr != S_OK)
+      return hr;
+
+    for(auto& key : candidates)
+      if(!pack(key)) break;
+  }
+
+  if(status != S_OK)
+    return status;
+
+  response->data_len = used;
+  response->msg_len = response->base_message_size() + used;
+
+  if (option_DEBUG > 2)
+    PLOG("SCAN: start=(%s) prefix=(%s) count=%u more=%u bytes=%lu",
+         start.c_str(), prefix.c_str(), header->count, header->more, used);
+
+  return S_OK;
+}
+
+
+status_t Shard::probe_key(const pool_t pool_id, const std::string& key)
+{
+  using namespace Component;
+
+  std::vector<uint64_t> attr;
+  status_t rc = _i_kvstore->get_attribute(pool_id, IKVStore::Attribute::VALUE_LEN, attr, &key);
+  if(rc == E_NOT_SUPPORTED) {
+    void*  value = nullptr;
+    size_t value_len = 0;
+    rc = _i_kvstore->get(pool_id, key, value, value_len);
+    if(rc == S_OK)
+      _i_kvstore->free_memory(value);
+  }
+  return rc;
+}
+
+
+status_t Shard::process_atomic_update(const Protocol::Message_IO_request* msg,
+                                      Protocol::Message_IO_response* response,
+                                      size_t buffer_size)
+{
+  using namespace Component;
+  using namespace Protocol;
+
+  struct update_t {
+    Atomic_update_op op;
+    const char *     data; /* WRITE only */
+  };
+
+  /* decode operation vector */
+  std::vector<update_t> updates;
+  const char * p = msg->value();
+  const char * end = p + msg->val_len;
+  while(p < end) {
+    update_t u;
+    if(p + sizeof(Atomic_update_op) > end)
+      return E_BAD_PARAM;
+    memcpy(&u.op, p, sizeof(u.op));
+    p += sizeof(u.op);
+    u.data = p;
+    if(u.op.type == static_cast<uint32_t>(IKVStore::Op_type::WRITE)) {
+      if(u.op.len > static_cast<size_t>(end - p))
+        return E_BAD_PARAM;
+      p += u.op.len;
+    }
+    updates.push_back(u);
+  }
+
+  const size_t results_len = updates.size() * sizeof(uint64_t);
+  if(updates.empty() || results_len > buffer_size - response->base_message_size())
+    return E_BAD_PARAM;
+
+  uint64_t * results = reinterpret_cast<uint64_t*>(response->data);
+  memset(results, 0, results_len);
+  response->data_len = results_len;
+  response->msg_len = response->base_message_size() + results_len;
+
+  const std::string k(msg->key(), msg->key_len);
+
+  /* lock creates missing keys, so check the key exists first */
+  status_t rc = probe_key(msg->pool_id, k);
+  if(rc != S_OK)
+    return rc;
+
+  void*  value = nullptr;
+  size_t value_len = 0;
+  IKVStore::key_t key_handle = IKVStore::KEY_NONE;
+  rc = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_WRITE,
+                        value, value_len, key_handle);
+  if(rc != S_OK)
+    return rc;
+  if(key_handle == IKVStore::KEY_NONE)
+    return IKVStore::E_KEY_NOT_FOUND;
+
+  /* translate into plain writes; integer operations see the value as
+     modified by the operations preceding them in the vector */
+  std::vector<size_t>      offsets;
+  std::vector<std::string> writes;
+
+  auto read_uint64 = [&](size_t offset) {
+    uint64_t v;
+    char * pv = reinterpret_cast<char*>(&v);
+    memcpy(pv, static_cast<const char*>(value) + offset, sizeof(v));
+    for(size_t i=0;i<writes.size();i++) {
+      size_t lo = std::max(offset, offsets[i]);
+      size_t hi = std::min(offset + sizeof(v), offsets[i] + writes[i].size());
+      if(lo < hi)
+        memcpy(pv + (lo - offset), writes[i].data() + (lo - offsets[i]), hi - lo);
+    }
+    return v;
+  };
+
+  auto add_write = [&](size_t offset, const void * data, size_t len) {
+    offsets.push_back(offset);
+    writes.emplace_back(static_cast<const char*>(data), len);
+  };
+
+  status_t status = S_OK;
+  for(size_t i=0;i<updates.size() && status == S_OK;i++) {
+    auto& op = updates[i].op;
+    auto type = static_cast<IKVStore::Op_type>(op.type);
+    size_t extent = (type == IKVStore::Op_type::WRITE || type == IKVStore::Op_type::ZERO) ?
+      op.len : sizeof(uint64_t);
+
+    if(op.offset > value_len || extent > value_len - op.offset) {
+      status = E_OUT_OF_BOUNDS;
+      break;
+    }
+
+    switch(type) {
+    case IKVStore::Op_type::WRITE:
+      add_write(op.offset, updates[i].data, op.len);
+      break;
+    case IKVStore::Op_type::ZERO:
+      {
+        std::string zeros(op.len, '\0');
+        add_write(op.offset, zeros.data(), zeros.size());
+      }
+      break;
+    case IKVStore::Op_type::INCREMENT_UINT64:
+      {
+        uint64_t v = read_uint64(op.offset);
+        results[i] = v;
+        v += op.arg0;
+        add_write(op.offset, &v, sizeof(v));
+      }
+      break;
+    case IKVStore::Op_type::CAS_UINT64:
+      {
+        uint64_t v = read_uint64(op.offset);
+        results[i] = v;
+        if(v != op.arg0)
+          status = IKVStore::E_CAS_FAILED; /* nothing is applied */
+        else
+          add_write(op.offset, &op.arg1, sizeof(op.arg1));
+      }
+      break;
+    default:
+      status = E_NOT_SUPPORTED;
+    }
+  }
+
+  if(status == S_OK) {
+    std::vector<IKVStore::Operation_write> ops;
+    std::vector<IKVStore::Operation*>      op_vector;
+    ops.reserve(writes.size());
+    for(size_t i=0;i<writes.size();i++) {
+      ops.emplace_back(offsets[i], writes[i].size(), writes[i].data());
+      op_vector.push_back(&ops.back());
+    }
+
+    /* stores with a crash-consistent update path apply it themselves;
+       the value lock is already held */
+    status = _i_kvstore->atomic_update(msg->pool_id, k, op_vector, false);
+    if(status == E_NOT_SUPPORTED) {
+      for(size_t i=0;i<writes.size();i++)
+        memcpy(static_cast<char*>(value) + offsets[i], writes[i].data(), writes[i].size());
+      status = S_OK;
+    }
+  }
+
+  _i_kvstore->unlock(msg->pool_id, key_handle);
+
+  if (option_DEBUG > 2)
+    PLOG("ATOMIC_UPDATE: key=(%s) ops=%lu status=%d", k.c_str(), updates.size(), status);
+
+  return status;
+}
+
+
+status_t Shard::process_configure(Connection_handler* handler,
+                                  Protocol::Message_IO_request* msg)
 {
   using namespace Component;
   
@@ -987,13 +1565,20 @@ status_t Shard::process_configure(Protocol::Message_IO_request* msg)
   if(command.substr(0,10) == "AddIndex::") {
     std::string index_str = command.substr(10);
 
+    if(lookup_index(msg->pool_id))
+      return S_OK; /* already built */
+
+    if(lookup_index_build(msg->pool_id))
+      return E_BUSY;
+
+    IKVIndex* index = nullptr;
+    std::string persistent_path;
+    bool verify = false;
+
     /* TODO: use shard configuration */
     if(index_str == "VolatileTree") {
 
-      if(_index_map == nullptr)
-        _index_map = new index_map_t();
-
-      /* create index component and put into shard index map */
+      /* create index component */
       IBase* comp = load_component("libcomanche-indexrbtree.so", rbtreeindex_factory);
       if (!comp)
         throw General_exception("unable to load libcomanche-indexrbtree.so");
@@ -1002,50 +1587,86 @@ status_t Shard::process_configure(Protocol::Message_IO_request* msg)
 
       std::stringstream ss;
       ss << "auth_id:" << msg->auth_id;
-      auto index = factory->create(ss.str(), "");
+      index = factory->create(ss.str(), "");
       assert(index);
       
-      _index_map->insert(std::make_pair((IKVStore::pool_t)msg->pool_id, index));
-
       factory->release_ref();
-
-      if (option_DEBUG > 1)
-        PLOG("Shard: rebuilding volatile index ...");
-
-      status_t hr;
-      if((hr = _i_kvstore->map_keys(msg->pool_id,
-                                    [&index](const std::string& key) {
-                                      index->insert(key);
-                                      return 0;
-                                    })) != S_OK) {
-        
-        hr = _i_kvstore->map(msg->pool_id,
-                             [&index](const std::string& key,
-                                      const void * value,
-                                      const size_t value_len) {
-                               index->insert(key);
-                               return 0;
-                             });
+    }
+    else if(index_str == "PersistentTree") {
+      std::string pool_name;
+      if(_pm_path.empty()) {
+        PWRN("persistent index requires shard pm_path");
+        return E_NOT_SUPPORTED;
       }
-        
-      return hr;
+      if(!handler->pool_manager().pool_name(msg->pool_id, pool_name))
+        return E_BAD_PARAM;
+
+      persistent_path = persistent_index_path(pool_name);
+      index = open_persistent_index(persistent_path);
+      if(index == nullptr)
+        return E_FAIL;
+
+      /* an index that may still hold the pool's keys is verified
+         rather than rebuilt */
+      const pool_t pool_id = msg->pool_id; /* msg is packed */
+      verify = index->count() > 0 && index->count() == _i_kvstore->count(pool_id);
+      if(!verify)
+        index->clear();
     }
     else {
       PWRN("unknown index (%s)", index_str.c_str());
       return E_BAD_PARAM;
     }
+
+    if (option_DEBUG > 1)
+      PLOG("Shard: building %s index in background ...", index_str.c_str());
+
+    /* populate incrementally; the index is put into the shard index
+       map and the client is answered when the build completes */
+    auto task = new Index_build_task(handler,
+                                     msg->request_id,
+                                     _i_kvstore,
+                                     msg->pool_id,
+                                     index,
+                                     verify);
+    _index_builds[msg->pool_id] = task;
+    if(!persistent_path.empty())
+      _persistent_indices[msg->pool_id] = persistent_path;
+    add_task_list(task);
+
+    return IKVStore::S_MORE;
   }
-  else if(command == "RemoveIndex::") {
+  else if(command.substr(0,13) == "QoS::Weight::") {
+    /* relative share of the shard given to requests on this pool */
+    unsigned long weight;
     try {
-      auto index = _index_map->at(msg->pool_id);     
-      _index_map->erase(msg->pool_id);
-      delete index;
-      if (option_DEBUG > 1)
-        PLOG("Shard: removed index on pool (%lx)", msg->pool_id);
+      weight = std::stoul(command.substr(13));
     }
     catch(...) {
       return E_BAD_PARAM;
     }
+    if(weight == 0 || weight > MAX_POOL_WEIGHT)
+      return E_BAD_PARAM;
+
+    if(weight == 1)
+      _pool_weights.erase(msg->pool_id);
+    else
+      _pool_weights[msg->pool_id] = static_cast<unsigned>(weight);
+    return S_OK;
+  }
+  else if(command == "RemoveIndex::") {
+    if(lookup_index_build(msg->pool_id)) {
+      abort_index_build(msg->pool_id);
+      release_index(msg->pool_id, true);
+      return S_OK;
+    }
+
+    if(lookup_index(msg->pool_id) == nullptr)
+      return E_BAD_PARAM;
+
+    release_index(msg->pool_id, true);
+    if (option_DEBUG > 1)
+      PLOG("Shard: removed index on pool (%lx)", msg->pool_id);
     
     return S_OK;
   }
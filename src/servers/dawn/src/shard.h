@@ -32,9 +32,12 @@
 #include "connection_handler.h"
 #include "dawn_config.h"
 #include "fabric_transport.h"
+#include "locked_value_table.h"
+#include "numa_topology.h"
 #include "pool_manager.h"
 #include "types.h"
 #include "task_key_find.h"
+#include "task_index_build.h"
 
 namespace Dawn
 {
@@ -47,20 +50,17 @@ class Shard : public Shard_transport {
 
 private:
   static constexpr size_t TWO_STAGE_THREADSHOLD = KiB(64); /* above this two stage is used */
+  static constexpr uint64_t SCHED_QUANTUM = 16; /*< cost units earned per scheduling round */
+  static constexpr size_t SCHED_COST_UNIT = KiB(4); /*< value bytes per cost unit */
+  static constexpr unsigned MAX_POOL_WEIGHT = 64;
   
 private:
 
-  struct lock_info_t {
-    Component::IKVStore::pool_t pool;
-    Component::IKVStore::key_t  key;
-    int                         count;
-  };
-
   using pool_t             = Component::IKVStore::pool_t;
   using buffer_t           = Shard_transport::buffer_t;
   using index_map_t        = std::unordered_map<pool_t, Component::IKVIndex*>;
-  using locked_value_map_t = std::map<const void*, lock_info_t>;
   using task_list_t        = std::list<Shard_task*>;
+  using index_build_map_t  = std::unordered_map<pool_t, Index_build_task*>;
   
   unsigned option_DEBUG;
 
@@ -105,6 +105,10 @@ public:
     /* TODO: unblock */
     _thread.join();
 
+    /* outstanding tasks may still reference the store */
+    for(auto t : _tasks)
+      delete t;
+
     assert(_i_kvstore);
     _i_kvstore->release_ref();
 
@@ -134,30 +138,37 @@ private:
                         Component::IKVStore::key_t key,
                         void*                      target)
   {
-    auto i = _locked_values.find(target);
-    if(i == _locked_values.end())
-      _locked_values[target] = {pool_id, key, 1};
-    else
-      _locked_values[target].count ++;
+    _locked_values.add(target, pool_id, key);
   }
 
   void release_locked_value(const void* target)
   {
     auto i = _locked_values.find(target);
-    if (i == _locked_values.end())
+    if (i == nullptr)
       throw Logic_exception("bad target to unlock value");
 
-    if(i->second.count == 1) {
-      _i_kvstore->unlock(i->second.pool,
-                         i->second.key);
+    if(i->count == 1) {
+      _i_kvstore->unlock(i->pool,
+                         i->key);
       
       _locked_values.erase(i);
     }
     else {
-      i->second.count --;
+      i->count --;
     }
   }
 
+  /** 
+   * Release value locks deferred by the sessions during this tick
+   * 
+   */
+  void release_deferred_locks()
+  {
+    for(auto target : _deferred_unlocks)
+      release_locked_value(target);
+    _deferred_unlocks.clear();
+  }
+
   void initialize_components(const std::string& backend,
                              const std::string& index,
                              const std::string& pci_addr,
@@ -183,7 +194,42 @@ private:
 
   void process_messages_from_ado();
 
-  status_t process_configure(Protocol::Message_IO_request* msg);
+  status_t process_scan(const Protocol::Message_IO_request* msg,
+                        Protocol::Message_IO_response* response,
+                        size_t buffer_size);
+
+  status_t process_atomic_update(const Protocol::Message_IO_request* msg,
+                                 Protocol::Message_IO_response* response,
+                                 size_t buffer_size);
+
+  /** 
+   * Check a key exists without locking it (lock creates missing keys);
+   * stores without VALUE_LEN are probed with a get
+   * 
+   * @return S_OK, E_KEY_NOT_FOUND or other error
+   */
+  status_t probe_key(const pool_t pool_id, const std::string& key);
+
+  status_t process_configure(Connection_handler* handler,
+                             Protocol::Message_IO_request* msg);
+
+  void complete_index_build(Shard_task* task, status_t status);
+
+  void abort_index_build(const pool_t pool_id);
+
+  std::string persistent_index_path(const std::string& pool_name) const;
+
+  Component::IKVIndex* open_persistent_index(const std::string& path);
+
+  void attach_persistent_index(const pool_t pool_id, const std::string& pool_name);
+
+  void release_index(const pool_t pool_id, bool remove_persistent = false);
+
+  bool schedule_requests();
+
+  uint64_t request_cost(const Protocol::Message* msg) const;
+
+  unsigned pool_weight(const Protocol::Message* msg) const;
 
   void process_tasks(unsigned& idle);
   
@@ -196,8 +242,30 @@ private:
     else return nullptr;
   }
 
+  Index_build_task * lookup_index_build(const pool_t pool_id) {
+    if(_index_builds.empty()) return nullptr;
+    auto search = _index_builds.find(pool_id);
+    return search == _index_builds.end() ? nullptr : search->second;
+  }
+
+  /** 
+   * Check a key fits the pool's index (if any), so that a put is
+   * refused before it reaches the store rather than failing in the index
+   * 
+   */
+  bool index_accepts_key(const pool_t pool_id, size_t key_len) {
+    auto build = lookup_index_build(pool_id);
+    auto index = build ? build->index() : lookup_index(pool_id);
+    return index == nullptr || key_len <= index->max_key_length();
+  }
+
   void add_index_key(const pool_t pool_id,
                      const std::string& k) {
+    auto build = lookup_index_build(pool_id);
+    if(build) {
+      build->log_insert(k);
+      return;
+    }
     auto index = lookup_index(pool_id);
     if(index)
       index->insert(k);
@@ -205,6 +273,11 @@ private:
 
   void remove_index_key(const pool_t pool_id,
                         const std::string& k) {
+    auto build = lookup_index_build(pool_id);
+    if(build) {
+      build->log_erase(k);
+      return;
+    }
     auto index = lookup_index(pool_id);
     if(index)
       index->erase(k);
@@ -259,6 +332,11 @@ private:
   }
     
   index_map_t*                     _index_map = nullptr;
+  index_build_map_t                _index_builds; /*< indices under construction */
+  std::unordered_map<pool_t, std::string> _persistent_indices; /*< backing file of persistent indices */
+  std::string                      _pm_path;
+  std::unordered_map<pool_t, unsigned> _pool_weights; /*< QoS weights; absent means 1 */
+  size_t                           _sched_start = 0;
   bool                             _thread_exit = false;
   bool                             _forced_exit;
   unsigned                         _core;
@@ -268,7 +346,8 @@ private:
   Component::IADO_manager_proxy*   _i_ado_mgr = nullptr;
   ado_map_t                        _ado_map;
   std::vector<Connection_handler*> _handlers;
-  locked_value_map_t               _locked_values;
+  Locked_value_table               _locked_values;
+  std::vector<const void*>         _deferred_unlocks; /*< gathered across sessions, released once per tick */
   task_list_t                      _tasks;
   std::set<work_request_key_t>     _outstanding_work;
 };
@@ -8,11 +8,22 @@ class Shard_task
 {
 public:
   Shard_task(Connection_handler* handler) : _handler(handler) {}
+  virtual ~Shard_task() {}
   virtual status_t do_work() = 0;
   virtual const void * get_result() const = 0;
   virtual size_t get_result_length() const = 0;
   virtual offset_t matched_position() const = 0;
+
+  /* tasks started by an IO request (e.g., configure) complete with an
+     IO response carrying the original request id; others with an INFO
+     response */
+  virtual bool io_response() const { return false; }
+  virtual uint64_t request_id() const { return 0; }
+
   Connection_handler * handler() const { return _handler; }
+
+  /* session went away; task may still run but no response is sent */
+  void detach() { _handler = nullptr; }
   
 protected:
   Connection_handler* _handler;
@@ -0,0 +1,294 @@
+#ifndef __DAWN_SERVER_TASK_INDEX_BUILD_H__
+#define __DAWN_SERVER_TASK_INDEX_BUILD_H__
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "task.h"
+
+namespace Dawn
+{
+
+/** 
+ * Secondary index build task.  Keys are first snapshotted from the
+ * store (on a helper thread when the store allows concurrent access,
+ * otherwise in bounded slices from the shard thread), then inserted into the index in bounded slices from the shard
+ * thread.  Puts and erases that arrive during the build are recorded
+ * in a side log which is replayed before the index is published.
+ *
+ * An existing (persistent) index can instead be verified: the sorted
+ * snapshot is compared key by key with the index, which is cleared and
+ * rebuilt on the first difference.
+ * 
+ */
+class Index_build_task : public Shard_task
+{
+  static constexpr unsigned MAX_KEYS_PER_WORK = 1024;
+  static const unsigned _debug_level = 0;
+
+  enum class Phase {
+    SNAPSHOT,
+    VERIFY,
+    INSERT,
+    REPLAY,
+  };
+
+  struct log_entry_t {
+    bool        insert; /* false for erase */
+    std::string key;
+  };
+  
+public:
+  Index_build_task(Connection_handler*  handler,
+                   uint64_t             request_id,
+                   Component::IKVStore* store,
+                   Component::IKVStore::pool_t pool,
+                   Component::IKVIndex* index,
+                   bool                 verify = false) :
+    Shard_task(handler), _request_id(request_id), _store(store), _pool(pool), _index(index),
+    _verify(verify)
+  {
+    using namespace Component;
+    assert(_store);
+    assert(_index);
+
+    auto model = _store->thread_safety();
+    if(model == IKVStore::THREAD_MODEL_RWLOCK_PER_POOL ||
+       model == IKVStore::THREAD_MODEL_MULTI_PER_POOL) {
+      _thread = std::thread([this]() { snapshot(); });
+    }
+  }
+
+  ~Index_build_task() {
+    abort();
+    if(_index) _index->release_ref();
+  }
+
+  status_t do_work() override {
+
+    if(_aborted) return E_FAIL;
+
+    switch(_phase) {
+    case Phase::SNAPSHOT:
+      if(!_thread.joinable()) {
+        /* store is not thread safe; walk it a slice at a time */
+        status_t hr = snapshot_slice();
+        if(hr != S_OK) return hr; /* S_MORE until the walk is complete */
+      }
+      else {
+        if(!_snapshot_done.load(std::memory_order_acquire))
+          return Component::IKVStore::S_MORE;
+        _thread.join();
+      }
+      if(_snapshot_status != S_OK) return _snapshot_status;
+
+      if(_debug_level > 0)
+        PLOG("index build: snapshot %lu keys", _snapshot.size());
+      _phase = _verify ? Phase::VERIFY : Phase::INSERT;
+      return Component::IKVStore::S_MORE;
+
+    case Phase::VERIFY:
+      {
+        if(_index->count() != _snapshot.size())
+          return rebuild();
+
+        if(_position < _snapshot.size()) {
+          /* scan resumes at the next expected key; keys are unique so a
+             mismatch shows as a different key at that point */
+          size_t end   = std::min(_snapshot.size(), _position + MAX_KEYS_PER_WORK);
+          size_t start = _position;
+          bool   match = true;
+          status_t hr = _index->scan(_snapshot[_position],
+                                     [this, end, &match](const std::string& key) {
+                                       if(key != _snapshot[_position]) {
+                                         match = false;
+                                         return false;
+                                       }
+                                       return ++_position < end;
+                                     });
+          if(hr != S_OK || !match || _position == start)
+            return rebuild();
+          return Component::IKVStore::S_MORE;
+        }
+
+        if(_debug_level > 0)
+          PLOG("index build: verified %lu keys", _snapshot.size());
+        std::vector<std::string>().swap(_snapshot);
+        _position = 0;
+        _phase = Phase::REPLAY;
+        return Component::IKVStore::S_MORE;
+      }
+
+    case Phase::INSERT:
+      {
+        size_t end = std::min(_snapshot.size(), _position + MAX_KEYS_PER_WORK);
+        for(;_position < end; _position++) {
+          if(!index_insert(_snapshot[_position]))
+            return E_LENGTH_EXCEEDED;
+        }
+
+        if(_position == _snapshot.size()) {
+          std::vector<std::string>().swap(_snapshot);
+          _position = 0;
+          _phase = Phase::REPLAY;
+        }
+        return Component::IKVStore::S_MORE;
+      }
+
+    case Phase::REPLAY:
+      {
+        /* log may still grow between slices; done once it is drained */
+        size_t end = std::min(_side_log.size(), _position + MAX_KEYS_PER_WORK);
+        for(;_position < end; _position++) {
+          auto& e = _side_log[_position];
+          if(!e.insert) _index->erase(e.key);
+          else if(!index_insert(e.key)) return E_LENGTH_EXCEEDED;
+        }
+
+        if(_position < _side_log.size())
+          return Component::IKVStore::S_MORE;
+
+        if(_debug_level > 0)
+          PLOG("index build: complete (%lu keys, %lu replayed)", _index->count(), _side_log.size());
+        _side_log.clear();
+        return S_OK;
+      }
+    }
+
+    throw Logic_exception("unexpected code path");
+  }
+
+  /** 
+   * Record updates arriving while the index is being built
+   * 
+   */
+  void log_insert(const std::string& key) { _side_log.push_back({true, key}); }
+  void log_erase(const std::string& key) { _side_log.push_back({false, key}); }
+
+  /** 
+   * Cancel build; waits for the helper to stop using the pool
+   * 
+   */
+  void abort() {
+    _aborted = true;
+    if(_thread.joinable())
+      _thread.join();
+  }
+
+  /** 
+   * Hand over the completed index
+   * 
+   */
+  Component::IKVIndex * release_index() {
+    auto index = _index;
+    _index = nullptr;
+    return index;
+  }
+
+  Component::IKVStore::pool_t pool() const { return _pool; }
+
+  Component::IKVIndex * index() const { return _index; }
+
+  const void * get_result() const override { return nullptr; }
+
+  size_t get_result_length() const override { return 0; }
+
+  offset_t matched_position() const override { return 0; }
+
+  bool io_response() const override { return true; }
+
+  uint64_t request_id() const override { return _request_id; }
+
+private:
+
+  status_t rebuild() {
+    PWRN("index build: existing index does not match pool; rebuilding");
+    _index->clear();
+    _position = 0;
+    _phase = Phase::INSERT;
+    return Component::IKVStore::S_MORE;
+  }
+
+  /* keys already in the pool may be too long for the index */
+  bool index_insert(const std::string& key) {
+    if(key.size() > _index->max_key_length()) {
+      PWRN("index build: key of length %lu exceeds index maximum (%lu)",
+           key.size(), _index->max_key_length());
+      return false;
+    }
+    _index->insert(key);
+    return true;
+  }
+
+  /* keys skipped or seen twice by the walk are fixed up by the side log
+     replay, and index inserts are idempotent */
+  status_t snapshot_slice() {
+    auto& keys = _snapshot;
+    status_t hr = _store->map_keys_slice(_pool, _cursor, MAX_KEYS_PER_WORK,
+                                         [&keys](const std::string& key) {
+                                           keys.push_back(key);
+                                           return 0;
+                                         });
+    switch(hr) {
+    case Component::IKVStore::S_MORE:
+      return hr;
+    case E_BAD_OFFSET: /* pool was resized; start over */
+      std::vector<std::string>().swap(_snapshot);
+      _cursor = 0;
+      return Component::IKVStore::S_MORE;
+    case E_NOT_SUPPORTED:
+      snapshot(); /* no resumable walk; snapshot inline */
+      return S_OK;
+    case S_OK:
+      if(_verify)
+        std::sort(keys.begin(), keys.end());
+      _snapshot_status = S_OK;
+      return S_OK;
+    default:
+      return hr;
+    }
+  }
+
+  void snapshot() {
+    auto& keys = _snapshot;
+    status_t hr = _store->map_keys(_pool,
+                                   [&keys](const std::string& key) {
+                                     keys.push_back(key);
+                                     return 0;
+                                   });
+    if(hr != S_OK) {
+      hr = _store->map(_pool,
+                       [&keys](const std::string& key,
+                               const void * value,
+                               const size_t value_len) {
+                         keys.push_back(key);
+                         return 0;
+                       });
+    }
+    if(_verify)
+      std::sort(keys.begin(), keys.end());
+    _snapshot_status = hr;
+    _snapshot_done.store(true, std::memory_order_release);
+  }
+
+private:
+  const uint64_t              _request_id;
+  Component::IKVStore*        _store;
+  Component::IKVStore::pool_t _pool;
+  Component::IKVIndex*        _index;
+  const bool                  _verify;
+  Phase                       _phase = Phase::SNAPSHOT;
+  bool                        _aborted = false;
+  std::thread                 _thread;
+  std::atomic<bool>           _snapshot_done{false};
+  status_t                    _snapshot_status = E_FAIL;
+  std::vector<std::string>    _snapshot;
+  std::vector<log_entry_t>    _side_log;
+  size_t                      _position = 0;
+  uint64_t                    _cursor = 0;
+};
+
+}
+#endif // __DAWN_SERVER_TASK_INDEX_BUILD_H__
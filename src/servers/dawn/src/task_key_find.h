@@ -1,6 +1,8 @@
 #ifndef __DAWN_SERVER_TASK_KEY_FIND_H__
 #define __DAWN_SERVER_TASK_KEY_FIND_H__
 
+#include <common/key_matcher.h>
+#include <memory>
 #include <string>
 #include <unistd.h>
 #include "task.h"
@@ -10,12 +12,13 @@ namespace Dawn
 
 /** 
  * Key search task.  We limit the number of hops we search so as to bound
- * the worst case execution time.
+ * the worst case execution time.  The expression is compiled once, when
+ * the task is created; an invalid expression throws from the constructor.
  * 
  */
 class Key_find_task : public Shard_task
 {
-  static constexpr unsigned MAX_COMPARES_PER_WORK = 5;
+  static constexpr unsigned MAX_COMPARES_PER_WORK = 256;
   static const unsigned _debug_level = 0;
   
 public:
@@ -27,7 +30,6 @@ public:
   {
     using namespace Component;
     assert(_index);
-    _index->add_ref();
 
     if(_debug_level > 0) {
       PLOG("offset=%lu", offset);
@@ -51,28 +53,27 @@ public:
       _expr = expression.substr(7);
     }
     else throw Logic_exception("unhandled expression");
-    
-    assert(_index);
+
+    if(_type != IKVIndex::FIND_TYPE_NEXT)
+      _matcher.reset(new Common::Key_matcher(IKVIndex::matcher_type(_type), _expr));
+
+    _index->add_ref();
   }
 
   ~Key_find_task() {
     _index->release_ref();
   }
 
-    //   case IKVIndex::FIND_TYPE_REGEX:
-    // case IKVIndex::FIND_TYPE_EXACT:
-    // case IKVIndex::FIND_TYPE_PREFIX:
-    // }
-
-
-  
   status_t do_work() {
 
     using namespace Component;
 
     status_t hr;
     try {
-      hr = _index->find(_expr, _offset, _type, _offset, _out_key, MAX_COMPARES_PER_WORK);
+      if(_matcher)
+        hr = _index->find(*_matcher, _offset, _offset, _out_key, MAX_COMPARES_PER_WORK);
+      else
+        hr = _index->find(_expr, _offset, _type, _offset, _out_key, MAX_COMPARES_PER_WORK);
       //      PLOG("OFFSET=%lu", _offset);
       if(hr == E_MAX_REACHED) {
         _offset++;
@@ -82,6 +83,9 @@ public:
         PLOG("matched: (%s)", _out_key.c_str());
         return S_OK;
       }
+      else if(hr == E_FAIL) {
+        return E_FAIL; /* end of index reached without a match */
+      }
     }
     catch(...) {
       PWRN("Shard::task_key index->find failed");
@@ -105,6 +109,7 @@ public:
 
 private:
   std::string                 _expr;
+  std::unique_ptr<Common::Key_matcher> _matcher; /* null for FIND_TYPE_NEXT */
   std::string                 _out_key;
   Component::IKVIndex::find_t _type;
   offset_t                    _offset;
@@ -0,0 +1,169 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+#include "locked_value_table.h"
+
+using namespace Dawn;
+using IKVStore = Component::IKVStore;
+
+namespace
+{
+const void* addr(uint64_t i) { return reinterpret_cast<const void*>((i + 1) * 64); }
+
+IKVStore::key_t key_of(uint64_t i) { return reinterpret_cast<IKVStore::key_t>(i + 1); }
+
+/* same slot function as Locked_value_table::hash */
+size_t home_slot(const void* target, size_t capacity)
+{
+  uint64_t h = reinterpret_cast<uint64_t>(target) * 0x9E3779B97F4A7C15ULL;
+  return size_t(h >> 32) & (capacity - 1);
+}
+
+/* addresses whose home slot is 'slot' in a table of initial capacity */
+std::vector<const void*> with_home(size_t slot, unsigned count, uint64_t& next)
+{
+  std::vector<const void*> result;
+  while (result.size() < count) {
+    auto a = addr(next++);
+    if (home_slot(a, Locked_value_table::INITIAL_CAPACITY) == slot) result.push_back(a);
+  }
+  return result;
+}
+
+TEST(Locked_value_table, AddFindErase)
+{
+  Locked_value_table t;
+  ASSERT_EQ(0, t.size());
+  ASSERT_EQ(nullptr, t.find(addr(0)));
+
+  t.add(addr(0), 7, key_of(0));
+  t.add(addr(0), 7, key_of(0));
+  ASSERT_EQ(1, t.size());
+
+  auto e = t.find(addr(0));
+  ASSERT_TRUE(e);
+  ASSERT_EQ(addr(0), e->target);
+  ASSERT_EQ(7, e->pool);
+  ASSERT_EQ(key_of(0), e->key);
+  ASSERT_EQ(2, e->count);
+
+  t.erase(e);
+  ASSERT_EQ(0, t.size());
+  ASSERT_EQ(nullptr, t.find(addr(0)));
+}
+
+TEST(Locked_value_table, Grow)
+{
+  const uint64_t count = Locked_value_table::INITIAL_CAPACITY * 40;
+
+  Locked_value_table t;
+  for (uint64_t i = 0; i < count; i++) t.add(addr(i), i, key_of(i));
+  ASSERT_EQ(count, t.size());
+
+  for (uint64_t i = 0; i < count; i++) {
+    auto e = t.find(addr(i));
+    ASSERT_TRUE(e) << "entry " << i << " lost on grow";
+    ASSERT_EQ(i, e->pool);
+    ASSERT_EQ(key_of(i), e->key);
+    ASSERT_EQ(1, e->count);
+  }
+
+  for (uint64_t i = 0; i < count; i += 2) t.erase(t.find(addr(i)));
+  ASSERT_EQ(count / 2, t.size());
+
+  for (uint64_t i = 0; i < count; i++) {
+    if (i % 2)
+      ASSERT_TRUE(t.find(addr(i)));
+    else
+      ASSERT_EQ(nullptr, t.find(addr(i)));
+  }
+}
+
+TEST(Locked_value_table, EraseAcrossWraparound)
+{
+  const size_t last = Locked_value_table::INITIAL_CAPACITY - 1;
+  uint64_t     next = 0;
+
+  /* a probe run from the last slot wraps to slots 0..2; an entry whose
+     home is slot 0 lands behind it in slot 3 */
+  auto tail = with_home(last, 4, next);
+  auto head = with_home(0, 1, next);
+
+  Locked_value_table t;
+  for (auto a : tail) t.add(a, 1, nullptr);
+  t.add(head[0], 2, nullptr);
+  ASSERT_EQ(5, t.size());
+
+  /* removing the run's first entry shifts the rest back across the end
+     of the array, and the slot-0 entry back to its home */
+  t.erase(t.find(tail[0]));
+  ASSERT_EQ(nullptr, t.find(tail[0]));
+  for (size_t i = 1; i < tail.size(); i++) ASSERT_TRUE(t.find(tail[i]));
+  ASSERT_TRUE(t.find(head[0]));
+  ASSERT_EQ(2, t.find(head[0])->pool);
+
+  /* removing from the middle of the wrapped part */
+  t.erase(t.find(tail[2]));
+  ASSERT_TRUE(t.find(tail[1]));
+  ASSERT_TRUE(t.find(tail[3]));
+  ASSERT_TRUE(t.find(head[0]));
+
+  t.erase(t.find(head[0]));
+  t.erase(t.find(tail[1]));
+  t.erase(t.find(tail[3]));
+  ASSERT_EQ(0, t.size());
+  for (auto a : tail) ASSERT_EQ(nullptr, t.find(a));
+  ASSERT_EQ(nullptr, t.find(head[0]));
+}
+
+TEST(Locked_value_table, MatchesMap)
+{
+  std::mt19937_64          rng(42);
+  std::map<const void*, int> model;
+  Locked_value_table       t;
+
+  for (unsigned op = 0; op < 200000; op++) {
+    auto a = addr(rng() % 2048);
+    auto e = t.find(a);
+    auto m = model.find(a);
+    ASSERT_EQ(m == model.end(), e == nullptr);
+
+    if (rng() % 3 == 0 && e) {
+      t.erase(e);
+      model.erase(m);
+    }
+    else {
+      t.add(a, 0, nullptr);
+      model[a]++;
+    }
+    ASSERT_EQ(model.size(), t.size());
+  }
+
+  for (auto& m : model) {
+    auto e = t.find(m.first);
+    ASSERT_TRUE(e);
+    ASSERT_EQ(m.second, e->count);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -2,6 +2,8 @@
 #define __DATA_H__
 
 #include <common/str_utils.h>
+#include <cstdint>
+#include <string>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++"
 #include <common/logging.h>
@@ -90,16 +92,52 @@ public:
     
     for( size_t i=0; i<_num_elements; ++i) 
     {
-      auto key = Common::random_string(_key_len);
-      auto val = Common::random_string(_val_len);
-
-      _data[i].key = key;
-      _data[i].value = val;
+      _data[i].key = make_key(i, _key_len);
+      _data[i].value = make_value(i, _val_len);
     }
 
     PLOG("%d elements initialized, size %d.", int(_num_elements), int(_val_len));
   }
   
+  /* 
+   * Deterministic key for element i. Characters are drawn from a
+   * 62-symbol alphabet; each base-62 digit of i is offset by a hash of
+   * the lower digits, so keys are unique for i < 62^key_len while
+   * neighbouring indexes do not yield neighbouring keys.
+   */
+  static std::string make_key(std::uint64_t i, size_t key_len)
+  {
+    std::string key(key_len, '0');
+    std::uint64_t rest = i;
+    std::uint64_t h = 0;
+    for ( size_t c = 0; c < key_len; ++c )
+    {
+      const auto digit = rest % ALPHABET_LEN;
+      rest /= ALPHABET_LEN;
+      key[c] = alphabet()[(digit + mix(h + c) % ALPHABET_LEN) % ALPHABET_LEN];
+      h = mix(h ^ (digit + 1));
+    }
+    return key;
+  }
+
+  /* Deterministic printable value for element i */
+  static std::string make_value(std::uint64_t i, size_t val_len)
+  {
+    std::string val(val_len, '0');
+    fill_value(i, &val[0], val_len);
+    return val;
+  }
+
+  static void fill_value(std::uint64_t i, char * buffer, size_t len)
+  {
+    std::uint64_t state = mix(i ^ 0x5bd1e995ULL);
+    for ( size_t c = 0; c < len; ++c )
+    {
+      if ( c % 8 == 0 ) { state = mix(state + c); }
+      buffer[c] = alphabet()[(state >> (8 * (c % 8))) % ALPHABET_LEN];
+    }
+  }
+
   const char * key(size_t i) const 
   {
     if(i >= _num_elements) throw General_exception("index out of bounds");
@@ -123,6 +161,23 @@ public:
   size_t value_len() const { return _val_len; }
   
   size_t num_elements() const { return _num_elements; }
+
+private:
+  static constexpr unsigned ALPHABET_LEN = 62;
+
+  static const char * alphabet()
+  {
+    return "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  }
+
+  /* splitmix64 finalizer */
+  static std::uint64_t mix(std::uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
 };
 
 #endif
@@ -0,0 +1,268 @@
+#include "exp_open_loop.h"
+
+#include "data.h"
+#include "program_options.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wfloat-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wshadow"
+#include "../ycsb/src/generator.h"
+#include "../ycsb/src/counter_generator.h"
+#include "../ycsb/src/zipfian_generator.h"
+#include "../ycsb/src/skewed_latest_generator.h"
+#pragma GCC diagnostic pop
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include <thread>
+
+std::mutex ExperimentOpenLoop::_summary_lock;
+HdrHistogram ExperimentOpenLoop::_summary_latency;
+std::uint64_t ExperimentOpenLoop::_summary_ops = 0;
+double ExperimentOpenLoop::_summary_rate = 0.0;
+
+namespace
+{
+  /* sleep for waits longer than this, spin for shorter ones */
+  constexpr auto SPIN_THRESHOLD = std::chrono::microseconds(100);
+
+  double to_usec(std::uint64_t ns)
+  {
+    return double(ns) / 1000.0;
+  }
+}
+
+ExperimentOpenLoop::ExperimentOpenLoop(const ProgramOptions &options)
+  : Experiment("open_loop", options)
+  , _distribution(
+      options.distribution == "zipfian" ? distribution_t::ZIPFIAN
+      : options.distribution == "latest" ? distribution_t::LATEST
+      : distribution_t::UNIFORM
+    )
+  , _rate(double(options.rate))
+  , _zipf_theta(options.zipf_theta)
+  , _rd_pct(options.read_pct)
+  , _op_index(0)
+  , _late_ops(0)
+  , _key_count(pool_num_objects())
+  , _start_time()
+  , _report_time()
+  , _report_interval(std::chrono::seconds(options.report_interval))
+  , _rnd{}
+  , _rand_pct(0, 99)
+  , _insert_key()
+  , _zipfian()
+  , _latest()
+  , _value(options.value_length, '0')
+  , _interval_latency()
+  , _total_latency()
+  , _service_time()
+{
+}
+
+ExperimentOpenLoop::~ExperimentOpenLoop()
+{
+}
+
+void ExperimentOpenLoop::initialize_custom(unsigned core)
+{
+  if ( _key_count < 2 )
+  {
+    throw std::runtime_error("open_loop test requires at least 2 elements");
+  }
+
+  _rnd.seed(core);
+  _insert_key.reset(new ycsbc::CounterGenerator(_key_count));
+
+  switch ( _distribution )
+  {
+  case distribution_t::ZIPFIAN:
+    _zipfian.reset(new ycsbc::ZipfianGenerator(0, _key_count - 1, _zipf_theta));
+    break;
+  case distribution_t::LATEST:
+    _latest.reset(new ycsbc::SkewedLatestGenerator(*_insert_key));
+    break;
+  case distribution_t::UNIFORM:
+    break;
+  }
+}
+
+std::uint64_t ExperimentOpenLoop::next_key(bool is_read)
+{
+  switch ( _distribution )
+  {
+  case distribution_t::ZIPFIAN:
+    /* scramble so that popular keys are spread across the key space */
+    return ycsbutils::FNVHash64(_zipfian->Next()) % _key_count;
+  case distribution_t::LATEST:
+    /* writes insert new keys; reads favour the most recent ones */
+    return is_read ? _latest->Next() : _insert_key->Next();
+  case distribution_t::UNIFORM:
+  default:
+    return std::uniform_int_distribution<std::uint64_t>(0, _key_count - 1)(_rnd);
+  }
+}
+
+void ExperimentOpenLoop::populate(unsigned core)
+{
+  PLOG("[%u] open_loop: populating %lu keys...", core, _key_count);
+
+  for ( std::uint64_t i = 0; i != _key_count; ++i )
+  {
+    const auto key = Data::make_key(i, g_data->key_len());
+    Data::fill_value(i, &_value[0], _value.size());
+    auto rc = store()->put(pool(), key, _value.data(), _value.size());
+    if ( rc != S_OK )
+    {
+      auto e = "open_loop: populate put failed with " + std::to_string(rc) + " at element " + std::to_string(i);
+      PERR("[%u] %s. Exiting.", core, e.c_str());
+      throw std::runtime_error(e);
+    }
+  }
+}
+
+void ExperimentOpenLoop::wait_until(clock_type::time_point t) const
+{
+  for ( auto now = clock_type::now(); now < t; now = clock_type::now() )
+  {
+    if ( t - now > SPIN_THRESHOLD )
+    {
+      std::this_thread::sleep_until(t - SPIN_THRESHOLD);
+    }
+  }
+}
+
+bool ExperimentOpenLoop::do_work(unsigned core)
+{
+  // handle first time setup
+  if ( _first_iter )
+  {
+    populate(core);
+
+    wait_for_delayed_start(core);
+
+    PLOG("[%u] Starting open_loop experiment (rate:%g ops/s, read:%u%%, value len:%zu)...", core, _rate, _rd_pct, _value.size());
+    _first_iter = false;
+
+    _start_time = clock_type::now();
+    _report_time = _start_time;
+    if ( _duration_directed )
+    {
+      _end_time_directed = std::chrono::high_resolution_clock::now() + *_duration_directed;
+    }
+  }
+
+  /* scheduled start of this operation; computed from the operation
+     index so that rounding does not accumulate */
+  const auto intended =
+    _start_time + std::chrono::nanoseconds(std::uint64_t(double(_op_index) * 1e9 / _rate));
+  wait_until(intended);
+
+  const bool is_read = _rand_pct(_rnd) < _rd_pct;
+  const auto key_index = next_key(is_read);
+  const auto key = Data::make_key(key_index, g_data->key_len());
+
+  const auto issued = clock_type::now();
+  if ( issued - intended > SPIN_THRESHOLD )
+  {
+    ++_late_ops;
+  }
+
+  status_t rc;
+  if ( is_read )
+  {
+    void * pval = nullptr;
+    size_t pval_len = 0;
+    rc = store()->get(pool(), key, pval, pval_len);
+    if ( rc == S_OK )
+    {
+      store()->free_memory(pval);
+    }
+  }
+  else
+  {
+    Data::fill_value(key_index ^ _op_index, &_value[0], _value.size());
+    rc = store()->put(pool(), key, _value.data(), _value.size());
+  }
+  const auto done = clock_type::now();
+
+  if ( rc != S_OK )
+  {
+    auto e = std::string(is_read ? "get" : "put") + " returned " + std::to_string(rc) + " for element " + std::to_string(key_index);
+    PERR("[%u] open_loop: %s. Exiting.", core, e.c_str());
+    throw std::runtime_error(e);
+  }
+
+  const auto latency = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(done - intended).count());
+  _interval_latency.record(latency);
+  _total_latency.record(latency);
+  _service_time.record(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(done - issued).count()));
+  ++_op_index;
+
+  if ( _report_interval <= done - _report_time )
+  {
+    auto ptime_str = to_iso_extended_string(boost::posix_time::microsec_clock::universal_time());
+    double secs = to_seconds(done - _report_time);
+    PLOG(
+      "time %s core %u ops/s %.0f latency(us) p50 %.1f p99 %.1f p999 %.1f max %.1f"
+      , ptime_str.c_str()
+      , core
+      , double(_interval_latency.count()) / secs
+      , to_usec(_interval_latency.percentile(50.0))
+      , to_usec(_interval_latency.percentile(99.0))
+      , to_usec(_interval_latency.percentile(99.9))
+      , to_usec(_interval_latency.max())
+    );
+    _interval_latency.reset();
+    _report_time = done;
+  }
+
+  return
+    _end_time_directed
+    ? std::chrono::high_resolution_clock::now() < *_end_time_directed
+    : _op_index != pool_num_objects()
+    ;
+}
+
+double ExperimentOpenLoop::to_seconds(clock_type::duration d)
+{
+  return std::chrono::duration<double>(d).count();
+}
+
+void ExperimentOpenLoop::cleanup_custom(unsigned core)
+{
+  double secs = to_seconds(clock_type::now() - _start_time);
+  double achieved = double(_op_index) / secs;
+
+  PINF("[%u] open_loop: %lu ops in %g secs (target %g ops/s, achieved %g ops/s, %lu issued late)",
+       core, _op_index, secs, _rate, achieved, _late_ops);
+  PINF("[%u] open_loop: latency(us) p50 %.1f p99 %.1f p999 %.1f max %.1f; service time(us) p50 %.1f p99 %.1f p999 %.1f",
+       core,
+       to_usec(_total_latency.percentile(50.0)),
+       to_usec(_total_latency.percentile(99.0)),
+       to_usec(_total_latency.percentile(99.9)),
+       to_usec(_total_latency.max()),
+       to_usec(_service_time.percentile(50.0)),
+       to_usec(_service_time.percentile(99.0)),
+       to_usec(_service_time.percentile(99.9)));
+
+  std::lock_guard<std::mutex> g(_summary_lock);
+  _summary_latency.add(_total_latency);
+  _summary_ops += _op_index;
+  _summary_rate += achieved;
+}
+
+void ExperimentOpenLoop::summarize()
+{
+  PMAJOR("open_loop: total %lu ops, %g ops/s; latency(us) p50 %.1f p99 %.1f p999 %.1f max %.1f",
+         _summary_ops,
+         _summary_rate,
+         to_usec(_summary_latency.percentile(50.0)),
+         to_usec(_summary_latency.percentile(99.0)),
+         to_usec(_summary_latency.percentile(99.9)),
+         to_usec(_summary_latency.max()));
+}
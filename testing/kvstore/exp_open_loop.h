@@ -0,0 +1,78 @@
+#ifndef __EXP_OPEN_LOOP_H__
+#define __EXP_OPEN_LOOP_H__
+
+#include "experiment.h"
+
+#include <common/hdr_histogram.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace ycsbc
+{
+  class CounterGenerator;
+  class ZipfianGenerator;
+  class SkewedLatestGenerator;
+}
+
+/*
+ * Open-loop latency experiment. Operations are scheduled at a fixed
+ * rate per core, independent of how quickly the store responds, and
+ * latency is measured from each operation's scheduled start rather
+ * than from when it was actually issued. A stalled store therefore
+ * shows up as queueing delay in the tail instead of silently lowering
+ * the offered load (coordinated omission).
+ *
+ * Keys and values are generated on the fly from the element index, so
+ * no Data set is needed.
+ */
+class ExperimentOpenLoop : public Experiment
+{
+  using clock_type = std::chrono::steady_clock;
+
+  enum class distribution_t { UNIFORM, ZIPFIAN, LATEST };
+
+  distribution_t _distribution;
+  double _rate;
+  double _zipf_theta;
+  unsigned _rd_pct;
+  std::uint64_t _op_index;
+  std::uint64_t _late_ops;
+  std::uint64_t _key_count;
+  clock_type::time_point _start_time;
+  clock_type::time_point _report_time;
+  clock_type::duration _report_interval;
+  std::mt19937_64 _rnd;
+  std::uniform_int_distribution<unsigned> _rand_pct;
+  std::unique_ptr<ycsbc::CounterGenerator> _insert_key;
+  std::unique_ptr<ycsbc::ZipfianGenerator> _zipfian;
+  std::unique_ptr<ycsbc::SkewedLatestGenerator> _latest;
+  std::string _value;
+  HdrHistogram _interval_latency;
+  HdrHistogram _total_latency;
+  HdrHistogram _service_time;
+
+  static std::mutex _summary_lock;
+  static HdrHistogram _summary_latency;
+  static std::uint64_t _summary_ops;
+  static double _summary_rate;
+
+  std::uint64_t next_key(bool is_read);
+  void populate(unsigned core);
+  void wait_until(clock_type::time_point t) const;
+  static double to_seconds(clock_type::duration);
+
+public:
+  ExperimentOpenLoop(const ProgramOptions &options);
+  ~ExperimentOpenLoop();
+  void initialize_custom(unsigned core) override;
+  bool do_work(unsigned core) override;
+  void cleanup_custom(unsigned core) override;
+  static void summarize();
+};
+
+#endif // __EXP_OPEN_LOOP_H__
@@ -5,6 +5,7 @@
 #include "exp_get.h"
 #include "exp_get_direct.h"
 #include "exp_erase.h"
+#include "exp_open_loop.h"
 #include "exp_put_direct.h"
 #include "exp_throughput.h"
 #include "exp_update.h"
@@ -67,6 +68,7 @@ namespace
     { "throughput", run_exp<ExperimentThroughput> },
     { "erase", run_exp<ExperimentErase> },
     { "update", run_exp<ExperimentUpdate> },
+    { "open_loop", run_exp<ExperimentOpenLoop> },
   };
 }
 
@@ -100,8 +102,9 @@ int main(int argc, char * argv[])
 
     ProgramOptions Options(vm);
 
-    bool use_direct_memory = Options.component == "dawn";
-    Experiment::g_data = new Data(Options.elements, Options.key_length, Options.value_length, use_direct_memory);
+    /* open_loop generates keys and values on the fly */
+    bool delay_initialization = Options.component == "dawn" || Options.test == "open_loop";
+    Experiment::g_data = new Data(Options.elements, Options.key_length, Options.value_length, delay_initialization);
 
     Options.report_file_name = Options.do_json_reporting ? Experiment::create_report(Options.component) : "";
 
@@ -71,6 +71,9 @@ try
   , summary( vm_.count("summary") )
   , read_pct( clamp(vm_["read_pct"].as<unsigned>(), 0U, 100U) )
   , insert_erase_pct( clamp(vm_["insert_erase_pct"].as<unsigned>(), 0U, 100U) )
+  , rate(vm_["rate"].as<unsigned>())
+  , distribution(vm_["distribution"].as<std::string>())
+  , zipf_theta(vm_["zipf_theta"].as<double>())
   , devices(vm_.count("devices") ? vm_["devices"].as<std::string>() : cores)
   , time_secs()
   , path( vm_.count("path") ? vm_["path"].as<std::string>() : boost::optional<std::string>() )
@@ -98,6 +101,17 @@ try
     throw std::runtime_error(e);
   }
 
+  if ( distribution != "uniform" && distribution != "zipfian" && distribution != "latest" )
+  {
+    auto e = "unknown key distribution '" + distribution + "'";
+    throw std::runtime_error(e);
+  }
+
+  if ( rate == 0 )
+  {
+    throw std::runtime_error("rate must be greater than zero");
+  }
+
   if ( component_is( "nvmestore" ) && ! pci_addr )
   {
     auto e = "component '" + component + "' requires --pci_addr argument";
@@ -147,6 +161,9 @@ void ProgramOptions::add_program_options(
     ("debug_level", po::value<int>()->default_value(0), "Debug level. Default: 0.")
     ("read_pct", po::value<unsigned>()->default_value(0) , "Read percentage in throughput test. Default: 0.")
     ("insert_erase_pct", po::value<unsigned>()->default_value(0) , "Insert/erase percentage in throughput test. Default: 0.")
+    ("rate", po::value<unsigned>()->default_value(10000), "Target operations per second, per core, in open_loop test. Default: 10000.")
+    ("distribution", po::value<std::string>()->default_value("uniform"), "Key distribution in open_loop test <uniform|zipfian|latest>. Default: uniform.")
+    ("zipf_theta", po::value<double>()->default_value(0.99), "Skew of the zipfian distribution. Default: 0.99.")
     ("owner", po::value<std::string>()->default_value("owner"), "Owner name for component registration")
     ("server", po::value<std::string>()->default_value("127.0.0.1"), "Dawn server IP address. Default: 127.0.0.1")
     ("port", po::value<unsigned>()->default_value(11911), "Dawn server port. Default 11911")
@@ -27,6 +27,9 @@ public:
   bool summary;
   unsigned read_pct;
   unsigned insert_erase_pct;
+  unsigned rate;
+  std::string distribution;
+  double zipf_theta;
   /* finalized later */
   std::string devices;
   unsigned time_secs;
@@ -177,7 +177,20 @@ int DawnDB::scan(const string &                table,
                  int                           count,
                  vector<pair<string, string>> &results)
 {
-  return -1;
+  /* a batch may end early on the transport's byte budget; continue
+     from the returned cursor until 'count' records have been read */
+  string cursor = key;
+  while (count > 0) {
+    string next;
+    size_t before = results.size();
+    int    ret    = client->scan(pool, cursor, "", count, 0, results, next);
+    if (ret != S_OK) return ret;
+
+    count -= results.size() - before;
+    if (next.empty()) break;
+    cursor = next;
+  }
+  return 0;
 }
 
 void DawnDB::clean()
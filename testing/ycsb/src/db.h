@@ -42,6 +42,8 @@ class DB {
                     int                           count,
                     vector<pair<string, string>> &results)           = 0;
   virtual void init(Properties &props, unsigned core = 0)            = 0;
+  /* called on each workload thread, with its id, before any operation */
+  virtual void thread_init(int thread_id) {}
   virtual void clean()                                               = 0;
   virtual ~DB(){};
 };
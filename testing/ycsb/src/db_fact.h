@@ -15,6 +15,7 @@
 
 #include "dawndb.h"
 #include "db.h"
+#include "kvstoredb.h"
 #include "properties.h"
 
 namespace ycsb
@@ -26,6 +27,9 @@ class DBFactory {
     if (props.getProperty("db") == "dawn") {
       return new DawnDB(props, core);
     }
+    else if (props.getProperty("db") == "kvstore") {
+      return new KVStoreDB(props, core);
+    }
     else
       return nullptr;
   }
@@ -0,0 +1,334 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "kvstoredb.h"
+#include "workload.h"
+#include <api/components.h>
+#include <common/exceptions.h>
+#include <common/str_utils.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace Component;
+using namespace std;
+using namespace ycsb;
+
+namespace
+{
+std::atomic<uint64_t> instance_count(0);
+
+const char *op_names[] = {"READ", "INSERT", "UPDATE", "ERASE", "SCAN"};
+
+/* times an operation into a histogram, in nanoseconds */
+class Latency_interval {
+ public:
+  Latency_interval(HdrHistogram &h)
+      : hist(h), start(std::chrono::steady_clock::now())
+  {
+  }
+  ~Latency_interval()
+  {
+    hist.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+  }
+
+ private:
+  HdrHistogram &                        hist;
+  std::chrono::steady_clock::time_point start;
+};
+}  // namespace
+
+KVStoreDB::KVStoreDB(Properties &props, unsigned core) { init(props, core); }
+
+KVStoreDB::~KVStoreDB() { clean(); }
+
+void KVStoreDB::init(Properties &props, unsigned core)
+{
+  this->core = core;
+  id         = ++instance_count;
+  path       = props.getProperty("path", "./data/");
+  poolsize   = GB(stoul(props.getProperty("poolsize", "1")));
+  shared     = props.getProperty("poolmode", "thread") == "shared";
+  value_capacity = std::max<uint64_t>(
+      atoll(props.getProperty("valuebyte", to_string(Workload::SIZE)).c_str()),
+      Workload::SIZE);
+
+  string component = props.getProperty("component", "mapstore");
+  int    debug     = stoi(props.getProperty("debug_level", "0"));
+
+  IBase *comp;
+  if (component == "hstore")
+    comp = load_component("libcomanche-hstore.so", hstore_factory);
+  else if (component == "mapstore")
+    comp = load_component("libcomanche-storemap.so", mapstore_factory);
+  else if (component == "filestore")
+    comp = load_component("libcomanche-storefile.so", filestore_factory);
+  else if (component == "nvmestore")
+    comp = load_component("libcomanche-nvmestore.so", nvmestore_factory);
+  else if (component == "pmstore")
+    comp = load_component("libcomanche-pmstore.so", pmstore_factory);
+  else
+    throw General_exception("unknown component (%s)", component.c_str());
+
+  if (!comp)
+    throw General_exception("unable to load component (%s)", component.c_str());
+
+  IKVStore_factory *fact = static_cast<IKVStore_factory *>(
+      comp->query_interface(IKVStore_factory::iid()));
+
+  if (component == "hstore") {
+    string dax      = props.getProperty("dax", "/dev/dax0.0");
+    string dax_addr = props.getProperty("dax_addr");
+    if (dax_addr.empty())
+      throw General_exception("hstore needs a mapping address (dax_addr)");
+    string device_map = "[ { \"region_id\": 0, \"path\": \"" + dax +
+                        "\", \"addr\": \"" + dax_addr + "\" } ]";
+    store = fact->create(debug, "name", "ycsb", device_map);
+  }
+  else if (component == "nvmestore") {
+    std::map<string, string> params;
+    params["owner"]        = "owner";
+    params["name"]         = "ycsb";
+    params["pci"]          = props.getProperty("pci");
+    params["pm_path"]      = "/mnt/pmem0/";
+    params["persist_type"] = "hstore";
+    store                  = fact->create(debug, params);
+  }
+  else if (component == "pmstore") {
+    store = fact->create(debug, "ycsb", "", "");
+  }
+  else {
+    store = fact->create("owner", "ycsb");
+  }
+  fact->release_ref();
+
+  if (!store)
+    throw General_exception("unable to create store (%s)", component.c_str());
+
+  /* stores that cannot take concurrent operations on the same pool are
+     serialized in shared mode */
+  serialize =
+      shared && store->thread_safety() != IKVStore::THREAD_MODEL_MULTI_PER_POOL;
+
+  if (props.getProperty("index", "none") == "rbtree") {
+    IBase *icomp =
+        load_component("libcomanche-indexrbtree.so", rbtreeindex_factory);
+    if (!icomp)
+      throw General_exception("unable to load libcomanche-indexrbtree.so");
+    index_factory = static_cast<IKVIndex_factory *>(
+        icomp->query_interface(IKVIndex_factory::iid()));
+  }
+
+  if (shared) {
+    std::lock_guard<std::mutex> g(lock);
+    shared_pool = open_pool("ycsb." + to_string(core));
+  }
+}
+
+KVStoreDB::Pool_state *KVStoreDB::open_pool(const string &name)
+{
+  std::unique_ptr<Pool_state> p(new Pool_state());
+  p->name = name;
+  p->pool = store->open_pool(path + name);
+
+  bool existing = p->pool != IKVStore::POOL_ERROR;
+  if (!existing)
+    p->pool = store->create_pool(path + name, poolsize,
+                                 IKVStore::FLAGS_SET_SIZE);
+  if (p->pool == IKVStore::POOL_ERROR)
+    throw General_exception("unable to open or create pool (%s)",
+                            (path + name).c_str());
+
+  if (index_factory) {
+    p->index = index_factory->create("ycsb", "");
+    /* index keys left by a previous load phase */
+    if (existing) {
+      auto index = p->index;
+      store->map_keys(p->pool, [index](const std::string &key) {
+        index->insert(key);
+        return 0;
+      });
+    }
+  }
+
+  pools.emplace_back(std::move(p));
+  return pools.back().get();
+}
+
+void KVStoreDB::thread_init(int thread_id)
+{
+  thread_state(thread_id);
+}
+
+KVStoreDB::Thread_state &KVStoreDB::thread_state(int thread_id)
+{
+  /* cached per thread; 'id' rather than 'this' guards against a new DB
+     reusing the address of a deleted one */
+  thread_local uint64_t      owner = 0;
+  thread_local Thread_state *state = nullptr;
+  if (owner == id) return *state;
+
+  std::lock_guard<std::mutex> g(lock);
+  threads.emplace_back(new Thread_state());
+  state       = threads.back().get();
+  /* the workload spreads keys by thread id, so a thread must find the
+     pool that the same id loaded; arrival order is only a fallback */
+  if (thread_id < 0) thread_id = int(threads.size() - 1);
+  state->pool = shared ? shared_pool
+                       : open_pool("ycsb." + to_string(core) + "." +
+                                   to_string(thread_id));
+  owner = id;
+  return *state;
+}
+
+int KVStoreDB::get(const string &table,
+                   const string &key,
+                   char *        value,
+                   bool          direct)
+{
+  auto &             t = thread_state();
+  Latency_interval   li(t.latency[OP_GET]);
+  std::unique_lock<std::mutex> g(t.pool->lock, std::defer_lock);
+  if (serialize) g.lock();
+
+  void * b   = nullptr;
+  size_t len = 0;
+  int    ret = store->get(t.pool->pool, key, b, len);
+  if (ret == S_OK) {
+    /* the caller's buffer is sized for the configured value length */
+    if (len <= value_capacity)
+      memcpy(value, b, len);
+    else
+      ret = E_INSUFFICIENT_BUFFER;
+    store->free_memory(b);
+  }
+  return ret;
+}
+
+int KVStoreDB::do_put(Pool_state *p, const string &key, const string &value)
+{
+  std::unique_lock<std::mutex> g(p->lock, std::defer_lock);
+  if (serialize || p->index) g.lock();
+
+  int ret = store->put(p->pool, key, value.c_str(), value.length());
+  if (ret == S_OK && p->index) p->index->insert(key);
+  return ret;
+}
+
+int KVStoreDB::put(const string &table,
+                   const string &key,
+                   const string &value,
+                   bool          direct)
+{
+  auto &           t = thread_state();
+  Latency_interval li(t.latency[OP_PUT]);
+  return do_put(t.pool, key, value);
+}
+
+int KVStoreDB::update(const string &table,
+                      const string &key,
+                      const string &value,
+                      bool          direct)
+{
+  auto &           t = thread_state();
+  Latency_interval li(t.latency[OP_UPDATE]);
+  return do_put(t.pool, key, value);
+}
+
+int KVStoreDB::erase(const string &table, const string &key)
+{
+  auto &           t = thread_state();
+  Latency_interval li(t.latency[OP_ERASE]);
+  std::unique_lock<std::mutex> g(t.pool->lock, std::defer_lock);
+  if (serialize || t.pool->index) g.lock();
+
+  int ret = store->erase(t.pool->pool, key);
+  if (ret == S_OK && t.pool->index) t.pool->index->erase(key);
+  return ret;
+}
+
+int KVStoreDB::scan(const string &                table,
+                    const string &                key,
+                    int                           count,
+                    vector<pair<string, string>> &results)
+{
+  auto &t = thread_state();
+  if (!t.pool->index) return E_NOT_SUPPORTED;
+
+  Latency_interval li(t.latency[OP_SCAN]);
+
+  vector<string> keys;
+  {
+    std::lock_guard<std::mutex> g(t.pool->lock);
+    int ret = t.pool->index->scan(key, [&keys, count](const string &k) {
+      keys.push_back(k);
+      return keys.size() < size_t(count);
+    });
+    if (ret != S_OK) return ret;
+  }
+
+  std::unique_lock<std::mutex> g(t.pool->lock, std::defer_lock);
+  if (serialize) g.lock();
+  for (auto &k : keys) {
+    void * b   = nullptr;
+    size_t len = 0;
+    /* a key erased since the index walk is skipped */
+    if (store->get(t.pool->pool, k, b, len) != S_OK) continue;
+    results.emplace_back(k, string(static_cast<char *>(b), len));
+    store->free_memory(b);
+  }
+  return S_OK;
+}
+
+void KVStoreDB::clean()
+{
+  if (!store) return;
+
+  /* merge per-thread histograms */
+  HdrHistogram total[OP_COUNT];
+  for (auto &t : threads)
+    for (int op = 0; op < OP_COUNT; op++) total[op].add(t->latency[op]);
+
+  for (int op = 0; op < OP_COUNT; op++) {
+    if (total[op].count() == 0) continue;
+    cout << "[" << op_names[op] << "], Operations, " << total[op].count()
+         << endl;
+    cout << "[" << op_names[op] << "], 50thPercentileLatency(us), "
+         << total[op].percentile(50.0) / 1000.0 << endl;
+    cout << "[" << op_names[op] << "], 99thPercentileLatency(us), "
+         << total[op].percentile(99.0) / 1000.0 << endl;
+    cout << "[" << op_names[op] << "], 99.9thPercentileLatency(us), "
+         << total[op].percentile(99.9) / 1000.0 << endl;
+    cout << "[" << op_names[op] << "], MaxLatency(us), "
+         << total[op].max() / 1000.0 << endl;
+  }
+
+  for (auto &p : pools) {
+    if (p->index) p->index->release_ref();
+    store->close_pool(p->pool);
+  }
+  pools.clear();
+  threads.clear();
+  shared_pool = nullptr;
+
+  if (index_factory) index_factory->release_ref();
+  index_factory = nullptr;
+
+  store->release_ref();
+  store = nullptr;
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright [2017-2019] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#ifndef __YCSB_KVSTOREDB_H__
+#define __YCSB_KVSTOREDB_H__
+
+#include <api/kvindex_itf.h>
+#include <api/kvstore_itf.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <common/hdr_histogram.h>
+#include "db.h"
+#include "properties.h"
+
+using namespace ycsbutils;
+
+namespace ycsb
+{
+/**
+ * DB backed by an IKVStore component loaded in-process (hstore,
+ * mapstore, filestore, nvmestore, pmstore). Properties:
+ *
+ *   component   store to load (default mapstore)
+ *   path        pool directory (default ./data/)
+ *   poolsize    pool size in GB (default 1)
+ *   poolmode    'thread' for a pool per thread, 'shared' for one pool
+ *   index       'rbtree' to maintain a volatile key index; needed for scan
+ *   dax         dax device for hstore, e.g. /dev/dax0.0
+ *   dax_addr    address at which hstore maps the dax device, e.g. 0x7000000000
+ *   pci         PCI address for nvmestore
+ *
+ * get() fails with E_INSUFFICIENT_BUFFER for a stored value longer than
+ * the workload's value buffer (valuebyte).
+ *
+ * Per-operation latencies are recorded per thread and reported by
+ * clean().
+ */
+class KVStoreDB : public DB {
+  public:
+   KVStoreDB(Properties &props, unsigned core = 0);
+   virtual ~KVStoreDB();
+   virtual int  get(const string &table,
+                    const string &key,
+                    char *        value,
+                    bool          direct = false) override;
+   virtual int  put(const string &table,
+                    const string &key,
+                    const string &value,
+                    bool          direct = false) override;
+   virtual int  update(const string &table,
+                       const string &key,
+                       const string &value,
+                       bool          direct = false) override;
+   virtual int  erase(const string &table, const string &key) override;
+   virtual int  scan(const string &                table,
+                     const string &                key,
+                     int                           count,
+                     vector<pair<string, string>> &results) override;
+   virtual void init(Properties &props, unsigned core = 0) override;
+   virtual void thread_init(int thread_id) override;
+   virtual void clean() override;
+
+  private:
+   enum { OP_GET, OP_PUT, OP_UPDATE, OP_ERASE, OP_SCAN, OP_COUNT };
+
+   struct Pool_state {
+     Component::IKVStore::pool_t pool  = Component::IKVStore::POOL_ERROR;
+     Component::IKVIndex *       index = nullptr;
+     string                      name;
+     std::mutex                  lock; /* index, and store if not thread safe */
+   };
+
+   struct Thread_state {
+     Pool_state * pool = nullptr;
+     HdrHistogram latency[OP_COUNT];
+   };
+
+   Thread_state &thread_state(int thread_id = -1);
+   Pool_state *  open_pool(const string &name);
+   int           do_put(Pool_state *p, const string &key, const string &value);
+
+   Component::IKVStore *                      store = nullptr;
+   Component::IKVIndex_factory *              index_factory = nullptr;
+   string                                     path;
+   size_t                                     poolsize = 0;
+   size_t                                     value_capacity = 0; /* caller's get buffer */
+   unsigned                                   core     = 0;
+   uint64_t                                   id       = 0;
+   bool                                       shared   = false;
+   bool                                       serialize = false;
+   std::mutex                                 lock;
+   Pool_state *                               shared_pool = nullptr;
+   vector<std::unique_ptr<Pool_state>>        pools;
+   vector<std::unique_ptr<Thread_state>>      threads;
+};
+
+}  // namespace ycsb
+
+#endif
@@ -21,6 +21,8 @@
 #include <random>
 #include <string>
 #include <mutex>
+#include <thread>
+#include <unistd.h>
 
 using namespace std;
 
@@ -123,10 +125,20 @@ inline uint64_t FNVHash64(uint64_t val)
 
 inline uint64_t Hash(uint64_t val) { return FNVHash64(val); }
 
+const uint64_t kRandomSeedBase = 0x5EEDB45E;
+
+inline uint64_t RandomSeed()
+{
+  /* distinct per process (MPI rank) and per thread */
+  return Hash(kRandomSeedBase ^ (uint64_t(::getpid()) << 32)) ^
+         Hash(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
 inline double RandomDouble(double min = 0.0, double max = 1.0)
 {
-  static std::default_random_engine             generator;
-  static std::uniform_real_distribution<double> uniform(min, max);
+  /* per-thread engine: generators may be driven from several threads */
+  static thread_local std::default_random_engine generator(RandomSeed());
+  std::uniform_real_distribution<double>         uniform(min, max);
   return uniform(generator);
 }
 
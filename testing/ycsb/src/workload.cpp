@@ -25,6 +25,7 @@
 #include "db_fact.h"
 #include "generator.h"
 #include "properties.h"
+#include "skewed_latest_generator.h"
 #include "uniform_generator.h"
 #include "zipfian_generator.h"
 
@@ -51,6 +52,8 @@ void Workload::initialize()
   int core;
   MPI_Comm_rank(MPI_COMM_WORLD, &core);
 
+  db->thread_init(id);
+
   string TABLE = "table" + to_string(core);
   records      = stoi(props.getProperty("recordcount"));
   records /= n;
@@ -70,18 +73,32 @@ void Workload::initialize()
   double updateproportion = stod(props.getProperty("updateproportion", "0"));
   double scanproportion   = stod(props.getProperty("scanproportion", "0"));
   double insertproportion = stod(props.getProperty("insertproportion", "0"));
+  double rmwproportion =
+      stod(props.getProperty("readmodifywriteproportion", "0"));
   if (readproportion > 0) op.AddValue(READ, readproportion);
   if (updateproportion > 0) op.AddValue(UPDATE, updateproportion);
   if (scanproportion > 0) op.AddValue(SCAN, scanproportion);
   if (insertproportion > 0) op.AddValue(INSERT, insertproportion);
+  if (rmwproportion > 0) op.AddValue(READMODIFYWRITE, rmwproportion);
+
+  valuebyte = atoll(props.getProperty("valuebyte", to_string(SIZE)).c_str());
+  value_buffer.resize(std::max<uint64_t>(valuebyte, SIZE));
 
+  /* keys inserted during run follow the loaded ones */
+  inserted = new CounterGenerator(records);
+  gen      = nullptr;
   if (props.getProperty("requestdistribution") == "uniform") {
     gen = new UniformGenerator(0, records - 1);
   }
   else if (props.getProperty("requestdistribution") == "zipfian") {
     gen = new ZipfianGenerator(records);
   }
+  else if (props.getProperty("requestdistribution") == "latest") {
+    gen = new SkewedLatestGenerator(*inserted);
+  }
   assert(gen);
+  scanlen = new UniformGenerator(
+      1, stoi(props.getProperty("maxscanlength", "100")));
   rd.reset();
   wr.reset();
   up.reset();
@@ -111,7 +128,7 @@ void Workload::load(double sec)
   up.reset();
   vector<double> latencies;
 
-  Generator<uint64_t>* loadkeygen = new CounterGenerator(0 + id * records + 1);
+  Generator<uint64_t>* loadkeygen = new CounterGenerator(0);
   MPI_Barrier(MPI_COMM_WORLD);
 
   rd.start();
@@ -119,8 +136,8 @@ void Workload::load(double sec)
     up.start();
     //pair<string, string>& kv = kvs[i];
     // cout << "insert" << endl;
-string key=Workload::buildKeyName(loadkeygen->Next());
-string value=Workload::buildValue(atoll(props.getProperty("valuebyte").c_str()));
+string key=Workload::buildKeyName(keyNumber(loadkeygen->Next()));
+string value=Workload::buildValue(valuebyte);
     wr.start();
 //    ret = db->put(Workload::TABLE, kv.first, kv.second);
     ret = db->put(Workload::TABLE, key, value);
@@ -174,21 +191,28 @@ void Workload::run()
       case SCAN:
         doScan();
         break;
+      case READMODIFYWRITE:
+        doReadModifyWrite();
+        break;
     }
   }
 }
 
-void Workload::doRead()
+/* index of an existing key, chosen by the request distribution */
+uint64_t Workload::nextKeyIndex()
 {
-  int index = gen->Next();
-  if (index > records - 1) {
+  uint64_t index = gen->Next();
+  if (index >= inserted->Last() + 1) {
     throw "Key index overflow!";
-    exit(-1);
   }
-  string& key = kvs[index].first;
-  char    value[Workload::SIZE];
+  return index;
+}
+
+void Workload::doRead()
+{
+  string key = buildKeyName(keyNumber(nextKeyIndex()));
   rd.start();
-  int ret = db->get(Workload::TABLE, key, value);
+  int ret = db->get(Workload::TABLE, key, value_buffer.data());
   if (ret != 0) {
     throw "Read fail!";
     exit(-1);
@@ -202,13 +226,8 @@ void Workload::doRead()
 void Workload::doUpdate()
 {
   // cout << "update" << endl;
-  int index = gen->Next();
-  if (index > records - 1) {
-    throw "Key index overflow!";
-    exit(-1);
-  }
-  string& key   = kvs[index].first;
-  string  value = buildValue(Workload::SIZE);
+  string key   = buildKeyName(keyNumber(nextKeyIndex()));
+  string value = buildValue(valuebyte);
   up.start();
   int ret = db->update(Workload::TABLE, key, value.c_str());
   if (ret != 0) {
@@ -221,8 +240,45 @@ void Workload::doUpdate()
   if (elapse * 1000000 >= 900) up_stat.add_value(elapse);
 }
 
-void Workload::doInsert() {}
-void Workload::doScan() {}
+void Workload::doInsert()
+{
+  string key   = buildKeyName(keyNumber(inserted->Next()));
+  string value = buildValue(valuebyte);
+  up.start();
+  int ret = db->put(Workload::TABLE, key, value);
+  if (ret != 0) {
+    throw "Insert fail!";
+  }
+  up.stop();
+  up_cnt++;
+}
+
+void Workload::doScan()
+{
+  string                       key = buildKeyName(keyNumber(nextKeyIndex()));
+  vector<pair<string, string>> results;
+  rd.start();
+  int ret = db->scan(Workload::TABLE, key, scanlen->Next(), results);
+  if (ret != 0) {
+    throw "Scan fail!";
+  }
+  rd.stop();
+  rd_cnt++;
+}
+
+void Workload::doReadModifyWrite()
+{
+  string key   = buildKeyName(keyNumber(nextKeyIndex()));
+  string value = buildValue(valuebyte);
+  up.start();
+  int ret = db->get(Workload::TABLE, key, value_buffer.data());
+  if (ret == 0) ret = db->update(Workload::TABLE, key, value);
+  if (ret != 0) {
+    throw "Read-modify-write fail!";
+  }
+  up.stop();
+  up_cnt++;
+}
 
 void Workload::cleanup()
 {
@@ -308,6 +364,15 @@ Workload::~Workload()
   cleanup();
   kvs.clear();
   delete gen;
+  delete scanlen;
+  delete inserted;
+}
+
+/* threads interleave over the key space so that inserted keys never
+   collide with another thread's */
+inline uint64_t Workload::keyNumber(uint64_t index)
+{
+  return index * n + id + 1;
 }
 
 inline string Workload::buildKeyName(uint64_t key_num)
@@ -19,6 +19,7 @@
 #include "../../kvstore/statistics.h"
 #include "../../kvstore/stopwatch.h"
 #include "db.h"
+#include "counter_generator.h"
 #include "discrete_generator.h"
 #include "generator.h"
 #include "properties.h"
@@ -48,6 +49,8 @@ class Workload {
   vector<pair<string, string>>        kvs;
   ycsbc::DiscreteGenerator<Operation> op;
   ycsbc::Generator<uint64_t>*         gen;
+  ycsbc::Generator<uint64_t>*         scanlen;
+  ycsbc::CounterGenerator*            inserted;
   static std::mutex                   _iops_lock;
   static unsigned long                _iops;
   static std::mutex                   _iops_load_lock;
@@ -66,12 +69,17 @@ class Workload {
 
   int           records;
   int           operations;
+  uint64_t      valuebyte;
+  vector<char>  value_buffer;
+  inline uint64_t keyNumber(uint64_t index);
   inline string buildKeyName(uint64_t key_num);
   inline string buildValue(uint64_t size);
+  uint64_t      nextKeyIndex();
   void          doRead();
   void          doInsert();
   void          doUpdate();
   void          doScan();
+  void          doReadModifyWrite();
   bool          isready = false;
 };
 